@@ -0,0 +1,410 @@
+#pragma once
+
+/* A small benchmark harness with the interface and the output format of
+ * Google Benchmark (https://github.com/google/benchmark), so that benchmarks
+ * can be written in the usual style
+ *
+ *     static void BM_Foo(benchmark::State& state) {
+ *         setup(state.range(0));
+ *         for (auto _ : state)
+ *             benchmark::DoNotOptimize(foo());
+ *         state.SetItemsProcessed(state.iterations() * n);
+ *     }
+ *     BENCHMARK(BM_Foo)->Arg(16)->Arg(64);
+ *
+ * and their results can be processed with the Google Benchmark tools (e.g.
+ * `compare.py`). The number of iterations is chosen such that each run takes
+ * at least `--benchmark_min_time` seconds. Supported options are
+ * `--benchmark_filter=<regex>`, `--benchmark_min_time=<seconds>`,
+ * `--benchmark_repetitions=<n>`, `--benchmark_format=<console|json>`,
+ * `--benchmark_out=<file>` and `--benchmark_list_tests`.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace benchmark {
+
+enum TimeUnit { kNanosecond, kMicrosecond, kMillisecond, kSecond };
+
+inline const char* unit_name(TimeUnit unit) {
+    switch(unit) {
+        case kNanosecond: return "ns";
+        case kMicrosecond: return "us";
+        case kMillisecond: return "ms";
+        default: return "s";
+    }
+}
+
+inline double unit_per_second(TimeUnit unit) {
+    switch(unit) {
+        case kNanosecond: return 1e9;
+        case kMicrosecond: return 1e6;
+        case kMillisecond: return 1e3;
+        default: return 1.;
+    }
+}
+
+template<class T>
+inline void DoNotOptimize(T const& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void ClobberMemory() {
+    asm volatile("" : : : "memory");
+}
+
+class State {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        State(int64_t max_iterations, const std::vector<int64_t>& args) : max_iterations(max_iterations), args(args) {}
+
+        int64_t range(int i = 0) const { return args.at(i); }
+        int64_t iterations() const { return max_iterations; }
+        void SetItemsProcessed(int64_t n) { items_processed = n; }
+        void SetBytesProcessed(int64_t n) { bytes_processed = n; }
+        void SetLabel(const std::string& l) { label = l; }
+        void SkipWithError(const std::string& msg) { error = msg; }
+
+        void PauseTiming() {
+            real_elapsed += clock::now() - real_start;
+            cpu_elapsed += std::clock() - cpu_start;
+        }
+
+        void ResumeTiming() {
+            real_start = clock::now();
+            cpu_start = std::clock();
+        }
+
+        // Marked unused so that `for (auto _ : state)` does not cause warnings.
+        struct __attribute__((unused)) Value {};
+
+        struct Iterator {
+            State* state;
+            int64_t remaining;
+            bool operator!=(const Iterator&) {
+                if(remaining > 0 && state->error.empty())
+                    return true;
+                state->PauseTiming();
+                return false;
+            }
+            void operator++() { --remaining; }
+            Value operator*() const { return Value(); }
+        };
+
+        Iterator begin() {
+            ResumeTiming();
+            return Iterator{this, max_iterations};
+        }
+
+        Iterator end() { return Iterator{this, 0}; }
+
+        double real_time() const { return std::chrono::duration<double>(real_elapsed).count(); }
+        double cpu_time() const { return double(cpu_elapsed)/CLOCKS_PER_SEC; }
+
+        std::map<std::string, double> counters;
+        int64_t items_processed = 0, bytes_processed = 0;
+        std::string label, error;
+
+    private:
+        int64_t max_iterations;
+        std::vector<int64_t> args;
+        clock::time_point real_start;
+        clock::duration real_elapsed = clock::duration::zero();
+        std::clock_t cpu_start = 0, cpu_elapsed = 0;
+};
+
+class Benchmark {
+    public:
+        Benchmark(const std::string& name, std::function<void(State&)> fn) : name(name), fn(fn) {}
+
+        Benchmark* Arg(int64_t a) { args.push_back({a}); return this; }
+        Benchmark* Args(const std::vector<int64_t>& a) { args.push_back(a); return this; }
+        Benchmark* Unit(TimeUnit u) { unit = u; return this; }
+        Benchmark* Iterations(int64_t n) { fixed_iterations = n; return this; }
+
+        std::string name;
+        std::function<void(State&)> fn;
+        std::vector<std::vector<int64_t>> args;
+        TimeUnit unit = kNanosecond;
+        int64_t fixed_iterations = 0;
+};
+
+struct Options {
+    std::string filter = ".";
+    double min_time = 0.5;
+    int repetitions = 1;
+    std::string format = "console";
+    std::string out;
+    bool list_tests = false;
+    std::string executable;
+};
+
+inline std::vector<std::unique_ptr<Benchmark>>& registry() {
+    static std::vector<std::unique_ptr<Benchmark>> benchmarks;
+    return benchmarks;
+}
+
+inline Options& options() {
+    static Options opts;
+    return opts;
+}
+
+inline Benchmark* RegisterBenchmark(const std::string& name, std::function<void(State&)> fn) {
+    registry().emplace_back(new Benchmark(name, fn));
+    return registry().back().get();
+}
+
+// Parses and removes the options of the harness from argv, the remaining
+// arguments are left for the caller.
+inline void Initialize(int* argc, char** argv) {
+    Options& opts = options();
+    opts.executable = argv[0];
+    int kept = 1;
+    for (int i = 1; i < *argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](const std::string& key, std::string& res) {
+            std::string prefix = "--" + key + "=";
+            if(arg.compare(0, prefix.size(), prefix) != 0)
+                return false;
+            res = arg.substr(prefix.size());
+            return true;
+        };
+        std::string v;
+        if(value("benchmark_filter", v)) opts.filter = v;
+        else if(value("benchmark_min_time", v)) opts.min_time = std::stod(v);
+        else if(value("benchmark_repetitions", v)) opts.repetitions = std::max(1, std::stoi(v));
+        else if(value("benchmark_format", v)) opts.format = v;
+        else if(value("benchmark_out", v)) opts.out = v;
+        else if(arg == "--benchmark_list_tests" || arg == "--benchmark_list_tests=true") opts.list_tests = true;
+        else argv[kept++] = argv[i];
+    }
+    *argc = kept;
+}
+
+struct Run {
+    std::string name, run_name, aggregate_name, label, error;
+    int repetition_index = 0;
+    int64_t iterations = 0;
+    double real_time = 0, cpu_time = 0;
+    TimeUnit unit = kNanosecond;
+    std::map<std::string, double> counters;
+};
+
+inline std::string json_escape(const std::string& s) {
+    std::string res;
+    for (char c : s) {
+        if(c == '"' || c == '\\')
+            res += '\\';
+        res += c;
+    }
+    return res;
+}
+
+inline Run run_once(Benchmark& b, const std::vector<int64_t>& args, int64_t iterations) {
+    State state(iterations, args);
+    b.fn(state);
+    Run run;
+    run.iterations = iterations;
+    double scale = unit_per_second(b.unit)/iterations;
+    run.real_time = state.real_time()*scale;
+    run.cpu_time = state.cpu_time()*scale;
+    run.unit = b.unit;
+    run.label = state.label;
+    run.error = state.error;
+    run.counters = state.counters;
+    if(state.items_processed > 0 && state.real_time() > 0)
+        run.counters["items_per_second"] = state.items_processed/state.real_time();
+    if(state.bytes_processed > 0 && state.real_time() > 0)
+        run.counters["bytes_per_second"] = state.bytes_processed/state.real_time();
+    return run;
+}
+
+// Runs one benchmark with one set of arguments, choosing the number of
+// iterations such that a run takes at least min_time.
+inline std::vector<Run> run_benchmark(Benchmark& b, const std::vector<int64_t>& args, const std::string& name) {
+    const Options& opts = options();
+    int64_t iterations = b.fixed_iterations > 0 ? b.fixed_iterations : 1;
+    Run run;
+    while(true) {
+        State state(iterations, args);
+        b.fn(state);
+        double t = state.real_time();
+        if(b.fixed_iterations > 0 || t >= opts.min_time || iterations >= 1000000000 || !state.error.empty())
+            break;
+        double multiplier = t > 0 ? 1.4*opts.min_time/t : 10.;
+        iterations = std::min<int64_t>(1000000000, std::max<int64_t>(iterations + 1, int64_t(iterations*std::min(multiplier, 10.))));
+    }
+    std::vector<Run> runs;
+    for (int r = 0; r < opts.repetitions; ++r) {
+        Run run = run_once(b, args, iterations);
+        run.name = name;
+        run.run_name = name;
+        run.repetition_index = r;
+        runs.push_back(run);
+    }
+    if(opts.repetitions > 1) {
+        std::vector<Run> aggregates;
+        for (std::string agg : {"mean", "median", "stddev"}) {
+            Run a = runs[0];
+            a.name = name + "_" + agg;
+            a.aggregate_name = agg;
+            auto stat = [&](std::function<double(const Run&)> get) {
+                std::vector<double> vals;
+                for (auto& run : runs)
+                    vals.push_back(get(run));
+                double mean = std::accumulate(vals.begin(), vals.end(), 0.)/vals.size();
+                if(agg == "mean")
+                    return mean;
+                if(agg == "median") {
+                    std::sort(vals.begin(), vals.end());
+                    size_t n = vals.size();
+                    return n % 2 ? vals[n/2] : 0.5*(vals[n/2 - 1] + vals[n/2]);
+                }
+                double var = 0.;
+                for (double v : vals)
+                    var += (v - mean)*(v - mean);
+                return std::sqrt(var/(vals.size() - 1));
+            };
+            a.real_time = stat([](const Run& r) { return r.real_time; });
+            a.cpu_time = stat([](const Run& r) { return r.cpu_time; });
+            for (auto& kv : a.counters) {
+                std::string key = kv.first;
+                kv.second = stat([&](const Run& r) { return r.counters.at(key); });
+            }
+            aggregates.push_back(a);
+        }
+        runs.insert(runs.end(), aggregates.begin(), aggregates.end());
+    }
+    return runs;
+}
+
+inline void write_json(std::ostream& os, const std::vector<Run>& runs, const std::map<std::string, std::string>& context) {
+    const Options& opts = options();
+    char host[256] = "";
+    gethostname(host, sizeof(host) - 1);
+    std::time_t now = std::time(nullptr);
+    char date[64];
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+    os << "{\n  \"context\": {\n";
+    os << "    \"date\": \"" << date << "\",\n";
+    os << "    \"host_name\": \"" << json_escape(host) << "\",\n";
+    os << "    \"executable\": \"" << json_escape(opts.executable) << "\",\n";
+    os << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+    os << "    \"library_build_type\": \"release\"";
+#else
+    os << "    \"library_build_type\": \"debug\"";
+#endif
+    for (auto& kv : context)
+        os << ",\n    \"" << json_escape(kv.first) << "\": \"" << json_escape(kv.second) << "\"";
+    os << "\n  },\n  \"benchmarks\": [";
+    os.precision(12);
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const Run& r = runs[i];
+        os << (i ? "," : "") << "\n    {\n";
+        os << "      \"name\": \"" << json_escape(r.name) << "\",\n";
+        os << "      \"run_name\": \"" << json_escape(r.run_name) << "\",\n";
+        os << "      \"run_type\": \"" << (r.aggregate_name.empty() ? "iteration" : "aggregate") << "\",\n";
+        os << "      \"repetitions\": " << opts.repetitions << ",\n";
+        os << "      \"repetition_index\": " << r.repetition_index << ",\n";
+        if(!r.aggregate_name.empty())
+            os << "      \"aggregate_name\": \"" << r.aggregate_name << "\",\n";
+        if(!r.error.empty()) {
+            os << "      \"error_occurred\": true,\n";
+            os << "      \"error_message\": \"" << json_escape(r.error) << "\",\n";
+        }
+        if(!r.label.empty())
+            os << "      \"label\": \"" << json_escape(r.label) << "\",\n";
+        os << "      \"threads\": 1,\n";
+        os << "      \"iterations\": " << r.iterations << ",\n";
+        os << "      \"real_time\": " << r.real_time << ",\n";
+        os << "      \"cpu_time\": " << r.cpu_time << ",\n";
+        os << "      \"time_unit\": \"" << unit_name(r.unit) << "\"";
+        for (auto& kv : r.counters)
+            os << ",\n      \"" << json_escape(kv.first) << "\": " << kv.second;
+        os << "\n    }";
+    }
+    os << "\n  ]\n}\n";
+}
+
+inline void write_console(std::ostream& os, const Run& r) {
+    char line[512];
+    std::snprintf(line, sizeof(line), "%-60s %12.4g %-2s %12.4g %-2s %12lld", r.name.c_str(),
+            r.real_time, unit_name(r.unit), r.cpu_time, unit_name(r.unit), (long long)r.iterations);
+    os << line;
+    for (auto& kv : r.counters) {
+        std::snprintf(line, sizeof(line), " %s=%.4g", kv.first.c_str(), kv.second);
+        os << line;
+    }
+    if(!r.label.empty())
+        os << " " << r.label;
+    if(!r.error.empty())
+        os << " ERROR: " << r.error;
+    os << std::endl;
+}
+
+// Runs all benchmarks matching the filter. `context` is added to the context
+// section of the JSON output.
+inline int RunSpecifiedBenchmarks(const std::map<std::string, std::string>& context = {}) {
+    const Options& opts = options();
+    std::regex filter(opts.filter);
+    std::vector<Run> runs;
+    bool console = opts.format != "json";
+    if(console && !opts.list_tests) {
+        char line[256];
+        std::snprintf(line, sizeof(line), "%-60s %15s %15s %12s", "Benchmark", "Time", "CPU", "Iterations");
+        std::cout << line << std::endl << std::string(105, '-') << std::endl;
+    }
+    for (auto& b : registry()) {
+        auto arg_sets = b->args.empty() ? std::vector<std::vector<int64_t>>{{}} : b->args;
+        for (auto& args : arg_sets) {
+            std::string name = b->name;
+            for (auto a : args)
+                name += "/" + std::to_string(a);
+            if(!std::regex_search(name, filter))
+                continue;
+            if(opts.list_tests) {
+                std::cout << name << std::endl;
+                continue;
+            }
+            auto res = run_benchmark(*b, args, name);
+            if(console)
+                for (auto& r : res)
+                    write_console(std::cout, r);
+            runs.insert(runs.end(), res.begin(), res.end());
+        }
+    }
+    if(opts.list_tests)
+        return 0;
+    if(!console)
+        write_json(std::cout, runs, context);
+    if(!opts.out.empty()) {
+        std::ofstream out(opts.out);
+        write_json(out, runs, context);
+    }
+    return 0;
+}
+
+}
+
+#define BENCHMARK_CONCAT2(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT2(a, b)
+#define BENCHMARK(fn) static benchmark::Benchmark* BENCHMARK_CONCAT(benchmark_, __LINE__) = benchmark::RegisterBenchmark(#fn, fn)
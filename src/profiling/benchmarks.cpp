@@ -0,0 +1,512 @@
+#include "xtensor/xarray.hpp"
+#include "xtensor/xrandom.hpp"
+#include "xtensor/xlayout.hpp"
+#include "simdhelpers.h"
+#include "biot_savart_impl.h"
+#include "biot_savart_vjp_impl.h"
+#include "regular_grid_interpolant_3d.h"
+#include "magneticfield_biotsavart.h"
+#include "xtensor/xtensor.hpp"
+#include "threads.h"
+#include "taskgraph.h"
+#include "benchmark.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+
+using namespace std;
+typedef xt::xarray<double> Array;
+template<class Type, std::size_t rank, xt::layout_type layout>
+using DefaultTensor = xt::xtensor<Type, rank, layout, XTENSOR_DEFAULT_ALLOCATOR(double)>;
+
+#ifndef SIMSOPT_CONFIG_DIR
+#define SIMSOPT_CONFIG_DIR "src/simsopt/configs"
+#endif
+
+/* Benchmarks of the C++ kernels on the coil sets in src/simsopt/configs.
+ * Run e.g.
+ *
+ *     ./benchmarks --benchmark_format=json --benchmark_out=results.json
+ *
+ * to obtain the results in the JSON format of Google Benchmark. The location
+ * of the config files can be changed with `--config_dir=<dir>`. The kernels
+ * that are only instantiated for numpy arrays (curves, surfaces, tracing,
+ * permanent magnet algorithms) are benchmarked by benchmarks.py.
+ */
+
+// Counts the heap allocations, to check that the kernels don't allocate memory
+// in their inner loops.
+static std::atomic<int64_t> num_allocations(0);
+
+void* operator new(std::size_t size) {
+    num_allocations++;
+    if(void* p = std::malloc(size > 0 ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+// Reports the number of heap allocations per iteration since `start`.
+void report_allocations(benchmark::State& state, int64_t start) {
+    state.counters["allocs_per_iteration"] = double(num_allocations - start)/std::max<int64_t>(state.iterations(), 1);
+}
+
+struct CoilSet {
+    string name;
+    vector<Array> gammas, dgammas;
+    double major_radius;
+    int num_quad_points() const {
+        int n = 0;
+        for (auto& g : gammas)
+            n += g.shape(0);
+        return n;
+    }
+};
+
+// Reads the Fourier coefficients of the coils in the format of
+// CurveXYZFourier.load_curves_from_file, evaluates the curves on order*ppp
+// quadrature points and applies the rotational and stellarator symmetry.
+CoilSet load_coils(const string& config_dir, const string& name, const string& filename, int order, int ppp, int nfp) {
+    ifstream file(config_dir + "/" + filename);
+    if(!file)
+        throw std::runtime_error("Could not open " + config_dir + "/" + filename + ", use --config_dir to set the location of the config files.");
+    vector<vector<double>> data;
+    string line;
+    while(getline(file, line)) {
+        if(line.empty())
+            continue;
+        vector<double> row;
+        stringstream ss(line);
+        string val;
+        while(getline(ss, val, ','))
+            row.push_back(stod(val));
+        data.push_back(row);
+    }
+    int num_coils = data[0].size()/6;
+    order = std::min(order, int(data.size()) - 1);
+    int n = order*ppp;
+
+    CoilSet coils;
+    coils.name = name;
+    vector<Array> base_gammas, base_dgammas;
+    double radius = 0.;
+    for (int ic = 0; ic < num_coils; ++ic) {
+        Array gamma = xt::zeros<double>({n, 3});
+        Array dgamma = xt::zeros<double>({n, 3});
+        for (int k = 0; k < n; ++k) {
+            double t = 2*M_PI*double(k)/n;
+            for (int d = 0; d < 3; ++d) {
+                gamma(k, d) = data[0][6*ic + 2*d + 1];
+                for (int io = 1; io <= order; ++io) {
+                    double s = data[io][6*ic + 2*d], c = data[io][6*ic + 2*d + 1];
+                    gamma(k, d) += s*sin(io*t) + c*cos(io*t);
+                    dgamma(k, d) += 2*M_PI*io*(s*cos(io*t) - c*sin(io*t));
+                }
+            }
+            radius += sqrt(gamma(k, 0)*gamma(k, 0) + gamma(k, 1)*gamma(k, 1))/(n*num_coils);
+        }
+        base_gammas.push_back(gamma);
+        base_dgammas.push_back(dgamma);
+    }
+    coils.major_radius = radius;
+    for (int flip = 0; flip < 2; ++flip) {
+        for (int l = 0; l < nfp; ++l) {
+            double c = cos(2*M_PI*l/nfp), s = sin(2*M_PI*l/nfp);
+            double sign = flip ? -1. : 1.;
+            for (int ic = 0; ic < num_coils; ++ic) {
+                Array gamma = xt::zeros<double>({n, 3});
+                Array dgamma = xt::zeros<double>({n, 3});
+                for (int k = 0; k < n; ++k) {
+                    for (auto p : {make_pair(&base_gammas[ic], &gamma), make_pair(&base_dgammas[ic], &dgamma)}) {
+                        auto& in = *p.first;
+                        auto& out = *p.second;
+                        double x = in(k, 0), y = sign*in(k, 1), z = sign*in(k, 2);
+                        out(k, 0) = c*x - s*y;
+                        out(k, 1) = s*x + c*y;
+                        out(k, 2) = z;
+                    }
+                }
+                coils.gammas.push_back(gamma);
+                coils.dgammas.push_back(dgamma);
+            }
+        }
+    }
+    return coils;
+}
+
+// Points on a torus with minor radius 0.1 R0 inside the coils.
+Array torus_points(const CoilSet& coils, int n) {
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> dist(0., 2*M_PI);
+    double R0 = coils.major_radius, a = 0.1*R0;
+    Array points = xt::zeros<double>({n, 3});
+    for (int i = 0; i < n; ++i) {
+        double phi = dist(gen), theta = dist(gen);
+        double R = R0 + a*cos(theta);
+        points(i, 0) = R*cos(phi);
+        points(i, 1) = R*sin(phi);
+        points(i, 2) = a*sin(theta);
+    }
+    return points;
+}
+
+struct Targets {
+    AlignedPaddedVec x, y, z;
+    Targets(const Array& points) : x(points.shape(0), 0.), y(points.shape(0), 0.), z(points.shape(0), 0.) {
+        for (size_t i = 0; i < points.shape(0); ++i) {
+            x[i] = points(i, 0);
+            y[i] = points(i, 1);
+            z[i] = points(i, 2);
+        }
+    }
+};
+
+template<int derivs, bool vector_potential>
+void BM_BiotSavart(benchmark::State& state, CoilSet& coils) {
+    int n = state.range(0);
+    Targets t(torus_points(coils, n));
+    Array B = xt::zeros<double>({n, 3});
+    Array dB = xt::zeros<double>({n, 3, 3});
+    Array d2B = xt::zeros<double>({n, 3, 3, 3});
+    int64_t allocations = num_allocations;
+    for (auto _ : state) {
+        for (size_t i = 0; i < coils.gammas.size(); ++i) {
+            if(vector_potential)
+                biot_savart_kernel_A<Array, derivs>(t.x, t.y, t.z, coils.gammas[i], coils.dgammas[i], B, dB, d2B, nullptr);
+            else
+                biot_savart_kernel<Array, derivs>(t.x, t.y, t.z, coils.gammas[i], coils.dgammas[i], B, dB, d2B, nullptr);
+        }
+        benchmark::DoNotOptimize(B.data());
+    }
+    report_allocations(state, allocations);
+    state.SetItemsProcessed(state.iterations()*int64_t(n)*coils.num_quad_points());
+    state.counters["num_targets"] = n;
+    state.counters["num_sources"] = coils.num_quad_points();
+}
+
+// The field of all coils with given currents, summed inside the kernel.
+void BM_BiotSavartSum(benchmark::State& state, CoilSet& coils) {
+    int n = state.range(0);
+    Array points = torus_points(coils, n);
+    Array B = xt::zeros<double>({n, 3});
+    vector<double> currents(coils.gammas.size(), 1e5);
+    vector<vector<double>> quadweights;
+    int64_t allocations = num_allocations;
+    for (auto _ : state) {
+        biot_savart_kernel_B_sum<Array>(points, coils.gammas, coils.dgammas, currents, B, quadweights);
+        benchmark::DoNotOptimize(B.data());
+    }
+    report_allocations(state, allocations);
+    state.SetItemsProcessed(state.iterations()*int64_t(n)*coils.num_quad_points());
+    state.counters["num_targets"] = n;
+    state.counters["num_sources"] = coils.num_quad_points();
+}
+
+template<int derivs, bool vector_potential>
+void BM_BiotSavartVJP(benchmark::State& state, CoilSet& coils) {
+    int n = state.range(0);
+    Targets t(torus_points(coils, n));
+    Array v = xt::random::randn<double>({n, 3});
+    Array vgrad = xt::random::randn<double>({n, 3, 3});
+    vector<Array> res_gamma, res_dgamma, res_grad_gamma, res_grad_dgamma;
+    for (auto& g : coils.gammas) {
+        res_gamma.push_back(xt::zeros<double>({int(g.shape(0)), 3}));
+        res_dgamma.push_back(xt::zeros<double>({int(g.shape(0)), 3}));
+        res_grad_gamma.push_back(xt::zeros<double>({int(g.shape(0)), 3}));
+        res_grad_dgamma.push_back(xt::zeros<double>({int(g.shape(0)), 3}));
+    }
+    int64_t allocations = num_allocations;
+    for (auto _ : state) {
+        for (size_t i = 0; i < coils.gammas.size(); ++i) {
+            if(vector_potential)
+                biot_savart_vector_potential_vjp_kernel<Array, derivs>(t.x, t.y, t.z, coils.gammas[i], coils.dgammas[i],
+                        v, res_gamma[i], res_dgamma[i], vgrad, res_grad_gamma[i], res_grad_dgamma[i]);
+            else
+                biot_savart_vjp_kernel<Array, derivs>(t.x, t.y, t.z, coils.gammas[i], coils.dgammas[i],
+                        v, res_gamma[i], res_dgamma[i], vgrad, res_grad_gamma[i], res_grad_dgamma[i]);
+        }
+        benchmark::DoNotOptimize(res_gamma[0].data());
+    }
+    report_allocations(state, allocations);
+    state.SetItemsProcessed(state.iterations()*int64_t(n)*coils.num_quad_points());
+    state.counters["num_targets"] = n;
+    state.counters["num_sources"] = coils.num_quad_points();
+}
+
+// A curve with fixed gamma and gammadash, since the curve classes are only
+// instantiated for numpy arrays.
+class FixedCurve : public Curve<Array> {
+    public:
+        Array fixed_gamma, fixed_gammadash;
+        FixedCurve(const Array& gamma, const Array& gammadash) :
+            Curve<Array>(int(gamma.shape(0))), fixed_gamma(gamma), fixed_gammadash(gammadash) {}
+        int num_dofs() override { return 0; }
+        void set_dofs_impl(const vector<double>& dofs) override {}
+        vector<double> get_dofs() override { return {}; }
+        void gamma_impl(Array& data, Array& quadpoints) override { data = fixed_gamma; }
+        void gammadash_impl(Array& data) override { data = fixed_gammadash; }
+};
+
+// A full evaluation of the BiotSavart class, including the cache lookups, the
+// sum over the coils and the bookkeeping around the kernels. The first
+// evaluation allocates the caches, every later one should not allocate.
+template<int derivs>
+void BM_BiotSavartCompute(benchmark::State& state, CoilSet& coils) {
+    int n = state.range(0);
+    vector<shared_ptr<Coil<Array>>> bs_coils;
+    for (size_t i = 0; i < coils.gammas.size(); ++i) {
+        auto curve = std::make_shared<FixedCurve>(coils.gammas[i], coils.dgammas[i]);
+        bs_coils.push_back(std::make_shared<Coil<Array>>(curve, std::make_shared<Current<Array>>(1e5)));
+    }
+    auto bs = std::make_shared<BiotSavart<DefaultTensor, Array>>(bs_coils);
+    DefaultTensor<double, 2, xt::layout_type::row_major> points = torus_points(coils, n);
+    bs->set_points_cart(points);
+    bs->compute(derivs);
+    int64_t allocations = num_allocations;
+    for (auto _ : state) {
+        bs->invalidate_cache();
+        bs->compute(derivs);
+        benchmark::ClobberMemory();
+    }
+    report_allocations(state, allocations);
+    state.SetItemsProcessed(state.iterations()*int64_t(n)*coils.num_quad_points());
+    state.counters["num_targets"] = n;
+    state.counters["num_sources"] = coils.num_quad_points();
+}
+
+// Many small kernels, as for the terms of an objective: the field of each coil
+// at the quadrature points of the next one. Either one after another, each with
+// its own parallel region, or concurrently as the tasks of a TaskGraph.
+template<bool concurrent>
+void BM_SmallKernels(benchmark::State& state, CoilSet& coils) {
+    int ncoils = coils.gammas.size();
+    vector<std::unique_ptr<Targets>> targets;
+    vector<Array> B, dummy;
+    for (int i = 0; i < ncoils; ++i) {
+        targets.emplace_back(new Targets(coils.gammas[(i+1) % ncoils]));
+        B.push_back(xt::zeros<double>({int(coils.gammas[(i+1) % ncoils].shape(0)), 3}));
+    }
+    dummy.push_back(xt::zeros<double>({1, 1, 1}));
+    dummy.push_back(xt::zeros<double>({1, 1, 1, 1}));
+    auto kernel = [&](int i) {
+        biot_savart_kernel<Array, 0>(targets[i]->x, targets[i]->y, targets[i]->z, coils.gammas[i], coils.dgammas[i], B[i], dummy[0], dummy[1], nullptr);
+    };
+    TaskGraph graph;
+    for (int i = 0; i < ncoils; ++i)
+        graph.add_task([&kernel, i]() { kernel(i); }, {});
+    for (auto _ : state) {
+        if(concurrent) {
+            graph.run();
+        } else {
+            for (int i = 0; i < ncoils; ++i)
+                kernel(i);
+        }
+        benchmark::DoNotOptimize(B[0].data());
+    }
+    int64_t pairs = 0;
+    for (int i = 0; i < ncoils; ++i)
+        pairs += int64_t(coils.gammas[(i+1) % ncoils].shape(0))*coils.gammas[i].shape(0);
+    state.SetItemsProcessed(state.iterations()*pairs);
+    state.counters["num_tasks"] = ncoils;
+    state.counters["num_threads"] = threads::get_num_threads();
+}
+
+// The field of the coils (with unit currents) as a function of cylindrical
+// coordinates, as used to build an InterpolatedField.
+std::function<Vec(Vec, Vec, Vec)> coil_field(CoilSet& coils) {
+    return [&coils](Vec rs, Vec phis, Vec zs) {
+        int n = rs.size();
+        Targets t(xt::zeros<double>({n, 3}));
+        for (int i = 0; i < n; ++i) {
+            t.x[i] = rs[i]*cos(phis[i]);
+            t.y[i] = rs[i]*sin(phis[i]);
+            t.z[i] = zs[i];
+        }
+        Array B = xt::zeros<double>({n, 3});
+        Array dB, d2B;
+        for (size_t i = 0; i < coils.gammas.size(); ++i)
+            biot_savart_kernel<Array, 0>(t.x, t.y, t.z, coils.gammas[i], coils.dgammas[i], B, dB, d2B, nullptr);
+        return Vec(B.begin(), B.end());
+    };
+}
+
+InterpolationRule interpolation_rule(bool chebyshev, int degree) {
+    if(chebyshev)
+        return ChebyshevInterpolationRule(degree);
+    return UniformInterpolationRule(degree);
+}
+
+RegularGridInterpolant3D<Array> coil_field_interpolant(CoilSet& coils, bool chebyshev, int degree, int cells) {
+    double R0 = coils.major_radius, a = 0.1*R0;
+    return RegularGridInterpolant3D<Array>(interpolation_rule(chebyshev, degree),
+            {R0 - a, R0 + a, cells}, {0., 2*M_PI, 4*cells}, {-a, a, cells}, 3, false);
+}
+
+template<bool chebyshev>
+void BM_InterpolantBuild(benchmark::State& state, CoilSet& coils) {
+    int degree = state.range(0), cells = state.range(1);
+    auto f = coil_field(coils);
+    for (auto _ : state) {
+        auto interpolant = coil_field_interpolant(coils, chebyshev, degree, cells);
+        interpolant.interpolate_batch(f);
+        benchmark::ClobberMemory();
+    }
+    int64_t dofs = int64_t(degree*cells + 1)*(4*degree*cells + 1)*(degree*cells + 1);
+    state.SetItemsProcessed(state.iterations()*dofs);
+    state.counters["num_dofs"] = dofs;
+}
+
+template<bool chebyshev>
+void BM_InterpolantEvaluate(benchmark::State& state, CoilSet& coils) {
+    int degree = state.range(0), cells = state.range(1);
+    int n = 100000;
+    auto f = coil_field(coils);
+    auto interpolant = coil_field_interpolant(coils, chebyshev, degree, cells);
+    interpolant.interpolate_batch(f);
+    double R0 = coils.major_radius, a = 0.1*R0;
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> dist(-1., 1.);
+    Array xyz = xt::zeros<double>({n, 3});
+    Array fxyz = xt::zeros<double>({n, 3});
+    for (int i = 0; i < n; ++i) {
+        xyz(i, 0) = R0 + 0.99*a*dist(gen);
+        xyz(i, 1) = M_PI*(1 + 0.99*dist(gen));
+        xyz(i, 2) = 0.99*a*dist(gen);
+    }
+    for (auto _ : state) {
+        interpolant.evaluate_batch(xyz, fxyz);
+        benchmark::DoNotOptimize(fxyz.data());
+    }
+    state.SetItemsProcessed(state.iterations()*n);
+}
+
+// Streams through a large array with the static OpenMP schedule of the
+// kernels, after the array was first touched either serially or by
+// threads::parallel_zero. On machines with several NUMA nodes the serially
+// initialized array lives on a single node, and the threads on the other
+// nodes access it through the interconnect.
+template<bool parallel_first_touch>
+void BM_FirstTouch(benchmark::State& state) {
+    int nrows = state.range(0), row_size = 3*1024;
+    std::unique_ptr<double[]> data(new double[std::size_t(nrows)*row_size]);
+    if(parallel_first_touch) {
+        threads::parallel_zero(data.get(), nrows, row_size);
+    } else {
+        for (std::size_t i = 0; i < std::size_t(nrows)*row_size; ++i)
+            data[i] = 0.;
+    }
+    for (auto _ : state) {
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < nrows; ++i) {
+            double* row = data.get() + std::size_t(i)*row_size;
+            for (int j = 0; j < row_size; ++j)
+                row[j] = 0.5*row[j] + 1.;
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations()*int64_t(nrows)*row_size*2*sizeof(double));
+    state.counters["num_threads"] = threads::get_num_threads();
+}
+
+// The sums of the flux objective over many points, with the usual OpenMP
+// reduction and in the deterministic mode, whose result doesn't depend on the
+// number of threads (see threads::parallel_sum).
+template<bool deterministic>
+void BM_ParallelSum(benchmark::State& state) {
+    int npoints = state.range(0);
+    std::mt19937 rng(0);
+    std::normal_distribution<double> dist;
+    std::vector<double> B(3*npoints), n(3*npoints);
+    for (int i = 0; i < 3*npoints; ++i) {
+        B[i] = dist(rng);
+        n[i] = dist(rng);
+    }
+    bool old_deterministic = threads::get_deterministic();
+    threads::set_deterministic(deterministic);
+    for (auto _ : state) {
+        auto totals = threads::parallel_sum<2>(npoints, [&](int i, double* sums) {
+            const double* Bi = B.data() + 3*i;
+            const double* ni = n.data() + 3*i;
+            double normN = std::sqrt(ni[0]*ni[0] + ni[1]*ni[1] + ni[2]*ni[2]);
+            double BdotN = (Bi[0]*ni[0] + Bi[1]*ni[1] + Bi[2]*ni[2])/normN;
+            sums[0] += BdotN*BdotN*normN;
+            sums[1] += (Bi[0]*Bi[0] + Bi[1]*Bi[1] + Bi[2]*Bi[2])*normN;
+        });
+        benchmark::DoNotOptimize(totals);
+    }
+    threads::set_deterministic(old_deterministic);
+    state.SetItemsProcessed(state.iterations()*int64_t(npoints));
+    state.counters["num_threads"] = threads::get_num_threads();
+}
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    string config_dir = SIMSOPT_CONFIG_DIR;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if(arg.rfind("--config_dir=", 0) == 0)
+            config_dir = arg.substr(13);
+        else
+            throw std::runtime_error("Unknown argument " + arg);
+    }
+
+    // Same orders and quadrature points as in simsopt.configs.zoo.
+    static vector<CoilSet> configs = {
+        load_coils(config_dir, "NCSX", "NCSX.dat", 25, 10, 3),
+        load_coils(config_dir, "HSX", "HSX.dat", 16, 10, 4),
+        load_coils(config_dir, "W7-X", "W7-X.dat", 48, 2, 5),
+        load_coils(config_dir, "GIULIANI", "GIULIANI_length18_nsurfaces5.curves", 16, 10, 2),
+    };
+
+    for (auto& coils : configs) {
+        auto reg = [&coils](const string& name, void (*fn)(benchmark::State&, CoilSet&)) {
+            return benchmark::RegisterBenchmark(name + "/" + coils.name, [fn, &coils](benchmark::State& state) { fn(state, coils); });
+        };
+        reg("BM_BiotSavart_B", BM_BiotSavart<0, false>)->Arg(1024)->Arg(16384)->Unit(benchmark::kMicrosecond);
+        reg("BM_BiotSavart_dB", BM_BiotSavart<1, false>)->Arg(1024)->Arg(16384)->Unit(benchmark::kMicrosecond);
+        reg("BM_BiotSavart_ddB", BM_BiotSavart<2, false>)->Arg(1024)->Arg(16384)->Unit(benchmark::kMicrosecond);
+        reg("BM_BiotSavart_A", BM_BiotSavart<0, true>)->Arg(1024)->Arg(16384)->Unit(benchmark::kMicrosecond);
+        reg("BM_BiotSavart_dA", BM_BiotSavart<1, true>)->Arg(1024)->Arg(16384)->Unit(benchmark::kMicrosecond);
+        reg("BM_BiotSavartCompute_B", BM_BiotSavartCompute<0>)->Arg(1024)->Arg(16384)->Unit(benchmark::kMicrosecond);
+        reg("BM_BiotSavartCompute_dB", BM_BiotSavartCompute<1>)->Arg(1024)->Unit(benchmark::kMicrosecond);
+        reg("BM_BiotSavartSum_B", BM_BiotSavartSum)->Arg(1024)->Arg(16384)->Unit(benchmark::kMicrosecond);
+        reg("BM_BiotSavartVJP_B", BM_BiotSavartVJP<0, false>)->Arg(1024)->Unit(benchmark::kMicrosecond);
+        reg("BM_BiotSavartVJP_dB", BM_BiotSavartVJP<1, false>)->Arg(1024)->Unit(benchmark::kMicrosecond);
+        reg("BM_BiotSavartVJP_A", BM_BiotSavartVJP<0, true>)->Arg(1024)->Unit(benchmark::kMicrosecond);
+        reg("BM_BiotSavartVJP_dA", BM_BiotSavartVJP<1, true>)->Arg(1024)->Unit(benchmark::kMicrosecond);
+        reg("BM_SmallKernels_Serial", BM_SmallKernels<false>)->Unit(benchmark::kMicrosecond);
+        reg("BM_SmallKernels_TaskGraph", BM_SmallKernels<true>)->Unit(benchmark::kMicrosecond);
+    }
+    // The interpolant only depends on the field through its smoothness, so one
+    // configuration suffices.
+    CoilSet& ncsx = configs[0];
+    auto reg = [&ncsx](const string& name, void (*fn)(benchmark::State&, CoilSet&)) {
+        return benchmark::RegisterBenchmark(name + "/" + ncsx.name, [fn, &ncsx](benchmark::State& state) { fn(state, ncsx); });
+    };
+    reg("BM_InterpolantBuild_Uniform", BM_InterpolantBuild<false>)->Args({3, 8})->Args({5, 8})->Unit(benchmark::kMillisecond);
+    reg("BM_InterpolantBuild_Chebyshev", BM_InterpolantBuild<true>)->Args({3, 8})->Args({5, 8})->Unit(benchmark::kMillisecond);
+    reg("BM_InterpolantEvaluate_Uniform", BM_InterpolantEvaluate<false>)->Args({3, 8})->Args({5, 8})->Unit(benchmark::kMicrosecond);
+    reg("BM_InterpolantEvaluate_Chebyshev", BM_InterpolantEvaluate<true>)->Args({3, 8})->Args({5, 8})->Unit(benchmark::kMicrosecond);
+
+    benchmark::RegisterBenchmark("BM_FirstTouch_Serial", BM_FirstTouch<false>)->Arg(4096)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("BM_FirstTouch_Parallel", BM_FirstTouch<true>)->Arg(4096)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("BM_ParallelSum_Default", BM_ParallelSum<false>)->Arg(16384)->Arg(1 << 20)->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark("BM_ParallelSum_Deterministic", BM_ParallelSum<true>)->Arg(16384)->Arg(1 << 20)->Unit(benchmark::kMicrosecond);
+
+    std::map<std::string, std::string> context;
+#if defined(USE_XSIMD)
+    context["simd"] = "xsimd";
+#else
+    context["simd"] = "none";
+#endif
+    context["config_dir"] = config_dir;
+    context["num_threads"] = std::to_string(threads::get_num_threads());
+    return benchmark::RunSpecifiedBenchmarks(context);
+}
@@ -0,0 +1,327 @@
+#!/usr/bin/env python
+r"""
+Benchmarks of the C++ kernels that are only available through the python
+bindings: curve and surface evaluation, field line tracing, the permanent
+magnet algorithms and the dipole field kernels. The remaining kernels
+(Biot-Savart and the interpolant) are benchmarked by the ``benchmarks``
+executable, see ``benchmarks.cpp``.
+
+The options and the JSON output follow Google Benchmark, so that the results
+of both can be concatenated and compared with the same tools::
+
+    python benchmarks.py --benchmark_format=json --benchmark_out=results.json
+"""
+import argparse
+import datetime
+import json
+import os
+import re
+import socket
+import sys
+import time
+
+import numpy as np
+
+import simsoptpp as sopp
+from simsopt.configs import get_ncsx_data, get_hsx_data, get_w7x_data, get_giuliani_data
+from simsopt.field import BiotSavart, InterpolatedField, coils_via_symmetries
+from simsopt.field.tracing import compute_fieldlines
+from simsopt.geo import SurfaceRZFourier, SurfaceXYZFourier, SurfaceXYZTensorFourier, CurveCWSFourier
+
+UNITS = {'ns': 1e9, 'us': 1e6, 'ms': 1e3, 's': 1.}
+
+CONFIGS = {
+    'NCSX': (get_ncsx_data, 3),
+    'HSX': (get_hsx_data, 4),
+    'W7-X': (get_w7x_data, 5),
+    'GIULIANI': (get_giuliani_data, 2),
+}
+
+
+def run_benchmark(fn, items, unit, args):
+    """
+    Calls ``fn(n)``, which runs ``n`` iterations of a benchmark, with an
+    increasing number of iterations until a run takes at least
+    ``args.benchmark_min_time`` seconds. Returns one result per repetition.
+    """
+    n = 1
+    while True:
+        t = time.perf_counter()
+        fn(n)
+        t = time.perf_counter() - t
+        if t >= args.benchmark_min_time or n >= 1e9:
+            break
+        n = max(n + 1, int(n * min(1.4 * args.benchmark_min_time / max(t, 1e-9), 10.)))
+    runs = []
+    for r in range(args.benchmark_repetitions):
+        a = sopp.arena_heap_allocations()
+        t, c = time.perf_counter(), time.process_time()
+        fn(n)
+        t, c = time.perf_counter() - t, time.process_time() - c
+        run = {'repetition_index': r, 'iterations': n,
+               'real_time': t / n * UNITS[unit], 'cpu_time': c / n * UNITS[unit], 'time_unit': unit,
+               'arena_allocations_per_iteration': (sopp.arena_heap_allocations() - a) / n}
+        if items:
+            run['items_per_second'] = items * n / t
+        runs.append(run)
+    return runs
+
+
+class Registry:
+
+    def __init__(self):
+        self.benchmarks = []
+
+    def add(self, name, setup, items=0, unit='us'):
+        """
+        ``setup()`` is called only if the benchmark is selected, and returns
+        the function that runs a single iteration. ``items`` is the number of
+        items processed per iteration, or a function returning it that is
+        called after ``setup()``.
+        """
+        self.benchmarks.append((name, setup, items, unit))
+
+    def run(self, args):
+        results = []
+        if args.benchmark_format == 'console':
+            print(f"{'Benchmark':60s} {'Time':>15s} {'CPU':>15s} {'Iterations':>12s}")
+            print('-' * 105)
+        for name, setup, items, unit in self.benchmarks:
+            if not re.search(args.benchmark_filter, name):
+                continue
+            if args.benchmark_list_tests:
+                print(name)
+                continue
+            f = setup()
+            nitems = items() if callable(items) else items
+
+            def loop(n):
+                for _ in range(n):
+                    f()
+            runs = run_benchmark(loop, nitems, unit, args)
+            for run in runs:
+                run.update({'name': name, 'run_name': name, 'run_type': 'iteration',
+                            'repetitions': args.benchmark_repetitions, 'threads': 1})
+                if args.benchmark_format == 'console':
+                    counters = f" items_per_second={run['items_per_second']:.4g}" if nitems else ""
+                    print(f"{name:60s} {run['real_time']:12.4g} {unit:2s} {run['cpu_time']:12.4g} {unit:2s} "
+                          f"{run['iterations']:12d}{counters}")
+            results += runs
+        return results
+
+
+def context():
+    return {
+        'date': datetime.datetime.now().astimezone().isoformat(timespec='seconds'),
+        'host_name': socket.gethostname(),
+        'executable': ' '.join([sys.executable] + sys.argv),
+        'num_cpus': os.cpu_count(),
+        'library_build_type': 'release',
+        'omp_num_threads': os.environ.get('OMP_NUM_THREADS', ''),
+        'num_threads': sopp.get_num_threads(),
+        'thread_affinity': thread_affinity(),
+    }
+
+
+def thread_affinity():
+    try:
+        return ' '.join(','.join(map(str, cpus)) for cpus in sopp.get_thread_affinity())
+    except RuntimeError:
+        return ''
+
+
+def invalidate_and(obj, fn):
+    def f():
+        obj.invalidate_cache()
+        fn()
+    return f
+
+
+def register_curves(registry, name, base_curves, ma):
+    curve = base_curves[0]
+    n = len(curve.quadpoints)
+    registry.add(f"BM_CurveXYZFourier_gamma/{name}",
+                 lambda: invalidate_and(curve, curve.gamma), items=n)
+    registry.add(f"BM_CurveXYZFourier_gammadashdashdash/{name}",
+                 lambda: invalidate_and(curve, curve.gammadashdashdash), items=n)
+    registry.add(f"BM_CurveXYZFourier_dgamma_by_dcoeff/{name}",
+                 lambda: invalidate_and(curve, curve.dgamma_by_dcoeff), items=n)
+    v = np.ones((n, 3))
+    registry.add(f"BM_CurveXYZFourier_dgamma_by_dcoeff_vjp/{name}",
+                 lambda: invalidate_and(curve, lambda: curve.dgamma_by_dcoeff_vjp(v)), items=n)
+    m = len(ma.quadpoints)
+    registry.add(f"BM_CurveRZFourier_gamma/{name}",
+                 lambda: invalidate_and(ma, ma.gamma), items=m)
+    registry.add(f"BM_CurveRZFourier_dgamma_by_dcoeff/{name}",
+                 lambda: invalidate_and(ma, ma.dgamma_by_dcoeff), items=m)
+
+
+def register_cws_curves(registry, name, nfp, major_radius):
+    # a curve on a circular winding surface, winding once poloidally
+    s = SurfaceRZFourier(nfp=nfp, stellsym=True, mpol=1, ntor=0)
+    s.set_rc(0, 0, major_radius)
+    s.set_rc(1, 0, 0.3 * major_radius)
+    s.set_zs(1, 0, 0.3 * major_radius)
+    order = 6
+
+    def make_curve():
+        curve = CurveCWSFourier(s.mpol, s.ntor, s.get_dofs(), 15 * order, order, nfp, True)
+        dofs = np.zeros(len(curve.get_dofs()))
+        dofs[0] = 1
+        curve.set_dofs(dofs)
+        return curve
+    curve = make_curve()
+    n = len(curve.quadpoints)
+    registry.add(f"BM_CurveCWSFourier_gamma/{name}",
+                 lambda: invalidate_and(curve, curve.gamma), items=n)
+    # the derivatives are kept in a cache that invalidate_cache doesn't reset,
+    # so each iteration evaluates them on a new curve
+    for quantity in ['dgamma_by_dcoeff', 'dgammadash_by_dcoeff']:
+        registry.add(f"BM_CurveCWSFourier_{quantity}/{name}",
+                     lambda quantity=quantity: lambda: getattr(make_curve(), quantity)(), items=n)
+
+
+def make_surface(cls, nfp, major_radius, **kwargs):
+    phis = np.linspace(0, 1 / nfp, 32, endpoint=False)
+    thetas = np.linspace(0, 1, 32, endpoint=False)
+    s = cls(nfp=nfp, stellsym=True, mpol=8, ntor=8, quadpoints_phi=phis, quadpoints_theta=thetas, **kwargs)
+    rng = np.random.default_rng(1)
+    s.x = 1e-3 * major_radius * rng.standard_normal(s.x.shape)
+    if cls is SurfaceRZFourier:
+        s.set_rc(0, 0, major_radius)
+        s.set_rc(1, 0, 0.1 * major_radius)
+        s.set_zs(1, 0, 0.1 * major_radius)
+    return s
+
+
+def register_surfaces(registry, name, nfp, major_radius):
+    for cls in [SurfaceRZFourier, SurfaceXYZFourier, SurfaceXYZTensorFourier]:
+        s = make_surface(cls, nfp, major_radius)
+        n = len(s.quadpoints_phi) * len(s.quadpoints_theta)
+        for quantity in ['gamma', 'normal', 'dgamma_by_dcoeff', 'dnormal_by_dcoeff']:
+            registry.add(f"BM_{cls.__name__}_{quantity}/{name}",
+                         lambda s=s, quantity=quantity: invalidate_and(s, getattr(s, quantity)), items=n)
+
+
+def register_tracing(registry, name, coils, ma, major_radius):
+    bs = BiotSavart(coils)
+    # a single point, as for each right hand side evaluation during tracing
+    point = ma.gamma()[:1].copy()
+
+    def rhs_biotsavart():
+        bs.set_points(point)
+        bs.B()
+    registry.add(f"BM_TracingRHS_BiotSavart/{name}", lambda: rhs_biotsavart, items=1)
+
+    def setup_interpolated():
+        a = 0.2 * major_radius
+        field = InterpolatedField(bs, 4, [major_radius - a, major_radius + a, 8], [0, 2 * np.pi, 32],
+                                  [-a, a, 8], True, nfp=1, stellsym=False)
+
+        def f():
+            field.set_points(point)
+            field.B()
+        return f
+    registry.add(f"BM_TracingRHS_InterpolatedField/{name}", setup_interpolated, items=1)
+
+    R0 = np.linalg.norm(ma.gamma()[0, :2]) + 0.02 * major_radius * np.arange(1, 3)
+    Z0 = np.zeros_like(R0)
+
+    steps = {}
+
+    def setup_tracing():
+        # the items are the time steps taken by the integrator
+        tys, _ = compute_fieldlines(bs, R0, Z0, tmax=100, tol=1e-8)
+        steps['n'] = sum(len(ty) for ty in tys)
+        return lambda: compute_fieldlines(bs, R0, Z0, tmax=100, tol=1e-8)
+    registry.add(f"BM_Tracing/{name}", setup_tracing, items=lambda: steps['n'], unit='ms')
+
+
+def register_dipoles(registry):
+    rng = np.random.default_rng(1)
+    ndipoles, npoints = 4096, 1024
+    dipole_grid = rng.standard_normal((ndipoles, 3))
+    m = rng.standard_normal((ndipoles, 3))
+    points = rng.standard_normal((npoints, 3)) + 5.
+    for quantity in ['B', 'A', 'dB', 'dA']:
+        kernel = getattr(sopp, f"dipole_field_{quantity}")
+        registry.add(f"BM_DipoleField_{quantity}/{ndipoles}x{npoints}",
+                     lambda kernel=kernel: lambda: kernel(points, dipole_grid, m), items=ndipoles * npoints)
+        out = np.zeros((npoints, 3) if quantity in ['B', 'A'] else (npoints, 3, 3))
+        registry.add(f"BM_DipoleField_{quantity}_out/{ndipoles}x{npoints}",
+                     lambda kernel=kernel, out=out: lambda: kernel(points, dipole_grid, m, out=out),
+                     items=ndipoles * npoints)
+
+    # the matrix of the permanent magnet problem, its memory is first touched
+    # by the threads that fill it
+    normals = rng.standard_normal((npoints, 3))
+    normals /= np.linalg.norm(normals, axis=1)[:, None]
+    registry.add(f"BM_DipoleField_Bn/{ndipoles}x{npoints}",
+                 lambda: lambda: sopp.dipole_field_Bn(points, dipole_grid, normals, 2, True, np.zeros(npoints)),
+                 items=ndipoles * npoints, unit='ms')
+
+    # the permanent magnet algorithms on a random least squares problem
+    ndipoles, nquad = 512, 1024
+    A = rng.random((nquad, ndipoles, 3))
+    b = rng.random(nquad)
+    ATb = np.tensordot(A, b, axes=([0, 0]))
+    m_maxima = np.ones(ndipoles)
+    m0 = np.zeros((ndipoles, 3))
+    alpha = 2.0 / np.linalg.norm(A.reshape(nquad, 3 * ndipoles), ord=2) ** 2
+    max_iter = 50
+
+    def mwpgp():
+        sopp.MwPGP_algorithm(A_obj=A, b_obj=b, ATb=ATb, m_proxy=m0, m0=m0, m_maxima=m_maxima, alpha=alpha,
+                             epsilon=0., max_iter=max_iter)
+    registry.add(f"BM_MwPGP/{ndipoles}x{nquad}", lambda: mwpgp, items=max_iter, unit='ms')
+
+    A_obj = np.ascontiguousarray(A.reshape(nquad, 3 * ndipoles).T)
+    K = 100
+
+    def gpmo():
+        sopp.GPMO_baseline(A_obj=A_obj, b_obj=b, mmax=m_maxima, normal_norms=np.ones(nquad), K=K, nhistory=10)
+    registry.add(f"BM_GPMO_baseline/{ndipoles}x{nquad}", lambda: gpmo, items=K, unit='ms')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--benchmark_filter', default='.')
+    parser.add_argument('--benchmark_min_time', type=float, default=0.5)
+    parser.add_argument('--benchmark_repetitions', type=int, default=1)
+    parser.add_argument('--benchmark_format', choices=['console', 'json'], default='console')
+    parser.add_argument('--benchmark_out', default='')
+    parser.add_argument('--benchmark_list_tests', action='store_true')
+    parser.add_argument('--num_threads', type=int, default=0,
+                        help='number of OpenMP threads, by default OMP_NUM_THREADS')
+    parser.add_argument('--pin_threads', action='store_true',
+                        help='pin thread i to the i-th cpu available to this process')
+    args = parser.parse_args()
+    if args.num_threads > 0:
+        sopp.set_num_threads(args.num_threads)
+    if args.pin_threads:
+        sopp.set_thread_affinity(sorted(os.sched_getaffinity(0)))
+
+    registry = Registry()
+    for name, (get_data, nfp) in CONFIGS.items():
+        base_curves, base_currents, ma = get_data()
+        coils = coils_via_symmetries(base_curves, base_currents, nfp, True)
+        major_radius = np.mean(np.linalg.norm(base_curves[0].gamma()[:, :2], axis=1))
+        register_curves(registry, name, base_curves, ma)
+        register_cws_curves(registry, name, nfp, major_radius)
+        register_surfaces(registry, name, nfp, major_radius)
+        register_tracing(registry, name, coils, ma, major_radius)
+    register_dipoles(registry)
+
+    results = registry.run(args)
+    if args.benchmark_list_tests:
+        return
+    output = json.dumps({'context': context(), 'benchmarks': results}, indent=2)
+    if args.benchmark_format == 'json':
+        print(output)
+    if args.benchmark_out:
+        with open(args.benchmark_out, 'w') as f:
+            f.write(output)
+
+
+if __name__ == "__main__":
+    main()
@@ -8,6 +8,7 @@ subpackage.
 """
 
 import itertools
+from contextlib import contextmanager
 from numbers import Integral, Real, Number
 from dataclasses import dataclass
 from abc import ABCMeta
@@ -297,3 +298,84 @@ def parallel_loop_bounds(comm, n):
         assert idxs[-1] == n
         return idxs[comm.rank], idxs[comm.rank+1]
 
+
+def shared_array(comm, shape):
+    """
+    Allocate a C contiguous array of doubles of the given shape in a shared
+    memory window (``MPI_Win_allocate_shared``), so that the ranks of ``comm``
+    on one node all see the same memory. The array is not initialized.
+
+    Returns the array, the communicator of the ranks on this node and the
+    window. The memory is released by ``win.Free()``, which has to be called
+    by all ranks of the node once the array is no longer used, followed by
+    ``nodecomm.Free()``.
+    """
+    from mpi4py import MPI
+    nodecomm = comm.Split_type(MPI.COMM_TYPE_SHARED, key=comm.rank)
+    itemsize = MPI.DOUBLE.Get_size()
+    size = int(np.prod(shape)) * itemsize if nodecomm.rank == 0 else 0
+    win = MPI.Win.Allocate_shared(size, itemsize, comm=nodecomm)
+    buf, _ = win.Shared_query(0)
+    out = np.ndarray(buffer=buf, dtype=np.float64, shape=shape)
+    return out, nodecomm, win
+
+
+@contextmanager
+def parallel_fill(comm, n, shape, fill):
+    """
+    Compute an array of shape ``(n, *shape)`` whose rows are split up across
+    an mpi communicator. Each rank calls ``fill(first, last, out)``, which
+    writes the rows ``first, ..., last-1`` into ``out``, a C contiguous array
+    of shape ``(last-first, *shape)``. The rows are split up as in
+    :func:`parallel_loop_bounds`, but such that the rows of the ranks on one
+    node are contiguous.
+
+    The ranks on one node write into a single array in a shared memory window
+    (see :func:`shared_array`), and one rank per node then exchanges the
+    rows with the other nodes, so that the array is only stored and received
+    once per node. The array is only valid inside the ``with`` block:
+
+    .. code-block::
+
+        with parallel_fill(comm, n, (3, ), fill) as values:
+            ...
+
+    For ``comm=None``, ``fill(0, n, out)`` is called for a regular array.
+    """
+    shape = (n, ) + tuple(shape)
+    if comm is None:
+        out = np.empty(shape)
+        fill(0, n, out)
+        yield out
+        return
+
+    from mpi4py import MPI
+    out, nodecomm, win = shared_array(comm, shape)
+    leadercomm = comm.Split(0 if nodecomm.rank == 0 else MPI.UNDEFINED, key=comm.rank)
+    if nodecomm.rank == 0:
+        nodeinfo = (leadercomm.rank, leadercomm.allgather(nodecomm.size))
+    else:
+        nodeinfo = None
+    node, nodesizes = nodecomm.bcast(nodeinfo, root=0)
+    # the ranks of node i are at positions offsets[i], ..., offsets[i+1]-1
+    offsets = np.cumsum([0] + nodesizes)
+    rows = [int(o)*n//comm.size for o in offsets]
+    position = offsets[node] + nodecomm.rank
+    first, last = position*n//comm.size, (position+1)*n//comm.size
+
+    rowsize = int(np.prod(shape[1:]))
+    try:
+        win.Fence()
+        fill(first, last, out[first:last])
+        win.Fence()
+        if nodecomm.rank == 0 and leadercomm.size > 1:
+            counts = [(rows[i+1]-rows[i])*rowsize for i in range(len(nodesizes))]
+            displs = [rows[i]*rowsize for i in range(len(nodesizes))]
+            leadercomm.Allgatherv(MPI.IN_PLACE, [out, counts, displs, MPI.DOUBLE])
+        win.Fence()
+        yield out
+    finally:
+        win.Free()
+        if leadercomm != MPI.COMM_NULL:
+            leadercomm.Free()
+        nodecomm.Free()
@@ -1,6 +1,8 @@
 from .biotsavart import *
 from .boozermagneticfield import *
 from .coil import *
+from .currentpotential import *
+from .force import *
 from .magneticfield import *
 from .magneticfieldclasses import *
 from .normal_field import *
@@ -10,6 +12,8 @@ __all__ = (
     biotsavart.__all__
     + boozermagneticfield.__all__
     + coil.__all__
+    + currentpotential.__all__
+    + force.__all__
     + magneticfield.__all__
     + magneticfieldclasses.__all__
     + normal_field.__all__
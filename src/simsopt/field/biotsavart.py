@@ -4,6 +4,7 @@ import numpy as np
 import simsoptpp as sopp
 from .magneticfield import MagneticField
 from .._core.json import GSONable, GSONDecoder, GSONEncoder
+from .._core.derivative import Derivative
 
 __all__ = ['BiotSavart']
 
@@ -19,15 +20,42 @@ class BiotSavart(sopp.BiotSavart, MagneticField):
 
     where :math:`\mu_0=4\pi 10^{-7}` is the magnetic constant.
 
+    If the curves of the coils are :obj:`~simsopt.geo.curvexyzfourier.CurveXYZFourier`
+    of the same order and with the same quadrature points, they can be
+    evaluated as one block by passing a
+    :obj:`~simsopt.geo.curvecollection.CurveCollection` of the curves of the
+    coils, in the same order. The field and its derivatives are then computed
+    from the contiguous ``gamma`` and ``gammadash`` blocks of the collection,
+    and the vector Jacobian products with respect to the curve dofs use the
+    batched products of the collection.
+
     Args:
         coils: A list of :obj:`simsopt.field.coil.Coil` objects.
+        collection: A :obj:`~simsopt.geo.curvecollection.CurveCollection` of
+            the curves of the coils, or ``None``.
     """
 
-    def __init__(self, coils):
+    def __init__(self, coils, collection=None):
         self._coils = coils
-        sopp.BiotSavart.__init__(self, coils)
+        self._collection = collection
+        if collection is None:
+            sopp.BiotSavart.__init__(self, coils)
+        else:
+            sopp.BiotSavart.__init__(self, coils, collection)
         MagneticField.__init__(self, depends_on=coils)
 
+    def _curve_arrays(self):
+        if self._collection is not None:
+            return self._collection.gammas(), self._collection.gammadashs()
+        return [coil.curve.gamma() for coil in self._coils], [coil.curve.gammadash() for coil in self._coils]
+
+    def _coils_vjp(self, res_gamma, res_gammadash, res_current):
+        coils = self._coils
+        if self._collection is not None:
+            return self._collection.dgamma_and_dgammadash_by_dcoeff_vjp(res_gamma, res_gammadash) \
+                + sum([coils[i].current.vjp(np.asarray([res_current[i]])) for i in range(len(coils))], Derivative({}))
+        return self._coils_vjp(res_gamma, res_gammadash, res_current)
+
     def dB_by_dcoilcurrents(self, compute_derivatives=0):
         points = self.get_points_cart_ref()
         npoints = len(points)
@@ -68,17 +96,18 @@ class BiotSavart(sopp.BiotSavart, MagneticField):
         """
 
         coils = self._coils
-        gammas = [coil.curve.gamma() for coil in coils]
-        gammadashs = [coil.curve.gammadash() for coil in coils]
+        gammas, gammadashs = self._curve_arrays()
         currents = [coil.current.get_value() for coil in coils]
         res_gamma = [np.zeros_like(gamma) for gamma in gammas]
         res_gammadash = [np.zeros_like(gammadash) for gammadash in gammadashs]
         res_grad_gamma = [np.zeros_like(gamma) for gamma in gammas]
         res_grad_gammadash = [np.zeros_like(gammadash) for gammadash in gammadashs]
 
-        points = self.get_points_cart_ref()
+        quadweights = [coil.curve.quadweights for coil in coils]
+        points = self.get_pointset()
         sopp.biot_savart_vjp_graph(points, gammas, gammadashs, currents, v,
-                                   res_gamma, res_gammadash, vgrad, res_grad_gamma, res_grad_gammadash)
+                                   res_gamma, res_gammadash, vgrad, res_grad_gamma, res_grad_gammadash,
+                                   quadweights=quadweights)
 
         dB_by_dcoilcurrents = self.dB_by_dcoilcurrents()
         res_current = [np.sum(v * dB_by_dcoilcurrents[i]) for i in range(len(dB_by_dcoilcurrents))]
@@ -86,8 +115,8 @@ class BiotSavart(sopp.BiotSavart, MagneticField):
         res_grad_current = [np.sum(vgrad * d2B_by_dXdcoilcurrents[i]) for i in range(len(d2B_by_dXdcoilcurrents))]
 
         res = (
-            sum([coils[i].vjp(res_gamma[i], res_gammadash[i], np.asarray([res_current[i]])) for i in range(len(coils))]),
-            sum([coils[i].vjp(res_grad_gamma[i], res_grad_gammadash[i], np.asarray([res_grad_current[i]])) for i in range(len(coils))])
+            self._coils_vjp(res_gamma, res_gammadash, res_current),
+            self._coils_vjp(res_grad_gamma, res_grad_gammadash, res_grad_current)
         )
 
         return res
@@ -106,18 +135,18 @@ class BiotSavart(sopp.BiotSavart, MagneticField):
         """
 
         coils = self._coils
-        gammas = [coil.curve.gamma() for coil in coils]
-        gammadashs = [coil.curve.gammadash() for coil in coils]
+        gammas, gammadashs = self._curve_arrays()
         currents = [coil.current.get_value() for coil in coils]
         res_gamma = [np.zeros_like(gamma) for gamma in gammas]
         res_gammadash = [np.zeros_like(gammadash) for gammadash in gammadashs]
 
-        points = self.get_points_cart_ref()
+        quadweights = [coil.curve.quadweights for coil in coils]
+        points = self.get_pointset()
         sopp.biot_savart_vjp_graph(points, gammas, gammadashs, currents, v,
-                                   res_gamma, res_gammadash, [], [], [])
+                                   res_gamma, res_gammadash, [], [], [], quadweights=quadweights)
         dB_by_dcoilcurrents = self.dB_by_dcoilcurrents()
         res_current = [np.sum(v * dB_by_dcoilcurrents[i]) for i in range(len(dB_by_dcoilcurrents))]
-        return sum([coils[i].vjp(res_gamma[i], res_gammadash[i], np.asarray([res_current[i]])) for i in range(len(coils))])
+        return self._coils_vjp(res_gamma, res_gammadash, res_current)
 
     def dA_by_dcoilcurrents(self, compute_derivatives=0):
         points = self.get_points_cart_ref()
@@ -159,17 +188,18 @@ class BiotSavart(sopp.BiotSavart, MagneticField):
         """
 
         coils = self._coils
-        gammas = [coil.curve.gamma() for coil in coils]
-        gammadashs = [coil.curve.gammadash() for coil in coils]
+        gammas, gammadashs = self._curve_arrays()
         currents = [coil.current.get_value() for coil in coils]
         res_gamma = [np.zeros_like(gamma) for gamma in gammas]
         res_gammadash = [np.zeros_like(gammadash) for gammadash in gammadashs]
         res_grad_gamma = [np.zeros_like(gamma) for gamma in gammas]
         res_grad_gammadash = [np.zeros_like(gammadash) for gammadash in gammadashs]
 
-        points = self.get_points_cart_ref()
+        quadweights = [coil.curve.quadweights for coil in coils]
+        points = self.get_pointset()
         sopp.biot_savart_vector_potential_vjp_graph(points, gammas, gammadashs, currents, v,
-                                                    res_gamma, res_gammadash, vgrad, res_grad_gamma, res_grad_gammadash)
+                                                    res_gamma, res_gammadash, vgrad, res_grad_gamma, res_grad_gammadash,
+                                                    quadweights=quadweights)
 
         dA_by_dcoilcurrents = self.dA_by_dcoilcurrents()
         res_current = [np.sum(v * dA_by_dcoilcurrents[i]) for i in range(len(dA_by_dcoilcurrents))]
@@ -177,8 +207,8 @@ class BiotSavart(sopp.BiotSavart, MagneticField):
         res_grad_current = [np.sum(vgrad * d2A_by_dXdcoilcurrents[i]) for i in range(len(d2A_by_dXdcoilcurrents))]
 
         res = (
-            sum([coils[i].vjp(res_gamma[i], res_gammadash[i], np.asarray([res_current[i]])) for i in range(len(coils))]),
-            sum([coils[i].vjp(res_grad_gamma[i], res_grad_gammadash[i], np.asarray([res_grad_current[i]])) for i in range(len(coils))])
+            self._coils_vjp(res_gamma, res_gammadash, res_current),
+            self._coils_vjp(res_grad_gamma, res_grad_gammadash, res_grad_current)
         )
 
         return res
@@ -197,22 +227,23 @@ class BiotSavart(sopp.BiotSavart, MagneticField):
         """
 
         coils = self._coils
-        gammas = [coil.curve.gamma() for coil in coils]
-        gammadashs = [coil.curve.gammadash() for coil in coils]
+        gammas, gammadashs = self._curve_arrays()
         currents = [coil.current.get_value() for coil in coils]
         res_gamma = [np.zeros_like(gamma) for gamma in gammas]
         res_gammadash = [np.zeros_like(gammadash) for gammadash in gammadashs]
 
-        points = self.get_points_cart_ref()
+        quadweights = [coil.curve.quadweights for coil in coils]
+        points = self.get_pointset()
         sopp.biot_savart_vector_potential_vjp_graph(points, gammas, gammadashs, currents, v,
-                                                    res_gamma, res_gammadash, [], [], [])
+                                                    res_gamma, res_gammadash, [], [], [], quadweights=quadweights)
         dA_by_dcoilcurrents = self.dA_by_dcoilcurrents()
         res_current = [np.sum(v * dA_by_dcoilcurrents[i]) for i in range(len(dA_by_dcoilcurrents))]
-        return sum([coils[i].vjp(res_gamma[i], res_gammadash[i], np.asarray([res_current[i]])) for i in range(len(coils))])
+        return self._coils_vjp(res_gamma, res_gammadash, res_current)
 
     def as_dict(self, serial_objs_dict) -> dict:
         d = super().as_dict(serial_objs_dict=serial_objs_dict)
         d["points"] = self.get_points_cart()
+        d["collection"] = self._collection is not None
         return d
 
     @classmethod
@@ -224,6 +255,10 @@ class BiotSavart(sopp.BiotSavart, MagneticField):
         coils = decoder.process_decoded(d["coils"],
                                         serial_objs_dict=serial_objs_dict,
                                         recon_objs=recon_objs)
-        bs = cls(coils)
+        collection = None
+        if d.get("collection", False):
+            from ..geo.curvecollection import CurveCollection
+            collection = CurveCollection([coil.curve for coil in coils])
+        bs = cls(coils, collection)
         bs.set_points_cart(xyz)
         return bs
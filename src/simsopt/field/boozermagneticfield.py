@@ -21,7 +21,7 @@ if MPI is not None:
         logger.debug(str(e))
 
 __all__ = ['BoozerMagneticField', 'BoozerAnalytic', 'BoozerRadialInterpolant',
-           'InterpolatedBoozerField']
+           'InterpolatedBoozerField', 'BoozerRadialSplineField']
 
 
 class BoozerMagneticField(sopp.BoozerMagneticField):
@@ -1084,6 +1084,95 @@ class BoozerRadialInterpolant(BoozerMagneticField):
             sopp.inverse_fourier_transform_odd(dmodBds[:, 0], bmns, self.xm_b, self.xn_b, thetas, zetas)
 
 
+    def _compute_impl(self, mask):
+        r"""
+        Computes all quantities whose bit is set in ``mask`` together. The
+        splines of the harmonics and of ``mn_factor`` are evaluated once and
+        shared between a quantity and its derivatives, and all Fourier series
+        are summed by :func:`simsoptpp.inverse_fourier_transform_many`, which
+        evaluates the trigonometric functions only once per point.
+        """
+        names = [name for q, name in enumerate(self.quantity_names()) if (mask >> q) & 1]
+        points = self.get_points_ref()
+        s = points[:, 0]
+        thetas = points[:, 1]
+        zetas = points[:, 2]
+
+        profiles = {'psip': self.psip_spline, 'G': self.G_spline, 'dGds': self.dGds_spline,
+                    'I': self.I_spline, 'dIds': self.dIds_spline,
+                    'iota': self.iota_spline, 'diotads': self.diotads_spline}
+        for name in names:
+            if name in profiles:
+                self.quantity_buffer(self.quantity_names().index(name))[:, 0] = profiles[name](s)
+
+        # (cos harmonics, sin harmonics) of each series, the ones that vanish
+        # for stellarator symmetric fields come second
+        series = {'modB': ('bmnc', 'bmns'), 'R': ('rmnc', 'rmns'), 'Z': ('zmnc', 'zmns'),
+                  'nu': ('numnc', 'numns'), 'K': ('kmnc', 'kmns')}
+        symmetric_part = {'modB': 0, 'R': 0, 'Z': 1, 'nu': 1, 'K': 1}
+        requested = []
+        for name in names:
+            for family in series:
+                kinds = {family: None, 'd'+family+'ds': 's', 'd'+family+'dtheta': 'theta', 'd'+family+'dzeta': 'zeta'}
+                if name in kinds and not (family == 'K' and kinds[name] == 's'):
+                    requested.append((name, family, kinds[name]))
+        if self.no_K:
+            for name, family, kind in requested:
+                if family == 'K':
+                    self.quantity_buffer(self.quantity_names().index(name))[:, 0] = 0.
+            requested = [r for r in requested if r[1] != 'K']
+        if len(requested) == 0:
+            return
+
+        num_modes = len(self.xm_b)
+        xm = np.asarray(self.xm_b, dtype=np.float64)[:, None]
+        xn = np.asarray(self.xn_b, dtype=np.float64)[:, None]
+        out = np.zeros((len(requested), len(s)))
+        # the coefficients of all quantities at all points are not kept in
+        # memory at once
+        chunk = max(1, 2**22//(len(requested)*num_modes))
+        for start in range(0, len(s), chunk):
+            idx = slice(start, min(start+chunk, len(s)))
+            s_chunk = s[idx]
+            mn_factor = np.array([spline(s_chunk) for spline in self.mn_factor_splines])
+            d_mn_factor = None
+            harmonics = {}
+            dharmonics = {}
+            for name, family, kind in requested:
+                for part, harmonic in enumerate(series[family]):
+                    if self.stellsym and part != symmetric_part[family]:
+                        continue
+                    if harmonic not in harmonics:
+                        harmonics[harmonic] = np.array([spline(s_chunk) for spline in getattr(self, harmonic+'_splines')])/mn_factor
+                    if kind == 's' and harmonic not in dharmonics:
+                        if d_mn_factor is None:
+                            d_mn_factor = np.array([spline(s_chunk) for spline in self.d_mn_factor_splines])
+                        dharmonics[harmonic] = (np.array([spline(s_chunk) for spline in getattr(self, 'd'+harmonic+'ds_splines')])
+                                                - harmonics[harmonic]*d_mn_factor)/mn_factor
+
+            cos_coeffs = np.zeros((len(requested), num_modes, s_chunk.shape[0]))
+            sin_coeffs = np.zeros((len(requested), num_modes, s_chunk.shape[0]))
+            for iq, (name, family, kind) in enumerate(requested):
+                cos_name, sin_name = series[family]
+                source = dharmonics if kind == 's' else harmonics
+                a = source.get(cos_name, 0.)
+                b = source.get(sin_name, 0.)
+                if kind is None or kind == 's':
+                    cos_coeffs[iq] += a
+                    sin_coeffs[iq] += b
+                elif kind == 'theta':
+                    cos_coeffs[iq] += xm*b
+                    sin_coeffs[iq] -= xm*a
+                else:
+                    cos_coeffs[iq] -= xn*b
+                    sin_coeffs[iq] += xn*a
+            out_chunk = np.zeros((len(requested), s_chunk.shape[0]))
+            sopp.inverse_fourier_transform_many(out_chunk, cos_coeffs, sin_coeffs, self.xm_b, self.xn_b,
+                                                np.ascontiguousarray(thetas[idx]), np.ascontiguousarray(zetas[idx]))
+            out[:, idx] = out_chunk
+        for iq, (name, family, kind) in enumerate(requested):
+            self.quantity_buffer(self.quantity_names().index(name))[:, 0] = out[iq]
+
 class InterpolatedBoozerField(sopp.InterpolatedBoozerField, BoozerMagneticField):
     r"""
     This field takes an existing :class:`BoozerMagneticField` and interpolates it on a
@@ -1124,3 +1213,98 @@ class InterpolatedBoozerField(sopp.InterpolatedBoozerField, BoozerMagneticField)
 
         sopp.InterpolatedBoozerField.__init__(self, field, degree, srange, thetarange, zetarange, extrapolate, nfp, stellsym)
 
+
+
+def _radial_splines(splines):
+    """
+    Converts a list of scipy splines with the same knots and degree, or a
+    single spline, into a :obj:`simsoptpp.RadialSplines`. Returns ``None`` if
+    ``splines`` is ``None``.
+    """
+    if splines is None:
+        return None
+    if not isinstance(splines, (list, tuple)):
+        splines = [splines]
+    t, _, k = splines[0]._eval_args
+    coeffs = []
+    for spline in splines:
+        ts, c, ks = spline._eval_args
+        if ks != k or len(ts) != len(t) or np.any(ts != t):
+            raise ValueError("All splines of a Fourier series need to have the same knots and degree.")
+        coeffs.append(c)
+    return sopp.RadialSplines(t, k, coeffs)
+
+
+class BoozerRadialSplineField(sopp.BoozerRadialSplineField, BoozerMagneticField):
+    r"""
+    A :class:`BoozerMagneticField` given by radial splines of the Fourier
+    harmonics of :math:`B`, :math:`R`, :math:`Z`, :math:`\nu` and :math:`K`
+    and of the profiles :math:`\psi_P`, :math:`G`, :math:`I` and :math:`\iota`,
+    evaluated in C++. For example,
+
+    .. math::
+        B(s,\theta,\zeta) = \sum_{m,n} s^{p_{mn}} \left(b^c_{mn}(s) \cos(m\theta - n\zeta) + b^s_{mn}(s) \sin(m\theta - n\zeta)\right).
+
+    All quantities are computed at once for each point: the splines are
+    evaluated once, :math:`\cos` and :math:`\sin` of all modes are shared
+    between the series, and derivatives with respect to :math:`s` are
+    obtained from the derivatives of the splines. Only the radial splines are
+    stored, so this is a memory-light alternative to
+    :class:`InterpolatedBoozerField` for equilibria with many modes.
+
+    Args:
+        psi0: the toroidal flux at the boundary divided by :math:`2\pi`.
+        xm: poloidal mode numbers.
+        xn: toroidal mode numbers.
+        radial_power: the powers :math:`p_{mn}` for each mode.
+        modB: a pair ``(cos_splines, sin_splines)`` of lists of scipy splines
+            with one spline per mode, either of which may be ``None``. All
+            splines of a list need to have the same knots.
+        R: as ``modB`` for the major radius.
+        Z: as ``modB`` for the height.
+        nu: as ``modB`` for :math:`\nu`.
+        K: as ``modB`` for :math:`K`, or ``None`` if :math:`K = 0`.
+        psip: scipy spline of :math:`\psi_P(s)`.
+        G: scipy spline of :math:`G(s)`.
+        I: scipy spline of :math:`I(s)`.
+        iota: scipy spline of :math:`\iota(s)`.
+    """
+
+    def __init__(self, psi0, xm, xn, radial_power, modB, R, Z, nu, K, psip, G, I, iota):
+        BoozerMagneticField.__init__(self, psi0)
+        series = []
+        for pair in [modB, R, Z, nu, K]:
+            if pair is None:
+                pair = (None, None)
+            series += [_radial_splines(pair[0]), _radial_splines(pair[1])]
+        sopp.BoozerRadialSplineField.__init__(
+            self, psi0, np.asarray(xm, dtype=np.float64), np.asarray(xn, dtype=np.float64),
+            np.asarray(radial_power, dtype=np.float64), *series,
+            _radial_splines(psip), _radial_splines(G), _radial_splines(I), _radial_splines(iota))
+
+    @classmethod
+    def from_radial_interpolant(cls, field):
+        r"""
+        Creates a :class:`BoozerRadialSplineField` from the splines of a
+        :class:`BoozerRadialInterpolant`.
+
+        The :math:`s` derivatives are obtained by differentiating the splines
+        of the harmonics, and with ``rescale=True`` the factors
+        :math:`s^{p_{mn}}` are applied exactly instead of being interpolated.
+        """
+        xm = np.asarray(field.xm_b, dtype=np.float64)
+        radial_power = np.zeros_like(xm)
+        if field.rescale:
+            radial_power[xm == 1] = 0.5
+            radial_power[(xm % 2 == 1)*(xm > 1)] = 1.5
+            radial_power[(xm % 2 == 0)*(xm > 1)] = 1.
+        stellsym = field.stellsym
+        modB = (field.bmnc_splines, None if stellsym else field.bmns_splines)
+        R = (field.rmnc_splines, None if stellsym else field.rmns_splines)
+        Z = (None if stellsym else field.zmnc_splines, field.zmns_splines)
+        nu = (None if stellsym else field.numnc_splines, field.numns_splines)
+        K = None
+        if not field.no_K:
+            K = (None if stellsym else field.kmnc_splines, field.kmns_splines)
+        return cls(field.psi0, xm, field.xn_b, radial_power, modB, R, Z, nu, K,
+                   field.psip_spline, field.G_spline, field.I_spline, field.iota_spline)
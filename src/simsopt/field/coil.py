@@ -8,7 +8,7 @@ from simsopt.geo.curve import RotatedCurve, Curve
 import simsoptpp as sopp
 
 
-__all__ = ['Coil', 'Current', 'coils_via_symmetries', 'load_coils_from_makegrid_file',
+__all__ = ['Coil', 'MultifilamentCoil', 'Current', 'coils_via_symmetries', 'load_coils_from_makegrid_file',
            'apply_symmetries_to_currents', 'apply_symmetries_to_curves',
            'coils_to_makegrid', 'coils_to_focus']
 
@@ -41,6 +41,25 @@ class Coil(sopp.Coil, Optimizable):
         return self.curve.plot(**kwargs)
 
 
+class MultifilamentCoil(Coil):
+    """
+    A finite build coil, approximated by the filaments of a
+    :obj:`~simsopt.geo.finitebuild.CurveMultifilament`. The current is the
+    total current through the winding pack, which is distributed among the
+    filaments according to the weights of the curve.
+    All filaments are passed to :obj:`~simsopt.field.biotsavart.BiotSavart` as
+    one block, and the derivatives with respect to the centre line are
+    computed in a single pass over the filaments.
+    """
+
+    def vjp(self, v_gamma, v_gammadash, v_current):
+        if not hasattr(self.curve, "dgamma_and_dgammadash_by_dcoeff_vjp"):
+            # e.g. a RotatedCurve of a CurveMultifilament
+            return Coil.vjp(self, v_gamma, v_gammadash, v_current)
+        return self.curve.dgamma_and_dgammadash_by_dcoeff_vjp(v_gamma, v_gammadash) \
+            + self.current.vjp(v_current)
+
+
 class CurrentBase(Optimizable):
 
     def __init__(self, **kwargs):
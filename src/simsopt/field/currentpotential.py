@@ -0,0 +1,112 @@
+import numpy as np
+
+import simsoptpp as sopp
+from .coil import Current
+
+__all__ = ['CurrentPotentialSolver']
+
+
+class CurrentPotentialSolver(sopp.CurrentPotentialSolver):
+    r"""
+    Computes the current potential on a winding surface whose field is
+    closest to a target normal field on a plasma surface, following
+    M. Landreman, Nucl. Fusion 57, 046003 (2017) (REGCOIL). The current
+    potential
+
+    .. math::
+        \Phi(\phi, \theta) = G\phi + I\theta + \sum_j \Phi_j \sin(2\pi(m_j\theta - n_{fp} n_j\phi))
+
+    (plus the corresponding cosines if the winding surface is not
+    stellarator symmetric), with :math:`\phi, \theta \in [0, 1)` the angles
+    of the winding surface, gives the surface current
+    :math:`\mathbf{K} = \mathbf{n} \times \nabla\Phi`. The coefficients
+    :math:`\Phi_j` minimize
+
+    .. math::
+        \chi^2_B + \lambda \chi^2_K = \int_{plasma} (\mathbf{B}\cdot\mathbf{n} - B_T)^2 dA + \lambda \int_{winding} |\mathbf{K}|^2 dA.
+
+    The inductance between the two surfaces is assembled in C++ on
+    construction, and the generalized eigendecomposition of the two quadratic
+    forms is computed once on the first call of :meth:`solve`, so that
+    scanning the regularization only costs a matrix-vector product per value
+    of :math:`\lambda`.
+
+    Args:
+        plasma_surface: a :obj:`simsopt.geo.surface.Surface` on which the normal
+            field is evaluated, e.g. with ``range="half period"``.
+        winding_surface: a :obj:`simsopt.geo.surfacerzfourier.SurfaceRZFourier`
+            carrying the current, whose quadrature points cover the full torus.
+        mpol: poloidal resolution of the current potential.
+        ntor: toroidal resolution of the current potential.
+        net_poloidal_current: the net poloidal current :math:`G` in Ampere,
+            i.e. the total current of all coils linking the magnetic axis.
+        net_toroidal_current: the net toroidal current :math:`I` in Ampere.
+        Bnormal_target: an optional ``(nphi, ntheta)`` array :math:`B_T` on the
+            quadrature points of ``plasma_surface``, e.g. the negative of the
+            normal field of the plasma currents.
+    """
+
+    def __init__(self, plasma_surface, winding_surface, mpol, ntor, net_poloidal_current,
+                 net_toroidal_current=0., Bnormal_target=None):
+        for quadpoints in [winding_surface.quadpoints_phi, winding_surface.quadpoints_theta]:
+            if not np.allclose(quadpoints, np.linspace(0, 1, len(quadpoints), endpoint=False)):
+                raise ValueError("The quadrature points of the winding surface need to cover the full torus uniformly.")
+        if Bnormal_target is None:
+            Bnormal_target = np.zeros((0,))
+        self.plasma_surface = plasma_surface
+        self.winding_surface = winding_surface
+        sopp.CurrentPotentialSolver.__init__(
+            self, plasma_surface, winding_surface, mpol, ntor, winding_surface.nfp, winding_surface.stellsym,
+            float(net_poloidal_current), float(net_toroidal_current),
+            np.ascontiguousarray(Bnormal_target, dtype=np.float64).flatten())
+
+    def solve(self, lam):
+        """
+        Returns the coefficients :math:`\\Phi_j` for the regularization ``lam``.
+        For ``lam = 0``, the part of :math:`\\Phi` that has no normal field on
+        the plasma surface is set to zero.
+        """
+        return np.asarray(sopp.CurrentPotentialSolver.solve(self, lam))
+
+    def scan(self, lams):
+        """
+        Solves the problem for each regularization in ``lams`` and returns the
+        coefficients as a ``(len(lams), num_dofs)`` array, together with arrays
+        containing :math:`\\chi^2_B` and :math:`\\chi^2_K`.
+        """
+        phis = np.asarray([self.solve(lam) for lam in lams])
+        chi2s = np.asarray([self.chi2(phi) for phi in phis]).reshape((-1, 2))
+        return phis, chi2s[:, 0], chi2s[:, 1]
+
+    def coils(self, phi, ncoils, order, numquadpoints, nsamples=None):
+        """
+        Cuts ``ncoils`` modular coils per half period out of the contours
+        :math:`\\Phi = G (k + 1/2)/(2 n_{fp} n_{coils})` of the current potential
+        and returns them as :obj:`simsopt.geo.curvecwsfourier.CurveCWSFourier`
+        curves on the winding surface, together with their currents
+        :math:`G/(2 n_{fp} n_{coils})`. The full set of coils is obtained with
+        :obj:`simsopt.field.coil.coils_via_symmetries`. This requires a zero
+        net toroidal current.
+
+        Args:
+            phi: the coefficients of the current potential.
+            ncoils: the number of coils per half period.
+            order: the order of the curves.
+            numquadpoints: the number of quadrature points of the curves.
+            nsamples: the number of points per contour to which the curves are
+                fitted, by default ``max(4*order, 64)``.
+
+        Returns:
+            A list of base curves and a list of base currents.
+        """
+        from ..geo.curvecwsfourier import CurveCWSFourier
+        if nsamples is None:
+            nsamples = max(4*order, 64)
+        s = self.winding_surface
+        curves = []
+        for dofs in self.cut_coils(phi, ncoils, order, nsamples):
+            curve = CurveCWSFourier(s.mpol, s.ntor, s.get_dofs(), numquadpoints, order, s.nfp, s.stellsym)
+            curve.set_dofs(np.asarray(dofs))
+            curves.append(curve)
+        currents = [Current(self.net_poloidal_current/(2*s.nfp*ncoils)) for _ in range(ncoils)]
+        return curves, currents
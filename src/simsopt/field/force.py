@@ -0,0 +1,153 @@
+import numpy as np
+
+import simsoptpp as sopp
+from .._core.optimizable import Optimizable
+from .._core.derivative import derivative_dec
+
+__all__ = ['regularization_circ', 'regularization_rect', 'coil_force_per_unit_length',
+           'coil_net_forces', 'coil_net_torques', 'LpCurveForce']
+
+
+def regularization_circ(a):
+    """
+    Regularization of the self field for a coil with a circular cross section
+    of radius ``a`` and uniform current density.
+    """
+    return a**2 / np.sqrt(np.e)
+
+
+def regularization_rect(a, b):
+    """
+    Regularization of the self field for a coil with a rectangular cross
+    section of dimensions ``a`` and ``b`` and uniform current density.
+    """
+    k = (-(b**4 - 6 * a**2 * b**2 + a**4) / (6 * a**2 * b**2) * np.log(a / b + b / a)
+         + b**2 / (6 * a**2) * np.log(b / a) + a**2 / (6 * b**2) * np.log(a / b)
+         + 4 * b / (3 * a) * np.arctan(a / b) + 4 * a / (3 * b) * np.arctan(b / a))
+    return a * b * np.exp(-25 / 6 + k)
+
+
+def _coil_arrays(coils, regularizations):
+    if np.isscalar(regularizations):
+        regularizations = [regularizations] * len(coils)
+    if len(regularizations) != len(coils):
+        raise ValueError("Need one regularization per coil.")
+    if any(len(c.curve.quadweights) > 0 for c in coils):
+        raise ValueError("The coil forces need uniformly spaced quadrature points without quadrature weights.")
+    gammas = [c.curve.gamma() for c in coils]
+    gammadashs = [c.curve.gammadash() for c in coils]
+    gammadashdashs = [c.curve.gammadashdash() for c in coils]
+    currents = [c.current.get_value() for c in coils]
+    return gammas, gammadashs, gammadashdashs, currents, [float(r) for r in regularizations]
+
+
+def coil_force_per_unit_length(coils, regularizations):
+    r"""
+    Returns the Lorentz force per unit length
+    :math:`d\mathbf{F}/dl = I \mathbf{t} \times \mathbf{B}` on the quadrature
+    points of each coil, as a list of ``(nquadpoints, 3)`` arrays. The field is
+    the one of all ``coils``, where the field of a coil on itself is the
+    regularized self field of a conductor with finite cross section (see
+    Landreman, Hurwitz, Antonsen, Nucl. Fusion 63, 2023). The regularization
+    is computed from the cross section with :obj:`regularization_circ` or
+    :obj:`regularization_rect`.
+
+    All pairs of coils are evaluated in C++ directly from the quadrature
+    points of the curves, so the quadrature points of each curve need to be
+    uniformly spaced on ``[0, 1)``. Curves with quadrature weights, e.g. from
+    :obj:`~simsopt.geo.curve.adaptive_quadrature`, raise a ``ValueError``.
+
+    Args:
+        coils: a list of :obj:`simsopt.field.coil.Coil`, e.g. including all
+            symmetric copies.
+        regularizations: the regularization of each coil, or a single value
+            for all coils.
+    """
+    return sopp.coil_forces(*_coil_arrays(coils, regularizations))
+
+
+def coil_net_forces(coils, regularizations):
+    """
+    Returns a ``(ncoils, 3)`` array containing the net force on each coil.
+    """
+    forces = coil_force_per_unit_length(coils, regularizations)
+    return np.asarray([np.mean(f * np.linalg.norm(c.curve.gammadash(), axis=1)[:, None], axis=0)
+                       for f, c in zip(forces, coils)])
+
+
+def coil_net_torques(coils, regularizations):
+    """
+    Returns a ``(ncoils, 3)`` array containing the net torque on each coil
+    about its centroid.
+    """
+    forces = coil_force_per_unit_length(coils, regularizations)
+    res = []
+    for f, c in zip(forces, coils):
+        gamma = c.curve.gamma()
+        arclength = np.linalg.norm(c.curve.gammadash(), axis=1)
+        centroid = np.sum(gamma * arclength[:, None], axis=0) / np.sum(arclength)
+        res.append(np.mean(np.cross(gamma - centroid, f) * arclength[:, None], axis=0))
+    return np.asarray(res)
+
+
+class LpCurveForce(Optimizable):
+    r"""
+    Penalty on the force per unit length on a set of coils,
+
+    .. math::
+        J = \frac{1}{p} \sum_{i} \int_{\text{coil}_i} \max(|d\mathbf{F}/dl| - F_0, 0)^p ~dl,
+
+    with :math:`d\mathbf{F}/dl` computed by :obj:`coil_force_per_unit_length`.
+    The derivatives with respect to the curve dofs and the currents are
+    computed by the adjoint of the C++ force kernel, at the cost of about
+    three force evaluations.
+
+    Args:
+        coils: a list of :obj:`simsopt.field.coil.Coil`, e.g. including all
+            symmetric copies.
+        regularizations: the regularization of each coil, or a single value
+            for all coils.
+        p: the exponent of the penalty.
+        threshold: the force per unit length :math:`F_0` below which the
+            penalty vanishes.
+    """
+
+    def __init__(self, coils, regularizations, p=2.0, threshold=0.0):
+        self.coils = coils
+        self.regularizations = regularizations
+        self.p = p
+        self.threshold = threshold
+        super().__init__(depends_on=coils)
+
+    def J(self):
+        forces = coil_force_per_unit_length(self.coils, self.regularizations)
+        res = 0
+        for f, c in zip(forces, self.coils):
+            arclength = np.linalg.norm(c.curve.gammadash(), axis=1)
+            excess = np.maximum(np.linalg.norm(f, axis=1) - self.threshold, 0)
+            res += np.mean(excess**self.p * arclength) / self.p
+        return res
+
+    @derivative_dec
+    def dJ(self):
+        args = _coil_arrays(self.coils, self.regularizations)
+        forces = sopp.coil_forces(*args)
+        v = []
+        dJ_by_dgammadash = []
+        for f, c in zip(forces, self.coils):
+            gammadash = c.curve.gammadash()
+            arclength = np.linalg.norm(gammadash, axis=1)
+            modf = np.linalg.norm(f, axis=1)
+            excess = np.maximum(modf - self.threshold, 0)
+            n = len(arclength)
+            v.append((excess**(self.p - 1) * arclength / (n * np.maximum(modf, 1e-300)))[:, None] * f)
+            dJ_by_dgammadash.append((excess**self.p / (self.p * n * arclength))[:, None] * gammadash)
+        dJ_by_dgamma, dJ_by_dgammadash_force, dJ_by_dgammadashdash, dJ_by_dcurrent = sopp.coil_forces_vjp(*args, v)
+        res = [c.curve.dgamma_by_dcoeff_vjp(dJ_by_dgamma[i])
+               + c.curve.dgammadash_by_dcoeff_vjp(dJ_by_dgammadash[i] + dJ_by_dgammadash_force[i])
+               + c.curve.dgammadashdash_by_dcoeff_vjp(dJ_by_dgammadashdash[i])
+               + c.current.vjp(np.asarray([dJ_by_dcurrent[i]]))
+               for i, c in enumerate(self.coils)]
+        return sum(res)
+
+    return_fn_map = {'J': J, 'dJ': dJ}
@@ -4,6 +4,7 @@ import simsoptpp as sopp
 from .._core.optimizable import Optimizable
 from .._core.derivative import Derivative
 from .._core.json import GSONDecoder, GSONable
+from .._core.util import parallel_fill
 
 __all__ = ['MagneticField', 'MagneticFieldSum', 'MagneticFieldMultiply']
 
@@ -27,9 +28,16 @@ class MagneticField(sopp.MagneticField, Optimizable):
     The cache is automatically cleared when ``set_points`` is called or one of the dependencies
     changes.
 
+    Several fields that are evaluated on the same points can share a
+    :obj:`simsoptpp.PointSet`, e.g. ``points = sopp.PointSet(xyz)`` followed by
+    ``field.set_points(points)`` for each field, so that the points are only
+    converted to the layout of the kernels and to cylindrical coordinates once.
+
     '''
 
     def set_points(self, xyz):
+        if isinstance(xyz, sopp.PointSet):
+            return self.set_pointset(xyz)
         return self.set_points_cart(xyz)
 
     def set_points_cart(self, xyz):
@@ -70,6 +78,47 @@ class MagneticField(sopp.MagneticField, Optimizable):
         """Multiply a field with a scalar."""
         return MagneticFieldMultiply(other, self)
 
+    def evaluate_distributed(self, xyz, comm=None, quantity="B"):
+        """
+        Evaluate the field at many points, split up across an MPI
+        communicator. Each rank evaluates ``quantity`` (e.g. ``"B"``,
+        ``"dB_by_dX"`` or ``"A"``) at its share of the points ``xyz``, and the
+        results are gathered on all ranks (see
+        :func:`~simsopt._core.util.parallel_fill`). The result is a regular
+        array on every rank, so each rank stores all values; use
+        :func:`~simsopt._core.util.parallel_fill` directly to keep a single
+        copy per node in shared memory. Every rank holds a copy of
+        the field, e.g. of the coils of a
+        :obj:`~simsopt.field.biotsavart.BiotSavart`, which is small compared to
+        the points. Has to be called by all ranks of ``comm``, with the same
+        points.
+
+        Args:
+            xyz: the points, an array of shape ``(n, 3)``.
+            comm: MPI communicator to parallelize over.
+            quantity: the name of the method of the field that is evaluated.
+
+        Returns:
+            An array of shape ``(n, ...)``, e.g. ``(n, 3)`` for ``"B"``.
+        """
+        xyz = np.ascontiguousarray(xyz, dtype=np.float64)
+        if len(xyz.shape) != 2 or xyz.shape[1] != 3 or xyz.shape[0] == 0:
+            raise ValueError(f"xyz array should have shape (n, 3) with n > 0, but has shape {xyz.shape}")
+        old_points = self.get_pointset()
+        evaluate = getattr(self, quantity)
+        self.set_points(xyz[:1])
+        shape = evaluate().shape[1:]
+
+        def fill(first, last, out):
+            if last > first:
+                self.set_points(xyz[first:last])
+                out[:] = evaluate()
+
+        with parallel_fill(comm, xyz.shape[0], shape, fill) as values:
+            res = np.array(values)
+        self.set_pointset(old_points)
+        return res
+
     def to_vtk(self, filename, nr=10, nphi=10, nz=10, rmin=1.0, rmax=2.0, zmin=-0.5, zmax=0.5):
         """Export the field evaluated on a regular grid for visualisation with e.g. Paraview."""
         from pyevtk.hl import gridToVTK
@@ -93,38 +142,28 @@ class MagneticField(sopp.MagneticField, Optimizable):
         gridToVTK(filename, X, Y, Z, pointData={"B": (contig(vals[..., 0]), contig(vals[..., 1]), contig(vals[..., 2]))})
 
 
-class MagneticFieldMultiply(MagneticField):
+class MagneticFieldMultiply(sopp.MagneticFieldScaled, MagneticField):
     """
     Class used to multiply a magnetic field by a scalar.  It takes as input a
     MagneticField class and a scalar and multiplies B, A and their derivatives
     by that value.
+
+    The product is evaluated in C++, so it can be traced and interpolated
+    without calling back into Python if ``Bfield`` is implemented in C++.
     """
 
     def __init__(self, scalar, Bfield):
         MagneticField.__init__(self, depends_on=[Bfield])
-        self.scalar = scalar
         self.Bfield = Bfield
+        sopp.MagneticFieldScaled.__init__(self, Bfield, scalar)
 
-    def _set_points_cb(self):
-        self.Bfield.set_points_cart(self.get_points_cart_ref())
-
-    def _B_impl(self, B):
-        B[:] = self.scalar*self.Bfield.B()
-
-    def _dB_by_dX_impl(self, dB):
-        dB[:] = self.scalar*self.Bfield.dB_by_dX()
-
-    def _d2B_by_dXdX_impl(self, ddB):
-        ddB[:] = self.scalar*self.Bfield.d2B_by_dXdX()
-
-    def _A_impl(self, A):
-        A[:] = self.scalar*self.Bfield.A()
-
-    def _dA_by_dX_impl(self, dA):
-        dA[:] = self.scalar*self.Bfield.dA_by_dX()
+    @property
+    def scalar(self):
+        return self.get_scalar()
 
-    def _d2A_by_dXdX_impl(self, ddA):
-        ddA[:] = self.scalar*self.Bfield.d2A_by_dXdX()
+    @scalar.setter
+    def scalar(self, value):
+        self.set_scalar(value)
 
     def as_dict(self, serial_objs_dict) -> dict:
         d = super().as_dict(serial_objs_dict=serial_objs_dict)
@@ -141,39 +180,21 @@ class MagneticFieldMultiply(MagneticField):
         return field
 
 
-class MagneticFieldSum(MagneticField):
+class MagneticFieldSum(sopp.MagneticFieldSum, MagneticField):
     """
     Class used to sum two or more magnetic field together.  It can either be
     called directly with a list of magnetic fields given as input and outputing
     another magnetic field with B, A and its derivatives added together or it
     can be called by summing magnetic fields classes as Bfield1 + Bfield1
+
+    The sum is evaluated in C++, so e.g. coils plus a Dommaschk perturbation
+    can be traced and interpolated without calling back into Python.
     """
 
     def __init__(self, Bfields):
         MagneticField.__init__(self, depends_on=Bfields)
         self.Bfields = Bfields
-
-    def _set_points_cb(self):
-        for bf in self.Bfields:
-            bf.set_points_cart(self.get_points_cart_ref())
-
-    def _B_impl(self, B):
-        B[:] = np.sum([bf.B() for bf in self.Bfields], axis=0)
-
-    def _dB_by_dX_impl(self, dB):
-        dB[:] = np.sum([bf.dB_by_dX() for bf in self.Bfields], axis=0)
-
-    def _d2B_by_dXdX_impl(self, ddB):
-        ddB[:] = np.sum([bf.d2B_by_dXdX() for bf in self.Bfields], axis=0)
-
-    def _A_impl(self, A):
-        A[:] = np.sum([bf.A() for bf in self.Bfields], axis=0)
-
-    def _dA_by_dX_impl(self, dA):
-        dA[:] = np.sum([bf.dA_by_dX() for bf in self.Bfields], axis=0)
-
-    def _d2A_by_dXdX_impl(self, ddA):
-        ddA[:] = np.sum([bf.d2A_by_dXdX() for bf in self.Bfields], axis=0)
+        sopp.MagneticFieldSum.__init__(self, Bfields)
 
     def B_vjp(self, v):
         return sum([bf.B_vjp(v) for bf in self.Bfields if np.any(bf.dofs_free_status)])
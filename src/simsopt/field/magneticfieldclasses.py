@@ -13,11 +13,12 @@ except ImportError:
 import simsoptpp as sopp
 from .magneticfield import MagneticField
 from .._core.json import GSONable, GSONDecoder
+from .._core.util import parallel_fill, parallel_loop_bounds, shared_array
 
 logger = logging.getLogger(__name__)
 
 __all__ = ['ToroidalField', 'PoloidalField', 'ScalarPotentialRZMagneticField',
-           'CircularCoil', 'Dommaschk', 'Reiman', 'InterpolatedField', 'DipoleField']
+           'CircularCoil', 'Dommaschk', 'Reiman', 'SurfaceCurrentField', 'InterpolatedField', 'DipoleField']
 
 
 class ToroidalField(MagneticField):
@@ -551,19 +552,19 @@ class DipoleField(MagneticField):
 
     def _B_impl(self, B):
         points = self.get_points_cart_ref()
-        B[:] = sopp.dipole_field_B(points, self.dipole_grid, self.m_vec)
+        sopp.dipole_field_B(points, self.dipole_grid, self.m_vec, out=B)
 
     def _dB_by_dX_impl(self, dB):
         points = self.get_points_cart_ref()
-        dB[:] = sopp.dipole_field_dB(points, self.dipole_grid, self.m_vec)
+        sopp.dipole_field_dB(points, self.dipole_grid, self.m_vec, out=dB)
 
     def _A_impl(self, A):
         points = self.get_points_cart_ref()
-        A[:] = sopp.dipole_field_A(points, self.dipole_grid, self.m_vec)
+        sopp.dipole_field_A(points, self.dipole_grid, self.m_vec, out=A)
 
     def _dA_by_dX_impl(self, dA):
         points = self.get_points_cart_ref()
-        dA[:] = sopp.dipole_field_dA(points, self.dipole_grid, self.m_vec)
+        sopp.dipole_field_dA(points, self.dipole_grid, self.m_vec, out=dA)
 
     def _dipole_fields_from_symmetries(self, dipole_grid, dipole_vectors, stellsym=True, nfp=1, coordinate_flag='cartesian', m_maxima=None, R0=1):
         """
@@ -686,13 +687,18 @@ class DipoleField(MagneticField):
         )
 
 
-class Dommaschk(MagneticField):
+class Dommaschk(sopp.DommaschkField, MagneticField):
     """
     Vacuum magnetic field created by an explicit representation of the magnetic
     field scalar potential as proposed by W. Dommaschk (1986), Computer Physics
     Communications 40, 203-218. As inputs, it takes the arrays for the harmonics
     m, n and its corresponding coefficients.
 
+    The field, including the toroidal field of strength ``1/R``, is
+    evaluated in C++, so it can be used directly by
+    :obj:`InterpolatedField` and the tracing routines without calling back
+    into Python.
+
     Args:
         m: first harmonic array
         n: second harmonic array
@@ -704,18 +710,8 @@ class Dommaschk(MagneticField):
         self.m = np.array(mn, dtype=np.int16)[:, 0]
         self.n = np.array(mn, dtype=np.int16)[:, 1]
         self.coeffs = coeffs
-        self.Btor = ToroidalField(1, 1)
-
-    def _set_points_cb(self):
-        self.Btor.set_points_cart(self.get_points_cart_ref())
-
-    def _B_impl(self, B):
-        points = self.get_points_cart_ref()
-        B[:] = np.add.reduce(sopp.DommaschkB(self.m, self.n, self.coeffs, points))+self.Btor.B()
-
-    def _dB_by_dX_impl(self, dB):
-        points = self.get_points_cart_ref()
-        dB[:] = np.add.reduce(sopp.DommaschkdB(self.m, self.n, self.coeffs, points))+self.Btor.dB_by_dX()
+        sopp.DommaschkField.__init__(self, [int(m) for m in self.m], [int(n) for n in self.n],
+                                     np.asarray(coeffs, dtype=np.float64).reshape((-1, 2)).tolist())
 
     @property
     def mn(self):
@@ -736,13 +732,17 @@ class Dommaschk(MagneticField):
         return field
 
 
-class Reiman(MagneticField):
+class Reiman(sopp.ReimanField, MagneticField):
     '''
     Magnetic field model in section 5 of Reiman and Greenside, Computer Physics Communications 43 (1986) 157—167.
     This field allows for an analytical expression of the magnetic island width
     that can be used for island optimization.  However, the field is not
     completely physical as it does not have nested flux surfaces.
 
+    The field is evaluated in C++, so it can be used directly by
+    :obj:`InterpolatedField` and the tracing routines without calling back
+    into Python.
+
     Args:
         iota0: unperturbed rotational transform
         iota1: unperturbed global magnetic shear
@@ -758,14 +758,70 @@ class Reiman(MagneticField):
         self.k = k
         self.epsilonk = epsilonk
         self.m0 = m0
+        sopp.ReimanField.__init__(self, iota0, iota1, [int(kk) for kk in k],
+                                  [float(e) for e in epsilonk], int(m0))
 
-    def _B_impl(self, B):
-        points = self.get_points_cart_ref()
-        B[:] = sopp.ReimanB(self.iota0, self.iota1, self.k, self.epsilonk, self.m0, points)
+    def as_dict(self, serial_objs_dict):
+        d = super().as_dict(serial_objs_dict=serial_objs_dict)
+        d["points"] = self.get_points_cart()
+        return d
 
-    def _dB_by_dX_impl(self, dB):
-        points = self.get_points_cart_ref()
-        dB[:] = sopp.ReimandB(self.iota0, self.iota1, self.k, self.epsilonk, self.m0, points)
+    @classmethod
+    def from_dict(cls, d, serial_objs_dict, recon_objs):
+        field = cls(d["iota0"], d["iota1"], d["k"], d["epsilonk"], d["m0"])
+        decoder = GSONDecoder()
+        xyz = decoder.process_decoded(d["points"], serial_objs_dict, recon_objs)
+        field.set_points_cart(xyz)
+        return field
+
+
+class SurfaceCurrentField(sopp.SurfaceCurrentField, MagneticField):
+    r"""
+    Magnetic field of a current sheet on a surface,
+
+    .. math::
+        \mathbf{B}(\mathbf{x}) = \frac{\mu_0}{4\pi} \int_S \mathbf{K}(\mathbf{y}) \times \frac{\mathbf{x} - \mathbf{y}}{|\mathbf{x} - \mathbf{y}|^3} dA(\mathbf{y}),
+
+    e.g. the current on a winding surface, or, by the virtual casing
+    principle, :math:`\mathbf{K} = \mathbf{n} \times \mathbf{B}/\mu_0` on a
+    flux surface with total field :math:`\mathbf{B}`, whose field outside of
+    the surface is the one of the plasma currents.
+
+    The integral is computed in C++ with the trapezoidal rule on the
+    quadrature points of the surface, so the field can be used directly by
+    :obj:`InterpolatedField` and the tracing routines. Points that coincide
+    with a quadrature point skip that point, which gives the average of the
+    fields on both sides of the sheet. If ``theta > 0``, blocks of quadrature
+    points that are far from the targets, relative to their size divided by
+    ``theta``, are replaced by their multipole expansion.
+
+    The quadrature points and current elements are computed from the surface
+    once and kept until ``K`` or the dofs of the surface change. If the
+    surface is changed in another way, call ``invalidate_sources()``.
+
+    Args:
+        surface: a :obj:`simsopt.geo.surface.Surface` whose quadrature points
+            cover the full torus, e.g. created with ``range="full torus"``.
+        K: a ``(nphi, ntheta, 3)`` array containing the surface current density
+            in cartesian coordinates at the quadrature points of ``surface``.
+        theta: the opening parameter of the multipole approximation, ``0``
+            evaluates the sum directly.
+    """
+
+    def __init__(self, surface, K, theta=0.):
+        for quadpoints in [surface.quadpoints_phi, surface.quadpoints_theta]:
+            if not np.allclose(quadpoints, np.linspace(0, 1, len(quadpoints), endpoint=False)):
+                raise ValueError("The quadrature points of the surface need to cover the full torus uniformly.")
+        MagneticField.__init__(self, depends_on=[surface])
+        self.surface = surface
+        sopp.SurfaceCurrentField.__init__(self, surface, np.ascontiguousarray(K, dtype=np.float64), float(theta))
+
+    def recompute_bell(self, parent=None):
+        self.invalidate_sources()
+
+    @property
+    def K(self):
+        return self.get_K()
 
     def as_dict(self, serial_objs_dict):
         d = super().as_dict(serial_objs_dict=serial_objs_dict)
@@ -774,8 +830,10 @@ class Reiman(MagneticField):
 
     @classmethod
     def from_dict(cls, d, serial_objs_dict, recon_objs):
-        field = cls(d["iota0"], d["iota1"], d["k"], d["epsilonk"], d["m0"])
         decoder = GSONDecoder()
+        surface = decoder.process_decoded(d["surface"], serial_objs_dict, recon_objs)
+        K = decoder.process_decoded(d["K"], serial_objs_dict, recon_objs)
+        field = cls(surface, K, d["theta"])
         xyz = decoder.process_decoded(d["points"], serial_objs_dict, recon_objs)
         field.set_points_cart(xyz)
         return field
@@ -839,6 +897,49 @@ class InterpolatedField(sopp.InterpolatedField, MagneticField):
 
         sopp.InterpolatedField.__init__(self, field, degree, rrange, phirange, zrange, extrapolate, nfp, stellsym, skip)
         self.__field = field
+        # the tables of the interpolants that are stored in shared memory
+        # windows by build_interpolants, as (table, nodecomm, win)
+        self._shared_tables = {}
+
+    def build_interpolants(self, comm=None, quantities=("B", "GradAbsB")):
+        """
+        Build the interpolants of the given quantities, with the evaluation
+        of the underlying field at the interpolation nodes split up across an
+        MPI communicator. The values at the nodes are gathered once per node
+        (see :func:`~simsopt._core.util.parallel_fill`). The ranks on a node
+        then fill the tables of the cells of the interpolant together, in a
+        shared memory window (see :func:`~simsopt._core.util.shared_array`)
+        that all of them evaluate the interpolant from, so that the tables are
+        stored once per node. Has to be called by all ranks of ``comm``
+        before the field is evaluated, otherwise each rank evaluates the
+        underlying field at all nodes when ``B()`` or ``GradAbsB()`` is first
+        called. Calling it again, also with ``comm=None``, frees the shared
+        memory of the previous call, so it has to be called by all ranks
+        again.
+
+        Args:
+            comm: MPI communicator to parallelize over.
+            quantities: a subset of ``("B", "GradAbsB")``.
+        """
+        for quantity in quantities:
+            if quantity not in ("B", "GradAbsB"):
+                raise ValueError(f"Unknown quantity {quantity}, can only interpolate B and GradAbsB.")
+            with parallel_fill(comm, self.num_dofs(), (3, ), getattr(self, "evaluate_dofs_" + quantity)) as values:
+                old = self._shared_tables.pop(quantity, None)
+                if comm is None:
+                    getattr(self, "set_values_" + quantity)(values)
+                else:
+                    table, nodecomm, win = shared_array(comm, (self.num_cells(), self.cell_table_size()))
+                    first, last = parallel_loop_bounds(nodecomm, self.num_cells())
+                    win.Fence()
+                    getattr(self, "fill_table_" + quantity)(values, first, last, table[first:last])
+                    win.Fence()
+                    getattr(self, "set_table_" + quantity)(table)
+                    self._shared_tables[quantity] = (table, nodecomm, win)
+                # the interpolant no longer uses the previous table
+                if old is not None:
+                    old[2].Free()
+                    old[1].Free()
 
     def to_vtk(self, filename):
         """Export the field evaluated on a regular grid for visualisation with e.g. Paraview."""
@@ -9,6 +9,7 @@ from .curvexyzfourier import *
 from .curveperturbed import *
 from .curveobjectives import *
 from .curvecwsfourier import *
+from .curvecollection import *
 
 from .finitebuild import *
 from .plotting import *
@@ -26,7 +27,7 @@ from .surfacexyztensorfourier import *
 from .permanent_magnet_grid import *
 
 __all__ = (curve.__all__ + curvehelical.__all__ +
-           curvecwsfourier.__all__ +
+           curvecwsfourier.__all__ + curvecollection.__all__ +
            curverzfourier.__all__ + curvexyzfourier.__all__ +
            curveperturbed.__all__ + curveobjectives.__all__ +
            finitebuild.__all__ + plotting.__all__ +
@@ -11,7 +11,8 @@ from .._core.derivative import Derivative
 from .jit import jit
 from .plotting import fix_matplotlib_3d
 
-__all__ = ['Curve', 'RotatedCurve', 'curves_to_vtk', 'create_equally_spaced_curves']
+__all__ = ['Curve', 'RotatedCurve', 'curves_to_vtk', 'create_equally_spaced_curves',
+           'adaptive_quadrature']
 
 
 @jit
@@ -73,6 +74,32 @@ class Curve(Optimizable):
         """
         self.invalidate_cache()
 
+    def quadrature_weights(self):
+        """
+        Returns the weights of the quadrature points for integrals over the
+        curve parameter, i.e. the weights set with ``set_quadweights``, or
+        ``1/numquadpoints`` for each point if none were set.
+        """
+        n = len(self.quadpoints)
+        if len(self.quadweights) > 0:
+            return np.asarray(self.quadweights)
+        return np.full((n, ), 1./n)
+
+    def as_dict(self, serial_objs_dict=None):
+        d = super().as_dict(serial_objs_dict=serial_objs_dict)
+        if len(self.quadweights) > 0:
+            d["quadweights"] = list(self.quadweights)
+        return d
+
+    @classmethod
+    def from_dict(cls, d, serial_objs_dict, recon_objs):
+        d = dict(d)
+        quadweights = d.pop("quadweights", None)
+        curve = super().from_dict(d, serial_objs_dict, recon_objs)
+        if quadweights is not None:
+            curve.set_quadweights(quadweights)
+        return curve
+
     def plot(self, engine="matplotlib", ax=None, show=True, plot_derivative=False, close=False, axis_equal=True, **kwargs):
         """
         Plot the curve in 3D using ``matplotlib.pyplot``, ``mayavi``, or ``plotly``.
@@ -625,6 +652,7 @@ class RotatedCurve(sopp.Curve, Curve):
     def __init__(self, curve, phi, flip):
         self.curve = curve
         sopp.Curve.__init__(self, curve.quadpoints)
+        self.set_quadweights(curve.quadweights)
         Curve.__init__(self, depends_on=[curve])
         self._phi = phi
         self.rotmat = np.asarray(
@@ -879,3 +907,99 @@ def create_equally_spaced_curves(ncurves, nfp, stellsym, R0=1.0, R1=0.5, order=6
         curve.x = curve.x  # need to do this to transfer data to C++
         curves.append(curve)
     return curves
+
+
+def adaptive_quadrature(curve, numquadpoints, target_points=None, distance_weight=16., curvature_weight=1., numsamples=None):
+    r"""
+    Compute non-uniform quadrature points and weights for ``curve`` that are
+    concentrated where the curve is strongly curved and, if ``target_points``
+    are given, where the curve comes close to these points, e.g. a magnet grid
+    or a winding surface on which the Biot-Savart field is evaluated.
+
+    The points are placed according to the density
+
+    .. math::
+
+        \rho(t) \propto |\Gamma'(t)| \left(1 + w_\kappa \frac{\kappa(t)}{\bar\kappa}\right)\left(1 + w_d \frac{d_\min}{d(t)}\right)
+
+    where :math:`\kappa` is the curvature, :math:`\bar\kappa` its mean,
+    :math:`d(t)` the distance of :math:`\Gamma(t)` to the closest target point
+    and :math:`d_\min` the smallest such distance. :math:`\rho` is smoothed by
+    a positive (Fejer) Fourier filter, and the points are given by
+    :math:`t_j = \tau(j/N)`, where :math:`\tau` is the inverse of the
+    cumulative density. The weights :math:`\tau'(j/N)/N = 1/(N\rho(t_j))`
+    result in a quadrature rule that retains the spectral accuracy of the
+    uniform rule for smooth integrands.
+
+    Usage example:
+
+    .. code-block::
+
+        quadpoints, quadweights = adaptive_quadrature(curve, 64, target_points=points)
+        adapted = CurveXYZFourier(quadpoints, curve.order)
+        adapted.x = curve.x
+        adapted.set_quadweights(quadweights)
+
+    The weights are used by :obj:`~simsopt.field.biotsavart.BiotSavart` and
+    by the objectives in :mod:`simsopt.geo.curveobjectives`, and they are
+    saved along with the curve. Note that they need to be set before applying
+    symmetries via :obj:`~simsopt.geo.curve.RotatedCurve`. The coil forces in
+    :mod:`simsopt.field.force` need uniformly spaced quadrature points.
+
+    Args:
+        curve: the curve, whose ``gamma_impl`` can be evaluated at arbitrary quadrature points.
+        numquadpoints: number of quadrature points to return.
+        target_points: array of shape ``(n, 3)`` or ``None``.
+        distance_weight: weight :math:`w_d` of the distance term.
+        curvature_weight: weight :math:`w_\kappa` of the curvature term.
+        numsamples: number of uniformly spaced points at which the density is
+                    sampled, defaults to ``max(16 * numquadpoints, 1024)``.
+
+    Returns:
+        quadpoints and quadweights, both arrays of length ``numquadpoints``.
+    """
+    if numsamples is None:
+        numsamples = max(16 * numquadpoints, 1024)
+    samples = np.linspace(0, 1, numsamples, endpoint=False)
+    gamma = np.zeros((numsamples, 3))
+    curve.gamma_impl(gamma, samples)
+    # derivatives of the samples by spectral differentiation
+    freqs = 2j * np.pi * np.fft.fftfreq(numsamples, d=1./numsamples)
+    gamma_hat = np.fft.fft(gamma, axis=0)
+    gammadash = np.real(np.fft.ifft(freqs[:, None] * gamma_hat, axis=0))
+    gammadashdash = np.real(np.fft.ifft(freqs[:, None]**2 * gamma_hat, axis=0))
+
+    arclength = np.linalg.norm(gammadash, axis=1)
+    density = arclength.copy()
+    if curvature_weight > 0:
+        kappa = np.linalg.norm(np.cross(gammadash, gammadashdash), axis=1)/arclength**3
+        density *= 1 + curvature_weight * kappa/np.mean(kappa)
+    if target_points is not None and distance_weight > 0:
+        from scipy.spatial import KDTree
+        dist = KDTree(np.asarray(target_points).reshape((-1, 3))).query(gamma)[0]
+        density *= 1 + distance_weight * np.min(dist)/dist
+
+    # smooth and normalize the density, rho(t) = 1 + sum_k a_k cos(2 pi k t) + b_k sin(2 pi k t)
+    coeffs = np.fft.rfft(density)
+    nummodes = numsamples // 4
+    k = np.arange(1, nummodes + 1)
+    fejer = 1 - k/(nummodes + 1)
+    a = 2 * coeffs[1:nummodes+1].real * fejer / coeffs[0].real
+    b = -2 * coeffs[1:nummodes+1].imag * fejer / coeffs[0].real
+
+    def rho(t):
+        return 1 + np.cos(2*np.pi*np.outer(t, k)) @ a + np.sin(2*np.pi*np.outer(t, k)) @ b
+
+    def cumulative(t):
+        return t + np.sin(2*np.pi*np.outer(t, k)) @ (a/(2*np.pi*k)) \
+            + (1 - np.cos(2*np.pi*np.outer(t, k))) @ (b/(2*np.pi*k))
+
+    # invert the cumulative density: initial guess by interpolation, then Newton
+    u = np.arange(numquadpoints)/numquadpoints
+    t = np.interp(u, cumulative(samples), samples)
+    for _ in range(20):
+        dt = (cumulative(t) - u)/rho(t)
+        t -= dt
+        if np.max(np.abs(dt)) < 1e-14:
+            break
+    return t, 1./(numquadpoints * rho(t))
@@ -0,0 +1,63 @@
+import numpy as np
+
+import simsoptpp as sopp
+from .._core.derivative import Derivative
+from .curvexyzfourier import CurveXYZFourier
+
+__all__ = ['CurveCollection']
+
+
+class CurveCollection(sopp.CurveXYZFourierCollection):
+    r"""
+    ``CurveCollection`` evaluates a list of :obj:`CurveXYZFourier` curves of
+    the same order and with the same quadrature points as one block. The
+    Fourier coefficients of all curves are stored in a single
+    structure-of-arrays block, and ``gamma()``, ``gammadash()``, ... return
+    arrays of shape ``(ncurves, numquadpoints, 3)`` that are computed by one
+    matrix product for all curves.
+
+    The collection does not own any dofs: it reads the dofs of the curves
+    whenever a block is requested, so the curves can be optimized as usual.
+    The entries of :meth:`gammas` and :meth:`gammadashs` are views into the
+    blocks and can be passed to the Biot-Savart functions in ``simsoptpp``
+    without copying.
+
+    Args:
+        curves: list of :obj:`CurveXYZFourier`.
+    """
+
+    def __init__(self, curves):
+        curves = list(curves)
+        if not all(isinstance(c, CurveXYZFourier) for c in curves):
+            raise ValueError("CurveCollection only supports curves of type CurveXYZFourier.")
+        self.curves = curves
+        sopp.CurveXYZFourierCollection.__init__(self, curves)
+
+    def gammas(self):
+        """
+        List of arrays of shape ``(numquadpoints, 3)``, one per curve, which
+        are views into ``gamma()``.
+        """
+        return list(self.gamma())
+
+    def gammadashs(self):
+        """
+        List of arrays of shape ``(numquadpoints, 3)``, one per curve, which
+        are views into ``gammadash()``.
+        """
+        return list(self.gammadash())
+
+    def dgamma_and_dgammadash_by_dcoeff_vjp(self, v_gamma, v_gammadash):
+        r"""
+        Returns the sum of the vector Jacobian products
+
+        .. math::
+            \sum_c v_{\gamma, c}^T \frac{\partial \Gamma_c}{\partial \mathbf c} + v_{\gamma', c}^T \frac{\partial \Gamma'_c}{\partial \mathbf c}
+
+        as a :obj:`~simsopt._core.derivative.Derivative`. ``v_gamma`` and
+        ``v_gammadash`` are either arrays of shape ``(ncurves, numquadpoints, 3)``
+        or lists of arrays of shape ``(numquadpoints, 3)``.
+        """
+        res = self.dgamma_by_dcoeff_vjp(np.ascontiguousarray(v_gamma, dtype=np.float64)) \
+            + self.dgammadash_by_dcoeff_vjp(np.ascontiguousarray(v_gammadash, dtype=np.float64))
+        return sum([Derivative({c: res[i]}) for i, c in enumerate(self.curves)], Derivative({}))
@@ -16,11 +16,11 @@ __all__ = ['CurveLength', 'LpCurveCurvature', 'LpCurveTorsion',
 
 
 @jit
-def curve_length_pure(l):
+def curve_length_pure(l, w):
     """
     This function is used in a Python+Jax implementation of the curve length formula.
     """
-    return jnp.mean(l)
+    return jnp.sum(w * l)
 
 
 class CurveLength(Optimizable):
@@ -34,14 +34,14 @@ class CurveLength(Optimizable):
 
     def __init__(self, curve):
         self.curve = curve
-        self.thisgrad = jit(lambda l: grad(curve_length_pure)(l))
+        self.thisgrad = jit(lambda l, w: grad(curve_length_pure)(l, w))
         super().__init__(depends_on=[curve])
 
     def J(self):
         """
         This returns the value of the quantity.
         """
-        return curve_length_pure(self.curve.incremental_arclength())
+        return curve_length_pure(self.curve.incremental_arclength(), self.curve.quadrature_weights())
 
     @derivative_dec
     def dJ(self):
@@ -50,18 +50,18 @@ class CurveLength(Optimizable):
         """
 
         return self.curve.dincremental_arclength_by_dcoeff_vjp(
-            self.thisgrad(self.curve.incremental_arclength()))
+            self.thisgrad(self.curve.incremental_arclength(), self.curve.quadrature_weights()))
 
     return_fn_map = {'J': J, 'dJ': dJ}
 
 
 @jit
-def Lp_curvature_pure(kappa, gammadash, p, desired_kappa):
+def Lp_curvature_pure(kappa, gammadash, w, p, desired_kappa):
     """
     This function is used in a Python+Jax implementation of the curvature penalty term.
     """
     arc_length = jnp.linalg.norm(gammadash, axis=1)
-    return (1./p)*jnp.mean(jnp.maximum(kappa-desired_kappa, 0)**p * arc_length)
+    return (1./p)*jnp.sum(w * jnp.maximum(kappa-desired_kappa, 0)**p * arc_length)
 
 
 class LpCurveCurvature(Optimizable):
@@ -80,35 +80,36 @@ class LpCurveCurvature(Optimizable):
         self.p = p
         self.threshold = threshold
         super().__init__(depends_on=[curve])
-        self.J_jax = jit(lambda kappa, gammadash: Lp_curvature_pure(kappa, gammadash, p, threshold))
-        self.thisgrad0 = jit(lambda kappa, gammadash: grad(self.J_jax, argnums=0)(kappa, gammadash))
-        self.thisgrad1 = jit(lambda kappa, gammadash: grad(self.J_jax, argnums=1)(kappa, gammadash))
+        self.J_jax = jit(lambda kappa, gammadash, w: Lp_curvature_pure(kappa, gammadash, w, p, threshold))
+        self.thisgrad0 = jit(lambda kappa, gammadash, w: grad(self.J_jax, argnums=0)(kappa, gammadash, w))
+        self.thisgrad1 = jit(lambda kappa, gammadash, w: grad(self.J_jax, argnums=1)(kappa, gammadash, w))
 
     def J(self):
         """
         This returns the value of the quantity.
         """
-        return self.J_jax(self.curve.kappa(), self.curve.gammadash())
+        return self.J_jax(self.curve.kappa(), self.curve.gammadash(), self.curve.quadrature_weights())
 
     @derivative_dec
     def dJ(self):
         """
         This returns the derivative of the quantity with respect to the curve dofs.
         """
-        grad0 = self.thisgrad0(self.curve.kappa(), self.curve.gammadash())
-        grad1 = self.thisgrad1(self.curve.kappa(), self.curve.gammadash())
+        w = self.curve.quadrature_weights()
+        grad0 = self.thisgrad0(self.curve.kappa(), self.curve.gammadash(), w)
+        grad1 = self.thisgrad1(self.curve.kappa(), self.curve.gammadash(), w)
         return self.curve.dkappa_by_dcoeff_vjp(grad0) + self.curve.dgammadash_by_dcoeff_vjp(grad1)
 
     return_fn_map = {'J': J, 'dJ': dJ}
 
 
 @jit
-def Lp_torsion_pure(torsion, gammadash, p, threshold):
+def Lp_torsion_pure(torsion, gammadash, w, p, threshold):
     """
     This function is used in a Python+Jax implementation of the formula for the torsion penalty term.
     """
     arc_length = jnp.linalg.norm(gammadash, axis=1)
-    return (1./p)*jnp.mean(jnp.maximum(jnp.abs(torsion)-threshold, 0)**p * arc_length)
+    return (1./p)*jnp.sum(w * jnp.maximum(jnp.abs(torsion)-threshold, 0)**p * arc_length)
 
 
 class LpCurveTorsion(Optimizable):
@@ -125,36 +126,37 @@ class LpCurveTorsion(Optimizable):
         self.curve = curve
         self.p = p
         self.threshold = threshold
-        self.J_jax = jit(lambda torsion, gammadash: Lp_torsion_pure(torsion, gammadash, p, threshold))
-        self.thisgrad0 = jit(lambda torsion, gammadash: grad(self.J_jax, argnums=0)(torsion, gammadash))
-        self.thisgrad1 = jit(lambda torsion, gammadash: grad(self.J_jax, argnums=1)(torsion, gammadash))
+        self.J_jax = jit(lambda torsion, gammadash, w: Lp_torsion_pure(torsion, gammadash, w, p, threshold))
+        self.thisgrad0 = jit(lambda torsion, gammadash, w: grad(self.J_jax, argnums=0)(torsion, gammadash, w))
+        self.thisgrad1 = jit(lambda torsion, gammadash, w: grad(self.J_jax, argnums=1)(torsion, gammadash, w))
         super().__init__(depends_on=[curve])
 
     def J(self):
         """
         This returns the value of the quantity.
         """
-        return self.J_jax(self.curve.torsion(), self.curve.gammadash())
+        return self.J_jax(self.curve.torsion(), self.curve.gammadash(), self.curve.quadrature_weights())
 
     @derivative_dec
     def dJ(self):
         """
         This returns the derivative of the quantity with respect to the curve dofs.
         """
-        grad0 = self.thisgrad0(self.curve.torsion(), self.curve.gammadash())
-        grad1 = self.thisgrad1(self.curve.torsion(), self.curve.gammadash())
+        w = self.curve.quadrature_weights()
+        grad0 = self.thisgrad0(self.curve.torsion(), self.curve.gammadash(), w)
+        grad1 = self.thisgrad1(self.curve.torsion(), self.curve.gammadash(), w)
         return self.curve.dtorsion_by_dcoeff_vjp(grad0) + self.curve.dgammadash_by_dcoeff_vjp(grad1)
 
     return_fn_map = {'J': J, 'dJ': dJ}
 
 
-def cc_distance_pure(gamma1, l1, gamma2, l2, minimum_distance):
+def cc_distance_pure(gamma1, l1, w1, gamma2, l2, w2, minimum_distance):
     """
     This function is used in a Python+Jax implementation of the curve-curve distance formula.
     """
     dists = jnp.sqrt(jnp.sum((gamma1[:, None, :] - gamma2[None, :, :])**2, axis=2))
-    alen = jnp.linalg.norm(l1, axis=1)[:, None] * jnp.linalg.norm(l2, axis=1)[None, :]
-    return jnp.sum(alen * jnp.maximum(minimum_distance-dists, 0)**2)/(gamma1.shape[0]*gamma2.shape[0])
+    alen = (w1 * jnp.linalg.norm(l1, axis=1))[:, None] * (w2 * jnp.linalg.norm(l2, axis=1))[None, :]
+    return jnp.sum(alen * jnp.maximum(minimum_distance-dists, 0)**2)
 
 
 class CurveCurveDistance(Optimizable):
@@ -183,11 +185,11 @@ class CurveCurveDistance(Optimizable):
         self.curves = curves
         self.minimum_distance = minimum_distance
 
-        self.J_jax = jit(lambda gamma1, l1, gamma2, l2: cc_distance_pure(gamma1, l1, gamma2, l2, minimum_distance))
-        self.thisgrad0 = jit(lambda gamma1, l1, gamma2, l2: grad(self.J_jax, argnums=0)(gamma1, l1, gamma2, l2))
-        self.thisgrad1 = jit(lambda gamma1, l1, gamma2, l2: grad(self.J_jax, argnums=1)(gamma1, l1, gamma2, l2))
-        self.thisgrad2 = jit(lambda gamma1, l1, gamma2, l2: grad(self.J_jax, argnums=2)(gamma1, l1, gamma2, l2))
-        self.thisgrad3 = jit(lambda gamma1, l1, gamma2, l2: grad(self.J_jax, argnums=3)(gamma1, l1, gamma2, l2))
+        self.J_jax = jit(lambda gamma1, l1, w1, gamma2, l2, w2: cc_distance_pure(gamma1, l1, w1, gamma2, l2, w2, minimum_distance))
+        self.thisgrad0 = jit(lambda gamma1, l1, w1, gamma2, l2, w2: grad(self.J_jax, argnums=0)(gamma1, l1, w1, gamma2, l2, w2))
+        self.thisgrad1 = jit(lambda gamma1, l1, w1, gamma2, l2, w2: grad(self.J_jax, argnums=1)(gamma1, l1, w1, gamma2, l2, w2))
+        self.thisgrad2 = jit(lambda gamma1, l1, w1, gamma2, l2, w2: grad(self.J_jax, argnums=3)(gamma1, l1, w1, gamma2, l2, w2))
+        self.thisgrad3 = jit(lambda gamma1, l1, w1, gamma2, l2, w2: grad(self.J_jax, argnums=4)(gamma1, l1, w1, gamma2, l2, w2))
         self.candidates = None
         self.num_basecurves = num_basecurves or len(curves)
         super().__init__(depends_on=curves)
@@ -222,9 +224,11 @@ class CurveCurveDistance(Optimizable):
         for i, j in self.candidates:
             gamma1 = self.curves[i].gamma()
             l1 = self.curves[i].gammadash()
+            w1 = self.curves[i].quadrature_weights()
             gamma2 = self.curves[j].gamma()
             l2 = self.curves[j].gammadash()
-            res += self.J_jax(gamma1, l1, gamma2, l2)
+            w2 = self.curves[j].quadrature_weights()
+            res += self.J_jax(gamma1, l1, w1, gamma2, l2, w2)
 
         return res
 
@@ -240,12 +244,14 @@ class CurveCurveDistance(Optimizable):
         for i, j in self.candidates:
             gamma1 = self.curves[i].gamma()
             l1 = self.curves[i].gammadash()
+            w1 = self.curves[i].quadrature_weights()
             gamma2 = self.curves[j].gamma()
             l2 = self.curves[j].gammadash()
-            dgamma_by_dcoeff_vjp_vecs[i] += self.thisgrad0(gamma1, l1, gamma2, l2)
-            dgammadash_by_dcoeff_vjp_vecs[i] += self.thisgrad1(gamma1, l1, gamma2, l2)
-            dgamma_by_dcoeff_vjp_vecs[j] += self.thisgrad2(gamma1, l1, gamma2, l2)
-            dgammadash_by_dcoeff_vjp_vecs[j] += self.thisgrad3(gamma1, l1, gamma2, l2)
+            w2 = self.curves[j].quadrature_weights()
+            dgamma_by_dcoeff_vjp_vecs[i] += self.thisgrad0(gamma1, l1, w1, gamma2, l2, w2)
+            dgammadash_by_dcoeff_vjp_vecs[i] += self.thisgrad1(gamma1, l1, w1, gamma2, l2, w2)
+            dgamma_by_dcoeff_vjp_vecs[j] += self.thisgrad2(gamma1, l1, w1, gamma2, l2, w2)
+            dgammadash_by_dcoeff_vjp_vecs[j] += self.thisgrad3(gamma1, l1, w1, gamma2, l2, w2)
 
         res = [self.curves[i].dgamma_by_dcoeff_vjp(dgamma_by_dcoeff_vjp_vecs[i]) + self.curves[i].dgammadash_by_dcoeff_vjp(dgammadash_by_dcoeff_vjp_vecs[i]) for i in range(len(self.curves))]
         return sum(res)
@@ -253,16 +259,16 @@ class CurveCurveDistance(Optimizable):
     return_fn_map = {'J': J, 'dJ': dJ}
 
 
-def cs_distance_pure(gammac, lc, gammas, ns, minimum_distance):
+def cs_distance_pure(gammac, lc, wc, gammas, ns, minimum_distance):
     """
     This function is used in a Python+Jax implementation of the curve-surface distance
     formula.
     """
     dists = jnp.sqrt(jnp.sum(
         (gammac[:, None, :] - gammas[None, :, :])**2, axis=2))
-    integralweight = jnp.linalg.norm(lc, axis=1)[:, None] \
+    integralweight = (wc * jnp.linalg.norm(lc, axis=1))[:, None] \
         * jnp.linalg.norm(ns, axis=1)[None, :]
-    return jnp.mean(integralweight * jnp.maximum(minimum_distance-dists, 0)**2)
+    return jnp.sum(integralweight * jnp.maximum(minimum_distance-dists, 0)**2)/gammas.shape[0]
 
 
 class CurveSurfaceDistance(Optimizable):
@@ -290,9 +296,9 @@ class CurveSurfaceDistance(Optimizable):
         self.surface = surface
         self.minimum_distance = minimum_distance
 
-        self.J_jax = jit(lambda gammac, lc, gammas, ns: cs_distance_pure(gammac, lc, gammas, ns, minimum_distance))
-        self.thisgrad0 = jit(lambda gammac, lc, gammas, ns: grad(self.J_jax, argnums=0)(gammac, lc, gammas, ns))
-        self.thisgrad1 = jit(lambda gammac, lc, gammas, ns: grad(self.J_jax, argnums=1)(gammac, lc, gammas, ns))
+        self.J_jax = jit(lambda gammac, lc, wc, gammas, ns: cs_distance_pure(gammac, lc, wc, gammas, ns, minimum_distance))
+        self.thisgrad0 = jit(lambda gammac, lc, wc, gammas, ns: grad(self.J_jax, argnums=0)(gammac, lc, wc, gammas, ns))
+        self.thisgrad1 = jit(lambda gammac, lc, wc, gammas, ns: grad(self.J_jax, argnums=1)(gammac, lc, wc, gammas, ns))
         self.candidates = None
         super().__init__(depends_on=curves)  # Bharat's comment: Shouldn't we add surface here
 
@@ -330,7 +336,8 @@ class CurveSurfaceDistance(Optimizable):
         for i, _ in self.candidates:
             gammac = self.curves[i].gamma()
             lc = self.curves[i].gammadash()
-            res += self.J_jax(gammac, lc, gammas, ns)
+            wc = self.curves[i].quadrature_weights()
+            res += self.J_jax(gammac, lc, wc, gammas, ns)
         return res
 
     @derivative_dec
@@ -348,8 +355,9 @@ class CurveSurfaceDistance(Optimizable):
         for i, _ in self.candidates:
             gammac = self.curves[i].gamma()
             lc = self.curves[i].gammadash()
-            dgamma_by_dcoeff_vjp_vecs[i] += self.thisgrad0(gammac, lc, gammas, ns)
-            dgammadash_by_dcoeff_vjp_vecs[i] += self.thisgrad1(gammac, lc, gammas, ns)
+            wc = self.curves[i].quadrature_weights()
+            dgamma_by_dcoeff_vjp_vecs[i] += self.thisgrad0(gammac, lc, wc, gammas, ns)
+            dgammadash_by_dcoeff_vjp_vecs[i] += self.thisgrad1(gammac, lc, wc, gammas, ns)
         res = [self.curves[i].dgamma_by_dcoeff_vjp(dgamma_by_dcoeff_vjp_vecs[i]) + self.curves[i].dgammadash_by_dcoeff_vjp(dgammadash_by_dcoeff_vjp_vecs[i]) for i in range(len(self.curves))]
         return sum(res)
 
@@ -413,15 +421,24 @@ class ArclengthVariation(Optimizable):
                 raise RuntimeError("Please provide a value other than `partial` for `nintervals`. We only have a default for `CurveXYZFourier` and `JaxCurveXYZFourier`.")
 
         self.nintervals = nintervals
-        indices = np.floor(np.linspace(0, nquadpoints, nintervals+1, endpoint=True)).astype(int)
-        mat = np.zeros((nintervals, nquadpoints))
-        for i in range(nintervals):
-            mat[i, indices[i]:indices[i+1]] = 1/(indices[i+1]-indices[i])
-        self.mat = mat
-        self.thisgrad = jit(lambda l: grad(lambda x: curve_arclengthvariation_pure(x, mat))(l))
+        self.indices = np.floor(np.linspace(0, nquadpoints, nintervals+1, endpoint=True)).astype(int)
+        self.thisgrad = jit(lambda l, mat: grad(curve_arclengthvariation_pure)(l, mat))
+
+    def interval_matrix(self):
+        """
+        Returns the matrix that maps the incremental arclength on the
+        quadrature points to its mean on each interval, using the quadrature
+        weights of the curve.
+        """
+        w = self.curve.quadrature_weights()
+        mat = np.zeros((self.nintervals, len(w)))
+        for i in range(self.nintervals):
+            start, stop = self.indices[i], self.indices[i+1]
+            mat[i, start:stop] = w[start:stop]/np.sum(w[start:stop])
+        return mat
 
     def J(self):
-        return float(curve_arclengthvariation_pure(self.curve.incremental_arclength(), self.mat))
+        return float(curve_arclengthvariation_pure(self.curve.incremental_arclength(), self.interval_matrix()))
 
     @derivative_dec
     def dJ(self):
@@ -429,18 +446,18 @@ class ArclengthVariation(Optimizable):
         This returns the derivative of the quantity with respect to the curve dofs.
         """
         return self.curve.dincremental_arclength_by_dcoeff_vjp(
-            self.thisgrad(self.curve.incremental_arclength()))
+            self.thisgrad(self.curve.incremental_arclength(), self.interval_matrix()))
 
     return_fn_map = {'J': J, 'dJ': dJ}
 
 
 @jit
-def curve_msc_pure(kappa, gammadash):
+def curve_msc_pure(kappa, gammadash, w):
     """
     This function is used in a Python+Jax implementation of the mean squared curvature objective.
     """
     arc_length = jnp.linalg.norm(gammadash, axis=1)
-    return jnp.mean(kappa**2 * arc_length)/jnp.mean(arc_length)
+    return jnp.sum(w * kappa**2 * arc_length)/jnp.sum(w * arc_length)
 
 
 class MeanSquaredCurvature(Optimizable):
@@ -460,16 +477,17 @@ class MeanSquaredCurvature(Optimizable):
         """
         super().__init__(depends_on=[curve])
         self.curve = curve
-        self.thisgrad0 = jit(lambda kappa, gammadash: grad(curve_msc_pure, argnums=0)(kappa, gammadash))
-        self.thisgrad1 = jit(lambda kappa, gammadash: grad(curve_msc_pure, argnums=1)(kappa, gammadash))
+        self.thisgrad0 = jit(lambda kappa, gammadash, w: grad(curve_msc_pure, argnums=0)(kappa, gammadash, w))
+        self.thisgrad1 = jit(lambda kappa, gammadash, w: grad(curve_msc_pure, argnums=1)(kappa, gammadash, w))
 
     def J(self):
-        return float(curve_msc_pure(self.curve.kappa(), self.curve.gammadash()))
+        return float(curve_msc_pure(self.curve.kappa(), self.curve.gammadash(), self.curve.quadrature_weights()))
 
     @derivative_dec
     def dJ(self):
-        grad0 = self.thisgrad0(self.curve.kappa(), self.curve.gammadash())
-        grad1 = self.thisgrad1(self.curve.kappa(), self.curve.gammadash())
+        w = self.curve.quadrature_weights()
+        grad0 = self.thisgrad0(self.curve.kappa(), self.curve.gammadash(), w)
+        grad1 = self.thisgrad1(self.curve.kappa(), self.curve.gammadash(), w)
         return self.curve.dkappa_by_dcoeff_vjp(grad0) + self.curve.dgammadash_by_dcoeff_vjp(grad1)
 
 
@@ -502,26 +520,12 @@ class LinkingNumber(Optimizable):
         """
 
     def J(self):
-        ncoils = len(self.curves)
-        linkNum = np.zeros([ncoils + 1, ncoils + 1])
-        i = 0
-        for c1 in self.curves[:(ncoils + 1)]:
-            j = 0
-            i = i + 1
-            for c2 in self.curves[:(ncoils + 1)]:
-                j = j + 1
-                if i < j:
-                    R1 = c1.gamma()
-                    R2 = c2.gamma()
-                    dS = c1.quadpoints[1] - c1.quadpoints[0]
-                    dT = c2.quadpoints[1] - c1.quadpoints[0]
-                    dR1 = c1.gammadash()
-                    dR2 = c2.gammadash()
-
-                    integrals = sopp.linkNumber(R1, R2, dR1, dR2) * dS * dT
-                    linkNum[i-1][j-1] = 1/(4*np.pi) * (integrals)
-        linkNumSum = sum(sum(abs(linkNum)))
-        return linkNumSum
+        gammas = [c.gamma() for c in self.curves]
+        # The Gauss integrals give every point the weight 1/numquadpoints, so
+        # the tangents are rescaled to apply the quadrature weights.
+        gammadashs = [c.gammadash() * (len(c.quadpoints) * c.quadrature_weights())[:, None] for c in self.curves]
+        linkNum = sopp.gauss_linking_number_matrix(gammas, gammadashs)
+        return np.sum(np.abs(np.triu(linkNum, k=1)))
 
     @derivative_dec
     def dJ(self):
@@ -160,6 +160,7 @@ class CurvePerturbed(sopp.Curve, Curve):
         """
         self.curve = curve
         sopp.Curve.__init__(self, curve.quadpoints)
+        self.set_quadweights(curve.quadweights)
         Curve.__init__(self, depends_on=[curve])
         self.sample = sample
 
@@ -13,8 +13,29 @@ The functions and classes in this model are used to deal with multifilament
 approximation of finite build coils.
 """
 
-__all__ = ['create_multifilament_grid',
-           'CurveFilament', 'FilamentRotation', 'ZeroRotation']
+__all__ = ['create_multifilament_grid', 'create_multifilament_curve',
+           'CurveFilament', 'CurveMultifilament', 'FilamentRotation', 'ZeroRotation']
+
+
+def _multifilament_shifts_and_rotation(curve, numfilaments_n, numfilaments_b, gapsize_n, gapsize_b, rotation_order, rotation_scaling):
+    if numfilaments_n % 2 == 1:
+        shifts_n = np.arange(numfilaments_n) - numfilaments_n//2
+    else:
+        shifts_n = np.arange(numfilaments_n) - numfilaments_n/2 + 0.5
+    shifts_n = shifts_n * gapsize_n
+    if numfilaments_b % 2 == 1:
+        shifts_b = np.arange(numfilaments_b) - numfilaments_b//2
+    else:
+        shifts_b = np.arange(numfilaments_b) - numfilaments_b/2 + 0.5
+    shifts_b = shifts_b * gapsize_b
+
+    if rotation_scaling is None:
+        rotation_scaling = 1/max(gapsize_n, gapsize_b)
+    if rotation_order is None:
+        rotation = ZeroRotation(curve.quadpoints)
+    else:
+        rotation = FilamentRotation(curve.quadpoints, rotation_order, scale=rotation_scaling)
+    return shifts_n, shifts_b, rotation
 
 
 def create_multifilament_grid(curve, numfilaments_n, numfilaments_b, gapsize_n, gapsize_b, rotation_order=None, rotation_scaling=None):
@@ -39,23 +60,8 @@ def create_multifilament_grid(curve, numfilaments_n, numfilaments_b, gapsize_n,
                            algorithms. If ``None``, then the default of ``1 / max(gapsize_n, gapsize_b)``
                            is used.
     """
-    if numfilaments_n % 2 == 1:
-        shifts_n = np.arange(numfilaments_n) - numfilaments_n//2
-    else:
-        shifts_n = np.arange(numfilaments_n) - numfilaments_n/2 + 0.5
-    shifts_n = shifts_n * gapsize_n
-    if numfilaments_b % 2 == 1:
-        shifts_b = np.arange(numfilaments_b) - numfilaments_b//2
-    else:
-        shifts_b = np.arange(numfilaments_b) - numfilaments_b/2 + 0.5
-    shifts_b = shifts_b * gapsize_b
-
-    if rotation_scaling is None:
-        rotation_scaling = 1/max(gapsize_n, gapsize_b)
-    if rotation_order is None:
-        rotation = ZeroRotation(curve.quadpoints)
-    else:
-        rotation = FilamentRotation(curve.quadpoints, rotation_order, scale=rotation_scaling)
+    shifts_n, shifts_b, rotation = _multifilament_shifts_and_rotation(
+        curve, numfilaments_n, numfilaments_b, gapsize_n, gapsize_b, rotation_order, rotation_scaling)
     filaments = []
     for i in range(numfilaments_n):
         for j in range(numfilaments_b):
@@ -89,6 +95,7 @@ class CurveFilament(sopp.Curve, Curve):
         """
         self.curve = curve
         sopp.Curve.__init__(self, curve.quadpoints)
+        self.set_quadweights(curve.quadweights)
         deps = [curve]
         if rotation is not None:
             deps.append(rotation)
@@ -150,6 +157,130 @@ class CurveFilament(sopp.Curve, Curve):
             + self.rotation.dalphadash_by_dcoeff_vjp(self.curve.quadpoints, vad)
 
 
+def create_multifilament_curve(curve, numfilaments_n, numfilaments_b, gapsize_n, gapsize_b, rotation_order=None, rotation_scaling=None, weights=None):
+    """
+    Same as :obj:`create_multifilament_grid`, but instead of one curve per
+    filament, a single :obj:`CurveMultifilament` containing all filaments is
+    returned. Combined with :obj:`~simsopt.field.coil.MultifilamentCoil` this
+    is considerably cheaper to evaluate in
+    :obj:`~simsopt.field.biotsavart.BiotSavart` than the individual filaments.
+
+    Args:
+        curve: The underlying curve.
+        numfilaments_n: number of filaments in normal direction.
+        numfilaments_b: number of filaments in bi-normal direction.
+        gapsize_n: gap between filaments in normal direction.
+        gapsize_b: gap between filaments in bi-normal direction.
+        rotation_order: see :obj:`create_multifilament_grid`.
+        rotation_scaling: see :obj:`create_multifilament_grid`.
+        weights: fraction of the total current carried by each filament,
+                 ordered as the filaments returned by
+                 :obj:`create_multifilament_grid`. ``None`` means that the
+                 current is split evenly.
+    """
+    shifts_n, shifts_b, rotation = _multifilament_shifts_and_rotation(
+        curve, numfilaments_n, numfilaments_b, gapsize_n, gapsize_b, rotation_order, rotation_scaling)
+    dn = [shifts_n[i] for i in range(numfilaments_n) for j in range(numfilaments_b)]
+    db = [shifts_b[j] for i in range(numfilaments_n) for j in range(numfilaments_b)]
+    return CurveMultifilament(curve, dn, db, rotation, weights=weights)
+
+
+class CurveMultifilament(sopp.Curve, Curve):
+
+    def __init__(self, curve, dn, db, rotation=None, weights=None):
+        """
+        All filaments of a finite build coil, stored as one curve. The filament
+        ``k`` is given by the shift of ``curve`` by ``dn[k]`` and ``db[k]``
+        in the rotated centroid frame, as for :obj:`CurveFilament`, and
+        occupies the rows ``k*n, ..., (k+1)*n - 1`` of :meth:`gamma()`,
+        where ``n`` is the number of quadrature points of ``curve``.
+
+        The frame and all filaments are computed in C++ in a single pass over
+        the quadrature points, and the vector Jacobian products with respect
+        to the dofs of ``curve`` and ``rotation`` are formed after summing over
+        the filaments, so that the cost is close to that of a single curve.
+
+        The current weights enter through the quadrature weights of the
+        block: the quadrature points of filament ``k`` are weighted by
+        ``weights[k]`` times the quadrature weights of ``curve``. Used as the
+        curve of a :obj:`~simsopt.field.coil.MultifilamentCoil`, the field of
+        the coil is then that of the filaments carrying ``weights[k]`` times
+        the coil current, while :meth:`gamma()` and :meth:`gammadash()` are
+        those of the filaments.
+
+        Args:
+            curve: the underlying curve
+            dn: list of shifts in normal direction, one per filament
+            db: list of shifts in binormal direction, one per filament
+            rotation: angle along the curve to rotate the frame.
+            weights: fraction of the current carried by each filament.
+                     ``None`` means that the current is split evenly.
+        """
+        assert len(dn) == len(db)
+        numfilaments = len(dn)
+        if weights is None:
+            weights = np.full((numfilaments, ), 1./numfilaments)
+        assert len(weights) == numfilaments
+        self.curve = curve
+        self.dn = list(dn)
+        self.db = list(db)
+        self.weights = list(weights)
+        self.numfilaments = numfilaments
+        sopp.Curve.__init__(self, np.tile(curve.quadpoints, numfilaments))
+        quadweights = curve.quadrature_weights()
+        self.set_quadweights(np.concatenate([w * quadweights for w in self.weights]))
+        deps = [curve]
+        if rotation is not None:
+            deps.append(rotation)
+        Curve.__init__(self, depends_on=deps)
+        if rotation is None:
+            rotation = ZeroRotation(curve.quadpoints)
+        self.rotation = rotation
+
+    def recompute_bell(self, parent=None):
+        self.invalidate_cache()
+
+    def _centreline(self):
+        c = self.curve
+        return (c.gamma(), c.gammadash(), c.gammadashdash(),
+                np.asarray(self.rotation.alpha(c.quadpoints), dtype=np.float64),
+                np.asarray(self.rotation.alphadash(c.quadpoints), dtype=np.float64))
+
+    def gamma_impl(self, gamma, quadpoints):
+        assert quadpoints.shape[0] == self.numfilaments * self.curve.quadpoints.shape[0]
+        gammadash = np.zeros_like(gamma)
+        sopp.multifilament_gamma(*self._centreline(), self.dn, self.db, gamma, gammadash)
+
+    def gammadash_impl(self, gammadash):
+        gamma = np.zeros_like(gammadash)
+        sopp.multifilament_gamma(*self._centreline(), self.dn, self.db, gamma, gammadash)
+
+    def filaments_gamma(self):
+        """
+        Returns the filaments as an array of shape ``(numfilaments, n, 3)``.
+        """
+        return self.gamma().reshape((self.numfilaments, -1, 3))
+
+    def dgamma_and_dgammadash_by_dcoeff_vjp(self, v_gamma, v_gammadash):
+        """
+        Returns ``dgamma_by_dcoeff_vjp(v_gamma) + dgammadash_by_dcoeff_vjp(v_gammadash)``,
+        but only differentiates the centroid frame once.
+        """
+        c = self.curve
+        vg, vgd, vgdd, va, vad = sopp.multifilament_vjp(*self._centreline(), self.dn, self.db, v_gamma, v_gammadash)
+        return c.dgamma_by_dcoeff_vjp(vg) \
+            + c.dgammadash_by_dcoeff_vjp(vgd) \
+            + c.dgammadashdash_by_dcoeff_vjp(vgdd) \
+            + self.rotation.dalpha_by_dcoeff_vjp(c.quadpoints, va) \
+            + self.rotation.dalphadash_by_dcoeff_vjp(c.quadpoints, vad)
+
+    def dgamma_by_dcoeff_vjp(self, v):
+        return self.dgamma_and_dgammadash_by_dcoeff_vjp(v, np.zeros_like(v))
+
+    def dgammadash_by_dcoeff_vjp(self, v):
+        return self.dgamma_and_dgammadash_by_dcoeff_vjp(np.zeros_like(v), v)
+
+
 class FilamentRotation(Optimizable):
 
     def __init__(self, quadpoints, order, scale=1., dofs=None):
@@ -9,7 +9,7 @@ from .._core.json import GSONable, GSONDecoder, GSONEncoder
 __all__ = ['SquaredFlux']
 
 
-class SquaredFlux(Optimizable):
+class SquaredFlux(sopp.SquaredFlux, Optimizable):
 
     r"""
     Objective representing the quadratic flux of a field on a surface, that is
@@ -21,6 +21,11 @@ class SquaredFlux(Optimizable):
     :math:`B_T` is an optional (zero by default) target value for the
     magnetic field.
 
+    The objective, the normal field and the derivatives are computed in C++
+    directly from the caches of the surface and the field. The field is
+    evaluated at the quadrature points of the surface, and its points are
+    updated automatically if the surface moves.
+
     Args:
         surface: A :obj:`simsopt.geo.surface.Surface` object on which to compute the flux
         field: A :obj:`simsopt.field.magneticfield.MagneticField` for which to compute the flux.
@@ -42,29 +47,13 @@ class SquaredFlux(Optimizable):
         else:
             self.Btarget = np.zeros(self.surface.normal().shape[:2])
         self.field = field
-        xyz = self.surface.gamma()
-        self.field.set_points(xyz.reshape((-1, 3)))
         self.local = local
+        sopp.SquaredFlux.__init__(self, surface, field, self.Btarget.flatten(), local)
         Optimizable.__init__(self, x0=np.asarray([]), depends_on=[field])
 
     def J(self):
-        n = self.surface.normal()
-        Bcoil = self.field.B().reshape(n.shape)
-
-        # return sopp.integral_BdotN(Bcoil, self.Btarget, n)
-        return sopp.integral_BdotN(Bcoil, self.Btarget, n, self.local)
-
+        return sopp.SquaredFlux.J(self)
 
     @derivative_dec
     def dJ(self):
-        n = self.surface.normal()
-        absn = np.linalg.norm(n, axis=2)
-        unitn = n * (1./absn)[:, :, None]
-        Bcoil = self.field.B().reshape(n.shape)
-        Bcoil_n = np.sum(Bcoil*unitn, axis=2)
-
-        B_n = (Bcoil_n - self.Btarget)
-        dJdB = (B_n[..., None] * unitn * absn[..., None])/absn.size
-        dJdB = dJdB.reshape((-1, 3))
-        return self.field.B_vjp(dJdB)
-
+        return self.field.B_vjp(self.dJ_by_dB())
@@ -0,0 +1,51 @@
+#include "arena.h"
+#include <atomic>
+#include <new>
+
+namespace arena {
+
+// The size of the first block of an arena, later blocks double in size.
+static constexpr std::size_t min_block_size = 1 << 16;
+
+static std::atomic<uint64_t> num_heap_allocations(0);
+
+Arena::~Arena() {
+    for (auto& block : blocks)
+        ::operator delete(block.data, std::align_val_t(alignment));
+}
+
+void* Arena::allocate(std::size_t bytes) {
+    bytes = std::max<std::size_t>((bytes + alignment - 1)/alignment*alignment, alignment);
+    // the remainder of a block that is too small is skipped
+    while(current < blocks.size() && offset + bytes > blocks[current].size) {
+        ++current;
+        offset = 0;
+    }
+    if(current == blocks.size()) {
+        std::size_t size = std::max(bytes, blocks.empty() ? min_block_size : 2*blocks.back().size);
+        char* data = static_cast<char*>(::operator new(size, std::align_val_t(alignment)));
+        blocks.push_back({data, size});
+        num_heap_allocations++;
+    }
+    char* res = blocks[current].data + offset;
+    offset += bytes;
+    return res;
+}
+
+std::size_t Arena::capacity() const {
+    std::size_t res = 0;
+    for (auto& block : blocks)
+        res += block.size;
+    return res;
+}
+
+Arena& local() {
+    thread_local Arena arena;
+    return arena;
+}
+
+uint64_t heap_allocations() {
+    return num_heap_allocations;
+}
+
+}
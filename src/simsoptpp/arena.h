@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "xtensor/xadapt.hpp"
+
+// Scratch memory for the transient arrays of the hot paths. Allocating a
+// pyarray costs a numpy allocation (and needs the GIL), and even an xarray
+// costs a heap allocation, which adds up when done per quadrature point or per
+// call of a kernel that is evaluated many times.
+//
+// Each thread has its own arena, a list of large blocks that memory is taken
+// from by bumping an offset. An `arena::Scope` rewinds the arena of its thread
+// to where it was when the scope was opened, so the scope of a top-level call
+// resets the arena, and nested scopes only release their own allocations. The
+// blocks are kept, so once the arena has grown to the size needed by a call,
+// repeating the call does not allocate any memory.
+//
+// Usage:
+//
+//     void kernel(...) {
+//         arena::Scope scope;
+//         auto tmp = arena::zeros<2>({n, 3}); // an xtensor adaptor
+//         ...
+//     } // the memory of tmp is released here
+//
+// The arrays must not outlive the scope in which they were allocated, and the
+// memory of a thread's arena must only be allocated by that thread (other
+// threads may read and write the arrays, e.g. in a parallel loop).
+
+namespace arena {
+
+// All allocations are aligned to 64 bytes, enough for AVX-512.
+constexpr std::size_t alignment = 64;
+
+class Arena {
+    public:
+        struct Mark {
+            std::size_t block;
+            std::size_t offset;
+        };
+
+        Arena() = default;
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+        ~Arena();
+
+        void* allocate(std::size_t bytes);
+
+        Mark mark() const { return {current, offset}; }
+        void rewind(const Mark& m) {
+            current = m.block;
+            offset = m.offset;
+        }
+
+        // The number of bytes of all blocks.
+        std::size_t capacity() const;
+
+    private:
+        struct Block {
+            char* data;
+            std::size_t size;
+        };
+        std::vector<Block> blocks;
+        // memory is taken from blocks[current], starting at offset
+        std::size_t current = 0;
+        std::size_t offset = 0;
+};
+
+// The arena of the calling thread.
+Arena& local();
+
+// The number of blocks that the arenas of all threads have allocated on the
+// heap so far. This stays constant when a call is repeated.
+uint64_t heap_allocations();
+
+class Scope {
+    public:
+        Scope() : arena(local()), start(arena.mark()) {}
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        ~Scope() { arena.rewind(start); }
+
+    private:
+        Arena& arena;
+        Arena::Mark start;
+};
+
+// Returns a row major xtensor adaptor of the given shape on memory of the
+// arena of the calling thread, initialized to zero.
+template<std::size_t N>
+auto zeros(const std::array<int, N>& dims) {
+    std::array<std::size_t, N> shape;
+    std::size_t size = 1;
+    for (std::size_t i = 0; i < N; ++i) {
+        shape[i] = dims[i];
+        size *= shape[i];
+    }
+    double* data = static_cast<double*>(local().allocate(size*sizeof(double)));
+    std::fill(data, data + size, 0.);
+    return xt::adapt(data, size, xt::no_ownership(), shape);
+}
+
+}
@@ -15,11 +15,14 @@ using namespace std;
 #define MYIF(c) if(c)
 #endif
 
+// The curve (gamma and dgamma_by_dphi) may be of a different type than the
+// outputs, e.g. a view into the block of a CurveXYZFourierCollection.
+
 #if defined(USE_XSIMD)
 
-template<class T, int derivs>
+template<class T, int derivs, class G>
 void biot_savart_kernel(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy, AlignedPaddedVec& pointsz,
-            T& gamma, T& dgamma_by_dphi, T& B, T& dB_by_dX, T& d2B_by_dXdX) {
+            G& gamma, G& dgamma_by_dphi, T& B, T& dB_by_dX, T& d2B_by_dXdX, const double* quadweights) {
     if(gamma.layout() != xt::layout_type::row_major)
           throw std::runtime_error("gamma needs to be in row-major storage order");
     if(dgamma_by_dphi.layout() != xt::layout_type::row_major)
@@ -41,7 +44,9 @@ void biot_savart_kernel(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy, Al
             Vec3dSimd(), Vec3dSimd(), Vec3dSimd()
         };
     }
-    double fak = (1e-7/num_quad_points);
+    // Without quadrature weights every quadrature point carries the weight
+    // 1/num_quad_points, otherwise the tangent at point j is scaled by quadweights[j].
+    double fak = quadweights ? 1e-7 : (1e-7/num_quad_points);
     double* gamma_j_ptr = &(gamma(0, 0));
     double* dgamma_j_by_dphi_ptr = &(dgamma_by_dphi(0, 0));
     // out vectors pointsx, pointsy, and pointsz are added and aligned, so we
@@ -65,7 +70,8 @@ void biot_savart_kernel(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy, Al
             auto norm_diff_inv   = rsqrt(norm_diff_2);
             auto norm_diff_3_inv = norm_diff_inv*norm_diff_inv*norm_diff_inv;
 
-            auto dgamma_by_dphi_j_simd = Vec3dSimd(dgamma_j_by_dphi_ptr[3*j+0], dgamma_j_by_dphi_ptr[3*j+1], dgamma_j_by_dphi_ptr[3*j+2]);
+            double w_j = quadweights ? quadweights[j] : 1.;
+            auto dgamma_by_dphi_j_simd = Vec3dSimd(w_j*dgamma_j_by_dphi_ptr[3*j+0], w_j*dgamma_j_by_dphi_ptr[3*j+1], w_j*dgamma_j_by_dphi_ptr[3*j+2]);
             auto dgamma_by_dphi_j_cross_diff = cross(dgamma_by_dphi_j_simd, diff);
 
             B_i.x = xsimd::fma(dgamma_by_dphi_j_cross_diff.x, norm_diff_3_inv, B_i.x);
@@ -170,9 +176,9 @@ void biot_savart_kernel(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy, Al
 
 #else
 
-template<class T, int derivs>
+template<class T, int derivs, class G>
 void biot_savart_kernel(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy, AlignedPaddedVec& pointsz,
-            T& gamma, T& dgamma_by_dphi, T& B, T& dB_by_dX, T& d2B_by_dXdX) {
+            G& gamma, G& dgamma_by_dphi, T& B, T& dB_by_dX, T& d2B_by_dXdX, const double* quadweights) {
     if(gamma.layout() != xt::layout_type::row_major)
           throw std::runtime_error("gamma needs to be in row-major storage order");
     if(dgamma_by_dphi.layout() != xt::layout_type::row_major)
@@ -193,7 +199,9 @@ void biot_savart_kernel(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy, Al
             Vec3dStd(), Vec3dStd(), Vec3dStd()
         };
     }
-    double fak = (1e-7/num_quad_points);
+    // Without quadrature weights every quadrature point carries the weight
+    // 1/num_quad_points, otherwise the tangent at point j is scaled by quadweights[j].
+    double fak = quadweights ? 1e-7 : (1e-7/num_quad_points);
     double* gamma_j_ptr = &(gamma(0, 0));
     double* dgamma_j_by_dphi_ptr = &(dgamma_by_dphi(0, 0));
     // out vectors pointsx, pointsy, and pointsz are added and aligned, so we
@@ -218,7 +226,8 @@ void biot_savart_kernel(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy, Al
             auto norm_diff_inv   = rsqrt(norm_diff_2);
             auto norm_diff_3_inv = norm_diff_inv*norm_diff_inv*norm_diff_inv;
 
-            auto dgamma_by_dphi_j_simd = Vec3dStd(dgamma_j_by_dphi_ptr[3*j+0], dgamma_j_by_dphi_ptr[3*j+1], dgamma_j_by_dphi_ptr[3*j+2]);
+            double w_j = quadweights ? quadweights[j] : 1.;
+            auto dgamma_by_dphi_j_simd = Vec3dStd(w_j*dgamma_j_by_dphi_ptr[3*j+0], w_j*dgamma_j_by_dphi_ptr[3*j+1], w_j*dgamma_j_by_dphi_ptr[3*j+2]);
             auto dgamma_by_dphi_j_cross_diff = cross(dgamma_by_dphi_j_simd, diff);
 
             B_i += (dgamma_by_dphi_j_cross_diff * norm_diff_3_inv);
@@ -291,9 +300,9 @@ void biot_savart_kernel(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy, Al
 
 #if defined(USE_XSIMD)
 
-template<class T, int derivs>
+template<class T, int derivs, class G>
 void biot_savart_kernel_A(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy, AlignedPaddedVec& pointsz,
-            T& gamma, T& dgamma_by_dphi, T& A, T& dA_by_dX, T& d2A_by_dXdX) {
+            G& gamma, G& dgamma_by_dphi, T& A, T& dA_by_dX, T& d2A_by_dXdX, const double* quadweights) {
     if(gamma.layout() != xt::layout_type::row_major)
           throw std::runtime_error("gamma needs to be in row-major storage order");
     if(dgamma_by_dphi.layout() != xt::layout_type::row_major)
@@ -315,7 +324,9 @@ void biot_savart_kernel_A(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy,
             Vec3dSimd(), Vec3dSimd(), Vec3dSimd()
         };
     }
-    double fak = (1e-7/num_quad_points);
+    // Without quadrature weights every quadrature point carries the weight
+    // 1/num_quad_points, otherwise the tangent at point j is scaled by quadweights[j].
+    double fak = quadweights ? 1e-7 : (1e-7/num_quad_points);
     double* gamma_j_ptr = &(gamma(0, 0));
     double* dgamma_j_by_dphi_ptr = &(dgamma_by_dphi(0, 0));
     // out vectors pointsx, pointsy, and pointsz are added and aligned, so we
@@ -339,7 +350,8 @@ void biot_savart_kernel_A(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy,
             auto norm_diff_inv   = rsqrt(norm_diff_2);
             auto norm_diff_3_inv = norm_diff_inv*norm_diff_inv*norm_diff_inv;
 
-            auto dgamma_by_dphi_j_simd = Vec3dSimd(dgamma_j_by_dphi_ptr[3*j+0], dgamma_j_by_dphi_ptr[3*j+1], dgamma_j_by_dphi_ptr[3*j+2]);
+            double w_j = quadweights ? quadweights[j] : 1.;
+            auto dgamma_by_dphi_j_simd = Vec3dSimd(w_j*dgamma_j_by_dphi_ptr[3*j+0], w_j*dgamma_j_by_dphi_ptr[3*j+1], w_j*dgamma_j_by_dphi_ptr[3*j+2]);
             A_i.x = xsimd::fma(dgamma_by_dphi_j_simd.x , norm_diff_inv, A_i.x) ;
             A_i.y = xsimd::fma(dgamma_by_dphi_j_simd.y , norm_diff_inv, A_i.y) ;
             A_i.z = xsimd::fma(dgamma_by_dphi_j_simd.z , norm_diff_inv, A_i.z) ;
@@ -417,9 +429,9 @@ void biot_savart_kernel_A(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy,
 
 #else
 
-template<class T, int derivs>
+template<class T, int derivs, class G>
 void biot_savart_kernel_A(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy, AlignedPaddedVec& pointsz,
-            T& gamma, T& dgamma_by_dphi, T& A, T& dA_by_dX, T& d2A_by_dXdX) {
+            G& gamma, G& dgamma_by_dphi, T& A, T& dA_by_dX, T& d2A_by_dXdX, const double* quadweights) {
     if(gamma.layout() != xt::layout_type::row_major)
           throw std::runtime_error("gamma needs to be in row-major storage order");
     if(dgamma_by_dphi.layout() != xt::layout_type::row_major)
@@ -440,7 +452,9 @@ void biot_savart_kernel_A(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy,
             Vec3dStd(), Vec3dStd(), Vec3dStd()
         };
     }
-    double fak = (1e-7/num_quad_points);
+    // Without quadrature weights every quadrature point carries the weight
+    // 1/num_quad_points, otherwise the tangent at point j is scaled by quadweights[j].
+    double fak = quadweights ? 1e-7 : (1e-7/num_quad_points);
     double* gamma_j_ptr = &(gamma(0, 0));
     double* dgamma_j_by_dphi_ptr = &(dgamma_by_dphi(0, 0));
     // out vectors pointsx, pointsy, and pointsz are added and aligned, so we
@@ -464,7 +478,8 @@ void biot_savart_kernel_A(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy,
             auto norm_diff_inv   = rsqrt(norm_diff_2);
             auto norm_diff_3_inv = norm_diff_inv*norm_diff_inv*norm_diff_inv;
 
-            auto dgamma_by_dphi_j_simd = Vec3dStd(dgamma_j_by_dphi_ptr[3*j+0], dgamma_j_by_dphi_ptr[3*j+1], dgamma_j_by_dphi_ptr[3*j+2]);
+            double w_j = quadweights ? quadweights[j] : 1.;
+            auto dgamma_by_dphi_j_simd = Vec3dStd(w_j*dgamma_j_by_dphi_ptr[3*j+0], w_j*dgamma_j_by_dphi_ptr[3*j+1], w_j*dgamma_j_by_dphi_ptr[3*j+2]);
             A_i += dgamma_by_dphi_j_simd * norm_diff_inv;
 
             MYIF(derivs > 0) {
@@ -527,3 +542,106 @@ void biot_savart_kernel_A(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy,
 }
 
 #endif
+
+// Computes B = sum_i currents[i] * B_i, where B_i is the field of coil i with
+// unit current, and writes it into B. In contrast to `biot_savart_kernel`, the
+// loop over the coils is inside the loop over the points, so that no array
+// per coil is needed and nothing is allocated. The loop over the points is
+// parallelized. `quadweights` contains the quadrature weights of each coil as
+// in `biot_savart_kernel`, an empty vector (for all or for a single coil)
+// means uniform weights.
+#if defined(USE_XSIMD)
+
+template<class T>
+void biot_savart_kernel_B_sum(T& points, vector<T>& gammas, vector<T>& dgamma_by_dphis, const vector<double>& currents, T& B, const vector<vector<double>>& quadweights) {
+    int num_points = points.shape(0);
+    int num_coils  = gammas.size();
+    for (int c = 0; c < num_coils; ++c) {
+        if(gammas[c].layout() != xt::layout_type::row_major)
+            throw std::runtime_error("gamma needs to be in row-major storage order");
+        if(dgamma_by_dphis[c].layout() != xt::layout_type::row_major)
+            throw std::runtime_error("dgamma_by_dphi needs to be in row-major storage order");
+        if(quadweights.size() > 0 && quadweights[c].size() > 0 && quadweights[c].size() != gammas[c].shape(0))
+            throw std::runtime_error("quadweights needs to be empty or have one entry per quadrature point.");
+    }
+    constexpr int simd_size = xsimd::simd_type<double>::size;
+#pragma omp parallel for schedule(static)
+    for(int i = 0; i < num_points; i += simd_size) {
+        auto point_i = Vec3dSimd();
+        int klimit = std::min(simd_size, num_points - i);
+        for(int k = 0; k < klimit; k++){
+            for (int d = 0; d < 3; ++d) {
+                point_i[d][k] = points(i + k, d);
+            }
+        }
+        auto B_i = Vec3dSimd();
+        for (int c = 0; c < num_coils; ++c) {
+            int num_quad_points = gammas[c].shape(0);
+            double* gamma_j_ptr = &(gammas[c](0, 0));
+            double* dgamma_j_by_dphi_ptr = &(dgamma_by_dphis[c](0, 0));
+            const double* w = (quadweights.size() > 0 && quadweights[c].size() > 0) ? quadweights[c].data() : nullptr;
+            auto B_ic = Vec3dSimd();
+            for (int j = 0; j < num_quad_points; ++j) {
+                auto diff = point_i - Vec3dSimd(gamma_j_ptr[3*j+0], gamma_j_ptr[3*j+1], gamma_j_ptr[3*j+2]);
+                auto norm_diff_inv   = rsqrt(normsq(diff));
+                auto norm_diff_3_inv = norm_diff_inv*norm_diff_inv*norm_diff_inv;
+                double w_j = w ? w[j] : 1.;
+                auto dgamma_by_dphi_j_simd = Vec3dSimd(w_j*dgamma_j_by_dphi_ptr[3*j+0], w_j*dgamma_j_by_dphi_ptr[3*j+1], w_j*dgamma_j_by_dphi_ptr[3*j+2]);
+                auto dgamma_by_dphi_j_cross_diff = cross(dgamma_by_dphi_j_simd, diff);
+                B_ic.x = xsimd::fma(dgamma_by_dphi_j_cross_diff.x, norm_diff_3_inv, B_ic.x);
+                B_ic.y = xsimd::fma(dgamma_by_dphi_j_cross_diff.y, norm_diff_3_inv, B_ic.y);
+                B_ic.z = xsimd::fma(dgamma_by_dphi_j_cross_diff.z, norm_diff_3_inv, B_ic.z);
+            }
+            B_ic *= w ? currents[c] * 1e-7 : currents[c] * 1e-7/num_quad_points;
+            B_i += B_ic;
+        }
+        for(int k = 0; k < klimit; k++){
+            B(i + k, 0) = B_i.x[k];
+            B(i + k, 1) = B_i.y[k];
+            B(i + k, 2) = B_i.z[k];
+        }
+    }
+}
+
+#else
+
+template<class T>
+void biot_savart_kernel_B_sum(T& points, vector<T>& gammas, vector<T>& dgamma_by_dphis, const vector<double>& currents, T& B, const vector<vector<double>>& quadweights) {
+    int num_points = points.shape(0);
+    int num_coils  = gammas.size();
+    for (int c = 0; c < num_coils; ++c) {
+        if(gammas[c].layout() != xt::layout_type::row_major)
+            throw std::runtime_error("gamma needs to be in row-major storage order");
+        if(dgamma_by_dphis[c].layout() != xt::layout_type::row_major)
+            throw std::runtime_error("dgamma_by_dphi needs to be in row-major storage order");
+        if(quadweights.size() > 0 && quadweights[c].size() > 0 && quadweights[c].size() != gammas[c].shape(0))
+            throw std::runtime_error("quadweights needs to be empty or have one entry per quadrature point.");
+    }
+#pragma omp parallel for schedule(static)
+    for(int i = 0; i < num_points; i++) {
+        auto point_i = Vec3dStd(points(i, 0), points(i, 1), points(i, 2));
+        auto B_i = Vec3dStd();
+        for (int c = 0; c < num_coils; ++c) {
+            int num_quad_points = gammas[c].shape(0);
+            double* gamma_j_ptr = &(gammas[c](0, 0));
+            double* dgamma_j_by_dphi_ptr = &(dgamma_by_dphis[c](0, 0));
+            const double* w = (quadweights.size() > 0 && quadweights[c].size() > 0) ? quadweights[c].data() : nullptr;
+            auto B_ic = Vec3dStd();
+            for (int j = 0; j < num_quad_points; ++j) {
+                auto diff = point_i - Vec3dStd(gamma_j_ptr[3*j+0], gamma_j_ptr[3*j+1], gamma_j_ptr[3*j+2]);
+                auto norm_diff_inv   = rsqrt(normsq(diff));
+                auto norm_diff_3_inv = norm_diff_inv*norm_diff_inv*norm_diff_inv;
+                double w_j = w ? w[j] : 1.;
+                auto dgamma_by_dphi_j = Vec3dStd(w_j*dgamma_j_by_dphi_ptr[3*j+0], w_j*dgamma_j_by_dphi_ptr[3*j+1], w_j*dgamma_j_by_dphi_ptr[3*j+2]);
+                B_ic += cross(dgamma_by_dphi_j, diff) * norm_diff_3_inv;
+            }
+            B_ic *= w ? currents[c] * 1e-7 : currents[c] * 1e-7/num_quad_points;
+            B_i += B_ic;
+        }
+        B(i, 0) = B_i.x;
+        B(i, 1) = B_i.y;
+        B(i, 2) = B_i.z;
+    }
+}
+
+#endif
@@ -1,17 +1,26 @@
 #include "biot_savart_impl.h"
 #include "biot_savart_py.h"
+#include "pygil.h"
 
-void biot_savart(Array& points, vector<Array>& gammas, vector<Array>& dgamma_by_dphis, vector<Array>& B, vector<Array>& dB_by_dX, vector<Array>& d2B_by_dXdX) {
-    auto pointsx = AlignedPaddedVec(points.shape(0), 0);
-    auto pointsy = AlignedPaddedVec(points.shape(0), 0);
-    auto pointsz = AlignedPaddedVec(points.shape(0), 0);
-    int num_points = points.shape(0);
-    for (int i = 0; i < num_points; ++i) {
-        pointsx[i] = points(i, 0);
-        pointsy[i] = points(i, 1);
-        pointsz[i] = points(i, 2);
-    }
+// Returns the quadrature weights of curve i, or nullptr for uniform weights.
+static const double* get_quadweights(vector<vector<double>>& quadweights, vector<Array>& gammas, int i) {
+    if(quadweights.size() == 0 || quadweights[i].size() == 0)
+        return nullptr;
+    if(quadweights[i].size() != gammas[i].shape(0))
+        throw std::runtime_error("quadweights needs to be empty or have one entry per quadrature point.");
+    return quadweights[i].data();
+}
+
+void biot_savart(PointSet& points, vector<Array>& gammas, vector<Array>& dgamma_by_dphis, vector<Array>& B, vector<Array>& dB_by_dX, vector<Array>& d2B_by_dXdX, vector<vector<double>>& quadweights) {
+    AlignedPaddedVec& pointsx = points.x();
+    AlignedPaddedVec& pointsy = points.y();
+    AlignedPaddedVec& pointsz = points.z();
     int num_coils  = gammas.size();
+    if(quadweights.size() != 0 && quadweights.size() != num_coils)
+        throw std::runtime_error("quadweights needs to be empty or have one entry per curve.");
+    vector<const double*> weights(num_coils);
+    for(int i=0; i<num_coils; i++)
+        weights[i] = get_quadweights(quadweights, gammas, i);
 
     Array dummyjac = xt::zeros<double>({1, 1, 1});
     Array dummyhess = xt::zeros<double>({1, 1, 1, 1});
@@ -24,31 +33,35 @@ void biot_savart(Array& points, vector<Array>& gammas, vector<Array>& dgamma_by_
         }
     }
     
+    ScopedGILRelease gil;
     #pragma omp parallel for
     for(int i=0; i<num_coils; i++) {
         if(nderivs == 2)
-            biot_savart_kernel<Array, 2>(pointsx, pointsy, pointsz, gammas[i], dgamma_by_dphis[i], B[i], dB_by_dX[i], d2B_by_dXdX[i]);
+            biot_savart_kernel<Array, 2>(pointsx, pointsy, pointsz, gammas[i], dgamma_by_dphis[i], B[i], dB_by_dX[i], d2B_by_dXdX[i], weights[i]);
         else {
             if(nderivs == 1)
-                biot_savart_kernel<Array, 1>(pointsx, pointsy, pointsz, gammas[i], dgamma_by_dphis[i], B[i], dB_by_dX[i], dummyhess);
+                biot_savart_kernel<Array, 1>(pointsx, pointsy, pointsz, gammas[i], dgamma_by_dphis[i], B[i], dB_by_dX[i], dummyhess, weights[i]);
             else
-                biot_savart_kernel<Array, 0>(pointsx, pointsy, pointsz, gammas[i], dgamma_by_dphis[i], B[i], dummyjac, dummyhess);
+                biot_savart_kernel<Array, 0>(pointsx, pointsy, pointsz, gammas[i], dgamma_by_dphis[i], B[i], dummyjac, dummyhess, weights[i]);
         }
     }
 }
 
-Array biot_savart_B(Array& points, vector<Array>& gammas, vector<Array>& dgamma_by_dphis, vector<double>& currents){
-    auto dB_by_dXs = vector<Array>();
-    auto d2B_by_dXdXs = vector<Array>();
+void biot_savart_B_out(Array& points, vector<Array>& gammas, vector<Array>& dgamma_by_dphis, vector<double>& currents, Array& B, vector<vector<double>>& quadweights){
     int num_coils = currents.size();
-    auto Bs = vector<Array>(num_coils, Array());
-    for (int i = 0; i < num_coils; ++i) {
-        Bs[i] = xt::zeros<double>({points.shape(0), points.shape(1)});
-    }
-    biot_savart(points, gammas, dgamma_by_dphis, Bs, dB_by_dXs, d2B_by_dXdXs);
-    Array B = xt::zeros<double>({points.shape(0), points.shape(1)});
-    for (int i = 0; i < num_coils; ++i) {
-        B += currents[i] * Bs[i];
-    }
+    if(gammas.size() != num_coils || dgamma_by_dphis.size() != num_coils)
+        throw std::runtime_error("gammas, dgamma_by_dphis and currents need to have the same length.");
+    if(quadweights.size() != 0 && quadweights.size() != num_coils)
+        throw std::runtime_error("quadweights needs to be empty or have one entry per curve.");
+    if(B.dimension() != 2 || B.shape(0) != points.shape(0) || B.shape(1) != 3)
+        throw std::runtime_error("B has wrong shape.");
+    ScopedGILRelease gil;
+    biot_savart_kernel_B_sum<Array>(points, gammas, dgamma_by_dphis, currents, B, quadweights);
+}
+
+Array biot_savart_B(Array& points, vector<Array>& gammas, vector<Array>& dgamma_by_dphis, vector<double>& currents, vector<vector<double>>& quadweights){
+    int num_points = points.shape(0);
+    Array B = xt::zeros<double>({num_points, 3});
+    biot_savart_B_out(points, gammas, dgamma_by_dphis, currents, B, quadweights);
     return B;
 }
@@ -1,8 +1,14 @@
 #pragma once
 
 #include "xtensor-python/pyarray.hpp"     // Numpy bindings
+#include "pointset.h"
 typedef xt::pyarray<double> Array;
 using std::vector;
 
-void biot_savart(Array& points, vector<Array>& gammas, vector<Array>& dgamma_by_dphis, vector<Array>& B, vector<Array>& dB_by_dX, vector<Array>& d2B_by_dXdX);
-Array biot_savart_B(Array& points, vector<Array>& gammas, vector<Array>& dgamma_by_dphis, vector<double>& currents);
+// `quadweights` contains the quadrature weights of each curve, see
+// `Curve::quadweights`. If empty, uniform weights are assumed for all curves.
+void biot_savart(PointSet& points, vector<Array>& gammas, vector<Array>& dgamma_by_dphis, vector<Array>& B, vector<Array>& dB_by_dX, vector<Array>& d2B_by_dXdX, vector<vector<double>>& quadweights);
+Array biot_savart_B(Array& points, vector<Array>& gammas, vector<Array>& dgamma_by_dphis, vector<double>& currents, vector<vector<double>>& quadweights);
+// Writes the field of the coils with the given currents into the preallocated
+// B of shape (npoints, 3), without allocating an array per coil.
+void biot_savart_B_out(Array& points, vector<Array>& gammas, vector<Array>& dgamma_by_dphis, vector<double>& currents, Array& B, vector<vector<double>>& quadweights);
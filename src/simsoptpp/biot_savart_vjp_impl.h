@@ -41,12 +41,13 @@ void biot_savart_vjp_kernel(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy
     double* res_gamma_ptr = &(res_gamma(0, 0));
     double* res_grad_dgamma_by_dphi_ptr = &(res_grad_dgamma_by_dphi(0, 0));
     double* res_grad_gamma_ptr = &(res_grad_gamma(0, 0));
+    // allocated once, the entries are overwritten for every point
+    auto vgrad_i = vector<Vec3dSimd, xs::aligned_allocator<Vec3dSimd, XSIMD_DEFAULT_ALIGNMENT>>{
+            Vec3dSimd(), Vec3dSimd(), Vec3dSimd()
+        };
     for(int i = 0; i < num_points-num_points%simd_size; i += simd_size) {
         Vec3dSimd point_i = Vec3dSimd(&(pointsx[i]), &(pointsy[i]), &(pointsz[i]));
         auto v_i   = Vec3dSimd();
-        auto vgrad_i = vector<Vec3dSimd, xs::aligned_allocator<Vec3dSimd, XSIMD_DEFAULT_ALIGNMENT>>{
-                Vec3dSimd(), Vec3dSimd(), Vec3dSimd()
-            };
 #pragma unroll
         for(int k=0; k<simd_size; k++){
             for (int d = 0; d < 3; ++d) {
@@ -201,12 +202,13 @@ void biot_savart_vjp_kernel(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy
     double* res_gamma_ptr = &(res_gamma(0, 0));
     double* res_grad_dgamma_by_dphi_ptr = &(res_grad_dgamma_by_dphi(0, 0));
     double* res_grad_gamma_ptr = &(res_grad_gamma(0, 0));
+    // allocated once, the entries are overwritten for every point
+    auto vgrad_i = vector<Vec3dStd>{
+            Vec3dStd(), Vec3dStd(), Vec3dStd()
+        };
     for(int i = 0; i < num_points; i++) {
         Vec3dStd point_i = Vec3dStd(&(pointsx[i]), &(pointsy[i]), &(pointsz[i]));
         auto v_i   = Vec3dStd();
-        auto vgrad_i = vector<Vec3dStd>{
-                Vec3dStd(), Vec3dStd(), Vec3dStd()
-            };
 #pragma unroll
             for (int d = 0; d < 3; ++d) {
                 v_i[d] = v(i, d);
@@ -300,12 +302,13 @@ void biot_savart_vector_potential_vjp_kernel(
     double* res_gamma_ptr = &(res_gamma(0, 0));
     double* res_grad_dgamma_by_dphi_ptr = &(res_grad_dgamma_by_dphi(0, 0));
     double* res_grad_gamma_ptr = &(res_grad_gamma(0, 0));
+    // allocated once, the entries are overwritten for every point
+    auto vgrad_i = vector<Vec3dSimd, xs::aligned_allocator<Vec3dSimd, XSIMD_DEFAULT_ALIGNMENT>>{
+            Vec3dSimd(), Vec3dSimd(), Vec3dSimd()
+        };
     for(int i = 0; i < num_points-num_points%simd_size; i += simd_size) {
         Vec3dSimd point_i = Vec3dSimd(&(pointsx[i]), &(pointsy[i]), &(pointsz[i]));
         auto v_i   = Vec3dSimd();
-        auto vgrad_i = vector<Vec3dSimd, xs::aligned_allocator<Vec3dSimd, XSIMD_DEFAULT_ALIGNMENT>>{
-                Vec3dSimd(), Vec3dSimd(), Vec3dSimd()
-            };
 #pragma unroll
         for(int k=0; k<simd_size; k++){
             for (int d = 0; d < 3; ++d) {
@@ -443,12 +446,13 @@ void biot_savart_vector_potential_vjp_kernel(
     double* res_gamma_ptr = &(res_gamma(0, 0));
     double* res_grad_dgamma_by_dphi_ptr = &(res_grad_dgamma_by_dphi(0, 0));
     double* res_grad_gamma_ptr = &(res_grad_gamma(0, 0));
+    // allocated once, the entries are overwritten for every point
+    auto vgrad_i = vector<Vec3dStd>{
+            Vec3dStd(), Vec3dStd(), Vec3dStd()
+        };
     for(int i = 0; i < num_points; i++) {
         Vec3dStd point_i = Vec3dStd(&(pointsx[i]), &(pointsy[i]), &(pointsz[i]));
         auto v_i   = Vec3dStd();
-        auto vgrad_i = vector<Vec3dStd>{
-                Vec3dStd(), Vec3dStd(), Vec3dStd()
-            };
 #pragma unroll
             for (int d = 0; d < 3; ++d) {
                 v_i[d] = v(i, d);
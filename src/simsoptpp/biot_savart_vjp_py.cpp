@@ -1,17 +1,55 @@
 #include "biot_savart_vjp_impl.h"
 #include "biot_savart_vjp_py.h"
+#include "perf.h"
+#include "pygil.h"
 
-void biot_savart_vjp(Array& points, vector<Array>& gammas, vector<Array>& dgamma_by_dphis, vector<double>& currents, Array& v, Array& vgrad, vector<Array>& dgamma_by_dcoeffs, vector<Array>& d2gamma_by_dphidcoeffs, vector<Array>& res_B, vector<Array>& res_dB){
-    auto pointsx = AlignedPaddedVec(points.shape(0), 0);
-    auto pointsy = AlignedPaddedVec(points.shape(0), 0);
-    auto pointsz = AlignedPaddedVec(points.shape(0), 0);
-    for (int i = 0; i < points.shape(0); ++i) {
-        pointsx[i] = points(i, 0);
-        pointsy[i] = points(i, 1);
-        pointsz[i] = points(i, 2);
+#ifdef SIMSOPT_PERF
+static uint64_t num_pairs(PointSet& points, vector<Array>& gammas) {
+    uint64_t res = 0;
+    for (auto& gamma : gammas)
+        res += uint64_t(points.size())*gamma.shape(0);
+    return res;
+}
+#endif
+
+static bool has_quadweights(vector<vector<double>>& quadweights, int i) {
+    return quadweights.size() > 0 && quadweights[i].size() > 0;
+}
+
+// The vjp kernels are linear in the weight of each quadrature point, so
+// non-uniform weights are applied by scaling row j of the result by quadweights[j].
+static void scale_rows(Array& res, vector<double>& quadweights) {
+    for (int j = 0; j < res.shape(0); ++j) {
+        for (int l = 0; l < 3; ++l) {
+            res(j, l) *= quadweights[j];
+        }
     }
+}
+
+// Passed to the kernels for the gradient terms when they are not computed,
+// the kernels don't access it. All calls share one array, which is created on
+// the first call (with the GIL held) and never destroyed, since it may outlive
+// the interpreter.
+static Array& unused_output() {
+    static Array* res = new Array(xt::zeros<double>({1, 1}));
+    return *res;
+}
+
+void biot_savart_vjp(PointSet& points, vector<Array>& gammas, vector<Array>& dgamma_by_dphis, vector<double>& currents, Array& v, Array& vgrad, vector<Array>& dgamma_by_dcoeffs, vector<Array>& d2gamma_by_dphidcoeffs, vector<Array>& res_B, vector<Array>& res_dB, vector<vector<double>>& quadweights){
+    SIMSOPT_PERF_SCOPE(timer, "biot_savart_vjp");
+    SIMSOPT_PERF_ADD(timer, points, points.size());
+    SIMSOPT_PERF_ADD(timer, pairs, num_pairs(points, gammas));
+    AlignedPaddedVec& pointsx = points.x();
+    AlignedPaddedVec& pointsy = points.y();
+    AlignedPaddedVec& pointsz = points.z();
 
     int num_coils  = gammas.size();
+    if(quadweights.size() != 0 && quadweights.size() != num_coils)
+        throw std::runtime_error("quadweights needs to be empty or have one entry per curve.");
+    for(int i=0; i<num_coils; i++) {
+        if(has_quadweights(quadweights, i) && quadweights[i].size() != gammas[i].shape(0))
+            throw std::runtime_error("quadweights needs to be empty or have one entry per quadrature point.");
+    }
 
     auto res_gamma = std::vector<Array>(num_coils, Array());
     auto res_dgamma_by_dphi = std::vector<Array>(num_coils, Array());
@@ -29,8 +67,9 @@ void biot_savart_vjp(Array& points, vector<Array>& gammas, vector<Array>& dgamma
             res_grad_dgamma_by_dphi[i] = xt::zeros<double>({num_points, 3});
         }
     }
-    Array dummy = Array();
+    Array& dummy = unused_output();
 
+    ScopedGILRelease gil;
     #pragma omp parallel for
     for(int i=0; i<num_coils; i++) {
         if(compute_dB)
@@ -40,6 +79,15 @@ void biot_savart_vjp(Array& points, vector<Array>& gammas, vector<Array>& dgamma
         else
             biot_savart_vjp_kernel<Array, 0>(pointsx, pointsy, pointsz, gammas[i], dgamma_by_dphis[i],
                     v, res_gamma[i], res_dgamma_by_dphi[i], dummy, dummy, dummy);
+        bool weighted = has_quadweights(quadweights, i);
+        if(weighted) {
+            scale_rows(res_gamma[i], quadweights[i]);
+            scale_rows(res_dgamma_by_dphi[i], quadweights[i]);
+            if(compute_dB) {
+                scale_rows(res_grad_gamma[i], quadweights[i]);
+                scale_rows(res_grad_dgamma_by_dphi[i], quadweights[i]);
+            }
+        }
         int numcoeff = dgamma_by_dcoeffs[i].shape(2);
         for (int j = 0; j < dgamma_by_dcoeffs[i].shape(0); ++j) {
             for (int l = 0; l < 3; ++l) {
@@ -56,27 +104,26 @@ void biot_savart_vjp(Array& points, vector<Array>& gammas, vector<Array>& dgamma
                 }
             }
         }
-        double fak = (currents[i] * 1e-7/gammas[i].shape(0));
+        double fak = weighted ? currents[i] * 1e-7 : (currents[i] * 1e-7/gammas[i].shape(0));
         res_B[i] *= fak;
         if(compute_dB)
             res_dB[i] *= fak;
     }
 }
 
-void biot_savart_vjp_graph(Array& points, vector<Array>& gammas, vector<Array>& dgamma_by_dphis, vector<double>& currents, Array& v, vector<Array>& res_gamma, vector<Array>& res_dgamma_by_dphi, Array& vgrad, vector<Array>& res_grad_gamma, vector<Array>& res_grad_dgamma_by_dphi) {
-    auto pointsx = AlignedPaddedVec(points.shape(0), 0);
-    auto pointsy = AlignedPaddedVec(points.shape(0), 0);
-    auto pointsz = AlignedPaddedVec(points.shape(0), 0);
-    for (int i = 0; i < points.shape(0); ++i) {
-        pointsx[i] = points(i, 0);
-        pointsy[i] = points(i, 1);
-        pointsz[i] = points(i, 2);
-    }
+void biot_savart_vjp_graph(PointSet& points, vector<Array>& gammas, vector<Array>& dgamma_by_dphis, vector<double>& currents, Array& v, vector<Array>& res_gamma, vector<Array>& res_dgamma_by_dphi, Array& vgrad, vector<Array>& res_grad_gamma, vector<Array>& res_grad_dgamma_by_dphi, vector<vector<double>>& quadweights) {
+    SIMSOPT_PERF_SCOPE(timer, "biot_savart_vjp_graph");
+    SIMSOPT_PERF_ADD(timer, points, points.size());
+    SIMSOPT_PERF_ADD(timer, pairs, num_pairs(points, gammas));
+    AlignedPaddedVec& pointsx = points.x();
+    AlignedPaddedVec& pointsy = points.y();
+    AlignedPaddedVec& pointsz = points.z();
 
     int num_coils  = gammas.size();
     bool compute_dB = res_grad_gamma.size() > 0;
-    Array dummy = Array();
+    Array& dummy = unused_output();
 
+    ScopedGILRelease gil;
     #pragma omp parallel for
     for(int i=0; i<num_coils; i++) {
         if(compute_dB)
@@ -88,30 +135,38 @@ void biot_savart_vjp_graph(Array& points, vector<Array>& gammas, vector<Array>&
                     v, res_gamma[i], res_dgamma_by_dphi[i],
                     dummy, dummy, dummy);
 
-        double fak = (currents[i] * 1e-7/gammas[i].shape(0));
+        bool weighted = has_quadweights(quadweights, i);
+        double fak = weighted ? currents[i] * 1e-7 : (currents[i] * 1e-7/gammas[i].shape(0));
         res_gamma[i] *= fak;
         res_dgamma_by_dphi[i] *= fak;
         if(compute_dB) {
             res_grad_gamma[i] *= fak;
             res_grad_dgamma_by_dphi[i] *= fak;
         }
+        if(weighted) {
+            scale_rows(res_gamma[i], quadweights[i]);
+            scale_rows(res_dgamma_by_dphi[i], quadweights[i]);
+            if(compute_dB) {
+                scale_rows(res_grad_gamma[i], quadweights[i]);
+                scale_rows(res_grad_dgamma_by_dphi[i], quadweights[i]);
+            }
+        }
     }
 }
 
-void biot_savart_vector_potential_vjp_graph(Array& points, vector<Array>& gammas, vector<Array>& dgamma_by_dphis, vector<double>& currents, Array& v, vector<Array>& res_gamma, vector<Array>& res_dgamma_by_dphi, Array& vgrad, vector<Array>& res_grad_gamma, vector<Array>& res_grad_dgamma_by_dphi) {
-    auto pointsx = AlignedPaddedVec(points.shape(0), 0);
-    auto pointsy = AlignedPaddedVec(points.shape(0), 0);
-    auto pointsz = AlignedPaddedVec(points.shape(0), 0);
-    for (int i = 0; i < points.shape(0); ++i) {
-        pointsx[i] = points(i, 0);
-        pointsy[i] = points(i, 1);
-        pointsz[i] = points(i, 2);
-    }
+void biot_savart_vector_potential_vjp_graph(PointSet& points, vector<Array>& gammas, vector<Array>& dgamma_by_dphis, vector<double>& currents, Array& v, vector<Array>& res_gamma, vector<Array>& res_dgamma_by_dphi, Array& vgrad, vector<Array>& res_grad_gamma, vector<Array>& res_grad_dgamma_by_dphi, vector<vector<double>>& quadweights) {
+    SIMSOPT_PERF_SCOPE(timer, "biot_savart_vector_potential_vjp_graph");
+    SIMSOPT_PERF_ADD(timer, points, points.size());
+    SIMSOPT_PERF_ADD(timer, pairs, num_pairs(points, gammas));
+    AlignedPaddedVec& pointsx = points.x();
+    AlignedPaddedVec& pointsy = points.y();
+    AlignedPaddedVec& pointsz = points.z();
 
     int num_coils  = gammas.size();
     bool compute_dA = res_grad_gamma.size() > 0;
-    Array dummy = Array();
+    Array& dummy = unused_output();
 
+    ScopedGILRelease gil;
     #pragma omp parallel for
     for(int i=0; i<num_coils; i++) {
         if(compute_dA)
@@ -123,12 +178,21 @@ void biot_savart_vector_potential_vjp_graph(Array& points, vector<Array>& gammas
                     v, res_gamma[i], res_dgamma_by_dphi[i],
                     dummy, dummy, dummy);
 
-        double fak = (currents[i] * 1e-7/gammas[i].shape(0));
+        bool weighted = has_quadweights(quadweights, i);
+        double fak = weighted ? currents[i] * 1e-7 : (currents[i] * 1e-7/gammas[i].shape(0));
         res_gamma[i] *= fak;
         res_dgamma_by_dphi[i] *= fak;
         if(compute_dA) {
             res_grad_gamma[i] *= fak;
             res_grad_dgamma_by_dphi[i] *= fak;
         }
+        if(weighted) {
+            scale_rows(res_gamma[i], quadweights[i]);
+            scale_rows(res_dgamma_by_dphi[i], quadweights[i]);
+            if(compute_dA) {
+                scale_rows(res_grad_gamma[i], quadweights[i]);
+                scale_rows(res_grad_dgamma_by_dphi[i], quadweights[i]);
+            }
+        }
     }
 }
@@ -2,6 +2,8 @@
 #include <xtensor/xarray.hpp>
 #include <xtensor/xnoalias.hpp>
 #include <stdexcept>
+#include <string>
+#include <algorithm>
 #include <fmt/core.h>
 #include <fmt/format.h>
 #include <fmt/ranges.h>
@@ -16,6 +18,16 @@ using std::vector;
 using std::shared_ptr;
 using std::make_shared;
 
+// The quantities of a BoozerMagneticField that can be requested together with
+// `BoozerMagneticField::compute`. Bit q of a mask stands for quantity q.
+enum BoozerQuantity {
+    booz_modB, booz_dmodBds, booz_dmodBdtheta, booz_dmodBdzeta, booz_d2modBdtheta2,
+    booz_d2modBdzeta2, booz_d2modBdthetadzeta, booz_R, booz_dRds, booz_dRdtheta, booz_dRdzeta,
+    booz_Z, booz_dZds, booz_dZdtheta, booz_dZdzeta, booz_nu, booz_dnuds, booz_dnudtheta,
+    booz_dnudzeta, booz_K, booz_dKdtheta, booz_dKdzeta, booz_psip, booz_G, booz_dGds, booz_I,
+    booz_dIds, booz_iota, booz_diotads, num_booz_quantities
+};
+
 template<template<class, std::size_t, xt::layout_type> class T>
 class BoozerMagneticField {
     public:
@@ -62,6 +74,10 @@ class BoozerMagneticField {
         virtual void _iota_impl(Tensor2& iota) { throw logic_error("_iota_impl was not implemented"); }
         virtual void _diotads_impl(Tensor2& diotads) { throw logic_error("_diotads_impl was not implemented"); }
         virtual void _set_points() { }
+        // Computes all quantities whose bit is set in mask in one pass and
+        // writes them to `quantity_buffer(q)`. Quantities that are not
+        // written are computed afterwards by their `_X_impl`.
+        virtual void _compute_impl(long mask) { }
 
         CachedTensor<T, 2> points;
         CachedTensor<T, 2> data_modB, data_dmodBdtheta, data_dmodBdzeta, data_dmodBds,\
@@ -72,6 +88,20 @@ class BoozerMagneticField {
           data_dKdzeta, data_K_derivs, data_d2modBdtheta2, data_d2modBdzeta2, data_d2modBdthetadzeta;
         int npoints;
 
+        CachedTensor<T, 2>& quantity_cache(int q) {
+            if(q < 0 || q >= num_booz_quantities)
+                throw std::runtime_error("Invalid quantity of a BoozerMagneticField.");
+            CachedTensor<T, 2>* caches[num_booz_quantities] = {
+                &data_modB, &data_dmodBds, &data_dmodBdtheta, &data_dmodBdzeta, &data_d2modBdtheta2,
+                &data_d2modBdzeta2, &data_d2modBdthetadzeta, &data_R, &data_dRds, &data_dRdtheta,
+                &data_dRdzeta, &data_Z, &data_dZds, &data_dZdtheta, &data_dZdzeta,
+                &data_nu, &data_dnuds, &data_dnudtheta, &data_dnudzeta, &data_K,
+                &data_dKdtheta, &data_dKdzeta, &data_psip, &data_G, &data_dGds,
+                &data_I, &data_dIds, &data_iota, &data_diotads
+            };
+            return *caches[q];
+        }
+
     public:
         BoozerMagneticField(double psi0) : psi0(psi0) {
             Tensor2 vals({{0., 0., 0.}});
@@ -133,6 +163,86 @@ class BoozerMagneticField {
             return points.get_or_create({npoints, 3});
         }
 
+        // Names of the quantities in the order of `BoozerQuantity`.
+        static const vector<std::string>& quantity_names() {
+            static const vector<std::string> names = {
+                "modB", "dmodBds", "dmodBdtheta", "dmodBdzeta", "d2modBdtheta2", "d2modBdzeta2",
+                "d2modBdthetadzeta", "R", "dRds", "dRdtheta", "dRdzeta", "Z",
+                "dZds", "dZdtheta", "dZdzeta", "nu", "dnuds", "dnudtheta",
+                "dnudzeta", "K", "dKdtheta", "dKdzeta", "psip", "G",
+                "dGds", "I", "dIds", "iota", "diotads"
+            };
+            return names;
+        }
+
+        // Mask for the given quantities. The derivative groups "modB_derivs",
+        // "K_derivs", "nu_derivs", "R_derivs" and "Z_derivs" stand for their
+        // components.
+        static long quantity_mask(const vector<std::string>& names) {
+            const vector<std::string>& all = quantity_names();
+            long mask = 0;
+            for (auto& name : names) {
+                auto it = std::find(all.begin(), all.end(), name);
+                if(it != all.end()) {
+                    mask |= 1L << (it - all.begin());
+                } else if(name == "modB_derivs") {
+                    mask |= (1L << booz_dmodBds) | (1L << booz_dmodBdtheta) | (1L << booz_dmodBdzeta);
+                } else if(name == "K_derivs") {
+                    mask |= (1L << booz_dKdtheta) | (1L << booz_dKdzeta);
+                } else if(name == "nu_derivs" || name == "R_derivs" || name == "Z_derivs") {
+                    std::string base = name.substr(0, name.size() - 7);
+                    for (auto d : {"s", "theta", "zeta"})
+                        mask |= quantity_mask({"d" + base + "d" + d});
+                } else {
+                    throw std::runtime_error(fmt::format("Unknown quantity {} of a BoozerMagneticField.", name));
+                }
+            }
+            return mask;
+        }
+
+        // Computes all quantities in mask that are not cached yet. Fields that
+        // override `_compute_impl` evaluate them in one fused pass over the
+        // points, sharing e.g. trigonometric functions and splines between
+        // the quantities; otherwise they are computed one by one.
+        void compute(long mask) {
+            long missing = 0;
+            for (int q = 0; q < num_booz_quantities; ++q) {
+                if(((mask >> q) & 1) && !quantity_cache(q).get_status())
+                    missing |= 1L << q;
+            }
+            if(missing == 0)
+                return;
+            _compute_impl(missing);
+            for (int q = 0; q < num_booz_quantities; ++q) {
+                if((missing >> q) & 1)
+                    quantity_ref(q);
+            }
+        }
+
+        // The `(npoints, 1)` cache of quantity q, marked as valid. Only meant
+        // to be written to by implementations of `_compute_impl`.
+        Tensor2& quantity_buffer(int q) {
+            return quantity_cache(q).get_or_create({npoints, 1});
+        }
+
+        Tensor2& quantity_ref(int q) {
+            if(q < 0 || q >= num_booz_quantities)
+                throw std::runtime_error("Invalid quantity of a BoozerMagneticField.");
+            static Tensor2& (BoozerMagneticField::* const refs[num_booz_quantities])() = {
+                &BoozerMagneticField::modB_ref, &BoozerMagneticField::dmodBds_ref, &BoozerMagneticField::dmodBdtheta_ref,
+                &BoozerMagneticField::dmodBdzeta_ref, &BoozerMagneticField::d2modBdtheta2_ref, &BoozerMagneticField::d2modBdzeta2_ref,
+                &BoozerMagneticField::d2modBdthetadzeta_ref, &BoozerMagneticField::R_ref, &BoozerMagneticField::dRds_ref,
+                &BoozerMagneticField::dRdtheta_ref, &BoozerMagneticField::dRdzeta_ref, &BoozerMagneticField::Z_ref,
+                &BoozerMagneticField::dZds_ref, &BoozerMagneticField::dZdtheta_ref, &BoozerMagneticField::dZdzeta_ref,
+                &BoozerMagneticField::nu_ref, &BoozerMagneticField::dnuds_ref, &BoozerMagneticField::dnudtheta_ref,
+                &BoozerMagneticField::dnudzeta_ref, &BoozerMagneticField::K_ref, &BoozerMagneticField::dKdtheta_ref,
+                &BoozerMagneticField::dKdzeta_ref, &BoozerMagneticField::psip_ref, &BoozerMagneticField::G_ref,
+                &BoozerMagneticField::dGds_ref, &BoozerMagneticField::I_ref, &BoozerMagneticField::dIds_ref,
+                &BoozerMagneticField::iota_ref, &BoozerMagneticField::diotads_ref
+            };
+            return (this->*refs[q])();
+        }
+
         Tensor2& K_ref() {
             return data_K.get_or_create_and_fill({npoints, 1}, [this](Tensor2& K) { return _K_impl(K);});
         }
@@ -36,6 +36,25 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
         vector<bool> symmetries = vector<bool>(1, false);
 
     protected:
+      void _compute_impl(long mask) override {
+          build_interpolants(mask);
+          Tensor2& stz = this->get_points_ref();
+          Tensor2 stz0 = xt::zeros<double>({npoints, 3});
+          Tensor2 stz_sym = xt::zeros<double>({npoints, 3});
+          // the points are mapped once and shared by all quantities
+          exploit_fluxfunction_points(stz, stz0);
+          exploit_symmetries_points(stz, stz_sym);
+          for (int q = 0; q < num_booz_quantities; ++q) {
+              if(!((mask >> q) & 1))
+                  continue;
+              ScalarInterpolant si = scalar_interpolant(q);
+              Tensor2& out = this->quantity_buffer(q);
+              (*si.interp)->evaluate_batch(si.fluxfunction ? stz0 : stz_sym, out);
+              if(stellsym && si.odd)
+                  apply_odd_symmetry(out);
+          }
+      }
+
       void _psip_impl(Tensor2& psip) override {
           if(!interp_psip)
               interp_psip = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, angle0_range, angle0_range, 1, extrapolate);
@@ -806,6 +825,114 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             }
         }
 
+        // The interpolant of quantity q of `BoozerQuantity` together with its
+        // build status, whether it is a flux function, i.e. only depends on
+        // s, and whether it is odd under stellarator symmetry.
+        struct ScalarInterpolant {
+            shared_ptr<RegularGridInterpolant3D<Tensor2>>* interp;
+            bool* status;
+            bool fluxfunction;
+            bool odd;
+        };
+
+        ScalarInterpolant scalar_interpolant(int q) {
+            ScalarInterpolant interpolants[num_booz_quantities] = {
+                {&interp_modB, &status_modB, false, false},
+                {&interp_dmodBds, &status_dmodBds, false, false},
+                {&interp_dmodBdtheta, &status_dmodBdtheta, false, true},
+                {&interp_dmodBdzeta, &status_dmodBdzeta, false, true},
+                {&interp_d2modBdtheta2, &status_d2modBdtheta2, false, false},
+                {&interp_d2modBdzeta2, &status_d2modBdzeta2, false, false},
+                {&interp_d2modBdthetadzeta, &status_d2modBdthetadzeta, false, false},
+                {&interp_R, &status_R, false, false},
+                {&interp_dRds, &status_dRds, false, false},
+                {&interp_dRdtheta, &status_dRdtheta, false, true},
+                {&interp_dRdzeta, &status_dRdzeta, false, true},
+                {&interp_Z, &status_Z, false, true},
+                {&interp_dZds, &status_dZds, false, true},
+                {&interp_dZdtheta, &status_dZdtheta, false, false},
+                {&interp_dZdzeta, &status_dZdzeta, false, false},
+                {&interp_nu, &status_nu, false, true},
+                {&interp_dnuds, &status_dnuds, false, true},
+                {&interp_dnudtheta, &status_dnudtheta, false, false},
+                {&interp_dnudzeta, &status_dnudzeta, false, false},
+                {&interp_K, &status_K, false, true},
+                {&interp_dKdtheta, &status_dKdtheta, false, false},
+                {&interp_dKdzeta, &status_dKdzeta, false, false},
+                {&interp_psip, &status_psip, true, false},
+                {&interp_G, &status_G, true, false},
+                {&interp_dGds, &status_dGds, true, false},
+                {&interp_I, &status_I, true, false},
+                {&interp_dIds, &status_dIds, true, false},
+                {&interp_iota, &status_iota, true, false},
+                {&interp_diotads, &status_diotads, true, false}
+            };
+            return interpolants[q];
+        }
+
+        // Builds the missing interpolants of the quantities in mask. All
+        // interpolants on the same grid are built together: the underlying
+        // field is evaluated once per batch of grid points for all of them,
+        // using its fused `compute`.
+        void build_interpolants(long mask) {
+            for (bool fluxfunction : {false, true}) {
+                vector<int> qs;
+                long group = 0;
+                for (int q = 0; q < num_booz_quantities; ++q) {
+                    if(!((mask >> q) & 1))
+                        continue;
+                    ScalarInterpolant si = scalar_interpolant(q);
+                    if(si.fluxfunction != fluxfunction || *si.status)
+                        continue;
+                    if(!*si.interp) {
+                        if(fluxfunction)
+                            *si.interp = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, angle0_range, angle0_range, 1, extrapolate);
+                        else
+                            *si.interp = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
+                    }
+                    qs.push_back(q);
+                    group |= 1L << q;
+                }
+                if(qs.empty())
+                    continue;
+                Tensor2 old_points = this->field->get_points();
+                // values of the other quantities for each batch, in the order
+                // in which interpolate_batch requests the batches
+                vector<vector<Vec>> pending(qs.size());
+                std::function<Vec(Vec, Vec, Vec)> fbatch = [&](Vec s, Vec theta, Vec zeta) {
+                    int n = s.size();
+                    Tensor2 points = xt::zeros<double>({n, 3});
+                    for (int i = 0; i < n; ++i) {
+                        points(i, 0) = s[i];
+                        if(!fluxfunction) {
+                            points(i, 1) = theta[i];
+                            points(i, 2) = zeta[i];
+                        }
+                    }
+                    this->field->set_points(points);
+                    this->field->compute(group);
+                    for (int j = 1; j < (int)qs.size(); ++j) {
+                        double* data = this->field->quantity_ref(qs[j]).data();
+                        pending[j].push_back(Vec(data, data + n));
+                    }
+                    double* data = this->field->quantity_ref(qs[0]).data();
+                    return Vec(data, data + n);
+                };
+                (*scalar_interpolant(qs[0]).interp)->interpolate_batch(fbatch);
+                for (int j = 1; j < (int)qs.size(); ++j) {
+                    int batch = 0;
+                    std::function<Vec(Vec, Vec, Vec)> fpending = [&](Vec s, Vec theta, Vec zeta) {
+                        return pending[j][batch++];
+                    };
+                    (*scalar_interpolant(qs[j]).interp)->interpolate_batch(fpending);
+                    pending[j].clear();
+                }
+                this->field->set_points(old_points);
+                for (int q : qs)
+                    *scalar_interpolant(q).status = true;
+            }
+        }
+
         Vec fbatch_scalar(Vec s, Vec theta, Vec zeta, string which_scalar) {
             int npoints = s.size();
             Tensor2 points = xt::zeros<double>({npoints, 3});
@@ -0,0 +1,219 @@
+#include "boozermagneticfield_spline.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// The smallest s at which the s derivative of s^p with 0 < p < 1 is evaluated.
+static const double s_min = 1e-10;
+
+RadialSplines::RadialSplines(vector<double> knots, int degree, vector<vector<double>> coeffs_) :
+    knots(knots), degree(degree), num_functions(coeffs_.size()), n(knots.size() - degree - 1) {
+    if(degree < 1)
+        throw std::runtime_error("RadialSplines needs a degree of at least one.");
+    if(n < degree + 1)
+        throw std::runtime_error("RadialSplines needs at least 2*(degree+1) knots.");
+    if(num_functions == 0)
+        throw std::runtime_error("RadialSplines needs at least one function.");
+    coeffs = vector<double>(n*num_functions);
+    for (int f = 0; f < num_functions; ++f) {
+        if((int)coeffs_[f].size() < n)
+            throw std::runtime_error("RadialSplines needs at least len(knots)-degree-1 coefficients per function.");
+        for (int j = 0; j < n; ++j)
+            coeffs[j*num_functions + f] = coeffs_[f][j];
+    }
+}
+
+void RadialSplines::evaluate(double s, double* work, double* val, double* dval) const {
+    int k = degree;
+    const double* t = knots.data();
+    // knot interval containing s, clamped to the first/last one for extrapolation
+    int span = std::upper_bound(t + k, t + n, s) - t - 1;
+    span = std::max(k, std::min(span, n - 1));
+
+    // nonzero basis functions N_{span-k}, ..., N_{span} of degree k (and of
+    // degree k-1 for the derivatives), see The NURBS Book, Algorithm A2.2
+    double* N = work;
+    double* Nkm1 = N + k + 1;
+    double* left = Nkm1 + k + 1;
+    double* right = left + k + 1;
+    N[0] = 1.;
+    for (int j = 1; j <= k; ++j) {
+        if(j == k)
+            std::copy(N, N + k, Nkm1);
+        left[j] = s - t[span + 1 - j];
+        right[j] = t[span + j] - s;
+        double saved = 0.;
+        for (int r = 0; r < j; ++r) {
+            double temp = N[r]/(right[r + 1] + left[j - r]);
+            N[r] = saved + right[r + 1]*temp;
+            saved = left[j - r]*temp;
+        }
+        N[j] = saved;
+    }
+
+    std::fill(val, val + num_functions, 0.);
+    if(dval)
+        std::fill(dval, dval + num_functions, 0.);
+    for (int r = 0; r <= k; ++r) {
+        int i = span - k + r;
+        const double* c = &coeffs[i*num_functions];
+        for (int f = 0; f < num_functions; ++f)
+            val[f] += N[r]*c[f];
+        if(!dval)
+            continue;
+        // derivative of N_{i,k} from N_{i,k-1} = Nkm1[r-1] and N_{i+1,k-1} = Nkm1[r]
+        double dN = 0.;
+        if(r > 0)
+            dN += k*Nkm1[r - 1]/(t[i + k] - t[i]);
+        if(r < k)
+            dN -= k*Nkm1[r]/(t[i + k + 1] - t[i + 1]);
+        for (int f = 0; f < num_functions; ++f)
+            dval[f] += dN*c[f];
+    }
+}
+
+template<template<class, std::size_t, xt::layout_type> class T>
+BoozerRadialSplineField<T>::BoozerRadialSplineField(double psi0, vector<double> xm, vector<double> xn, vector<double> radial_power,
+        shared_ptr<RadialSplines> modB_cos, shared_ptr<RadialSplines> modB_sin,
+        shared_ptr<RadialSplines> R_cos, shared_ptr<RadialSplines> R_sin,
+        shared_ptr<RadialSplines> Z_cos, shared_ptr<RadialSplines> Z_sin,
+        shared_ptr<RadialSplines> nu_cos, shared_ptr<RadialSplines> nu_sin,
+        shared_ptr<RadialSplines> K_cos, shared_ptr<RadialSplines> K_sin,
+        shared_ptr<RadialSplines> psip_spline, shared_ptr<RadialSplines> G_spline,
+        shared_ptr<RadialSplines> I_spline, shared_ptr<RadialSplines> iota_spline) :
+    BoozerMagneticField<T>(psi0), xm(xm), xn(xn), radial_power(radial_power),
+    modB_cos(modB_cos), modB_sin(modB_sin), R_cos(R_cos), R_sin(R_sin), Z_cos(Z_cos), Z_sin(Z_sin),
+    nu_cos(nu_cos), nu_sin(nu_sin), K_cos(K_cos), K_sin(K_sin),
+    psip_spline(psip_spline), G_spline(G_spline), I_spline(I_spline), iota_spline(iota_spline),
+    modes(xm, xn) {
+    int num_modes = xm.size();
+    if((int)radial_power.size() != num_modes)
+        throw std::runtime_error("radial_power needs to have the same length as xm.");
+    for (auto& spl : {modB_cos, modB_sin, R_cos, R_sin, Z_cos, Z_sin, nu_cos, nu_sin, K_cos, K_sin}) {
+        if(spl && spl->num_functions != num_modes)
+            throw std::runtime_error("The radial splines of a Fourier series need one function per mode.");
+    }
+    for (auto& spl : {psip_spline, G_spline, I_spline, iota_spline}) {
+        if(spl && spl->num_functions != 1)
+            throw std::runtime_error("The radial splines of a profile need exactly one function.");
+    }
+    powers = radial_power;
+    std::sort(powers.begin(), powers.end());
+    powers.erase(std::unique(powers.begin(), powers.end()), powers.end());
+    power_index = vector<int>(num_modes);
+    for (int im = 0; im < num_modes; ++im)
+        power_index[im] = std::lower_bound(powers.begin(), powers.end(), radial_power[im]) - powers.begin();
+}
+
+// Evaluates the splines a (cos part) and b (sin part) of a Fourier series at
+// s and adds
+//   f = sum a c + b s, and its derivatives wrt s, theta, zeta to out[0:4], and
+//   the second derivatives wrt theta^2, zeta^2, theta zeta to out2[0:3] if
+//   out2 is not null.
+static void accumulate_series(const RadialSplines* a, const RadialSplines* b, double s, const FourierModes& modes,
+        const double* c, const double* sn, const double* rp, const double* drp, const vector<int>& power_index,
+        double* work, double* val, double* dval, double* out, double* out2) {
+    int num_modes = modes.num_modes;
+    for (int part = 0; part < 2; ++part) {
+        const RadialSplines* spl = part == 0 ? a : b;
+        if(!spl)
+            continue;
+        spl->evaluate(s, work, val, dval);
+        // for the sin part, the roles of cos and sin are swapped and the
+        // angular derivatives change sign
+        const double* ce = part == 0 ? c : sn;
+        const double* se = part == 0 ? sn : c;
+        double sign = part == 0 ? 1. : -1.;
+        double f = 0., fs = 0., ft = 0., fz = 0., ftt = 0., fzz = 0., ftz = 0.;
+        for (int im = 0; im < num_modes; ++im) {
+            int ip = power_index[im];
+            double coef = val[im]*rp[ip];
+            double dcoef = dval[im]*rp[ip] + val[im]*drp[ip];
+            double even = coef*ce[im];
+            double odd = coef*se[im];
+            f += even;
+            fs += dcoef*ce[im];
+            ft -= modes.xm[im]*odd;
+            fz += modes.xn[im]*odd;
+            if(out2) {
+                ftt -= modes.xm[im]*modes.xm[im]*even;
+                fzz -= modes.xn[im]*modes.xn[im]*even;
+                ftz += modes.xm[im]*modes.xn[im]*even;
+            }
+        }
+        out[0] += f;
+        out[1] += fs;
+        out[2] += sign*ft;
+        out[3] += sign*fz;
+        if(out2) {
+            out2[0] += ftt;
+            out2[1] += fzz;
+            out2[2] += ftz;
+        }
+    }
+}
+
+template<template<class, std::size_t, xt::layout_type> class T>
+void BoozerRadialSplineField<T>::compute_table() {
+    table.assign(npoints*num_booz_quantities, 0.);
+    int num_modes = modes.num_modes;
+    int num_powers = powers.size();
+    int spline_worksize = 0;
+    for (auto& spl : {modB_cos, modB_sin, R_cos, R_sin, Z_cos, Z_sin, nu_cos, nu_sin, K_cos, K_sin,
+            psip_spline, G_spline, I_spline, iota_spline}) {
+        if(spl)
+            spline_worksize = std::max(spline_worksize, spl->worksize());
+    }
+    auto& points = this->get_points_ref();
+    double* points_ptr = points.data();
+    double* table_ptr = table.data();
+#pragma omp parallel
+    {
+        vector<double> work(std::max(modes.worksize(), spline_worksize));
+        vector<double> c(num_modes), sn(num_modes), val(num_modes), dval(num_modes);
+        vector<double> rp(num_powers), drp(num_powers);
+#pragma omp for
+        for (int i = 0; i < npoints; ++i) {
+            double s = points_ptr[3*i];
+            double theta = points_ptr[3*i + 1];
+            double zeta = points_ptr[3*i + 2];
+            double* row = table_ptr + i*num_booz_quantities;
+            // s^p with 0 < p < 1 (e.g. p = 1/2 for m = 1) has an infinite
+            // derivative on the axis, so the derivative is evaluated no
+            // closer to the axis than s_min
+            double s_pos = std::max(s, 0.);
+            for (int ip = 0; ip < num_powers; ++ip) {
+                double p = powers[ip];
+                rp[ip] = p == 0. ? 1. : std::pow(s_pos, p);
+                drp[ip] = p == 0. ? 0. : p*std::pow(p < 1. ? std::max(s, s_min) : s_pos, p - 1.);
+            }
+            modes.angles(theta, zeta, work.data(), c.data(), sn.data());
+            // the K series has no s derivative column, it goes to a scratch slot
+            double K_out[4] = {0., 0., 0., 0.};
+            auto series = [&](const shared_ptr<RadialSplines>& a, const shared_ptr<RadialSplines>& b, double* out, double* out2) {
+                accumulate_series(a.get(), b.get(), s, modes, c.data(), sn.data(), rp.data(), drp.data(), power_index,
+                        work.data(), val.data(), dval.data(), out, out2);
+            };
+            series(modB_cos, modB_sin, row + booz_modB, row + booz_d2modBdtheta2);
+            series(R_cos, R_sin, row + booz_R, nullptr);
+            series(Z_cos, Z_sin, row + booz_Z, nullptr);
+            series(nu_cos, nu_sin, row + booz_nu, nullptr);
+            series(K_cos, K_sin, K_out, nullptr);
+            row[booz_K] = K_out[0];
+            row[booz_dKdtheta] = K_out[2];
+            row[booz_dKdzeta] = K_out[3];
+
+            if(psip_spline)
+                psip_spline->evaluate(s, work.data(), row + booz_psip, nullptr);
+            if(G_spline)
+                G_spline->evaluate(s, work.data(), row + booz_G, row + booz_dGds);
+            if(I_spline)
+                I_spline->evaluate(s, work.data(), row + booz_I, row + booz_dIds);
+            if(iota_spline)
+                iota_spline->evaluate(s, work.data(), row + booz_iota, row + booz_diotads);
+        }
+    }
+}
+
+#include "xtensor-python/pytensor.hpp"     // Numpy bindings
+template class BoozerRadialSplineField<xt::pytensor>;
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <vector>
+#include "boozermagneticfield.h"
+#include "boozerradialinterpolant.h"
+
+using std::vector;
+using std::shared_ptr;
+
+// A family of B-splines in s that share knots and degree, e.g. the radial
+// profiles of all Fourier modes of one quantity. The knots and coefficients
+// are given in the format used by scipy (`t`, `c`, `k`), i.e. `knots` has
+// length n+degree+1 and only the first n coefficients of each function are
+// used. Outside of the knots the splines are extrapolated with the polynomial
+// of the first/last interval, as done by scipy.
+class RadialSplines {
+    public:
+        const vector<double> knots;
+        const int degree;
+        const int num_functions;
+
+        RadialSplines(vector<double> knots, int degree, vector<vector<double>> coeffs);
+
+        // Length of the work array for `evaluate`.
+        int worksize() const {
+            return 4*(degree+1);
+        }
+
+        // Writes the values and the s derivatives of all functions at s to
+        // val[i] and dval[i]. The derivatives are skipped if dval is nullptr.
+        void evaluate(double s, double* work, double* val, double* dval) const;
+
+    private:
+        int n;
+        // coefficients stored as (n, num_functions), so that the
+        // degree+1 coefficients needed at one s are contiguous
+        vector<double> coeffs;
+};
+
+template<template<class, std::size_t, xt::layout_type> class T>
+class BoozerRadialSplineField : public BoozerMagneticField<T> {
+    /*
+     * A Boozer field given by radial splines of its Fourier coefficients,
+     *
+     *   modB = sum_mn s^p_mn (bmnc(s) cos(m theta - n zeta) + bmns(s) sin(m theta - n zeta)),
+     *
+     * and similarly for R, Z, nu and K, plus splines of the profiles psip, G,
+     * I and iota. The factor s^p_mn allows to spline the coefficients divided
+     * by their behaviour near the axis.
+     *
+     * All quantities are computed together in one pass over the points: the
+     * splines are evaluated once per point, cos and sin of all modes are
+     * obtained by recurrence and shared between modB, R, Z, nu, K and their
+     * angular derivatives, and the s derivatives are obtained from the
+     * derivatives of the splines. The results are kept in a table until the
+     * points change. Compared to an `InterpolatedBoozerField`, only the
+     * radial splines are stored, so that the memory does not grow with the
+     * number of modes squared.
+     *
+     * The cos and sin splines of each series may be null, in which case the
+     * corresponding part of the series vanishes.
+     */
+    public:
+        using typename BoozerMagneticField<T>::Tensor2;
+        using BoozerMagneticField<T>::npoints;
+
+        const vector<double> xm, xn, radial_power;
+        const shared_ptr<RadialSplines> modB_cos, modB_sin, R_cos, R_sin, Z_cos, Z_sin, nu_cos, nu_sin, K_cos, K_sin;
+        const shared_ptr<RadialSplines> psip_spline, G_spline, I_spline, iota_spline;
+
+    private:
+        FourierModes modes;
+        // distinct values of radial_power and the index into them for each mode
+        vector<double> powers;
+        vector<int> power_index;
+        vector<double> table;
+        bool table_valid = false;
+
+        void compute_table();
+
+        const double* column_data() {
+            if(!table_valid) {
+                compute_table();
+                table_valid = true;
+            }
+            return table.data();
+        }
+
+        void copy_columns(Tensor2& out, std::initializer_list<BoozerQuantity> cols) {
+            const double* tab = column_data();
+            int ncols = cols.size();
+            double* out_ptr = out.data();
+            for (int i = 0; i < npoints; ++i) {
+                int j = 0;
+                for (BoozerQuantity c : cols)
+                    out_ptr[i*ncols + j++] = tab[i*num_booz_quantities + c];
+            }
+        }
+
+    protected:
+        void _compute_impl(long mask) override {
+            const double* tab = column_data();
+            for (int q = 0; q < num_booz_quantities; ++q) {
+                if(!((mask >> q) & 1))
+                    continue;
+                double* out_ptr = this->quantity_buffer(q).data();
+                for (int i = 0; i < npoints; ++i)
+                    out_ptr[i] = tab[i*num_booz_quantities + q];
+            }
+        }
+
+        void _modB_impl(Tensor2& out) override { copy_columns(out, {booz_modB}); }
+        void _dmodBds_impl(Tensor2& out) override { copy_columns(out, {booz_dmodBds}); }
+        void _dmodBdtheta_impl(Tensor2& out) override { copy_columns(out, {booz_dmodBdtheta}); }
+        void _dmodBdzeta_impl(Tensor2& out) override { copy_columns(out, {booz_dmodBdzeta}); }
+        void _modB_derivs_impl(Tensor2& out) override { copy_columns(out, {booz_dmodBds, booz_dmodBdtheta, booz_dmodBdzeta}); }
+        void _d2modBdtheta2_impl(Tensor2& out) override { copy_columns(out, {booz_d2modBdtheta2}); }
+        void _d2modBdzeta2_impl(Tensor2& out) override { copy_columns(out, {booz_d2modBdzeta2}); }
+        void _d2modBdthetadzeta_impl(Tensor2& out) override { copy_columns(out, {booz_d2modBdthetadzeta}); }
+        void _R_impl(Tensor2& out) override { copy_columns(out, {booz_R}); }
+        void _dRds_impl(Tensor2& out) override { copy_columns(out, {booz_dRds}); }
+        void _dRdtheta_impl(Tensor2& out) override { copy_columns(out, {booz_dRdtheta}); }
+        void _dRdzeta_impl(Tensor2& out) override { copy_columns(out, {booz_dRdzeta}); }
+        void _R_derivs_impl(Tensor2& out) override { copy_columns(out, {booz_dRds, booz_dRdtheta, booz_dRdzeta}); }
+        void _Z_impl(Tensor2& out) override { copy_columns(out, {booz_Z}); }
+        void _dZds_impl(Tensor2& out) override { copy_columns(out, {booz_dZds}); }
+        void _dZdtheta_impl(Tensor2& out) override { copy_columns(out, {booz_dZdtheta}); }
+        void _dZdzeta_impl(Tensor2& out) override { copy_columns(out, {booz_dZdzeta}); }
+        void _Z_derivs_impl(Tensor2& out) override { copy_columns(out, {booz_dZds, booz_dZdtheta, booz_dZdzeta}); }
+        void _nu_impl(Tensor2& out) override { copy_columns(out, {booz_nu}); }
+        void _dnuds_impl(Tensor2& out) override { copy_columns(out, {booz_dnuds}); }
+        void _dnudtheta_impl(Tensor2& out) override { copy_columns(out, {booz_dnudtheta}); }
+        void _dnudzeta_impl(Tensor2& out) override { copy_columns(out, {booz_dnudzeta}); }
+        void _nu_derivs_impl(Tensor2& out) override { copy_columns(out, {booz_dnuds, booz_dnudtheta, booz_dnudzeta}); }
+        void _K_impl(Tensor2& out) override { copy_columns(out, {booz_K}); }
+        void _dKdtheta_impl(Tensor2& out) override { copy_columns(out, {booz_dKdtheta}); }
+        void _dKdzeta_impl(Tensor2& out) override { copy_columns(out, {booz_dKdzeta}); }
+        void _K_derivs_impl(Tensor2& out) override { copy_columns(out, {booz_dKdtheta, booz_dKdzeta}); }
+        void _psip_impl(Tensor2& out) override { copy_columns(out, {booz_psip}); }
+        void _G_impl(Tensor2& out) override { copy_columns(out, {booz_G}); }
+        void _dGds_impl(Tensor2& out) override { copy_columns(out, {booz_dGds}); }
+        void _I_impl(Tensor2& out) override { copy_columns(out, {booz_I}); }
+        void _dIds_impl(Tensor2& out) override { copy_columns(out, {booz_dIds}); }
+        void _iota_impl(Tensor2& out) override { copy_columns(out, {booz_iota}); }
+        void _diotads_impl(Tensor2& out) override { copy_columns(out, {booz_diotads}); }
+
+    public:
+        BoozerRadialSplineField(double psi0, vector<double> xm, vector<double> xn, vector<double> radial_power,
+                shared_ptr<RadialSplines> modB_cos, shared_ptr<RadialSplines> modB_sin,
+                shared_ptr<RadialSplines> R_cos, shared_ptr<RadialSplines> R_sin,
+                shared_ptr<RadialSplines> Z_cos, shared_ptr<RadialSplines> Z_sin,
+                shared_ptr<RadialSplines> nu_cos, shared_ptr<RadialSplines> nu_sin,
+                shared_ptr<RadialSplines> K_cos, shared_ptr<RadialSplines> K_sin,
+                shared_ptr<RadialSplines> psip_spline, shared_ptr<RadialSplines> G_spline,
+                shared_ptr<RadialSplines> I_spline, shared_ptr<RadialSplines> iota_spline);
+
+        void invalidate_cache() override {
+            BoozerMagneticField<T>::invalidate_cache();
+            table_valid = false;
+        }
+};
@@ -1,9 +1,281 @@
 #include "boozerradialinterpolant.h"
 #include <math.h>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include "threads.h"
 #include "xtensor-python/pyarray.hpp"
 typedef xt::pyarray<double> Array;
 #include <xtensor/xview.hpp>
 
+FourierModes::FourierModes(const vector<double>& xm, const vector<double>& xn) : num_modes(xm.size()), xm(xm), xn(xn), k(num_modes), m_index(num_modes), n_index(num_modes) {
+    if(xn.size() != xm.size())
+        throw std::runtime_error("xm and xn need to have the same length.");
+    for (int im = 0; im < num_modes; ++im) {
+        if(xm[im] != std::round(xm[im]) || xm[im] < 0 || xn[im] != std::round(xn[im]))
+            recurrence = false;
+    }
+    if(recurrence) {
+        for (int im = 0; im < num_modes; ++im) {
+            mmax = std::max(mmax, int(xm[im]));
+            nfp = std::gcd(nfp, std::abs(int(xn[im])));
+        }
+        nfp = std::max(nfp, 1);
+        for (int im = 0; im < num_modes; ++im) {
+            k[im] = int(xn[im])/nfp;
+            kmax = std::max(kmax, std::abs(k[im]));
+        }
+    }
+    m_unique = xm;
+    n_unique = xn;
+    for (auto* u : {&m_unique, &n_unique}) {
+        std::sort(u->begin(), u->end());
+        u->erase(std::unique(u->begin(), u->end()), u->end());
+    }
+    for (int im = 0; im < num_modes; ++im) {
+        m_index[im] = std::lower_bound(m_unique.begin(), m_unique.end(), xm[im]) - m_unique.begin();
+        n_index[im] = std::lower_bound(n_unique.begin(), n_unique.end(), xn[im]) - n_unique.begin();
+    }
+}
+
+static vector<double> to_vector(Array& a) {
+    return vector<double>(a.data(), a.data() + a.size());
+}
+
+// Checks whether the points are a tensor product grid ordered as
+// thetas[iz*ntheta + it] = theta_it, zetas[iz*ntheta + it] = zeta_iz, as
+// created by np.meshgrid(thetas, zetas).
+static bool tensor_grid(Array& thetas, Array& zetas, vector<double>& theta_grid, vector<double>& zeta_grid) {
+    int num_points = thetas.shape(0);
+    if(num_points == 0)
+        return false;
+    int ntheta = 1;
+    while(ntheta < num_points && zetas(ntheta) == zetas(0))
+        ntheta++;
+    if(num_points % ntheta != 0)
+        return false;
+    int nzeta = num_points/ntheta;
+    for (int iz = 0; iz < nzeta; ++iz) {
+        for (int it = 0; it < ntheta; ++it) {
+            int ip = iz*ntheta + it;
+            if(thetas(ip) != thetas(it) || zetas(ip) != zetas(iz*ntheta))
+                return false;
+        }
+    }
+    theta_grid.resize(ntheta);
+    zeta_grid.resize(nzeta);
+    for (int it = 0; it < ntheta; ++it)
+        theta_grid[it] = thetas(it);
+    for (int iz = 0; iz < nzeta; ++iz)
+        zeta_grid[iz] = zetas(iz*ntheta);
+    return true;
+}
+
+// Number of quantities needed to evaluate K: B, R, dR/dtheta, dR/dzeta, dR/ds,
+// dZ/dtheta, dZ/dzeta, dZ/ds, nu, dnu/ds, dnu/dtheta, dnu/dzeta.
+static constexpr int NUM_K_QUANTITIES = 12;
+
+// Each of the quantities is a series sum_im a[q][im]*cos(angle) + b[q][im]*sin(angle).
+// The coefficients for surface isurf are written to a and b of size
+// NUM_K_QUANTITIES*num_modes. The non-stellarator symmetric coefficients may
+// be nullptr.
+static void K_coefficients(const FourierModes& modes, int isurf,
+        Array& rmnc, Array& drmncds, Array& zmns, Array& dzmnsds, Array& numns, Array& dnumnsds, Array& bmnc,
+        Array* rmns, Array* drmnsds, Array* zmnc, Array* dzmncds, Array* numnc, Array* dnumncds, Array* bmns,
+        double* a, double* b) {
+    int nm = modes.num_modes;
+    for (int im = 0; im < nm; ++im) {
+        double m = modes.xm[im];
+        double n = modes.xn[im];
+        a[ 0*nm+im] = bmnc(im,isurf);     b[ 0*nm+im] = bmns ? (*bmns)(im,isurf) : 0.;
+        a[ 1*nm+im] = rmnc(im,isurf);     b[ 1*nm+im] = rmns ? (*rmns)(im,isurf) : 0.;
+        a[ 2*nm+im] = rmns ? m*(*rmns)(im,isurf) : 0.;   b[ 2*nm+im] = -m*rmnc(im,isurf);
+        a[ 3*nm+im] = rmns ? -n*(*rmns)(im,isurf) : 0.;  b[ 3*nm+im] = n*rmnc(im,isurf);
+        a[ 4*nm+im] = drmncds(im,isurf);  b[ 4*nm+im] = drmnsds ? (*drmnsds)(im,isurf) : 0.;
+        a[ 5*nm+im] = m*zmns(im,isurf);   b[ 5*nm+im] = zmnc ? -m*(*zmnc)(im,isurf) : 0.;
+        a[ 6*nm+im] = -n*zmns(im,isurf);  b[ 6*nm+im] = zmnc ? n*(*zmnc)(im,isurf) : 0.;
+        a[ 7*nm+im] = dzmncds ? (*dzmncds)(im,isurf) : 0.;  b[ 7*nm+im] = dzmnsds(im,isurf);
+        a[ 8*nm+im] = numnc ? (*numnc)(im,isurf) : 0.;      b[ 8*nm+im] = numns(im,isurf);
+        a[ 9*nm+im] = dnumncds ? (*dnumncds)(im,isurf) : 0.; b[ 9*nm+im] = dnumnsds(im,isurf);
+        a[10*nm+im] = m*numns(im,isurf);  b[10*nm+im] = numnc ? -m*(*numnc)(im,isurf) : 0.;
+        a[11*nm+im] = -n*numns(im,isurf); b[11*nm+im] = numnc ? n*(*numnc)(im,isurf) : 0.;
+    }
+}
+
+// K = (g_{s zeta} + iota g_{s theta})/sqrt(g) from the quantities above.
+static inline double K_from_quantities(const double* q, double zeta, double G, double iota, double I) {
+    double B = q[0], R = q[1], dRdtheta = q[2], dRdzeta = q[3], dRds = q[4];
+    double dZdtheta = q[5], dZdzeta = q[6], dZds = q[7];
+    double nu = q[8], dnuds = q[9], dnudtheta = q[10], dnudzeta = q[11];
+    double phi = zeta - nu;
+    double dphids = - dnuds;
+    double dphidtheta = - dnudtheta;
+    double dphidzeta = 1 - dnudzeta;
+    double cosphi = cos(phi);
+    double sinphi = sin(phi);
+    double dXdtheta = dRdtheta * cosphi - R * sinphi * dphidtheta;
+    double dYdtheta = dRdtheta * sinphi + R * cosphi * dphidtheta;
+    double dXds   = dRds   * cosphi - R * sinphi * dphids;
+    double dYds   = dRds   * sinphi + R * cosphi * dphids;
+    double dXdzeta  = dRdzeta  * cosphi - R * sinphi * dphidzeta;
+    double dYdzeta  = dRdzeta  * sinphi + R * cosphi * dphidzeta;
+    double gstheta = dXdtheta * dXds + dYdtheta * dYds + dZdtheta * dZds;
+    double gszeta  = dXdzeta  * dXds + dYdzeta  * dYds + dZdzeta  * dZds;
+    double sqrtg = (G + iota*I)/(B*B);
+    return (gszeta + iota*gstheta)/sqrtg;
+}
+
+// Evaluates K on all points of each surface and projects it onto cos and sin
+// of the modes, i.e. kmnc_kmns(0, im, isurf) = sum_ip K*cos(angle)*w_im and
+// kmnc_kmns(1, im, isurf) = sum_ip K*sin(angle)*w_im with w_0 = 1/(4 pi^2) for
+// the cos part (the sin part of mode 0 is not computed) and w_im = 1/(2 pi^2)
+// otherwise.
+//
+// On tensor product grids, both the evaluation and the projection are split
+// into a sum over zeta and a sum over theta, which reduces the cost from
+// O(ntheta*nzeta*num_modes) to O(ntheta*nzeta*num_m + nzeta*num_modes), where
+// num_m is the number of distinct xm. On other grids, the surfaces are
+// processed point by point with the angles obtained by recurrence.
+static void compute_kmnc_kmns_impl(Array& rmnc, Array& drmncds, Array& zmns, Array& dzmnsds,
+    Array& numns, Array& dnumnsds, Array& bmnc,
+    Array* rmns, Array* drmnsds, Array* zmnc, Array* dzmncds,
+    Array* numnc, Array* dnumncds, Array* bmns,
+    Array& iota, Array& G, Array& I, Array& xm, Array& xn, Array& thetas, Array& zetas, Array& kmnc_kmns) {
+
+    const int Q = NUM_K_QUANTITIES;
+    FourierModes modes(to_vector(xm), to_vector(xn));
+    int num_modes = modes.num_modes;
+    int num_surf = rmnc.shape(1);
+    int num_points = thetas.shape(0);
+    vector<double> weight(num_modes, 1./(2.*M_PI*M_PI));
+    if(num_modes > 0)
+        weight[0] = 1./(4.*M_PI*M_PI);
+
+    vector<double> theta_grid, zeta_grid;
+    if(tensor_grid(thetas, zetas, theta_grid, zeta_grid)) {
+        int ntheta = theta_grid.size();
+        int nzeta = zeta_grid.size();
+        int num_m = modes.m_unique.size();
+        int num_n = modes.n_unique.size();
+        // cos/sin(m*theta) and cos/sin(n*zeta) for the distinct m and n
+        vector<double> cm(num_m*ntheta), sm(num_m*ntheta), cn(num_n*nzeta), sn(num_n*nzeta);
+        for (int mi = 0; mi < num_m; ++mi) {
+            for (int it = 0; it < ntheta; ++it) {
+                cm[mi*ntheta + it] = cos(modes.m_unique[mi]*theta_grid[it]);
+                sm[mi*ntheta + it] = sin(modes.m_unique[mi]*theta_grid[it]);
+            }
+        }
+        for (int ni = 0; ni < num_n; ++ni) {
+            for (int iz = 0; iz < nzeta; ++iz) {
+                cn[ni*nzeta + iz] = cos(modes.n_unique[ni]*zeta_grid[iz]);
+                sn[ni*nzeta + iz] = sin(modes.n_unique[ni]*zeta_grid[iz]);
+            }
+        }
+#pragma omp parallel
+        {
+            vector<double> a(Q*num_modes), b(Q*num_modes);
+            vector<double> P(Q*num_m), Pt(Q*num_m), vals(Q*ntheta), K(ntheta), KC(num_m), KS(num_m);
+            vector<double> kmnc(num_modes), kmns(num_modes);
+#pragma omp for
+            for (int isurf = 0; isurf < num_surf; ++isurf) {
+                K_coefficients(modes, isurf, rmnc, drmncds, zmns, dzmnsds, numns, dnumnsds, bmnc,
+                        rmns, drmnsds, zmnc, dzmncds, numnc, dnumncds, bmns, a.data(), b.data());
+                std::fill(kmnc.begin(), kmnc.end(), 0.);
+                std::fill(kmns.begin(), kmns.end(), 0.);
+                for (int iz = 0; iz < nzeta; ++iz) {
+                    // a*cos(m theta - n zeta) + b*sin(m theta - n zeta)
+                    //   = cos(m theta)*(a*cos(n zeta) - b*sin(n zeta)) + sin(m theta)*(a*sin(n zeta) + b*cos(n zeta))
+                    std::fill(P.begin(), P.end(), 0.);
+                    std::fill(Pt.begin(), Pt.end(), 0.);
+                    for (int im = 0; im < num_modes; ++im) {
+                        int mi = modes.m_index[im];
+                        double c = cn[modes.n_index[im]*nzeta + iz];
+                        double s = sn[modes.n_index[im]*nzeta + iz];
+                        for (int q = 0; q < Q; ++q) {
+                            P[q*num_m + mi] += a[q*num_modes + im]*c - b[q*num_modes + im]*s;
+                            Pt[q*num_m + mi] += a[q*num_modes + im]*s + b[q*num_modes + im]*c;
+                        }
+                    }
+                    std::fill(vals.begin(), vals.end(), 0.);
+                    for (int q = 0; q < Q; ++q) {
+                        double* v = &vals[q*ntheta];
+                        for (int mi = 0; mi < num_m; ++mi) {
+                            double p = P[q*num_m + mi];
+                            double pt = Pt[q*num_m + mi];
+                            const double* c = &cm[mi*ntheta];
+                            const double* s = &sm[mi*ntheta];
+                            for (int it = 0; it < ntheta; ++it)
+                                v[it] += p*c[it] + pt*s[it];
+                        }
+                    }
+                    double qp[Q];
+                    for (int it = 0; it < ntheta; ++it) {
+                        for (int q = 0; q < Q; ++q)
+                            qp[q] = vals[q*ntheta + it];
+                        K[it] = K_from_quantities(qp, zeta_grid[iz], G(isurf), iota(isurf), I(isurf));
+                    }
+                    // sum over theta first, then combine with cos/sin(n zeta)
+                    for (int mi = 0; mi < num_m; ++mi) {
+                        const double* c = &cm[mi*ntheta];
+                        const double* s = &sm[mi*ntheta];
+                        double kc = 0., ks = 0.;
+                        for (int it = 0; it < ntheta; ++it) {
+                            kc += K[it]*c[it];
+                            ks += K[it]*s[it];
+                        }
+                        KC[mi] = kc;
+                        KS[mi] = ks;
+                    }
+                    for (int im = 0; im < num_modes; ++im) {
+                        int mi = modes.m_index[im];
+                        double c = cn[modes.n_index[im]*nzeta + iz];
+                        double s = sn[modes.n_index[im]*nzeta + iz];
+                        kmnc[im] += c*KC[mi] + s*KS[mi];
+                        kmns[im] += c*KS[mi] - s*KC[mi];
+                    }
+                }
+                for (int im = 0; im < num_modes; ++im) {
+                    kmnc_kmns(0,im,isurf) = weight[im]*kmnc[im];
+                    kmnc_kmns(1,im,isurf) = im > 0 ? weight[im]*kmns[im] : 0.;
+                }
+            }
+        }
+    } else {
+#pragma omp parallel
+        {
+            vector<double> a(Q*num_modes), b(Q*num_modes);
+            vector<double> work(modes.worksize()), c(num_modes), s(num_modes);
+            vector<double> kmnc(num_modes), kmns(num_modes);
+#pragma omp for
+            for (int isurf = 0; isurf < num_surf; ++isurf) {
+                K_coefficients(modes, isurf, rmnc, drmncds, zmns, dzmnsds, numns, dnumnsds, bmnc,
+                        rmns, drmnsds, zmnc, dzmncds, numnc, dnumncds, bmns, a.data(), b.data());
+                std::fill(kmnc.begin(), kmnc.end(), 0.);
+                std::fill(kmns.begin(), kmns.end(), 0.);
+                for (int ip = 0; ip < num_points; ++ip) {
+                    modes.angles(thetas(ip), zetas(ip), work.data(), c.data(), s.data());
+                    double qp[Q];
+                    for (int q = 0; q < Q; ++q) {
+                        double v = 0.;
+                        for (int im = 0; im < num_modes; ++im)
+                            v += a[q*num_modes + im]*c[im] + b[q*num_modes + im]*s[im];
+                        qp[q] = v;
+                    }
+                    double K = K_from_quantities(qp, zetas(ip), G(isurf), iota(isurf), I(isurf));
+                    for (int im = 0; im < num_modes; ++im) {
+                        kmnc[im] += K*c[im];
+                        kmns[im] += K*s[im];
+                    }
+                }
+                for (int im = 0; im < num_modes; ++im) {
+                    kmnc_kmns(0,im,isurf) = weight[im]*kmnc[im];
+                    kmnc_kmns(1,im,isurf) = im > 0 ? weight[im]*kmns[im] : 0.;
+                }
+            }
+        }
+    }
+}
+
 Array compute_kmnc_kmns(Array& rmnc, Array& drmncds, Array& zmns, Array& dzmnsds,
     Array& numns, Array& dnumnsds, Array& bmnc,
     Array& rmns, Array& drmnsds, Array& zmnc, Array& dzmncds,
@@ -12,67 +284,10 @@ Array compute_kmnc_kmns(Array& rmnc, Array& drmncds, Array& zmns, Array& dzmnsds
 
     int num_modes = rmnc.shape(0);
     int num_surf = rmnc.shape(1);
-    int num_points = thetas.shape(0);
-
     Array kmnc_kmns = xt::zeros<double>({2,num_modes,num_surf});
-
-    // Outer iteration over surface
-    #pragma omp parallel for
-    for (int isurf=0; isurf < num_surf; ++isurf) {
-      for (int ip=0; ip < num_points; ++ip) {
-        double B = 0.;
-        double R = 0.;
-        double dRdtheta = 0.;
-        double dRdzeta = 0.;
-        double dRds = 0.;
-        double dZdtheta = 0.;
-        double dZdzeta = 0.;
-        double dZds = 0.;
-        double nu = 0.;
-        double dnuds = 0.;
-        double dnudtheta = 0.;
-        double dnudzeta = 0.;
-        for (int im=0; im < num_modes; ++im) {
-          double angle = xm(im)*thetas(ip)-xn(im)*zetas(ip);
-          B += bmnc(im,isurf)*cos(angle) + bmns(im,isurf)*sin(angle);
-          R += rmnc(im,isurf)*cos(angle) + rmns(im,isurf)*sin(angle);
-          dRdtheta += -rmnc(im,isurf)*xm(im)*sin(angle) + rmns(im,isurf)*xm(im)*cos(angle);
-          dRdzeta  +=  rmnc(im,isurf)*xn(im)*sin(angle) - rmns(im,isurf)*xn(im)*cos(angle);
-          dRds += drmncds(im,isurf)*cos(angle) + drmnsds(im,isurf)*sin(angle);
-          dZdtheta += zmns(im,isurf)*xm(im)*cos(angle) - zmnc(im,isurf)*xm(im)*sin(angle);
-          dZdzeta += -zmns(im,isurf)*xn(im)*cos(angle) + zmnc(im,isurf)*xn(im)*sin(angle);
-          dZds += dzmnsds(im,isurf)*sin(angle) + dzmncds(im,isurf)*cos(angle);
-          nu   += numns(im,isurf)*sin(angle) + numnc(im,isurf)*cos(angle);
-          dnuds += dnumnsds(im,isurf)*sin(angle) + dnumncds(im,isurf)*cos(angle);
-          dnudtheta += numns(im,isurf)*xm(im)*cos(angle) - numnc(im,isurf)*xm(im)*sin(angle);
-          dnudzeta += -numns(im,isurf)*xn(im)*cos(angle) + numnc(im,isurf)*xn(im)*sin(angle);
-        }
-        double phi = zetas(ip) - nu;
-        double dphids = - dnuds;
-        double dphidtheta = - dnudtheta;
-        double dphidzeta = 1 - dnudzeta;
-        double dXdtheta = dRdtheta * cos(phi) - R * sin(phi) * dphidtheta;
-        double dYdtheta = dRdtheta * sin(phi) + R * cos(phi) * dphidtheta;
-        double dXds   = dRds   * cos(phi) - R * sin(phi) * dphids;
-        double dYds   = dRds   * sin(phi) + R * cos(phi) * dphids;
-        double dXdzeta  = dRdzeta  * cos(phi) - R * sin(phi) * dphidzeta;
-        double dYdzeta  = dRdzeta  * sin(phi) + R * cos(phi) * dphidzeta;
-        double gstheta = dXdtheta * dXds + dYdtheta * dYds + dZdtheta * dZds;
-        double gszeta  = dXdzeta  * dXds + dYdzeta  * dYds + dZdzeta  * dZds;
-        double sqrtg = (G(isurf) + iota(isurf)*I(isurf))/(B*B);
-        double K = (gszeta + iota(isurf)*gstheta)/sqrtg;
-
-        for (int im=0; im < num_modes; ++im) {
-          double angle = xm(im)*thetas(ip)-xn(im)*zetas(ip);
-          if (im > 0) {
-            kmnc_kmns(1,im,isurf) = kmnc_kmns(1,im,isurf) + K*sin(angle)/(2.*M_PI*M_PI);
-            kmnc_kmns(0,im,isurf) = kmnc_kmns(0,im,isurf) + K*cos(angle)/(2.*M_PI*M_PI);
-          } else {
-            kmnc_kmns(0,im,isurf) = kmnc_kmns(0,im,isurf) + K*cos(angle)/(4.*M_PI*M_PI);
-          }
-        }
-      }
-    }
+    compute_kmnc_kmns_impl(rmnc, drmncds, zmns, dzmnsds, numns, dnumnsds, bmnc,
+            &rmns, &drmnsds, &zmnc, &dzmncds, &numnc, &dnumncds, &bmns,
+            iota, G, I, xm, xn, thetas, zetas, kmnc_kmns);
     return kmnc_kmns;
 }
 
@@ -80,141 +295,129 @@ Array compute_kmns(Array& rmnc, Array& drmncds, Array& zmns, Array& dzmnsds, Arr
 
     int num_modes = rmnc.shape(0);
     int num_surf = rmnc.shape(1);
-    int num_points = thetas.shape(0);
-
-    Array kmns = xt::zeros<double>({num_modes,num_surf});
-
-    // Outer iteration over surface
-    #pragma omp parallel for
-    for (int isurf=0; isurf < num_surf; ++isurf) {
-      for (int ip=0; ip < num_points; ++ip) {
-        double B = 0.;
-        double R = 0.;
-        double dRdtheta = 0.;
-        double dRdzeta = 0.;
-        double dRds = 0.;
-        double dZdtheta = 0.;
-        double dZdzeta = 0.;
-        double dZds = 0.;
-        double nu = 0.;
-        double dnuds = 0.;
-        double dnudtheta = 0.;
-        double dnudzeta = 0.;
-        for (int im=0; im < num_modes; ++im) {
-          B += bmnc(im,isurf)*cos(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          R += rmnc(im,isurf)*cos(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          dRdtheta += -rmnc(im,isurf)*xm(im)*sin(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          dRdzeta +=   rmnc(im,isurf)*xn(im)*sin(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          dRds += drmncds(im,isurf)*cos(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          dZdtheta += zmns(im,isurf)*xm(im)*cos(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          dZdzeta += -zmns(im,isurf)*xn(im)*cos(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          dZds += dzmnsds(im,isurf)*sin(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          nu += numns(im,isurf)*sin(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          dnuds += dnumnsds(im,isurf)*sin(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          dnudtheta += numns(im,isurf)*xm(im)*cos(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          dnudzeta += -numns(im,isurf)*xn(im)*cos(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-        }
-        double phi = zetas(ip) - nu;
-        double dphids = - dnuds;
-        double dphidtheta = - dnudtheta;
-        double dphidzeta = 1 - dnudzeta;
-        double dXdtheta = dRdtheta * cos(phi) - R * sin(phi) * dphidtheta;
-        double dYdtheta = dRdtheta * sin(phi) + R * cos(phi) * dphidtheta;
-        double dXds   = dRds   * cos(phi) - R * sin(phi) * dphids;
-        double dYds   = dRds   * sin(phi) + R * cos(phi) * dphids;
-        double dXdzeta  = dRdzeta  * cos(phi) - R * sin(phi) * dphidzeta;
-        double dYdzeta  = dRdzeta  * sin(phi) + R * cos(phi) * dphidzeta;
-        double gstheta = dXdtheta * dXds + dYdtheta * dYds + dZdtheta * dZds;
-        double gszeta  = dXdzeta  * dXds + dYdzeta  * dYds + dZdzeta  * dZds;
-        double sqrtg = (G(isurf) + iota(isurf)*I(isurf))/(B*B);
-        double K = (gszeta + iota(isurf)*gstheta)/sqrtg;
-
-        for (int im=1; im < num_modes; ++im) {
-          kmns(im,isurf) = kmns(im,isurf) + K*sin(xm(im)*thetas(ip)-xn(im)*zetas(ip))/(2.*M_PI*M_PI);
-        }
-      }
-    }
+    Array kmnc_kmns = xt::zeros<double>({2,num_modes,num_surf});
+    compute_kmnc_kmns_impl(rmnc, drmncds, zmns, dzmnsds, numns, dnumnsds, bmnc,
+            nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+            iota, G, I, xm, xn, thetas, zetas, kmnc_kmns);
+    Array kmns = xt::view(kmnc_kmns, 1, xt::all(), xt::all());
     return kmns;
 }
 
-Array fourier_transform_odd(Array& K, Array& xm, Array& xn, Array& thetas, Array& zetas) {
+// Computes sum_ip K(ip)*f(angle_im(ip)) / sum_ip f(angle_im(ip))^2 for all modes,
+// with f = sin if odd and f = cos otherwise. The odd transform skips mode 0.
+static Array fourier_transform(Array& K, Array& xm, Array& xn, Array& thetas, Array& zetas, bool odd) {
 
-    int num_modes = xm.shape(0);
+    FourierModes modes(to_vector(xm), to_vector(xn));
+    int num_modes = modes.num_modes;
     int num_points = thetas.shape(0);
     Array kmns = xt::zeros<double>({num_modes});
-
-    double norm;
-    for (int im=1; im < num_modes; ++im) {
-      norm = 0.;
-      #pragma omp parallel for
-      for (int ip=0; ip < num_points; ++ip) {
-        kmns(im) += K(ip)*sin(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-        norm += pow(sin(xm(im)*thetas(ip)-xn(im)*zetas(ip)),2.);
-      }
-      kmns(im) = kmns(im)/norm;
+    // The points are split into chunks whose partial sums are added up in
+    // the order of the chunks, so that the result doesn't depend on the
+    // scheduling of the threads. There is one chunk per thread, or chunks of
+    // `deterministic_block_size` points in the deterministic mode so that
+    // the result doesn't depend on the number of threads either.
+    int chunk_size = threads::get_deterministic() ? threads::deterministic_block_size
+        : (num_points + threads::get_num_threads() - 1) / threads::get_num_threads();
+    chunk_size = std::max(chunk_size, 1);
+    int num_chunks = (num_points + chunk_size - 1) / chunk_size;
+    vector<double> partial(2*num_modes*num_chunks, 0.);
+#pragma omp parallel
+    {
+        vector<double> work(modes.worksize()), c(num_modes), s(num_modes);
+        double* f = odd ? s.data() : c.data();
+#pragma omp for schedule(static)
+        for (int ic = 0; ic < num_chunks; ++ic) {
+            double* num_chunk = partial.data() + 2*num_modes*ic;
+            double* norm_chunk = num_chunk + num_modes;
+            int last = std::min(num_points, (ic + 1)*chunk_size);
+            for (int ip = ic*chunk_size; ip < last; ++ip) {
+                modes.angles(thetas(ip), zetas(ip), work.data(), c.data(), s.data());
+                for (int im = 0; im < num_modes; ++im) {
+                    num_chunk[im] += K(ip)*f[im];
+                    norm_chunk[im] += f[im]*f[im];
+                }
+            }
+        }
     }
+    vector<double> num(num_modes, 0.), norm(num_modes, 0.);
+    for (int ic = 0; ic < num_chunks; ++ic) {
+        for (int im = 0; im < num_modes; ++im) {
+            num[im] += partial[2*num_modes*ic + im];
+            norm[im] += partial[2*num_modes*ic + num_modes + im];
+        }
+    }
+    for (int im = odd ? 1 : 0; im < num_modes; ++im)
+        kmns(im) = num[im]/norm[im];
     return kmns;
 }
 
-Array fourier_transform_even(Array& K, Array& xm, Array& xn, Array& thetas, Array& zetas) {
-
-    int num_modes = xm.shape(0);
-    int num_points = thetas.shape(0);
-    Array kmns = xt::zeros<double>({num_modes});
+Array fourier_transform_odd(Array& K, Array& xm, Array& xn, Array& thetas, Array& zetas) {
+    return fourier_transform(K, xm, xn, thetas, zetas, true);
+}
 
-    double norm;
-    for (int im=0; im < num_modes; ++im) {
-      norm = 0.;
-      #pragma omp parallel for
-      for (int ip=0; ip < num_points; ++ip) {
-        kmns(im) += K(ip)*cos(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-        norm += pow(cos(xm(im)*thetas(ip)-xn(im)*zetas(ip)),2.);
-      }
-      kmns(im) = kmns(im)/norm;
-    }
-    return kmns;
+Array fourier_transform_even(Array& K, Array& xm, Array& xn, Array& thetas, Array& zetas) {
+    return fourier_transform(K, xm, xn, thetas, zetas, false);
 }
 
-void inverse_fourier_transform_odd(Array& K, Array& kmns, Array& xm, Array& xn, Array& thetas, Array& zetas) {
+// K(ip) += sum_im kmns(im[, ip])*f(angle_im(ip)) with f = sin if odd and
+// f = cos otherwise. The odd transform skips mode 0.
+static void inverse_fourier_transform(Array& K, Array& kmns, Array& xm, Array& xn, Array& thetas, Array& zetas, bool odd) {
 
-    int num_modes = xm.shape(0);
+    FourierModes modes(to_vector(xm), to_vector(xn));
+    int num_modes = modes.num_modes;
     int num_points = thetas.shape(0);
-    int dim = kmns.dimension();
-    if (dim==2) {
-      for (int im=1; im < num_modes; ++im) {
-        #pragma omp parallel for
-        for (int ip=0; ip < num_points; ++ip) {
-          K(ip) += kmns(im,ip)*sin(xm(im)*thetas(ip)-xn(im)*zetas(ip));
+    bool pointwise = kmns.dimension() == 2;
+#pragma omp parallel
+    {
+        vector<double> work(modes.worksize()), c(num_modes), s(num_modes);
+        double* f = odd ? s.data() : c.data();
+#pragma omp for
+        for (int ip = 0; ip < num_points; ++ip) {
+            modes.angles(thetas(ip), zetas(ip), work.data(), c.data(), s.data());
+            double res = 0.;
+            for (int im = odd ? 1 : 0; im < num_modes; ++im)
+                res += (pointwise ? kmns(im,ip) : kmns(im))*f[im];
+            K(ip) += res;
         }
-      }
-    } else {
-      for (int im=1; im < num_modes; ++im) {
-        #pragma omp parallel for
-        for (int ip=0; ip < num_points; ++ip) {
-          K(ip) += kmns(im)*sin(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-        }
-      }
     }
 }
 
+void inverse_fourier_transform_odd(Array& K, Array& kmns, Array& xm, Array& xn, Array& thetas, Array& zetas) {
+    inverse_fourier_transform(K, kmns, xm, xn, thetas, zetas, true);
+}
+
 void inverse_fourier_transform_even(Array& K, Array& kmns, Array& xm, Array& xn, Array& thetas, Array& zetas) {
+    inverse_fourier_transform(K, kmns, xm, xn, thetas, zetas, false);
+}
 
-    int num_modes = xm.shape(0);
+void inverse_fourier_transform_many(Array& out, Array& cos_coeffs, Array& sin_coeffs, Array& xm, Array& xn, Array& thetas, Array& zetas) {
+    FourierModes modes(to_vector(xm), to_vector(xn));
+    int num_modes = modes.num_modes;
     int num_points = thetas.shape(0);
-    int dim = kmns.dimension();
-    if (dim==2) {
-      for (int im=0; im < num_modes; ++im) {
-        #pragma omp parallel for
-        for (int ip=0; ip < num_points; ++ip) {
-          K(ip) += kmns(im,ip)*cos(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-        }
-      }
-    } else {
-      for (int im=0; im < num_modes; ++im) {
-        #pragma omp parallel for
-        for (int ip=0; ip < num_points; ++ip) {
-          K(ip) += kmns(im)*cos(xm(im)*thetas(ip)-xn(im)*zetas(ip));
+    int num_quantities = out.shape(0);
+    for (Array* coeffs : {&cos_coeffs, &sin_coeffs}) {
+        if(coeffs->dimension() != 3 || (int)coeffs->shape(0) != num_quantities || (int)coeffs->shape(1) != num_modes || (int)coeffs->shape(2) != num_points)
+            throw std::runtime_error("The coefficients need to have shape (len(out), len(xm), len(thetas)).");
+    }
+    if(out.dimension() != 2 || (int)out.shape(1) != num_points)
+        throw std::runtime_error("out needs to have shape (num_quantities, len(thetas)).");
+    double* out_ptr = out.data();
+    double* cos_ptr = cos_coeffs.data();
+    double* sin_ptr = sin_coeffs.data();
+#pragma omp parallel
+    {
+        vector<double> work(modes.worksize()), c(num_modes), s(num_modes);
+#pragma omp for
+        for (int ip = 0; ip < num_points; ++ip) {
+            modes.angles(thetas(ip), zetas(ip), work.data(), c.data(), s.data());
+            for (int iq = 0; iq < num_quantities; ++iq) {
+                double* cq = cos_ptr + iq*num_modes*num_points + ip;
+                double* sq = sin_ptr + iq*num_modes*num_points + ip;
+                double res = 0.;
+                for (int im = 0; im < num_modes; ++im)
+                    res += cq[im*num_points]*c[im] + sq[im*num_points]*s[im];
+                out_ptr[iq*num_points + ip] += res;
+            }
         }
-      }
     }
 }
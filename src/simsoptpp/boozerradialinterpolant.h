@@ -1,10 +1,88 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
 #include "xtensor-python/pyarray.hpp"
 typedef xt::pyarray<double> Array;
+using std::vector;
+
+// The modes (xm, xn) of a Fourier series in m*theta - n*zeta.
+//
+// If all xm are nonnegative integers and all xn are integer multiples of some
+// nfp, cos and sin of m*theta - n*zeta are obtained for all modes from
+// cos/sin(theta) and cos/sin(nfp*zeta) by recurrence, i.e. with two calls to
+// sincos per point instead of one per mode. Otherwise they are evaluated
+// directly.
+//
+// For tensor product grids, the distinct values of xm and xn are stored, so
+// that sums over the modes can be split into a sum over theta and a sum over
+// zeta.
+struct FourierModes {
+    int num_modes;
+    vector<double> xm, xn;
+    bool recurrence = true;
+    int nfp = 0;
+    int mmax = 0;
+    int kmax = 0;
+    vector<int> k;
+    vector<double> m_unique, n_unique;
+    vector<int> m_index, n_index;
+
+    FourierModes(const vector<double>& xm, const vector<double>& xn);
+
+    int worksize() const {
+        return 2*(mmax+1) + 2*(kmax+1);
+    }
+
+    // Writes c[im] = cos(xm[im]*theta - xn[im]*zeta) and s[im] = sin(...).
+    void angles(double theta, double zeta, double* work, double* c, double* s) const {
+        if(!recurrence) {
+            for (int im = 0; im < num_modes; ++im) {
+                double angle = xm[im]*theta - xn[im]*zeta;
+                c[im] = std::cos(angle);
+                s[im] = std::sin(angle);
+            }
+            return;
+        }
+        double* cm = work;
+        double* sm = cm + mmax + 1;
+        double* ck = sm + mmax + 1;
+        double* sk = ck + kmax + 1;
+        fill_multiples(theta, mmax, cm, sm);
+        fill_multiples(nfp*zeta, kmax, ck, sk);
+        for (int im = 0; im < num_modes; ++im) {
+            int m = int(xm[im]);
+            int kk = std::abs(k[im]);
+            double cn = ck[kk];
+            double sn = k[im] < 0 ? -sk[kk] : sk[kk];
+            c[im] = cm[m]*cn + sm[m]*sn;
+            s[im] = sm[m]*cn - cm[m]*sn;
+        }
+    }
+
+    // cos(j*x) and sin(j*x) for j = 0, ..., jmax.
+    static void fill_multiples(double x, int jmax, double* c, double* s) {
+        c[0] = 1.;
+        s[0] = 0.;
+        if(jmax == 0)
+            return;
+        c[1] = std::cos(x);
+        s[1] = std::sin(x);
+        for (int j = 2; j <= jmax; ++j) {
+            c[j] = c[j-1]*c[1] - s[j-1]*s[1];
+            s[j] = s[j-1]*c[1] + c[j-1]*s[1];
+        }
+    }
+};
+
 
 Array fourier_transform_odd(Array& K, Array& xm, Array& xn, Array& thetas, Array& zetas);
 Array fourier_transform_even(Array& K, Array& xm, Array& xn, Array& thetas, Array& zetas);
 void inverse_fourier_transform_odd(Array& K, Array& kmns, Array& xm, Array& xn, Array& thetas, Array& zetas);
 void inverse_fourier_transform_even(Array& K, Array& kmns, Array& xm, Array& xn, Array& thetas, Array& zetas);
+// out(q, ip) += sum_im cos_coeffs(q, im, ip)*cos(angle_im(ip)) + sin_coeffs(q, im, ip)*sin(angle_im(ip))
+// for several quantities q at once, sharing cos and sin of the angles.
+void inverse_fourier_transform_many(Array& out, Array& cos_coeffs, Array& sin_coeffs, Array& xm, Array& xn, Array& thetas, Array& zetas);
 Array compute_kmns(Array& rmnc, Array& drmncds, Array& zmns, Array& dzmnsds, Array& numns, Array& dnumnsds, Array& bmnc, Array& iota, Array& G, Array& I, Array& xm, Array& xn, Array& thetas, Array& zetas);
 Array compute_kmnc_kmns(Array& rmnc, Array& drmncds, Array& zmns, Array& dzmnsds,
     Array& numns, Array& dnumnsds, Array& bmnc,
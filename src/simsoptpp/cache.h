@@ -7,6 +7,7 @@
 //#include <fmt/format.h>
 //#include <fmt/ranges.h>
 #include "cachedarray.h"
+#include "perf.h"
 
 
 using std::string;
@@ -17,7 +18,7 @@ class Cache {
     private:
         std::map<string, CachedArray<Array>> cache;
     public:
-        bool get_status(string key) const {
+        bool get_status(const string& key) const {
             auto loc = cache.find(key);
             if(loc == cache.end()){ // Key not found
                 return false;
@@ -27,7 +28,7 @@ class Cache {
             }
             return true;
         }
-        Array& get_or_create(string key, vector<int> dims){
+        Array& get_or_create(const string& key, const vector<int>& dims){
             auto loc = cache.find(key);
             if(loc == cache.end()){ // Key not found --> allocate array
                 loc = cache.insert(std::make_pair(key, CachedArray<Array>(xt::zeros<double>(dims)))).first; 
@@ -42,6 +43,20 @@ class Cache {
             return loc->second.data;
         }
 
+        // Like get_or_create, but a new array is not initialized. The caller has
+        // to initialize it, preferably from the OpenMP thread that later works
+        // on it, so that its memory is placed on the NUMA node of that thread.
+        Array& get_or_allocate(const string& key, const vector<int>& dims){
+            auto loc = cache.find(key);
+            if(loc == cache.end()){ // Key not found --> allocate array
+                loc = cache.insert(std::make_pair(key, CachedArray<Array>(Array::from_shape(dims)))).first;
+            } else if(loc->second.data.shape(0) != dims[0]) { // key found but not the right number of points
+                loc->second = CachedArray<Array>(Array::from_shape(dims));
+            }
+            loc->second.status = true;
+            return loc->second.data;
+        }
+
         Array& get_or_create_and_fill(string key, vector<int> dims, std::function<void(Array&)> impl) {
             auto loc = cache.find(key);
             if(loc == cache.end()){ // Key not found --> allocate array
@@ -53,8 +68,11 @@ class Cache {
             }
             if(!(loc->second.status)){ // needs recomputing
                 //fmt::print("Fill array for key {} of size [{}] at {}\n", key, fmt::join(dims, ", "), fmt::ptr(loc->second.data.data()));
+                SIMSOPT_PERF_COUNT("cache_misses", 1);
                 impl(loc->second.data);
                 loc->second.status = true;
+            } else {
+                SIMSOPT_PERF_COUNT("cache_hits", 1);
             }
             return loc->second.data;
         }
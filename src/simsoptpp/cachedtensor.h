@@ -3,6 +3,7 @@
 #include <vector>
 #include "xtensor/xarray.hpp"
 #include "xtensor/xlayout.hpp"
+#include "perf.h"
 
 using std::vector;
 using std::array;
@@ -41,8 +42,11 @@ class CachedTensor {
         }
 
         inline T& get_or_create_and_fill(const Shape& new_dims, const std::function<void(T&)>& impl){
-            if(status)
+            if(status) {
+                SIMSOPT_PERF_COUNT("field_cache_hits", 1);
                 return data;
+            }
+            SIMSOPT_PERF_COUNT("field_cache_misses", 1);
             if(dims != new_dims){
                 data = xt::zeros<double>(new_dims);
                 //fmt::print("Dims ({} != {}) don't match, create a new Tensor.\n", dims, new_dims);
@@ -0,0 +1,278 @@
+#include "coil_forces.h"
+#include "perf.h"
+#include <cmath>
+#include <stdexcept>
+
+static const double mu0_over_4pi = 1e-7;
+
+// All quadrature points of all coils in one contiguous block.
+struct CoilSet {
+    int ncoils, npoints;
+    vector<int> offset, coil;
+    vector<double> x, xd, xdd;
+    vector<double> I, delta;
+    // (2 - 2 cos(2 pi k/n))/2, k = 0, ..., n-1, for each coil
+    vector<vector<double>> cosfac;
+
+    CoilSet(vector<Array>& gammas, vector<Array>& gammadashs, vector<Array>& gammadashdashs,
+            vector<double>& currents, vector<double>& regularizations) {
+        ncoils = gammas.size();
+        if(gammadashs.size() != ncoils || gammadashdashs.size() != ncoils || currents.size() != ncoils || regularizations.size() != ncoils)
+            throw std::runtime_error("gammas, gammadashs, gammadashdashs, currents and regularizations need to have the same length.");
+        offset.push_back(0);
+        for (int a = 0; a < ncoils; ++a) {
+            int n = gammas[a].shape(0);
+            if(gammas[a].dimension() != 2 || gammas[a].shape(1) != 3)
+                throw std::runtime_error("gamma has wrong shape.");
+            if(gammadashs[a].shape(0) != n || gammadashdashs[a].shape(0) != n)
+                throw std::runtime_error("gamma, gammadash and gammadashdash need to have the same shape.");
+            if(regularizations[a] <= 0)
+                throw std::runtime_error("The regularization needs to be positive.");
+            offset.push_back(offset.back() + n);
+            for (int i = 0; i < n; ++i) {
+                coil.push_back(a);
+                for (int l = 0; l < 3; ++l) {
+                    x.push_back(gammas[a](i, l));
+                    xd.push_back(gammadashs[a](i, l));
+                    xdd.push_back(gammadashdashs[a](i, l));
+                }
+            }
+            vector<double> c(n);
+            for (int k = 0; k < n; ++k)
+                c[k] = 1 - std::cos(2*M_PI*k/n);
+            cosfac.push_back(c);
+        }
+        npoints = offset.back();
+        I = currents;
+        delta = regularizations;
+    }
+
+    int size(int a) const { return offset[a+1] - offset[a]; }
+};
+
+static inline void cross(const double* a, const double* b, double* c) {
+    c[0] = a[1]*b[2] - a[2]*b[1];
+    c[1] = a[2]*b[0] - a[0]*b[2];
+    c[2] = a[0]*b[1] - a[1]*b[0];
+}
+
+static inline double dot(const double* a, const double* b) {
+    return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+// The local part of the self field is mu0/(4 pi) I (r' x r'') Q(|r'|^2). It is
+// the analytic integral of the local expansion of the regularized integrand,
+// minus its quadrature. Returns Q and dQ/dq with q = |r'|^2.
+static void self_term(const CoilSet& coils, int a, double q, double& Q, double& dQ) {
+    const vector<double>& c = coils.cosfac[a];
+    int n = c.size();
+    double delta = coils.delta[a];
+    double P = 0., dP = 0.;
+    for (int k = 0; k < n; ++k) {
+        double den = 2*c[k]*q/(4*M_PI*M_PI) + delta;
+        double inv = 1./(den*std::sqrt(den));
+        P += c[k]*inv;
+        dP -= 3*c[k]*c[k]/(4*M_PI*M_PI)*inv/den;
+    }
+    double L = -2 + std::log(16*q/(M_PI*M_PI*delta));
+    double q32 = q*std::sqrt(q);
+    Q = L/(2*q32) - P/(4*M_PI*M_PI*n);
+    dQ = (1 - 1.5*L)/(2*q32*q) - dP/(4*M_PI*M_PI*n);
+}
+
+// Field of all coils at quadrature point i.
+static void field(const CoilSet& coils, int i, double* B) {
+    int a = coils.coil[i];
+    const double* xi = &coils.x[3*i];
+    B[0] = B[1] = B[2] = 0.;
+    for (int b = 0; b < coils.ncoils; ++b) {
+        double pre = coils.I[b]/coils.size(b);
+        double delta = b == a ? coils.delta[a] : 0.;
+        double Bb[3] = {0., 0., 0.};
+        for (int j = coils.offset[b]; j < coils.offset[b+1]; ++j) {
+            const double* xj = &coils.x[3*j];
+            const double* xdj = &coils.xd[3*j];
+            double d[3] = {xi[0] - xj[0], xi[1] - xj[1], xi[2] - xj[2]};
+            double D = dot(d, d) + delta;
+            double inv = 1./(D*std::sqrt(D));
+            double c[3];
+            cross(xdj, d, c);
+            for (int l = 0; l < 3; ++l)
+                Bb[l] += c[l]*inv;
+        }
+        for (int l = 0; l < 3; ++l)
+            B[l] += pre*Bb[l];
+    }
+    const double* xdi = &coils.xd[3*i];
+    const double* xddi = &coils.xdd[3*i];
+    double Q, dQ;
+    self_term(coils, a, dot(xdi, xdi), Q, dQ);
+    double c[3];
+    cross(xdi, xddi, c);
+    for (int l = 0; l < 3; ++l)
+        B[l] = mu0_over_4pi*(B[l] + coils.I[a]*Q*c[l]);
+}
+
+vector<Array> coil_forces(vector<Array>& gammas, vector<Array>& gammadashs, vector<Array>& gammadashdashs,
+        vector<double>& currents, vector<double>& regularizations) {
+    SIMSOPT_PERF_SCOPE(timer, "coil_forces");
+    CoilSet coils(gammas, gammadashs, gammadashdashs, currents, regularizations);
+    SIMSOPT_PERF_ADD(timer, points, coils.npoints);
+    SIMSOPT_PERF_ADD(timer, pairs, uint64_t(coils.npoints)*coils.npoints);
+    vector<Array> res;
+    for (int a = 0; a < coils.ncoils; ++a)
+        res.push_back(xt::zeros<double>({coils.size(a), 3}));
+    vector<double*> res_ptr;
+    for (int a = 0; a < coils.ncoils; ++a)
+        res_ptr.push_back(res[a].data());
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int i = 0; i < coils.npoints; ++i) {
+        int a = coils.coil[i];
+        double B[3];
+        field(coils, i, B);
+        const double* xdi = &coils.xd[3*i];
+        double f[3];
+        cross(xdi, B, f);
+        double scale = coils.I[a]/std::sqrt(dot(xdi, xdi));
+        double* out = res_ptr[a] + 3*(i - coils.offset[a]);
+        for (int l = 0; l < 3; ++l)
+            out[l] = scale*f[l];
+    }
+    return res;
+}
+
+std::tuple<vector<Array>, vector<Array>, vector<Array>, vector<double>> coil_forces_vjp(
+        vector<Array>& gammas, vector<Array>& gammadashs, vector<Array>& gammadashdashs,
+        vector<double>& currents, vector<double>& regularizations, vector<Array>& v) {
+    SIMSOPT_PERF_SCOPE(timer, "coil_forces_vjp");
+    CoilSet coils(gammas, gammadashs, gammadashdashs, currents, regularizations);
+    SIMSOPT_PERF_ADD(timer, points, coils.npoints);
+    SIMSOPT_PERF_ADD(timer, pairs, uint64_t(coils.npoints)*coils.npoints);
+    if(v.size() != coils.ncoils)
+        throw std::runtime_error("v needs to have one entry per coil.");
+    vector<double> vs;
+    for (int a = 0; a < coils.ncoils; ++a) {
+        if(v[a].size() != 3*coils.size(a))
+            throw std::runtime_error("v has wrong shape.");
+        vs.insert(vs.end(), v[a].data(), v[a].data() + 3*coils.size(a));
+    }
+    int npoints = coils.npoints;
+    // w = dJ/dB at each point, and the derivatives of J wrt the current
+    // collected per point
+    vector<double> w(3*npoints), gx(3*npoints, 0.), gxd(3*npoints, 0.), gxdd(3*npoints, 0.);
+    vector<double> gI(npoints, 0.);
+
+    // dF/dl = I u x B with u = r'/|r'|, and the local part of the self field
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int i = 0; i < npoints; ++i) {
+        int a = coils.coil[i];
+        double Ia = coils.I[a];
+        const double* vi = &vs[3*i];
+        const double* xdi = &coils.xd[3*i];
+        const double* xddi = &coils.xdd[3*i];
+        double B[3];
+        field(coils, i, B);
+        double norm = std::sqrt(dot(xdi, xdi));
+        double u[3] = {xdi[0]/norm, xdi[1]/norm, xdi[2]/norm};
+        double* wi = &w[3*i];
+        cross(vi, u, wi);
+        for (int l = 0; l < 3; ++l)
+            wi[l] *= Ia;
+        double uxB[3], Bxv[3];
+        cross(u, B, uxB);
+        cross(B, vi, Bxv);
+        gI[i] += dot(vi, uxB);
+        double gu = Ia*dot(Bxv, u);
+        for (int l = 0; l < 3; ++l)
+            gxd[3*i + l] += (Ia*Bxv[l] - gu*u[l])/norm;
+
+        double Q, dQ;
+        self_term(coils, a, norm*norm, Q, dQ);
+        double c[3], xddxw[3], wxxd[3];
+        cross(xdi, xddi, c);
+        cross(xddi, wi, xddxw);
+        cross(wi, xdi, wxxd);
+        double s = dot(wi, c);
+        gI[i] += mu0_over_4pi*s*Q;
+        for (int l = 0; l < 3; ++l) {
+            gxd[3*i + l] += mu0_over_4pi*Ia*(Q*xddxw[l] + 2*s*dQ*xdi[l]);
+            gxdd[3*i + l] += mu0_over_4pi*Ia*Q*wxxd[l];
+        }
+    }
+
+    // Biot-Savart sums, once with the target and once with the source as the
+    // outer loop, so that no two threads write to the same point
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int k = 0; k < npoints; ++k) {
+        int ak = coils.coil[k];
+        const double* xk = &coils.x[3*k];
+        const double* xdk = &coils.xd[3*k];
+        const double* wk = &w[3*k];
+        double gx_target[3] = {0., 0., 0.};
+        double gx_source[3] = {0., 0., 0.};
+        double gxd_source[3] = {0., 0., 0.};
+        double gI_source = 0.;
+        for (int b = 0; b < coils.ncoils; ++b) {
+            // k as a target of the points of coil b
+            double pre = mu0_over_4pi*coils.I[b]/coils.size(b);
+            double delta = b == ak ? coils.delta[ak] : 0.;
+            for (int j = coils.offset[b]; j < coils.offset[b+1]; ++j) {
+                const double* xj = &coils.x[3*j];
+                const double* xdj = &coils.xd[3*j];
+                double d[3] = {xk[0] - xj[0], xk[1] - xj[1], xk[2] - xj[2]};
+                double D = dot(d, d) + delta;
+                double inv = 1./(D*std::sqrt(D));
+                double c[3], wxxd[3];
+                cross(xdj, d, c);
+                cross(wk, xdj, wxxd);
+                double s = dot(wk, c);
+                for (int l = 0; l < 3; ++l)
+                    gx_target[l] += pre*(wxxd[l] - 3*s*d[l]/D)*inv;
+            }
+            // k as a source for the points of coil b
+            double pre_k = mu0_over_4pi/coils.size(ak);
+            for (int i = coils.offset[b]; i < coils.offset[b+1]; ++i) {
+                const double* xi = &coils.x[3*i];
+                const double* wi = &w[3*i];
+                double d[3] = {xi[0] - xk[0], xi[1] - xk[1], xi[2] - xk[2]};
+                double D = dot(d, d) + delta;
+                double inv = 1./(D*std::sqrt(D));
+                double c[3], wxxd[3], dxw[3];
+                cross(xdk, d, c);
+                cross(wi, xdk, wxxd);
+                cross(d, wi, dxw);
+                double s = dot(wi, c);
+                gI_source += pre_k*s*inv;
+                for (int l = 0; l < 3; ++l) {
+                    gxd_source[l] += pre_k*dxw[l]*inv;
+                    gx_source[l] -= pre_k*(wxxd[l] - 3*s*d[l]/D)*inv;
+                }
+            }
+        }
+        double Ik = coils.I[ak];
+        for (int l = 0; l < 3; ++l) {
+            gx[3*k + l] += gx_target[l] + Ik*gx_source[l];
+            gxd[3*k + l] += Ik*gxd_source[l];
+        }
+        gI[k] += gI_source;
+    }
+
+    vector<Array> res_gamma, res_gammadash, res_gammadashdash;
+    vector<double> res_current(coils.ncoils, 0.);
+    for (int a = 0; a < coils.ncoils; ++a) {
+        int n = coils.size(a);
+        int o = coils.offset[a];
+        res_gamma.push_back(xt::zeros<double>({n, 3}));
+        res_gammadash.push_back(xt::zeros<double>({n, 3}));
+        res_gammadashdash.push_back(xt::zeros<double>({n, 3}));
+        for (int i = 0; i < n; ++i) {
+            for (int l = 0; l < 3; ++l) {
+                res_gamma[a](i, l) = gx[3*(o + i) + l];
+                res_gammadash[a](i, l) = gxd[3*(o + i) + l];
+                res_gammadashdash[a](i, l) = gxdd[3*(o + i) + l];
+            }
+            res_current[a] += gI[o + i];
+        }
+    }
+    return std::make_tuple(res_gamma, res_gammadash, res_gammadashdash, res_current);
+}
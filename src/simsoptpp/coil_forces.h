@@ -0,0 +1,36 @@
+#pragma once
+
+#include <tuple>
+#include <vector>
+#include "xtensor-python/pyarray.hpp"     // Numpy bindings
+typedef xt::pyarray<double> Array;
+using std::vector;
+
+// Lorentz force per unit length dF/dl = I t x B on the quadrature points of a
+// set of coils, where B is the field of all coils. The field of the other
+// coils is computed with the Biot-Savart law on their quadrature points. The
+// field of the coil itself is the regularized self field of a coil with finite
+// cross section, see
+// Landreman, Hurwitz, Antonsen, "Efficient calculation of self magnetic field,
+// self-force, and self-inductance for electromagnetic coils", Nucl. Fusion 63
+// (2023), doi:10.1088/1741-4326/acd8fb,
+//
+//   B_self(s) = mu0 I/(4 pi) [ int r'(s~) x (r(s) - r(s~))/(|r(s) - r(s~)|^2 + delta)^(3/2) ds~
+//                              - int (local expansion of the integrand) ds~
+//                              + analytic integral of the local expansion ],
+//
+// where delta = a^2/sqrt(e) for a circular cross section of radius a. The
+// quadrature points of each coil need to be uniformly spaced on [0, 1).
+//
+// `gammas`, `gammadashs` and `gammadashdashs` contain the positions and their
+// first two derivatives wrt the curve parameter, each of shape (nquadpoints, 3).
+// Returns dF/dl for each coil, of shape (nquadpoints, 3).
+vector<Array> coil_forces(vector<Array>& gammas, vector<Array>& gammadashs, vector<Array>& gammadashdashs,
+        vector<double>& currents, vector<double>& regularizations);
+
+// Vector-Jacobian product of `coil_forces`. Given v of shape (nquadpoints, 3)
+// for each coil, returns the products with respect to gamma, gammadash and
+// gammadashdash of each coil, and with respect to the currents.
+std::tuple<vector<Array>, vector<Array>, vector<Array>, vector<double>> coil_forces_vjp(
+        vector<Array>& gammas, vector<Array>& gammadashs, vector<Array>& gammadashdashs,
+        vector<double>& currents, vector<double>& regularizations, vector<Array>& v);
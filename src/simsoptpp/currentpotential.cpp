@@ -0,0 +1,334 @@
+#include "currentpotential.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+template<class Array>
+CurrentPotentialSolver<Array>::CurrentPotentialSolver(shared_ptr<Surface<Array>> plasma_surface, shared_ptr<Surface<Array>> winding_surface,
+        int mpol, int ntor, int nfp, bool stellsym, double net_poloidal_current, double net_toroidal_current,
+        Array& Bnormal_target) :
+    plasma_surface(plasma_surface), winding_surface(winding_surface), mpol(mpol), ntor(ntor), nfp(nfp),
+    stellsym(stellsym), net_poloidal_current(net_poloidal_current), net_toroidal_current(net_toroidal_current) {
+    if(!plasma_surface || !winding_surface)
+        throw std::runtime_error("CurrentPotentialSolver needs a plasma surface and a winding surface.");
+    if(mpol < 0 || ntor < 0 || mpol + ntor == 0)
+        throw std::runtime_error("CurrentPotentialSolver needs mpol >= 0, ntor >= 0 and at least one mode.");
+    for (int m = 0; m <= mpol; ++m) {
+        for (int n = (m == 0 ? 1 : -ntor); n <= ntor; ++n) {
+            xm.push_back(m);
+            xn.push_back(n);
+        }
+    }
+    num_basis = stellsym ? xm.size() : 2*xm.size();
+    assemble(Bnormal_target);
+}
+
+template<class Array>
+void CurrentPotentialSolver<Array>::basis(double phi, double theta, double* f, double* dfdphi, double* dfdtheta) const {
+    int num_modes = xm.size();
+    for (int k = 0; k < num_modes; ++k) {
+        double angle = 2*M_PI*(xm[k]*theta - nfp*xn[k]*phi);
+        double s = std::sin(angle);
+        double c = std::cos(angle);
+        f[k] = s;
+        dfdphi[k] = -2*M_PI*nfp*xn[k]*c;
+        dfdtheta[k] = 2*M_PI*xm[k]*c;
+        if(!stellsym) {
+            f[num_modes + k] = c;
+            dfdphi[num_modes + k] = 2*M_PI*nfp*xn[k]*s;
+            dfdtheta[num_modes + k] = -2*M_PI*xm[k]*s;
+        }
+    }
+}
+
+template<class Array>
+void CurrentPotentialSolver<Array>::current_times_area(int i, int j, double* Kj, double* Ksec) {
+    Array& dgamma_by_dphi = winding_surface->gammadash1();
+    Array& dgamma_by_dtheta = winding_surface->gammadash2();
+    vector<double> f(num_basis), dfdphi(num_basis), dfdtheta(num_basis);
+    basis(winding_surface->quadpoints_phi[i], winding_surface->quadpoints_theta[j], f.data(), dfdphi.data(), dfdtheta.data());
+    for (int l = 0; l < 3; ++l) {
+        double rphi = dgamma_by_dphi(i, j, l);
+        double rtheta = dgamma_by_dtheta(i, j, l);
+        for (int b = 0; b < num_basis; ++b)
+            Kj[3*b + l] = dfdphi[b]*rtheta - dfdtheta[b]*rphi;
+        Ksec[l] = net_poloidal_current*rtheta - net_toroidal_current*rphi;
+    }
+}
+
+template<class Array>
+void CurrentPotentialSolver<Array>::assemble(Array& Bnormal_target) {
+    const double mu0_over_4pi = 1e-7;
+    int nphi_w = winding_surface->numquadpoints_phi;
+    int ntheta_w = winding_surface->numquadpoints_theta;
+    int nw = nphi_w*ntheta_w;
+    int nphi_p = plasma_surface->numquadpoints_phi;
+    int ntheta_p = plasma_surface->numquadpoints_theta;
+    int np = nphi_p*ntheta_p;
+    if(Bnormal_target.size() != 0 && (int)Bnormal_target.size() != np)
+        throw std::runtime_error("Bnormal_target needs to have one value per quadrature point of the plasma surface.");
+
+    // winding surface: basis functions, currents and the regularization
+    Array& gamma_w = winding_surface->gamma();
+    Array& normal_w = winding_surface->normal();
+    Matrix F(nw, num_basis);
+    Matrix Kmat(3*nw, num_basis);
+    Vector ksec(3*nw);
+    // K dA of the net currents, stored as (nw, 3)
+    vector<double> KdA_sec(3*nw);
+    {
+        vector<double> f(num_basis), dfdphi(num_basis), dfdtheta(num_basis), Kj(3*num_basis);
+        double Ksec[3];
+        for (int i = 0; i < nphi_w; ++i) {
+            for (int j = 0; j < ntheta_w; ++j) {
+                int c = i*ntheta_w + j;
+                basis(winding_surface->quadpoints_phi[i], winding_surface->quadpoints_theta[j], f.data(), dfdphi.data(), dfdtheta.data());
+                for (int b = 0; b < num_basis; ++b)
+                    F(c, b) = f[b];
+                current_times_area(i, j, Kj.data(), Ksec);
+                double normN = std::sqrt(normal_w(i, j, 0)*normal_w(i, j, 0) + normal_w(i, j, 1)*normal_w(i, j, 1) + normal_w(i, j, 2)*normal_w(i, j, 2));
+                // int |K|^2 dA = sum |K N|^2/(|N| nw)
+                double w = 1./std::sqrt(normN*nw);
+                for (int l = 0; l < 3; ++l) {
+                    for (int b = 0; b < num_basis; ++b)
+                        Kmat(3*c + l, b) = w*Kj[3*b + l];
+                    ksec(3*c + l) = w*Ksec[l];
+                    KdA_sec[3*c + l] = Ksec[l]/nw;
+                }
+            }
+        }
+    }
+    A_K = Kmat.transpose()*Kmat;
+    b_K = -Kmat.transpose()*ksec;
+    c_K = ksec.squaredNorm();
+
+    // plasma surface: normal field of the basis functions (through the
+    // inductance between the two grids) and of the net currents
+    Array& gamma_p = plasma_surface->gamma();
+    Array& normal_p = plasma_surface->normal();
+    g = Matrix(np, num_basis);
+    Bnormal_net = Vector(np);
+    h = Vector(np);
+    plasma_weights = Vector(np);
+    const double* gamma_w_ptr = gamma_w.data();
+    const double* normal_w_ptr = normal_w.data();
+    const double* gamma_p_ptr = gamma_p.data();
+    const double* normal_p_ptr = normal_p.data();
+    const double* target_ptr = Bnormal_target.size() > 0 ? Bnormal_target.data() : nullptr;
+    constexpr int block_size = 32;
+#pragma omp parallel
+    {
+        Matrix inductance(block_size, nw);
+#pragma omp for schedule(dynamic)
+        for (int p0 = 0; p0 < np; p0 += block_size) {
+            int rows = std::min(block_size, np - p0);
+            for (int r = 0; r < rows; ++r) {
+                int p = p0 + r;
+                const double* x = gamma_p_ptr + 3*p;
+                const double* n = normal_p_ptr + 3*p;
+                double normN = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+                double nhat[3] = {n[0]/normN, n[1]/normN, n[2]/normN};
+                plasma_weights(p) = normN/np;
+                double Bsec = 0.;
+                for (int c = 0; c < nw; ++c) {
+                    const double* y = gamma_w_ptr + 3*c;
+                    const double* N = normal_w_ptr + 3*c;
+                    double d[3] = {x[0] - y[0], x[1] - y[1], x[2] - y[2]};
+                    double r2 = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+                    double rinv = 1./std::sqrt(r2);
+                    double rinv3 = rinv*rinv*rinv;
+                    double nd = nhat[0]*d[0] + nhat[1]*d[1] + nhat[2]*d[2];
+                    double Nd = N[0]*d[0] + N[1]*d[1] + N[2]*d[2];
+                    double nN = nhat[0]*N[0] + nhat[1]*N[1] + nhat[2]*N[2];
+                    // the current K of Phi is the one of a dipole layer with
+                    // moment -Phi N/|N| per area, whose normal field is
+                    inductance(r, c) = -mu0_over_4pi*(3.*nd*Nd*rinv*rinv - nN)*rinv3/nw;
+                    const double* KdA = KdA_sec.data() + 3*c;
+                    double KdAxd[3] = {KdA[1]*d[2] - KdA[2]*d[1], KdA[2]*d[0] - KdA[0]*d[2], KdA[0]*d[1] - KdA[1]*d[0]};
+                    Bsec += (KdAxd[0]*nhat[0] + KdAxd[1]*nhat[1] + KdAxd[2]*nhat[2])*rinv3;
+                }
+                Bnormal_net(p) = mu0_over_4pi*Bsec;
+                h(p) = Bnormal_net(p) - (target_ptr ? target_ptr[p] : 0.);
+            }
+            g.middleRows(p0, rows) = inductance.topRows(rows)*F;
+        }
+    }
+    Matrix Wg = plasma_weights.asDiagonal()*g;
+    A_B = g.transpose()*Wg;
+    b_B = -Wg.transpose()*h;
+    c_B = h.dot(plasma_weights.asDiagonal()*h);
+}
+
+template<class Array>
+void CurrentPotentialSolver<Array>::decompose() {
+    Eigen::GeneralizedSelfAdjointEigenSolver<Matrix> es(A_B, A_K);
+    if(es.info() != Eigen::Success)
+        throw std::runtime_error("The regularization matrix of CurrentPotentialSolver is not positive definite, increase the resolution of the winding surface.");
+    V = es.eigenvectors();
+    D = es.eigenvalues();
+    decomposed = true;
+}
+
+template<class Array>
+vector<double> CurrentPotentialSolver<Array>::solve(double lambda) {
+    if(lambda < 0)
+        throw std::runtime_error("lambda needs to be nonnegative.");
+    if(!decomposed)
+        decompose();
+    Vector rhs = b_B + lambda*b_K;
+    Vector coeffs = V.transpose()*rhs;
+    // Without regularization, combinations of the basis functions whose
+    // normal field on the plasma surface vanishes up to round off are left
+    // out, instead of dividing by zero. Of all minimizers of chi2_B, this
+    // returns the one with the smallest norm x^T A_K x.
+    double tol = 1e-12*std::max(D.cwiseAbs().maxCoeff(), lambda);
+    for (int b = 0; b < num_basis; ++b) {
+        if(D(b) + lambda > tol)
+            coeffs(b) /= D(b) + lambda;
+        else
+            coeffs(b) = 0.;
+    }
+    Vector x = V*coeffs;
+    return vector<double>(x.data(), x.data() + num_basis);
+}
+
+template<class Array>
+std::tuple<double, double> CurrentPotentialSolver<Array>::chi2(const vector<double>& phi) {
+    if((int)phi.size() != num_basis)
+        throw std::runtime_error("phi has wrong size.");
+    Eigen::Map<const Vector> x(phi.data(), num_basis);
+    double chi2_B = x.dot(A_B*x) - 2*b_B.dot(x) + c_B;
+    double chi2_K = x.dot(A_K*x) - 2*b_K.dot(x) + c_K;
+    return std::make_tuple(chi2_B, chi2_K);
+}
+
+template<class Array>
+Array CurrentPotentialSolver<Array>::current_potential(const vector<double>& phi) {
+    if((int)phi.size() != num_basis)
+        throw std::runtime_error("phi has wrong size.");
+    int nphi_w = winding_surface->numquadpoints_phi;
+    int ntheta_w = winding_surface->numquadpoints_theta;
+    Array res = xt::zeros<double>({nphi_w, ntheta_w});
+    vector<double> f(num_basis), dfdphi(num_basis), dfdtheta(num_basis);
+    for (int i = 0; i < nphi_w; ++i) {
+        for (int j = 0; j < ntheta_w; ++j) {
+            basis(winding_surface->quadpoints_phi[i], winding_surface->quadpoints_theta[j], f.data(), dfdphi.data(), dfdtheta.data());
+            double val = 0.;
+            for (int b = 0; b < num_basis; ++b)
+                val += phi[b]*f[b];
+            res(i, j) = val;
+        }
+    }
+    return res;
+}
+
+template<class Array>
+Array CurrentPotentialSolver<Array>::K(const vector<double>& phi) {
+    if((int)phi.size() != num_basis)
+        throw std::runtime_error("phi has wrong size.");
+    int nphi_w = winding_surface->numquadpoints_phi;
+    int ntheta_w = winding_surface->numquadpoints_theta;
+    Array& normal_w = winding_surface->normal();
+    Array res = xt::zeros<double>({nphi_w, ntheta_w, 3});
+    vector<double> Kj(3*num_basis);
+    double Ksec[3];
+    for (int i = 0; i < nphi_w; ++i) {
+        for (int j = 0; j < ntheta_w; ++j) {
+            current_times_area(i, j, Kj.data(), Ksec);
+            double normN = std::sqrt(normal_w(i, j, 0)*normal_w(i, j, 0) + normal_w(i, j, 1)*normal_w(i, j, 1) + normal_w(i, j, 2)*normal_w(i, j, 2));
+            for (int l = 0; l < 3; ++l) {
+                double val = Ksec[l];
+                for (int b = 0; b < num_basis; ++b)
+                    val += phi[b]*Kj[3*b + l];
+                res(i, j, l) = val/normN;
+            }
+        }
+    }
+    return res;
+}
+
+template<class Array>
+Array CurrentPotentialSolver<Array>::Bnormal(const vector<double>& phi) {
+    if((int)phi.size() != num_basis)
+        throw std::runtime_error("phi has wrong size.");
+    int nphi_p = plasma_surface->numquadpoints_phi;
+    int ntheta_p = plasma_surface->numquadpoints_theta;
+    Eigen::Map<const Vector> x(phi.data(), num_basis);
+    Vector Bn = g*x + Bnormal_net;
+    Array res = xt::zeros<double>({nphi_p, ntheta_p});
+    for (int i = 0; i < nphi_p; ++i) {
+        for (int j = 0; j < ntheta_p; ++j)
+            res(i, j) = Bn(i*ntheta_p + j);
+    }
+    return res;
+}
+
+template<class Array>
+vector<vector<double>> CurrentPotentialSolver<Array>::cut_coils(const vector<double>& phi, int ncoils, int order, int nsamples) {
+    if((int)phi.size() != num_basis)
+        throw std::runtime_error("phi has wrong size.");
+    if(net_poloidal_current == 0. || net_toroidal_current != 0.)
+        throw std::runtime_error("Only modular coils can be cut, which needs a nonzero net poloidal and a zero net toroidal current.");
+    if(ncoils < 1 || order < 0 || nsamples < 2*order + 1)
+        throw std::runtime_error("cut_coils needs ncoils >= 1, order >= 0 and nsamples >= 2*order+1.");
+    double G = net_poloidal_current;
+    double bound = 0.;
+    for (double p : phi)
+        bound += std::abs(p);
+    vector<double> f(num_basis), dfdphi(num_basis), dfdtheta(num_basis);
+    // G phi + sum_j Phi_j f_j(phi, theta) - level
+    auto contour_residual = [&](double phi_, double theta, double level) {
+        basis(phi_, theta, f.data(), dfdphi.data(), dfdtheta.data());
+        double val = G*phi_ - level;
+        for (int b = 0; b < num_basis; ++b)
+            val += phi[b]*f[b];
+        return val;
+    };
+
+    vector<vector<double>> res;
+    vector<double> contour(nsamples);
+    for (int k = 0; k < ncoils; ++k) {
+        double level = G*(k + 0.5)/(2*nfp*ncoils);
+        for (int s = 0; s < nsamples; ++s) {
+            double theta = double(s)/nsamples;
+            // |sum_j Phi_j f_j| <= bound, so the contour lies in this interval
+            double lo = (level - bound)/G;
+            double hi = (level + bound)/G;
+            if(lo > hi)
+                std::swap(lo, hi);
+            double flo = contour_residual(lo, theta, level);
+            for (int it = 0; it < 100 && hi - lo > 1e-15; ++it) {
+                double mid = 0.5*(lo + hi);
+                double fmid = contour_residual(mid, theta, level);
+                if((fmid < 0) == (flo < 0)) {
+                    lo = mid;
+                    flo = fmid;
+                } else {
+                    hi = mid;
+                }
+            }
+            contour[s] = 2*M_PI*0.5*(lo + hi);
+        }
+        // dofs of CurveCWSFourier: theta_l, theta_c, theta_s, phi_l, phi_c, phi_s
+        vector<double> dofs(2*(2*order + 1) + 2, 0.);
+        dofs[0] = 1.;
+        int offset = 2*order + 2;
+        for (int m = 0; m <= order; ++m) {
+            double cm = 0., sm = 0.;
+            for (int s = 0; s < nsamples; ++s) {
+                double t = 2*M_PI*s/nsamples;
+                cm += contour[s]*std::cos(m*t);
+                sm += contour[s]*std::sin(m*t);
+            }
+            double scale = (m == 0 || 2*m == nsamples) ? 1./nsamples : 2./nsamples;
+            dofs[offset + 1 + m] = scale*cm;
+            if(m > 0)
+                dofs[offset + 1 + order + m] = scale*sm;
+        }
+        res.push_back(dofs);
+    }
+    return res;
+}
+
+#include "xtensor-python/pyarray.hpp"     // Numpy bindings
+template class CurrentPotentialSolver<xt::pyarray<double>>;
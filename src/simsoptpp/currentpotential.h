@@ -0,0 +1,112 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <tuple>
+#include <Eigen/Dense>
+#include "surface.h"
+
+using std::vector;
+using std::shared_ptr;
+
+template<class Array>
+class CurrentPotentialSolver {
+    /*
+     * Computes the current potential on a winding surface whose normal field
+     * on a plasma surface is closest to a target, following
+     * M. Landreman, Nucl. Fusion 57 (2017) 046003 (REGCOIL).
+     *
+     * With phi, theta in [0, 1) the angles of the winding surface and
+     * N = dgamma/dphi x dgamma/dtheta its normal, the current potential
+     *
+     *   Phi = G phi + I theta + sum_j Phi_j f_j(phi, theta)
+     *
+     * gives the surface current K = (dPhi/dphi dgamma/dtheta - dPhi/dtheta dgamma/dphi)/|N|.
+     * G is the net poloidal current, I the net toroidal current, and the
+     * basis functions are f_j = sin(2 pi (m theta - nfp n phi)), plus the
+     * corresponding cosines if the problem is not stellarator symmetric. The
+     * coefficients minimize
+     *
+     *   chi2_B + lambda chi2_K,
+     *   chi2_B = int_plasma (B.n - Bnormal_target)^2 dA,
+     *   chi2_K = int_winding |K|^2 dA.
+     *
+     * On construction, the inductance between the quadrature points of the
+     * two surfaces is assembled, reusing the gamma and normal caches of the
+     * surfaces, and reduced to the normal field of each basis function.
+     * Both quadratic forms are then diagonalized simultaneously once, so that
+     * the solution for every further value of lambda only costs a product
+     * with the cached eigenvectors.
+     *
+     * The quadrature points of the winding surface need to cover the full
+     * torus, those of the plasma surface any part of it, e.g. a half period.
+     */
+    public:
+        using Matrix = Eigen::MatrixXd;
+        using Vector = Eigen::VectorXd;
+
+        const shared_ptr<Surface<Array>> plasma_surface;
+        const shared_ptr<Surface<Array>> winding_surface;
+        const int mpol, ntor, nfp;
+        const bool stellsym;
+        const double net_poloidal_current, net_toroidal_current;
+        vector<int> xm, xn;
+
+    private:
+        int num_basis;
+        // normal field on the plasma surface per basis function (np, num_basis),
+        // and of the net currents (np), and the latter minus the target
+        Matrix g;
+        Vector Bnormal_net;
+        Vector h;
+        Vector plasma_weights;
+        // chi2_B = x^T A_B x - 2 b_B^T x + c_B, and similarly for chi2_K
+        Matrix A_B, A_K;
+        Vector b_B, b_K;
+        double c_B, c_K;
+        // V^T A_K V = 1, V^T A_B V = diag(D)
+        bool decomposed = false;
+        Matrix V;
+        Vector D;
+
+        // Writes the basis functions and their derivatives wrt phi and theta
+        // at the point (phi, theta).
+        void basis(double phi, double theta, double* f, double* dfdphi, double* dfdtheta) const;
+        // K |N| of every basis function (3*num_basis) and of the net currents
+        // (3) at quadrature point (i, j) of the winding surface.
+        void current_times_area(int i, int j, double* Kj, double* Ksec);
+        void assemble(Array& Bnormal_target);
+        void decompose();
+
+    public:
+        CurrentPotentialSolver(shared_ptr<Surface<Array>> plasma_surface, shared_ptr<Surface<Array>> winding_surface,
+                int mpol, int ntor, int nfp, bool stellsym, double net_poloidal_current, double net_toroidal_current,
+                Array& Bnormal_target);
+
+        int num_dofs() { return num_basis; }
+
+        // Returns the coefficients Phi_j for the given regularization. For
+        // lambda = 0, the part of Phi without normal field on the plasma
+        // surface is set to zero.
+        vector<double> solve(double lambda);
+
+        // Returns chi2_B and chi2_K for the coefficients Phi_j.
+        std::tuple<double, double> chi2(const vector<double>& phi);
+
+        // Returns the single valued part of the current potential on the
+        // quadrature points of the winding surface.
+        Array current_potential(const vector<double>& phi);
+
+        // Returns the surface current density on the quadrature points of the
+        // winding surface, as a (nphi, ntheta, 3) array.
+        Array K(const vector<double>& phi);
+
+        // Returns B.n on the quadrature points of the plasma surface.
+        Array Bnormal(const vector<double>& phi);
+
+        // Cuts ncoils modular coils per half period out of the contours
+        // Phi = G (k + 1/2)/(2 nfp ncoils), k = 0, ..., ncoils-1, and returns
+        // the dofs of the corresponding `CurveCWSFourier` of the given order,
+        // with theta(t) = t and phi(t) fitted to nsamples points of the contour.
+        vector<vector<double>> cut_coils(const vector<double>& phi, int ncoils, int order, int nsamples);
+};
@@ -12,6 +12,7 @@ using std::logic_error;
 
 #include "xtensor/xarray.hpp"
 #include "cachedarray.h"
+#include "perf.h"
 
 #include <Eigen/QR>
 
@@ -39,6 +40,20 @@ Array curve_vjp_contraction(const Array& mat, const Array& v){
     return res;
 }
 
+template<class Array>
+Array curve_jvp_contraction(const Array& mat, const Array& w){
+    // Computes res(j, k) = \sum_i mat(j, k, i) * w(i), i.e. the derivative of
+    // the curve in direction w of the dofs.
+    int numquadpoints = mat.shape(0);
+    int numdofs = mat.shape(2);
+    Array res = xt::zeros<double>({numquadpoints, 3});
+    Eigen::Map<Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor>> eigen_mat(const_cast<double*>(mat.data()), numquadpoints*3, numdofs);
+    Eigen::Map<Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor>> eigen_w(const_cast<double*>(w.data()), numdofs, 1);
+    Eigen::Map<Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor>> eigen_res(const_cast<double*>(res.data()), numquadpoints*3, 1);
+    eigen_res = eigen_mat*eigen_w;
+    return res;
+}
+
 template<class Array>
 class Curve {
     private:
@@ -52,26 +67,38 @@ class Curve {
 
 
     protected:
-        Array& check_the_cache(string key, vector<int> dims, std::function<void(Array&)> impl){
+        // The shape is passed as a plain array, so that a lookup that hits the
+        // cache doesn't allocate memory.
+        template<std::size_t N>
+        Array& check_the_cache(const string& key, const int (&dims)[N], std::function<void(Array&)> impl){
             auto loc = cache.find(key);
             if(loc == cache.end()){ // Key not found --> allocate array
                 loc = cache.insert(std::make_pair(key, CachedArray<Array>(xt::zeros<double>(dims)))).first; 
             }
             if(!((loc->second).status)){ // needs recomputing
+                SIMSOPT_PERF_COUNT("curve_cache_misses", 1);
+                SIMSOPT_PERF_SCOPE(timer, "Curve::" + key);
                 impl((loc->second).data);
                 (loc->second).status = true;
+            } else {
+                SIMSOPT_PERF_COUNT("curve_cache_hits", 1);
             }
             return (loc->second).data;
         }
 
-        Array& check_the_persistent_cache(string key, vector<int> dims, std::function<void(Array&)> impl){
+        template<std::size_t N>
+        Array& check_the_persistent_cache(const string& key, const int (&dims)[N], std::function<void(Array&)> impl){
             auto loc = cache_persistent.find(key);
             if(loc == cache_persistent.end()){ // Key not found --> allocate array
                 loc = cache_persistent.insert(std::make_pair(key, CachedArray<Array>(xt::zeros<double>(dims)))).first; 
             }
             if(!((loc->second).status)){ // needs recomputing
+                SIMSOPT_PERF_COUNT("curve_cache_misses", 1);
+                SIMSOPT_PERF_SCOPE(timer, "Curve::" + key);
                 impl((loc->second).data);
                 (loc->second).status = true;
+            } else {
+                SIMSOPT_PERF_COUNT("curve_cache_hits", 1);
             }
             return (loc->second).data;
         }
@@ -83,6 +110,10 @@ class Curve {
     public://protected:
         int numquadpoints;
         Array quadpoints;
+        // Quadrature weights for integrals over the curve parameter, used by
+        // the Biot-Savart law and the curve objectives. Empty means that the quadrature points are
+        // uniformly spaced and every point carries the weight 1/numquadpoints.
+        vector<double> quadweights;
 
     public:
 
@@ -106,6 +137,16 @@ class Curve {
             numquadpoints = _quadpoints.size();
         }
 
+        void set_quadweights(const vector<double>& _quadweights) {
+            if(_quadweights.size() != 0 && _quadweights.size() != numquadpoints)
+                throw std::runtime_error("quadweights needs to be empty or have one entry per quadrature point.");
+            quadweights = _quadweights;
+        }
+
+        const double* quadweights_ptr() const {
+            return quadweights.empty() ? nullptr : quadweights.data();
+        }
+
         void invalidate_cache() {
             for (auto it = cache.begin(); it != cache.end(); ++it) {
                 (it->second).status = false;
@@ -188,6 +229,22 @@ class Curve {
             return curve_vjp_contraction<Array>(dgammadashdashdash_by_dcoeff(), v);
         };
 
+        virtual Array dgamma_by_dcoeff_jvp_impl(Array& w) {
+            return curve_jvp_contraction<Array>(dgamma_by_dcoeff(), w);
+        };
+
+        virtual Array dgammadash_by_dcoeff_jvp_impl(Array& w) {
+            return curve_jvp_contraction<Array>(dgammadash_by_dcoeff(), w);
+        };
+
+        virtual Array dgammadashdash_by_dcoeff_jvp_impl(Array& w) {
+            return curve_jvp_contraction<Array>(dgammadashdash_by_dcoeff(), w);
+        };
+
+        virtual Array dgammadashdashdash_by_dcoeff_jvp_impl(Array& w) {
+            return curve_jvp_contraction<Array>(dgammadashdashdash_by_dcoeff(), w);
+        };
+
         Array& kappa() {
             return check_the_cache("kappa", {numquadpoints}, [this](Array& A) { return kappa_impl(A);});
         }
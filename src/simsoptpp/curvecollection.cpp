@@ -0,0 +1,111 @@
+#include "curvecollection.h"
+
+template<class Array>
+CurveXYZFourierCollection<Array>::CurveXYZFourierCollection(vector<shared_ptr<CurveXYZFourier<Array>>> _curves) :
+    curves(_curves), ncurves(_curves.size()),
+    order(_curves.size() > 0 ? _curves[0]->order : 0),
+    numquadpoints(_curves.size() > 0 ? _curves[0]->numquadpoints : 0) {
+    if(ncurves == 0)
+        throw std::runtime_error("CurveXYZFourierCollection needs at least one curve.");
+    for (int c = 1; c < ncurves; ++c) {
+        if(curves[c]->order != order)
+            throw std::runtime_error("All curves in a CurveXYZFourierCollection need to have the same order.");
+        if(curves[c]->numquadpoints != numquadpoints)
+            throw std::runtime_error("All curves in a CurveXYZFourierCollection need to have the same quadrature points.");
+        for (int q = 0; q < numquadpoints; ++q) {
+            if(curves[c]->quadpoints[q] != curves[0]->quadpoints[q])
+                throw std::runtime_error("All curves in a CurveXYZFourierCollection need to have the same quadrature points.");
+        }
+    }
+    basis = FourierBasisTable::get(curves[0]->quadpoints.data(), numquadpoints, order, 1);
+    coeffs_cos = RowMatrixXd::Zero(order+1, 3*ncurves);
+    coeffs_sin = RowMatrixXd::Zero(order, 3*ncurves);
+    for (int d = 0; d < 4; ++d)
+        blocks[d] = xt::zeros<double>({ncurves, numquadpoints, 3});
+}
+
+template<class Array>
+void CurveXYZFourierCollection<Array>::update() {
+    bool changed = false;
+    for (int c = 0; c < ncurves; ++c) {
+        auto& dofs = curves[c]->dofs;
+        for (int i = 0; i < 3; ++i) {
+            int col = 3*c + i;
+            changed |= coeffs_cos(0, col) != dofs[i][0];
+            coeffs_cos(0, col) = dofs[i][0];
+            for (int j = 1; j < order+1; ++j) {
+                changed |= coeffs_sin(j-1, col) != dofs[i][2*j-1];
+                changed |= coeffs_cos(j, col) != dofs[i][2*j];
+                coeffs_sin(j-1, col) = dofs[i][2*j-1];
+                coeffs_cos(j, col) = dofs[i][2*j];
+            }
+        }
+    }
+    if(changed)
+        invalidate_cache();
+}
+
+template<class Array>
+void CurveXYZFourierCollection<Array>::compute(int derivative, Array& data) {
+    // one product for all curves, the result has shape (numquadpoints, 3*ncurves)
+    RowMatrixXd res = basis->cos[derivative] * coeffs_cos;
+    res.noalias() += basis->sin[derivative] * coeffs_sin;
+    double* data_ptr = data.data();
+#pragma omp parallel for
+    for (int c = 0; c < ncurves; ++c) {
+        Eigen::Map<RowMatrixXd> data_c(data_ptr + 3*numquadpoints*c, numquadpoints, 3);
+        data_c = res.middleCols(3*c, 3);
+    }
+}
+
+template<class Array>
+Array& CurveXYZFourierCollection<Array>::block(int derivative) {
+    if(derivative < 0 || derivative > 3)
+        throw std::runtime_error("Only derivatives up to order three are available.");
+    update();
+    if(!status[derivative]) {
+        compute(derivative, blocks[derivative]);
+        status[derivative] = true;
+    }
+    return blocks[derivative];
+}
+
+template<class Array>
+Array CurveXYZFourierCollection<Array>::vjp(int derivative, Array& v) {
+    if(derivative < 0 || derivative > 3)
+        throw std::runtime_error("Only derivatives up to order three are available.");
+    if(v.dimension() != 3 || v.shape(0) != ncurves || v.shape(1) != numquadpoints || v.shape(2) != 3)
+        throw std::runtime_error("v needs to have shape (ncurves, numquadpoints, 3).");
+    // gather v into shape (numquadpoints, 3*ncurves) and contract with the basis
+    RowMatrixXd v_all(numquadpoints, 3*ncurves);
+    double* v_ptr = v.data();
+#pragma omp parallel for
+    for (int c = 0; c < ncurves; ++c) {
+        v_all.middleCols(3*c, 3) = Eigen::Map<RowMatrixXd>(v_ptr + 3*numquadpoints*c, numquadpoints, 3);
+    }
+    RowMatrixXd v_cos = basis->cos[derivative].transpose() * v_all;
+    RowMatrixXd v_sin = basis->sin[derivative].transpose() * v_all;
+
+    Array res = xt::zeros<double>({ncurves, num_dofs()});
+    for (int c = 0; c < ncurves; ++c) {
+        for (int i = 0; i < 3; ++i) {
+            int col = 3*c + i;
+            double* res_ci = &(res(c, i*(2*order+1)));
+            res_ci[0] = v_cos(0, col);
+            for (int j = 1; j < order+1; ++j) {
+                res_ci[2*j-1] = v_sin(j-1, col);
+                res_ci[2*j] = v_cos(j, col);
+            }
+        }
+    }
+    return res;
+}
+
+#ifdef SIMSOPT_WITHOUT_PYTHON
+// for the C++ benchmarks, which don't link against python
+template class CurveXYZFourierCollection<xt::xarray<double>>;
+#else
+#include "xtensor-python/pyarray.hpp"     // Numpy bindings
+typedef xt::pyarray<double> Array;
+template class CurveXYZFourierCollection<Array>;
+#endif
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <stdexcept>
+
+#include "curvexyzfourier.h"
+
+using std::shared_ptr;
+using std::vector;
+
+template<class Array>
+class CurveXYZFourierCollection {
+    /*
+       CurveXYZFourierCollection evaluates N curves of type CurveXYZFourier
+       with the same order and the same quadrature points in one go.
+
+       The Fourier coefficients of all curves are gathered into one
+       structure-of-arrays block
+
+           coeffs_cos(j, 3*c + i) = coefficient of cos(2*pi*j*t) in coordinate i of curve c,
+           coeffs_sin(j-1, 3*c + i) = coefficient of sin(2*pi*j*t) in coordinate i of curve c,
+
+       so that gamma and its derivatives of all curves are obtained from a
+       single matrix product with the shared FourierBasisTable. This replaces
+       N small products of a few hundred quadrature points each (with their
+       own virtual dispatch and cache lookups) by one product that is large
+       enough to be vectorized and parallelized efficiently.
+
+       The results are stored in blocks of shape (ncurves, numquadpoints, 3),
+       i.e. the values for curve c are contiguous. Slicing the block along the
+       first axis hence gives arrays that can be passed to the Biot-Savart
+       functions without copying.
+
+       The collection holds references to the curves and gathers their dofs
+       whenever one of the blocks is requested; the blocks are only recomputed
+       if any of the dofs have changed.
+       */
+    private:
+        shared_ptr<const FourierBasisTable> basis;
+        RowMatrixXd coeffs_cos;
+        RowMatrixXd coeffs_sin;
+        Array blocks[4];
+        bool status[4] = {false, false, false, false};
+
+        // Gathers the dofs of all curves into the SoA block and invalidates
+        // the cached blocks if any of them have changed.
+        void update();
+        void compute(int derivative, Array& data);
+
+    public:
+        const vector<shared_ptr<CurveXYZFourier<Array>>> curves;
+        const int ncurves;
+        const int order;
+        const int numquadpoints;
+
+        CurveXYZFourierCollection(vector<shared_ptr<CurveXYZFourier<Array>>> _curves);
+
+        inline int num_dofs() {
+            return 3*(2*order+1);
+        }
+
+        void invalidate_cache() {
+            for (int d = 0; d < 4; ++d)
+                status[d] = false;
+        }
+
+        // Blocks of shape (ncurves, numquadpoints, 3).
+        Array& gamma() { return block(0); }
+        Array& gammadash() { return block(1); }
+        Array& gammadashdash() { return block(2); }
+        Array& gammadashdashdash() { return block(3); }
+        Array& block(int derivative);
+
+        // Vector-Jacobian products for all curves at once. `v` has shape
+        // (ncurves, numquadpoints, 3), the result has shape (ncurves, num_dofs())
+        // and row c is the same as curves[c]->d*_by_dcoeff_vjp_impl(v[c]).
+        Array dgamma_by_dcoeff_vjp(Array& v) { return vjp(0, v); }
+        Array dgammadash_by_dcoeff_vjp(Array& v) { return vjp(1, v); }
+        Array dgammadashdash_by_dcoeff_vjp(Array& v) { return vjp(2, v); }
+        Array dgammadashdashdash_by_dcoeff_vjp(Array& v) { return vjp(3, v); }
+        Array vjp(int derivative, Array& v);
+};
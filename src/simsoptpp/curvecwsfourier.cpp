@@ -1,4 +1,5 @@
 #include "curvecwsfourier.h"
+#include "arena.h"
 
 template <class Array>
 void CurveCWSFourier<Array>::gamma_impl(Array &data, Array &quadpoints)
@@ -333,16 +334,18 @@ void CurveCWSFourier<Array>::dgamma_by_dcoeff_impl(Array &data)
 
     for (int k = 0; k < numquadpoints; ++k)
     {
+        // the scratch arrays of this quadrature point are released at the end of the iteration
+        arena::Scope scope;
         double CWSt = 2 * M_PI * quadpoints[k];
 
         double phi = 0;
         double theta = 0;
-        Array dphi_by_dphicoeff = xt::zeros<double>({2 * (order + 1)});
-        Array dtheta_by_dthetacoeff = xt::zeros<double>({2 * (order + 1)});
+        auto dphi_by_dphicoeff = arena::zeros<1>({2 * (order + 1)});
+        auto dtheta_by_dthetacoeff = arena::zeros<1>({2 * (order + 1)});
 
         double r = 0;
-        Array dr_dcoeff = xt::zeros<double>({4 * (order + 1)});
-        Array dz_dcoeff = xt::zeros<double>({4 * (order + 1)});
+        auto dr_dcoeff = arena::zeros<1>({4 * (order + 1)});
+        auto dz_dcoeff = arena::zeros<1>({4 * (order + 1)});
 
         double dr_dthetacoeff = 0;
         double dz_dthetacoeff = 0;
@@ -395,7 +398,8 @@ void CurveCWSFourier<Array>::dgamma_by_dcoeff_impl(Array &data)
             }
         }
 
-#pragma omp parallel for
+// the accumulators are reset for every i, so each thread needs its own
+#pragma omp parallel for private(dr_dthetacoeff, dz_dthetacoeff, dr_dphicoeff, dz_dphicoeff)
         for (int i = 0; i < counter; ++i)
         {
             dr_dthetacoeff = 0;
@@ -452,23 +456,25 @@ void CurveCWSFourier<Array>::dgammadash_by_dcoeff_impl(Array &data)
 
     for (int k = 0; k < numquadpoints; ++k)
     {
+        // the scratch arrays of this quadrature point are released at the end of the iteration
+        arena::Scope scope;
         double CWSt = 2 * M_PI * quadpoints[k];
 
         double phi = 0;
         double theta = 0;
-        Array dphi_by_dphicoeff = xt::zeros<double>({2 * (order + 1)});
-        Array dtheta_by_dthetacoeff = xt::zeros<double>({2 * (order + 1)});
+        auto dphi_by_dphicoeff = arena::zeros<1>({2 * (order + 1)});
+        auto dtheta_by_dthetacoeff = arena::zeros<1>({2 * (order + 1)});
 
         double dphi_dt = 0;
         double dtheta_dt = 0;
-        Array d2phi_by_dphicoeffdt = xt::zeros<double>({2 * (order + 1)});
-        Array d2theta_by_dthetacoeffdt = xt::zeros<double>({2 * (order + 1)});
+        auto d2phi_by_dphicoeffdt = arena::zeros<1>({2 * (order + 1)});
+        auto d2theta_by_dthetacoeffdt = arena::zeros<1>({2 * (order + 1)});
 
         double r = 0;
         double dr_dt = 0;
-        Array dr_dcoeff = xt::zeros<double>({4 * (order + 1)});
-        Array d2r_dcoeffdt = xt::zeros<double>({4 * (order + 1)});
-        Array d2z_dcoeffdt = xt::zeros<double>({4 * (order + 1)});
+        auto dr_dcoeff = arena::zeros<1>({4 * (order + 1)});
+        auto d2r_dcoeffdt = arena::zeros<1>({4 * (order + 1)});
+        auto d2z_dcoeffdt = arena::zeros<1>({4 * (order + 1)});
 
         // AUX VECTORS
         double dr_dthetacoeff = 0;
@@ -545,7 +551,7 @@ void CurveCWSFourier<Array>::dgammadash_by_dcoeff_impl(Array &data)
             }
         }
 
-#pragma omp parallel for
+#pragma omp parallel for private(dr_dthetacoeff, dr_dphicoeff, d2r_dthetacoeffdt, d2r_dphicoeffdt, d2z_dthetacoeffdt, d2z_dphicoeffdt)
         for (int i = 0; i < counter; ++i)
         {
             dr_dthetacoeff = 0;
@@ -618,31 +624,33 @@ void CurveCWSFourier<Array>::dgammadashdash_by_dcoeff_impl(Array &data)
 
     for (int k = 0; k < numquadpoints; ++k)
     {
+        // the scratch arrays of this quadrature point are released at the end of the iteration
+        arena::Scope scope;
         double CWSt = 2 * M_PI * quadpoints[k];
 
         double phi = 0;
         double theta = 0;
-        Array dphi_by_dphicoeff = xt::zeros<double>({2 * (order + 1)});
-        Array dtheta_by_dthetacoeff = xt::zeros<double>({2 * (order + 1)});
+        auto dphi_by_dphicoeff = arena::zeros<1>({2 * (order + 1)});
+        auto dtheta_by_dthetacoeff = arena::zeros<1>({2 * (order + 1)});
 
         double dphi_dt = 0;
         double dtheta_dt = 0;
-        Array d2phi_by_dphicoeffdt = xt::zeros<double>({2 * (order + 1)});
-        Array d2theta_by_dthetacoeffdt = xt::zeros<double>({2 * (order + 1)});
+        auto d2phi_by_dphicoeffdt = arena::zeros<1>({2 * (order + 1)});
+        auto d2theta_by_dthetacoeffdt = arena::zeros<1>({2 * (order + 1)});
 
         double d2phi_dt2 = 0;
         double d2theta_dt2 = 0;
-        Array d3phi_by_dphicoeffdt2 = xt::zeros<double>({2 * (order + 1)});
-        Array d3theta_by_dthetacoeffdt2 = xt::zeros<double>({2 * (order + 1)});
+        auto d3phi_by_dphicoeffdt2 = arena::zeros<1>({2 * (order + 1)});
+        auto d3theta_by_dthetacoeffdt2 = arena::zeros<1>({2 * (order + 1)});
 
         double r = 0;
         double dr_dt = 0;
         double d2r_dt2 = 0;
 
-        Array dr_dcoeff = xt::zeros<double>({4 * (order + 1)});
-        Array d2r_dcoeffdt = xt::zeros<double>({4 * (order + 1)});
-        Array d3r_dcoeffdt2 = xt::zeros<double>({4 * (order + 1)});
-        Array d3z_dcoeffdt2 = xt::zeros<double>({4 * (order + 1)});
+        auto dr_dcoeff = arena::zeros<1>({4 * (order + 1)});
+        auto d2r_dcoeffdt = arena::zeros<1>({4 * (order + 1)});
+        auto d3r_dcoeffdt2 = arena::zeros<1>({4 * (order + 1)});
+        auto d3z_dcoeffdt2 = arena::zeros<1>({4 * (order + 1)});
 
         double dr_dthetacoeff = 0;
         double dr_dphicoeff = 0;
@@ -738,7 +746,7 @@ void CurveCWSFourier<Array>::dgammadashdash_by_dcoeff_impl(Array &data)
         }
 
 // SURFACE
-#pragma omp parallel for
+#pragma omp parallel for private(dr_dthetacoeff, dr_dphicoeff, d2r_dthetacoeffdt, d2r_dphicoeffdt, d3r_dthetacoeffdt2, d3r_dphicoeffdt2, d3z_dthetacoeffdt2, d3z_dphicoeffdt2)
         for (int i = 0; i < counter; i++)
         {
             dr_dthetacoeff = 0;
@@ -869,38 +877,40 @@ void CurveCWSFourier<Array>::dgammadashdashdash_by_dcoeff_impl(Array &data)
 
     for (int k = 0; k < numquadpoints; ++k)
     {
+        // the scratch arrays of this quadrature point are released at the end of the iteration
+        arena::Scope scope;
         double CWSt = 2 * M_PI * quadpoints[k];
 
         double phi = 0;
         double theta = 0;
-        Array dphi_by_dphicoeff = xt::zeros<double>({2 * (order + 1)});
-        Array dtheta_by_dthetacoeff = xt::zeros<double>({2 * (order + 1)});
+        auto dphi_by_dphicoeff = arena::zeros<1>({2 * (order + 1)});
+        auto dtheta_by_dthetacoeff = arena::zeros<1>({2 * (order + 1)});
 
         double dphi_dt = 0;
         double dtheta_dt = 0;
-        Array d2phi_by_dphicoeffdt = xt::zeros<double>({2 * (order + 1)});
-        Array d2theta_by_dthetacoeffdt = xt::zeros<double>({2 * (order + 1)});
+        auto d2phi_by_dphicoeffdt = arena::zeros<1>({2 * (order + 1)});
+        auto d2theta_by_dthetacoeffdt = arena::zeros<1>({2 * (order + 1)});
 
         double d2phi_dt2 = 0;
         double d2theta_dt2 = 0;
-        Array d3phi_by_dphicoeffdt2 = xt::zeros<double>({2 * (order + 1)});
-        Array d3theta_by_dthetacoeffdt2 = xt::zeros<double>({2 * (order + 1)});
+        auto d3phi_by_dphicoeffdt2 = arena::zeros<1>({2 * (order + 1)});
+        auto d3theta_by_dthetacoeffdt2 = arena::zeros<1>({2 * (order + 1)});
 
         double d3phi_dt3 = 0;
         double d3theta_dt3 = 0;
-        Array d4phi_by_dphicoeffdt3 = xt::zeros<double>({2 * (order + 1)});
-        Array d4theta_by_dthetacoeffdt3 = xt::zeros<double>({2 * (order + 1)});
+        auto d4phi_by_dphicoeffdt3 = arena::zeros<1>({2 * (order + 1)});
+        auto d4theta_by_dthetacoeffdt3 = arena::zeros<1>({2 * (order + 1)});
 
         double r = 0;
         double dr_dt = 0;
         double d2r_dt2 = 0;
         double d3r_dt3 = 0;
 
-        Array dr_dcoeff = xt::zeros<double>({4 * (order + 1)});
-        Array d2r_dcoeffdt = xt::zeros<double>({4 * (order + 1)});
-        Array d3r_dcoeffdt2 = xt::zeros<double>({4 * (order + 1)});
-        Array d4r_dcoeffdt3 = xt::zeros<double>({4 * (order + 1)});
-        Array d4z_dcoeffdt3 = xt::zeros<double>({4 * (order + 1)});
+        auto dr_dcoeff = arena::zeros<1>({4 * (order + 1)});
+        auto d2r_dcoeffdt = arena::zeros<1>({4 * (order + 1)});
+        auto d3r_dcoeffdt2 = arena::zeros<1>({4 * (order + 1)});
+        auto d4r_dcoeffdt3 = arena::zeros<1>({4 * (order + 1)});
+        auto d4z_dcoeffdt3 = arena::zeros<1>({4 * (order + 1)});
 
         double dr_dthetacoeff = 0;
         double dr_dphicoeff = 0;
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include <Eigen/Core>
+
+using std::vector;
+using std::shared_ptr;
+
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrixXd;
+
+class FourierBasisTable {
+    /*
+     * FourierBasisTable stores the one dimensional Fourier basis
+     *
+     *     cos(2*pi*nfp*j*t), j = 0, ..., order,
+     *     sin(2*pi*nfp*j*t), j = 1, ..., order,
+     *
+     * and its first three derivatives with respect to t at a fixed set of
+     * quadrature points t_q. For curves that are linear in their Fourier
+     * coefficients (CurveXYZFourier, CurveRZFourier) this is all that is
+     * needed to evaluate gamma and its derivatives, and to compute
+     * Jacobian-vector and vector-Jacobian products with respect to the dofs,
+     * without ever forming the dense (nquadpoints, 3, ndofs) Jacobian.
+     *
+     * The tables only depend on (quadpoints, order, nfp), so they are shared
+     * between all curves with the same parameters via `FourierBasisTable::get`.
+     * A coil set of N curves of equal order and resolution hence holds a
+     * single table instead of N dense Jacobians.
+     *
+     * cos[k](q, j)   = d^k/dt^k cos(2*pi*nfp*j*t_q), shape (nquadpoints, order+1)
+     * sin[k](q, j-1) = d^k/dt^k sin(2*pi*nfp*j*t_q), shape (nquadpoints, order)
+     */
+    public:
+        const int order;
+        const int nfp;
+        const int numquadpoints;
+        std::array<RowMatrixXd, 4> cos;
+        std::array<RowMatrixXd, 4> sin;
+        // cos(2*pi*t_q) and sin(2*pi*t_q), used to rotate from cylindrical to
+        // cartesian coordinates in CurveRZFourier.
+        Eigen::VectorXd cosphi;
+        Eigen::VectorXd sinphi;
+
+        FourierBasisTable(const vector<double>& quadpoints, int order, int nfp) :
+            order(order), nfp(nfp), numquadpoints(quadpoints.size()) {
+            for (int k = 0; k < 4; ++k) {
+                cos[k] = RowMatrixXd::Zero(numquadpoints, order+1);
+                sin[k] = RowMatrixXd::Zero(numquadpoints, order);
+            }
+            cosphi = Eigen::VectorXd::Zero(numquadpoints);
+            sinphi = Eigen::VectorXd::Zero(numquadpoints);
+            for (int q = 0; q < numquadpoints; ++q) {
+                cosphi(q) = std::cos(2*M_PI*quadpoints[q]);
+                sinphi(q) = std::sin(2*M_PI*quadpoints[q]);
+                cos[0](q, 0) = 1.;
+                for (int j = 1; j < order+1; ++j) {
+                    double omega = 2*M_PI*nfp*j;
+                    double c = std::cos(omega*quadpoints[q]);
+                    double s = std::sin(omega*quadpoints[q]);
+                    cos[0](q, j) = c;
+                    cos[1](q, j) = -omega*s;
+                    cos[2](q, j) = -omega*omega*c;
+                    cos[3](q, j) = omega*omega*omega*s;
+                    sin[0](q, j-1) = s;
+                    sin[1](q, j-1) = omega*c;
+                    sin[2](q, j-1) = -omega*omega*s;
+                    sin[3](q, j-1) = -omega*omega*omega*c;
+                }
+            }
+        }
+
+        // Returns the table for the given parameters. Tables are kept alive
+        // as long as at least one curve refers to them.
+        static shared_ptr<const FourierBasisTable> get(const double* quadpoints, int numquadpoints, int order, int nfp) {
+            using Key = std::tuple<int, int, vector<double>>;
+            static std::map<Key, std::weak_ptr<const FourierBasisTable>> registry;
+            static std::mutex registry_mutex;
+
+            auto key = Key(order, nfp, vector<double>(quadpoints, quadpoints + numquadpoints));
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            auto loc = registry.find(key);
+            if(loc != registry.end()) {
+                if(auto table = loc->second.lock())
+                    return table;
+            }
+            // drop the entries of tables that are no longer in use
+            for (auto it = registry.begin(); it != registry.end();) {
+                if(it->second.expired())
+                    it = registry.erase(it);
+                else
+                    ++it;
+            }
+            auto table = std::make_shared<const FourierBasisTable>(std::get<2>(key), order, nfp);
+            registry[key] = table;
+            return table;
+        }
+};
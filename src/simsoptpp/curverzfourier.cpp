@@ -1,255 +1,225 @@
 #include "curverzfourier.h"
 
+// Weight binom(derivative, k) * (2*pi)^(derivative-k) of r^{(k)} e_R^{[derivative-k]}
+// in the k-th derivative of r e_R, see the comment in curverzfourier.h.
+static double rz_binomial_weight(int derivative, int k) {
+    static const int binom[4][4] = {{1, 0, 0, 0}, {1, 1, 0, 0}, {1, 2, 1, 0}, {1, 3, 3, 1}};
+    return binom[derivative][k] * std::pow(2*M_PI, derivative-k);
+}
+
+// x and y component of the m-th derivative of e_R = (cos(phi), sin(phi), 0)
+// with respect to phi.
+static inline void rz_unit_vector_derivative(int m, double c, double s, double& ex, double& ey) {
+    switch(m % 4) {
+        case 0: ex = c;  ey = s;  break;
+        case 1: ex = -s; ey = c;  break;
+        case 2: ex = -c; ey = -s; break;
+        default: ex = s; ey = -c; break;
+    }
+}
 
 template<class Array>
-void CurveRZFourier<Array>::gamma_impl(Array& data, Array& quadpoints) {
-    int numquadpoints = quadpoints.size();
-    data *= 0;
-    for (int k = 0; k < numquadpoints; ++k) {
-        double phi = 2 * M_PI * quadpoints[k];
-        for (int i = 0; i < order+1; ++i) {
-            data(k, 0) += rc[i] * cos(nfp*i*phi) * cos(phi);
-            data(k, 1) += rc[i] * cos(nfp*i*phi) * sin(phi);
-        }
-        for (int i = 1; i < order+1; ++i) {
-            data(k, 2) += zs[i-1] * sin(nfp*i*phi);
-        }
+void CurveRZFourier<Array>::fourier_jvp(int derivative, const double* coeffs, Array& data) {
+    auto& table = fourier_basis();
+    Eigen::Map<const Eigen::VectorXd> coeffs_rc(coeffs, order+1);
+    Eigen::VectorXd coeffs_rs = Eigen::VectorXd::Zero(order);
+    Eigen::VectorXd coeffs_zc = Eigen::VectorXd::Zero(order+1);
+    Eigen::VectorXd coeffs_zs;
+    if(stellsym) {
+        coeffs_zs = Eigen::Map<const Eigen::VectorXd>(coeffs + order+1, order);
+    } else {
+        coeffs_rs = Eigen::Map<const Eigen::VectorXd>(coeffs + order+1, order);
+        coeffs_zc = Eigen::Map<const Eigen::VectorXd>(coeffs + 2*order+1, order+1);
+        coeffs_zs = Eigen::Map<const Eigen::VectorXd>(coeffs + 3*order+2, order);
     }
-    if(!stellsym){
-        for (int k = 0; k < numquadpoints; ++k) {
-            double phi = 2 * M_PI * quadpoints[k];
-            for (int i = 1; i < order+1; ++i) {
-                data(k, 0) += rs[i-1] * sin(nfp*i*phi) * cos(phi);
-                data(k, 1) += rs[i-1] * sin(nfp*i*phi) * sin(phi);
-            }
-            for (int i = 0; i < order+1; ++i) {
-                data(k, 2) += zc[i] * cos(nfp*i*phi);
-            }
-        }
+    // derivatives of r(t) up to the requested order
+    std::array<Eigen::VectorXd, 4> r;
+    for (int k = 0; k <= derivative; ++k) {
+        r[k] = table.cos[k] * coeffs_rc;
+        if(!stellsym)
+            r[k].noalias() += table.sin[k] * coeffs_rs;
+    }
+    Eigen::VectorXd z = table.sin[derivative] * coeffs_zs;
+    if(!stellsym)
+        z.noalias() += table.cos[derivative] * coeffs_zc;
+
+    for (int q = 0; q < numquadpoints; ++q) {
+        double x = 0., y = 0.;
+        for (int k = 0; k <= derivative; ++k) {
+            double ex, ey;
+            rz_unit_vector_derivative(derivative-k, table.cosphi(q), table.sinphi(q), ex, ey);
+            double w = rz_binomial_weight(derivative, k) * r[k](q);
+            x += w * ex;
+            y += w * ey;
+        }
+        data(q, 0) = x;
+        data(q, 1) = y;
+        data(q, 2) = z(q);
     }
 }
 
 template<class Array>
-void CurveRZFourier<Array>::gammadash_impl(Array& data) {
-    data *= 0;
-    for (int k = 0; k < numquadpoints; ++k) {
-        double phi = 2 * M_PI * quadpoints[k];
-        for (int i = 0; i < order+1; ++i) {
-            data(k, 0) += rc[i] * ( -(i*nfp) * sin(nfp*i*phi) * cos(phi) - cos(nfp*i*phi) * sin(phi));
-            data(k, 1) += rc[i] * ( -(i*nfp) * sin(nfp*i*phi) * sin(phi) + cos(nfp*i*phi) * cos(phi));
-        }
-        for (int i = 1; i < order+1; ++i) {
-            data(k, 2) += zs[i-1] * (nfp*i) * cos(nfp*i*phi);
-        }
+Array CurveRZFourier<Array>::fourier_jvp(int derivative, Array& w) {
+    if(w.size() != std::size_t(num_dofs()))
+        throw std::runtime_error("w needs to have one entry per dof.");
+    Array res = xt::zeros<double>({numquadpoints, 3});
+    fourier_jvp(derivative, w.data(), res);
+    return res;
+}
+
+template<class Array>
+Array CurveRZFourier<Array>::fourier_vjp(int derivative, Array& v) {
+    if(v.size() != std::size_t(3*numquadpoints))
+        throw std::runtime_error("v needs to have shape (numquadpoints, 3).");
+    auto& table = fourier_basis();
+    Eigen::VectorXd v_rc = Eigen::VectorXd::Zero(order+1);
+    Eigen::VectorXd v_rs = Eigen::VectorXd::Zero(order);
+    Eigen::VectorXd u(numquadpoints);
+    for (int k = 0; k <= derivative; ++k) {
+        // project v onto e_R^{[derivative-k]}
+        double weight = rz_binomial_weight(derivative, k);
+        for (int q = 0; q < numquadpoints; ++q) {
+            double ex, ey;
+            rz_unit_vector_derivative(derivative-k, table.cosphi(q), table.sinphi(q), ex, ey);
+            u(q) = weight * (v(q, 0) * ex + v(q, 1) * ey);
+        }
+        v_rc.noalias() += table.cos[k].transpose() * u;
+        if(!stellsym)
+            v_rs.noalias() += table.sin[k].transpose() * u;
     }
-    if(!stellsym){
-        for (int k = 0; k < numquadpoints; ++k) {
-            double phi = 2 * M_PI * quadpoints[k];
-            for (int i = 1; i < order+1; ++i) {
-                data(k, 0) += rs[i-1] * ( (i*nfp) * cos(nfp*i*phi) * cos(phi) - sin(nfp*i*phi) * sin(phi));
-                data(k, 1) += rs[i-1] * ( (i*nfp) * cos(nfp*i*phi) * sin(phi) + sin(nfp*i*phi) * cos(phi));
-            }
-            for (int i = 0; i < order+1; ++i) {
-                data(k, 2) -= zc[i] * (nfp*i) * sin(nfp*i*phi);
-            }
-        }
+    for (int q = 0; q < numquadpoints; ++q)
+        u(q) = v(q, 2);
+    Eigen::VectorXd v_zs = table.sin[derivative].transpose() * u;
+
+    Array res = xt::zeros<double>({num_dofs()});
+    int counter = 0;
+    for (int i = 0; i < order+1; ++i)
+        res(counter++) = v_rc(i);
+    if(!stellsym) {
+        Eigen::VectorXd v_zc = table.cos[derivative].transpose() * u;
+        for (int i = 0; i < order; ++i)
+            res(counter++) = v_rs(i);
+        for (int i = 0; i < order+1; ++i)
+            res(counter++) = v_zc(i);
     }
-    data *= (2*M_PI);
+    for (int i = 0; i < order; ++i)
+        res(counter++) = v_zs(i);
+    return res;
 }
 
 template<class Array>
-void CurveRZFourier<Array>::gammadashdash_impl(Array& data) {
-    data *= 0;
-    for (int k = 0; k < numquadpoints; ++k) {
-        double phi = 2 * M_PI * quadpoints[k];
+void CurveRZFourier<Array>::fourier_jacobian(int derivative, Array& data) {
+    auto& table = fourier_basis();
+    for (int q = 0; q < numquadpoints; ++q) {
+        double ex[4], ey[4];
+        for (int k = 0; k <= derivative; ++k)
+            rz_unit_vector_derivative(derivative-k, table.cosphi(q), table.sinphi(q), ex[k], ey[k]);
+        int counter = 0;
         for (int i = 0; i < order+1; ++i) {
-            data(k, 0) += rc[i] * (+2*(nfp*i)*sin(nfp*i*phi)*sin(phi)-(pow(nfp*i, 2)+1)*cos(nfp*i*phi)*cos(phi));
-            data(k, 1) += rc[i] * (-2*(nfp*i)*sin(nfp*i*phi)*cos(phi)-(pow(nfp*i, 2)+1)*cos(nfp*i*phi)*sin(phi));
-        }
-        for (int i = 1; i < order+1; ++i) {
-            data(k, 2) -= zs[i-1] * pow(nfp*i, 2)*sin(nfp*i*phi);
+            double x = 0., y = 0.;
+            for (int k = 0; k <= derivative; ++k) {
+                double w = rz_binomial_weight(derivative, k) * table.cos[k](q, i);
+                x += w * ex[k];
+                y += w * ey[k];
+            }
+            data(q, 0, counter) = x;
+            data(q, 1, counter) = y;
+            counter++;
         }
-    }
-    if(!stellsym){
-        for (int k = 0; k < numquadpoints; ++k) {
-            double phi = 2 * M_PI * quadpoints[k];
-            for (int i = 1; i < order+1; ++i) {
-                data(k, 0) += rs[i-1] * (-(pow(nfp*i,2)+1)*sin(nfp*i*phi)*cos(phi) - 2*(i*nfp)*cos(nfp*i*phi)*sin(phi));
-                data(k, 1) += rs[i-1] * (-(pow(nfp*i,2)+1)*sin(nfp*i*phi)*sin(phi) + 2*(i*nfp)*cos(nfp*i*phi)*cos(phi));
+        if(!stellsym){
+            for (int i = 0; i < order; ++i) {
+                double x = 0., y = 0.;
+                for (int k = 0; k <= derivative; ++k) {
+                    double w = rz_binomial_weight(derivative, k) * table.sin[k](q, i);
+                    x += w * ex[k];
+                    y += w * ey[k];
+                }
+                data(q, 0, counter) = x;
+                data(q, 1, counter) = y;
+                counter++;
             }
             for (int i = 0; i < order+1; ++i) {
-                data(k, 2) -= zc[i] * pow(nfp*i, 2)*cos(nfp*i*phi);
+                data(q, 2, counter) = table.cos[derivative](q, i);
+                counter++;
             }
         }
+        for (int i = 0; i < order; ++i) {
+            data(q, 2, counter) = table.sin[derivative](q, i);
+            counter++;
+        }
     }
-    data *= 2*M_PI*2*M_PI;
 }
 
+
 template<class Array>
-void CurveRZFourier<Array>::gammadashdashdash_impl(Array& data) {
+void CurveRZFourier<Array>::gamma_impl(Array& data, Array& quadpoints) {
+    if(&quadpoints == &(this->quadpoints)) {
+        auto coeffs = get_dofs();
+        fourier_jvp(0, coeffs.data(), data);
+        return;
+    }
+    int numquadpoints = quadpoints.size();
     data *= 0;
     for (int k = 0; k < numquadpoints; ++k) {
         double phi = 2 * M_PI * quadpoints[k];
         for (int i = 0; i < order+1; ++i) {
-            data(k, 0) += rc[i]*(
-                    +(3*pow(nfp*i, 2) + 1)*cos(nfp*i*phi)*sin(phi)
-                    +(pow(nfp*i, 2) + 3)*(nfp*i)*sin(nfp*i*phi)*cos(phi)
-                    );
-            data(k, 1) += rc[i]*(
-                    +(pow(nfp*i, 2) + 3)*(nfp*i)*sin(nfp*i*phi)*sin(phi)
-                    -(3*pow(nfp*i, 2) + 1)*cos(nfp*i*phi)*cos(phi)
-                    );
+            data(k, 0) += rc[i] * cos(nfp*i*phi) * cos(phi);
+            data(k, 1) += rc[i] * cos(nfp*i*phi) * sin(phi);
         }
         for (int i = 1; i < order+1; ++i) {
-            data(k, 2) -= zs[i-1] * pow(nfp*i, 3) * cos(nfp*i*phi);
+            data(k, 2) += zs[i-1] * sin(nfp*i*phi);
         }
     }
     if(!stellsym){
         for (int k = 0; k < numquadpoints; ++k) {
             double phi = 2 * M_PI * quadpoints[k];
             for (int i = 1; i < order+1; ++i) {
-                data(k, 0) += rs[i-1]*(
-                        -(pow(nfp*i,2)+3) * (nfp*i) * cos(nfp*i*phi)*cos(phi)
-                        +(3*pow(nfp*i,2)+1) * sin(nfp*i*phi)*sin(phi)
-                        );
-                data(k, 1) += rs[i-1]*(
-                        -(pow(nfp*i,2)+3)*(nfp*i)*cos(nfp*i*phi)*sin(phi) 
-                        -(3*pow(nfp*i,2)+1)*sin(nfp*i*phi)*cos(phi) 
-                        );
+                data(k, 0) += rs[i-1] * sin(nfp*i*phi) * cos(phi);
+                data(k, 1) += rs[i-1] * sin(nfp*i*phi) * sin(phi);
             }
             for (int i = 0; i < order+1; ++i) {
-                data(k, 2) += zc[i] * pow(nfp*i, 3) * sin(nfp*i*phi);
+                data(k, 2) += zc[i] * cos(nfp*i*phi);
             }
         }
     }
-    data *= 2*M_PI*2*M_PI*2*M_PI;
+}
+
+template<class Array>
+void CurveRZFourier<Array>::gammadash_impl(Array& data) {
+    auto coeffs = get_dofs();
+    fourier_jvp(1, coeffs.data(), data);
+}
+
+template<class Array>
+void CurveRZFourier<Array>::gammadashdash_impl(Array& data) {
+    auto coeffs = get_dofs();
+    fourier_jvp(2, coeffs.data(), data);
+}
+
+template<class Array>
+void CurveRZFourier<Array>::gammadashdashdash_impl(Array& data) {
+    auto coeffs = get_dofs();
+    fourier_jvp(3, coeffs.data(), data);
 }
 
 template<class Array>
 void CurveRZFourier<Array>::dgamma_by_dcoeff_impl(Array& data) {
-    for (int k = 0; k < numquadpoints; ++k) {
-        double phi = 2 * M_PI * quadpoints[k];
-        int counter = 0;
-        for (int i = 0; i < order+1; ++i) {
-            data(k, 0, counter) = cos(nfp*i*phi) * cos(phi);
-            data(k, 1, counter) = cos(nfp*i*phi) * sin(phi);
-            counter++;
-        }
-        if(!stellsym){
-            for (int i = 1; i < order+1; ++i) {
-                data(k, 0, counter) = sin(nfp*i*phi) * cos(phi);
-                data(k, 1, counter) = sin(nfp*i*phi) * sin(phi);
-                counter++;
-            }
-            for (int i = 0; i < order+1; ++i) {
-                data(k, 2, counter) = cos(nfp*i*phi);
-                counter++;
-            }
-        }
-        for (int i = 1; i < order+1; ++i) {
-            data(k, 2, counter) = sin(nfp*i*phi); counter++;
-        }
-    }
+    fourier_jacobian(0, data);
 }
 
 template<class Array>
 void CurveRZFourier<Array>::dgammadash_by_dcoeff_impl(Array& data) {
-    for (int k = 0; k < numquadpoints; ++k) {
-        double phi = 2 * M_PI * quadpoints[k];
-        int counter = 0;
-        for (int i = 0; i < order+1; ++i) {
-            data(k, 0, counter) = ( -(i*nfp) * sin(nfp*i*phi) * cos(phi) - cos(nfp*i*phi) * sin(phi));
-            data(k, 1, counter) = ( -(i*nfp) * sin(nfp*i*phi) * sin(phi) + cos(nfp*i*phi) * cos(phi));
-            counter++;
-        }
-        if(!stellsym){
-            for (int i = 1; i < order+1; ++i) {
-                data(k, 0, counter) = ( (i*nfp) * cos(nfp*i*phi) * cos(phi) - sin(nfp*i*phi) * sin(phi));
-                data(k, 1, counter) = ( (i*nfp) * cos(nfp*i*phi) * sin(phi) + sin(nfp*i*phi) * cos(phi));
-                counter++;
-            }
-            for (int i = 0; i < order+1; ++i) {
-                data(k, 2, counter) = -(nfp*i) * sin(nfp*i*phi);
-                counter++;
-            }
-        }
-        for (int i = 1; i < order+1; ++i) {
-            data(k, 2, counter) = (nfp*i) * cos(nfp*i*phi);
-            counter++;
-        }
-    }
-    data *= (2*M_PI);
+    fourier_jacobian(1, data);
 }
 
 template<class Array>
 void CurveRZFourier<Array>::dgammadashdash_by_dcoeff_impl(Array& data) {
-    for (int k = 0; k < numquadpoints; ++k) {
-        double phi = 2 * M_PI * quadpoints[k];
-        int counter = 0;
-        for (int i = 0; i < order+1; ++i) {
-            data(k, 0, counter) = (+2*(nfp*i)*sin(nfp*i*phi)*sin(phi)-(pow(nfp*i, 2)+1)*cos(nfp*i*phi)*cos(phi));
-            data(k, 1, counter) = (-2*(nfp*i)*sin(nfp*i*phi)*cos(phi)-(pow(nfp*i, 2)+1)*cos(nfp*i*phi)*sin(phi));
-            counter++;
-        }
-        if(!stellsym){
-            for (int i = 1; i < order+1; ++i) {
-                data(k, 0, counter) = (-(pow(nfp*i,2)+1)*sin(nfp*i*phi)*cos(phi) - 2*(i*nfp)*cos(nfp*i*phi)*sin(phi));
-                data(k, 1, counter) = (-(pow(nfp*i,2)+1)*sin(nfp*i*phi)*sin(phi) + 2*(i*nfp)*cos(nfp*i*phi)*cos(phi));
-                counter++;
-            }
-            for (int i = 0; i < order+1; ++i) {
-                data(k, 2, counter) = -pow(nfp*i, 2)*cos(nfp*i*phi);
-                counter++;
-            }
-        }
-        for (int i = 1; i < order+1; ++i) {
-            data(k, 2, counter) = -pow(nfp*i, 2)*sin(nfp*i*phi);
-            counter++;
-        }
-    }
-    data *= 2*M_PI*2*M_PI;
+    fourier_jacobian(2, data);
 }
 
 template<class Array>
 void CurveRZFourier<Array>::dgammadashdashdash_by_dcoeff_impl(Array& data) {
-    for (int k = 0; k < numquadpoints; ++k) {
-        double phi = 2 * M_PI * quadpoints[k];
-        int counter = 0;
-        for (int i = 0; i < order+1; ++i) {
-            data(k, 0, counter) = (
-                    +(3*pow(nfp*i, 2) + 1)*cos(nfp*i*phi)*sin(phi)
-                    +(pow(nfp*i, 2) + 3)*(nfp*i)*sin(nfp*i*phi)*cos(phi)
-                    );
-            data(k, 1, counter) = (
-                    +(pow(nfp*i, 2) + 3)*(nfp*i)*sin(nfp*i*phi)*sin(phi)
-                    -(3*pow(nfp*i, 2) + 1)*cos(nfp*i*phi)*cos(phi)
-                    );
-            counter++;
-        }
-        if(!stellsym){
-            for (int i = 1; i < order+1; ++i) {
-                data(k, 0, counter) = (
-                        -(pow(nfp*i,2)+3) * (nfp*i) * cos(nfp*i*phi)*cos(phi)
-                        +(3*pow(nfp*i,2)+1) * sin(nfp*i*phi)*sin(phi)
-                        );
-                data(k, 1, counter) = (
-                        -(pow(nfp*i,2)+3)*(nfp*i)*cos(nfp*i*phi)*sin(phi) 
-                        -(3*pow(nfp*i,2)+1)*sin(nfp*i*phi)*cos(phi) 
-                        );
-                counter++;
-            }
-            for (int i = 0; i < order+1; ++i) {
-                data(k, 2, counter) = pow(nfp*i, 3) * sin(nfp*i*phi);
-                counter++;
-            }
-        }
-
-        for (int i = 1; i < order+1; ++i) {
-            data(k, 2, counter) = -pow(nfp*i, 3) * cos(nfp*i*phi);
-            counter++;
-        }
-    }
-    data *= 2*M_PI*2*M_PI*2*M_PI;
+    fourier_jacobian(3, data);
 }
 
 #include "xtensor-python/pyarray.hpp"     // Numpy bindings
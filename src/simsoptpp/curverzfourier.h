@@ -1,6 +1,7 @@
 #pragma once
 
 #include "curve.h"
+#include "curvefourierbasis.h"
 
 template<class Array>
 class CurveRZFourier : public Curve<Array> {
@@ -20,7 +21,35 @@ class CurveRZFourier : public Curve<Array> {
        or in the stellsym = true case they are stored 
 
            [r_{c,0},...,r_{c,order},z_{s,1},...,z_{s,order}]
+
+       As for CurveXYZFourier, Jacobian-vector and vector-Jacobian products are
+       computed against a FourierBasisTable that is shared between all curves
+       with the same quadrature points, order and nfp. The k-th derivative of
+       the curve is assembled from the derivatives of r(phi) via
+
+           d^k/dt^k (r e_R) = \sum_{l=0}^{k} binom(k, l) r^{(l)} (2*pi)^{k-l} e_R^{[k-l]}
+
+       where e_R^{[m]} is the m-th derivative of e_R = (cos(phi), sin(phi), 0)
+       with respect to phi = 2*pi*t.
        */
+    private:
+        shared_ptr<const FourierBasisTable> basis;
+
+        // Built by the constructors, so that several threads can evaluate
+        // the same curve.
+        const FourierBasisTable& fourier_basis() const {
+            return *basis;
+        }
+
+        void build_fourier_basis() {
+            basis = FourierBasisTable::get(this->quadpoints.data(), this->numquadpoints, this->order, this->nfp);
+        }
+
+        void fourier_jvp(int derivative, const double* coeffs, Array& data);
+        Array fourier_vjp(int derivative, Array& v);
+        Array fourier_jvp(int derivative, Array& w);
+        void fourier_jacobian(int derivative, Array& data);
+
     public:
         const int order;
         const int nfp;
@@ -39,6 +68,7 @@ class CurveRZFourier : public Curve<Array> {
             rs = xt::zeros<double>({order});
             zc = xt::zeros<double>({order + 1});
             zs = xt::zeros<double>({order});
+            build_fourier_basis();
         }
 
         CurveRZFourier(vector<double> _quadpoints, int _order, int _nfp, bool _stellsym) : Curve<Array>(_quadpoints), order(_order), nfp(_nfp), stellsym(_stellsym) {
@@ -46,6 +76,7 @@ class CurveRZFourier : public Curve<Array> {
             rs = xt::zeros<double>({order});
             zc = xt::zeros<double>({order + 1});
             zs = xt::zeros<double>({order});
+            build_fourier_basis();
         }
 
         CurveRZFourier(Array _quadpoints, int _order, int _nfp, bool _stellsym) : Curve<Array>(_quadpoints), order(_order), nfp(_nfp), stellsym(_stellsym) {
@@ -53,6 +84,7 @@ class CurveRZFourier : public Curve<Array> {
             rs = xt::zeros<double>({order});
             zc = xt::zeros<double>({order + 1});
             zs = xt::zeros<double>({order});
+            build_fourier_basis();
         }
 
         inline int num_dofs() override {
@@ -124,4 +156,14 @@ class CurveRZFourier : public Curve<Array> {
         void dgammadashdash_by_dcoeff_impl(Array& data) override;
         void dgammadashdashdash_by_dcoeff_impl(Array& data) override;
 
+        Array dgamma_by_dcoeff_vjp_impl(Array& v) override { return fourier_vjp(0, v); }
+        Array dgammadash_by_dcoeff_vjp_impl(Array& v) override { return fourier_vjp(1, v); }
+        Array dgammadashdash_by_dcoeff_vjp_impl(Array& v) override { return fourier_vjp(2, v); }
+        Array dgammadashdashdash_by_dcoeff_vjp_impl(Array& v) override { return fourier_vjp(3, v); }
+
+        Array dgamma_by_dcoeff_jvp_impl(Array& w) override { return fourier_jvp(0, w); }
+        Array dgammadash_by_dcoeff_jvp_impl(Array& w) override { return fourier_jvp(1, w); }
+        Array dgammadashdash_by_dcoeff_jvp_impl(Array& w) override { return fourier_jvp(2, w); }
+        Array dgammadashdashdash_by_dcoeff_jvp_impl(Array& w) override { return fourier_jvp(3, w); }
+
 };
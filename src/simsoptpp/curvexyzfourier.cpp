@@ -1,106 +1,122 @@
 #include "curvexyzfourier.h"
 
 template<class Array>
-void CurveXYZFourier<Array>::gamma_impl(Array& data, Array& quadpoints) {
-    int numquadpoints = quadpoints.size();
-    data *= 0;
-    for (int k = 0; k < numquadpoints; ++k) {
-        for (int i = 0; i < 3; ++i) {
-            data(k, i) += dofs[i][0];
-            for (int j = 1; j < order+1; ++j) {
-                data(k, i) += dofs[i][2*j-1]*sin(2*M_PI*j*quadpoints[k]);
-                data(k, i) += dofs[i][2*j]*cos(2*M_PI*j*quadpoints[k]);
-            }
+void CurveXYZFourier<Array>::fourier_jvp(int derivative, const double* coeffs, Array& data) {
+    auto& table = fourier_basis();
+    RowMatrixXd coeffs_cos(order+1, 3);
+    RowMatrixXd coeffs_sin(order, 3);
+    for (int i = 0; i < 3; ++i) {
+        const double* coeffs_i = coeffs + i*(2*order+1);
+        coeffs_cos(0, i) = coeffs_i[0];
+        for (int j = 1; j < order+1; ++j) {
+            coeffs_sin(j-1, i) = coeffs_i[2*j-1];
+            coeffs_cos(j, i) = coeffs_i[2*j];
         }
     }
+    Eigen::Map<RowMatrixXd> eigen_data(data.data(), numquadpoints, 3);
+    eigen_data.noalias() = table.cos[derivative] * coeffs_cos;
+    eigen_data.noalias() += table.sin[derivative] * coeffs_sin;
 }
 
 template<class Array>
-void CurveXYZFourier<Array>::gammadash_impl(Array& data) {
-    data *= 0;
-    for (int k = 0; k < numquadpoints; ++k) {
-        for (int i = 0; i < 3; ++i) {
-            for (int j = 1; j < order+1; ++j) {
-                data(k, i) += +dofs[i][2*j-1]*2*M_PI*j*cos(2*M_PI*j*quadpoints[k]);
-                data(k, i) += -dofs[i][2*j]*2*M_PI*j*sin(2*M_PI*j*quadpoints[k]);
-            }
+Array CurveXYZFourier<Array>::fourier_jvp(int derivative, Array& w) {
+    if(w.size() != std::size_t(num_dofs()))
+        throw std::runtime_error("w needs to have one entry per dof.");
+    Array res = xt::zeros<double>({numquadpoints, 3});
+    fourier_jvp(derivative, w.data(), res);
+    return res;
+}
+
+template<class Array>
+Array CurveXYZFourier<Array>::fourier_vjp(int derivative, Array& v) {
+    if(v.size() != std::size_t(3*numquadpoints))
+        throw std::runtime_error("v needs to have shape (numquadpoints, 3).");
+    auto& table = fourier_basis();
+    Eigen::Map<RowMatrixXd> eigen_v(const_cast<double*>(v.data()), numquadpoints, 3);
+    RowMatrixXd v_cos = table.cos[derivative].transpose() * eigen_v;
+    RowMatrixXd v_sin = table.sin[derivative].transpose() * eigen_v;
+    Array res = xt::zeros<double>({num_dofs()});
+    for (int i = 0; i < 3; ++i) {
+        double* res_i = &(res(i*(2*order+1)));
+        res_i[0] = v_cos(0, i);
+        for (int j = 1; j < order+1; ++j) {
+            res_i[2*j-1] = v_sin(j-1, i);
+            res_i[2*j] = v_cos(j, i);
         }
     }
+    return res;
 }
 
 template<class Array>
-void CurveXYZFourier<Array>::gammadashdash_impl(Array& data) {
-    data *= 0;
+void CurveXYZFourier<Array>::fourier_jacobian(int derivative, Array& data) {
+    auto& table = fourier_basis();
     for (int k = 0; k < numquadpoints; ++k) {
         for (int i = 0; i < 3; ++i) {
+            data(k, i, i*(2*order+1)) = table.cos[derivative](k, 0);
             for (int j = 1; j < order+1; ++j) {
-                data(k, i) += -dofs[i][2*j-1] * (2*M_PI*j)*(2*M_PI*j)*sin(2*M_PI*j*quadpoints[k]);
-                data(k, i) += -dofs[i][2*j]   * (2*M_PI*j)*(2*M_PI*j)*cos(2*M_PI*j*quadpoints[k]);
+                data(k, i, i*(2*order+1) + 2*j-1) = table.sin[derivative](k, j-1);
+                data(k, i, i*(2*order+1) + 2*j  ) = table.cos[derivative](k, j);
             }
         }
     }
 }
 
 template<class Array>
-void CurveXYZFourier<Array>::gammadashdashdash_impl(Array& data) {
+void CurveXYZFourier<Array>::gamma_impl(Array& data, Array& quadpoints) {
+    if(&quadpoints == &(this->quadpoints)) {
+        auto coeffs = get_dofs();
+        fourier_jvp(0, coeffs.data(), data);
+        return;
+    }
+    int numquadpoints = quadpoints.size();
     data *= 0;
     for (int k = 0; k < numquadpoints; ++k) {
         for (int i = 0; i < 3; ++i) {
+            data(k, i) += dofs[i][0];
             for (int j = 1; j < order+1; ++j) {
-                data(k, i) += -dofs[i][2*j-1] * (2*M_PI*j)*(2*M_PI*j)*(2*M_PI*j)*cos(2*M_PI*j*quadpoints[k]);
-                data(k, i) += +dofs[i][2*j]   * (2*M_PI*j)*(2*M_PI*j)*(2*M_PI*j)*sin(2*M_PI*j*quadpoints[k]);
+                data(k, i) += dofs[i][2*j-1]*sin(2*M_PI*j*quadpoints[k]);
+                data(k, i) += dofs[i][2*j]*cos(2*M_PI*j*quadpoints[k]);
             }
         }
     }
 }
 
+template<class Array>
+void CurveXYZFourier<Array>::gammadash_impl(Array& data) {
+    auto coeffs = get_dofs();
+    fourier_jvp(1, coeffs.data(), data);
+}
+
+template<class Array>
+void CurveXYZFourier<Array>::gammadashdash_impl(Array& data) {
+    auto coeffs = get_dofs();
+    fourier_jvp(2, coeffs.data(), data);
+}
+
+template<class Array>
+void CurveXYZFourier<Array>::gammadashdashdash_impl(Array& data) {
+    auto coeffs = get_dofs();
+    fourier_jvp(3, coeffs.data(), data);
+}
+
 template<class Array>
 void CurveXYZFourier<Array>::dgamma_by_dcoeff_impl(Array& data) {
-    for (int k = 0; k < numquadpoints; ++k) {
-        for (int i = 0; i < 3; ++i) {
-            data(k, i, i*(2*order+1)) = 1.;
-            for (int j = 1; j < order+1; ++j) {
-                data(k, i, i*(2*order+1) + 2*j-1) = sin(2*M_PI*j*quadpoints[k]);
-                data(k, i, i*(2*order+1) + 2*j  ) = cos(2*M_PI*j*quadpoints[k]);
-            }
-        }
-    }
+    fourier_jacobian(0, data);
 }
 
 template<class Array>
 void CurveXYZFourier<Array>::dgammadash_by_dcoeff_impl(Array& data) {
-    for (int k = 0; k < numquadpoints; ++k) {
-        for (int i = 0; i < 3; ++i) {
-            for (int j = 1; j < order+1; ++j) {
-                data(k, i, i*(2*order+1) + 2*j-1) = +2*M_PI*j*cos(2*M_PI*j*quadpoints[k]);
-                data(k, i, i*(2*order+1) + 2*j  ) = -2*M_PI*j*sin(2*M_PI*j*quadpoints[k]);
-            }
-        }
-    }
+    fourier_jacobian(1, data);
 }
 
 template<class Array>
 void CurveXYZFourier<Array>::dgammadashdash_by_dcoeff_impl(Array& data) {
-    for (int k = 0; k < numquadpoints; ++k) {
-        for (int i = 0; i < 3; ++i) {
-            for (int j = 1; j < order+1; ++j) {
-                data(k, i, i*(2*order+1) + 2*j-1) = -(2*M_PI*j)*(2*M_PI*j)*sin(2*M_PI*j*quadpoints[k]);
-                data(k, i, i*(2*order+1) + 2*j  ) = -(2*M_PI*j)*(2*M_PI*j)*cos(2*M_PI*j*quadpoints[k]);
-            }
-        }
-    }
+    fourier_jacobian(2, data);
 }
 
 template<class Array>
 void CurveXYZFourier<Array>::dgammadashdashdash_by_dcoeff_impl(Array& data) {
-    for (int k = 0; k < numquadpoints; ++k) {
-        for (int i = 0; i < 3; ++i) {
-            for (int j = 1; j < order+1; ++j) {
-                data(k, i, i*(2*order+1) + 2*j-1) = -(2*M_PI*j)*(2*M_PI*j)*(2*M_PI*j)*cos(2*M_PI*j*quadpoints[k]);
-                data(k, i, i*(2*order+1) + 2*j  ) = +(2*M_PI*j)*(2*M_PI*j)*(2*M_PI*j)*sin(2*M_PI*j*quadpoints[k]);
-            }
-        }
-    }
+    fourier_jacobian(3, data);
 }
 
 #include "xtensor-python/pyarray.hpp"     // Numpy bindings
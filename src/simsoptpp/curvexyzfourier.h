@@ -1,6 +1,7 @@
 #pragma once
 
 #include "curve.h"
+#include "curvefourierbasis.h"
 
 template<class Array>
 class CurveXYZFourier : public Curve<Array> {
@@ -16,7 +17,34 @@ class CurveXYZFourier : public Curve<Array> {
 
            [x_{c,0},x_{s,1},x_{c,1},...,x_{s,order},x_{c,order},y_{c,0},y_{s,1},y_{c,1},...]
 
+       The Jacobians with respect to the dofs only contain the Fourier basis,
+       which is stored in a FourierBasisTable that is shared between all curves
+       with the same quadrature points and order. Vector-Jacobian and
+       Jacobian-vector products are computed as small matrix products against
+       that table, so that the dense (numquadpoints, 3, num_dofs) Jacobians
+       are only created when they are explicitly requested.
        */
+    private:
+        shared_ptr<const FourierBasisTable> basis;
+
+        // Built by the constructors, so that several threads can evaluate
+        // the same curve.
+        const FourierBasisTable& fourier_basis() const {
+            return *basis;
+        }
+
+        void build_fourier_basis() {
+            basis = FourierBasisTable::get(this->quadpoints.data(), this->numquadpoints, this->order, 1);
+        }
+
+        // Evaluates the `derivative`-th derivative of the curve with Fourier
+        // coefficients `coeffs` (in the same order as the dofs) at the
+        // quadrature points, i.e. contracts the Jacobian with `coeffs`.
+        void fourier_jvp(int derivative, const double* coeffs, Array& data);
+        Array fourier_vjp(int derivative, Array& v);
+        Array fourier_jvp(int derivative, Array& w);
+        void fourier_jacobian(int derivative, Array& data);
+
     public:
         using Curve<Array>::quadpoints;
         using Curve<Array>::numquadpoints;
@@ -30,6 +58,7 @@ class CurveXYZFourier : public Curve<Array> {
                 vector<double>(2*order+1, 0.), 
                 vector<double>(2*order+1, 0.)
             };
+            build_fourier_basis();
         }
 
         CurveXYZFourier(vector<double> _quadpoints, int _order) : Curve<Array>(_quadpoints), order(_order) {
@@ -38,6 +67,7 @@ class CurveXYZFourier : public Curve<Array> {
                 vector<double>(2*order+1, 0.), 
                 vector<double>(2*order+1, 0.)
             };
+            build_fourier_basis();
         }
 
         CurveXYZFourier(Array _quadpoints, int _order) : Curve<Array>(_quadpoints), order(_order) {
@@ -46,6 +76,7 @@ class CurveXYZFourier : public Curve<Array> {
                 vector<double>(2*order+1, 0.), 
                 vector<double>(2*order+1, 0.)
             };
+            build_fourier_basis();
         }
 
         inline int num_dofs() override {
@@ -97,6 +128,14 @@ class CurveXYZFourier : public Curve<Array> {
         void dgammadash_by_dcoeff_impl(Array& data) override;
         void dgammadashdash_by_dcoeff_impl(Array& data) override;
         void dgammadashdashdash_by_dcoeff_impl(Array& data) override;
-        //Array dgamma_by_dcoeff_vjp_impl(Array& v) override;
-        //Array dgammadash_by_dcoeff_vjp_impl(Array& v) override;
+
+        Array dgamma_by_dcoeff_vjp_impl(Array& v) override { return fourier_vjp(0, v); }
+        Array dgammadash_by_dcoeff_vjp_impl(Array& v) override { return fourier_vjp(1, v); }
+        Array dgammadashdash_by_dcoeff_vjp_impl(Array& v) override { return fourier_vjp(2, v); }
+        Array dgammadashdashdash_by_dcoeff_vjp_impl(Array& v) override { return fourier_vjp(3, v); }
+
+        Array dgamma_by_dcoeff_jvp_impl(Array& w) override { return fourier_jvp(0, w); }
+        Array dgammadash_by_dcoeff_jvp_impl(Array& w) override { return fourier_jvp(1, w); }
+        Array dgammadashdash_by_dcoeff_jvp_impl(Array& w) override { return fourier_jvp(2, w); }
+        Array dgammadashdashdash_by_dcoeff_jvp_impl(Array& w) override { return fourier_jvp(3, w); }
 };
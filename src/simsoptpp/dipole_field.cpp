@@ -1,9 +1,17 @@
 #include "dipole_field.h"
 #include "simdhelpers.h"
 #include "vec3dsimd.h"
+#include "pygil.h"
+#include "threads.h"
+#include <algorithm>
 #include <cmath>
 #include <Eigen/Dense>
 
+static void check_output_shape(Array& out, std::vector<size_t> shape, const std::string& name) {
+    if(out.dimension() != shape.size() || !std::equal(shape.begin(), shape.end(), out.shape().begin()))
+        throw std::runtime_error(name + " has wrong shape.");
+}
+
 #if defined(USE_XSIMD)
 // Calculate the B field at a set of evaluation points from N dipoles:
 // B = mu0 / (4 * pi) sum_{i=1}^N 3(m_i * r_i)r_i / |r_i|^5 - m_i / |r_i|^3
@@ -13,7 +21,7 @@
 // everything in xyz coordinates
 // r_i = points - m_points
 // m_i = m
-Array dipole_field_B(Array& points, Array& m_points, Array& m) {
+void dipole_field_B_out(Array& points, Array& m_points, Array& m, Array& B) {
     // warning: row_major checks below do NOT throw an error correctly on a compute node on Cori
     if(points.layout() != xt::layout_type::row_major)
           throw std::runtime_error("points needs to be in row-major storage order");
@@ -25,13 +33,14 @@ Array dipole_field_B(Array& points, Array& m_points, Array& m) {
     int num_points = points.shape(0);
     int num_dipoles = m_points.shape(0);
     constexpr int simd_size = xsimd::simd_type<double>::size;
-    Array B = xt::zeros<double>({points.shape(0), points.shape(1)});
+    check_output_shape(B, {points.shape(0), 3}, "B");
    
     // initialize pointers to the beginning of m and the dipole grid
     double* m_points_ptr = &(m_points(0, 0));
     double* m_ptr = &(m(0, 0));
     double fak = 1e-7;  // mu0 divided by 4 * pi factor
 
+    ScopedGILRelease gil;
     // Loop through the evaluation points by chunks of simd_size
     #pragma omp parallel for schedule(static)
     for(int i = 0; i < num_points; i += simd_size) {
@@ -65,11 +74,10 @@ Array dipole_field_B(Array& points, Array& m_points, Array& m) {
                 B(i + k, 2) = fak * B_i.z[k];
             }
     }
-    return B;
 }
 
 // A = mu0 / (4 * pi) sum_{i=1}^N m_i x r_i / |r_i|^3
-Array dipole_field_A(Array& points, Array& m_points, Array& m) {
+void dipole_field_A_out(Array& points, Array& m_points, Array& m, Array& A) {
     // warning: row_major checks below do NOT throw an error correctly on a compute node on Cori
     if(points.layout() != xt::layout_type::row_major)
           throw std::runtime_error("points needs to be in row-major storage order");
@@ -81,13 +89,14 @@ Array dipole_field_A(Array& points, Array& m_points, Array& m) {
     int num_points = points.shape(0);
     int num_dipoles = m_points.shape(0);
     constexpr int simd_size = xsimd::simd_type<double>::size;
-    Array A = xt::zeros<double>({points.shape(0), points.shape(1)});
+    check_output_shape(A, {points.shape(0), 3}, "A");
    
     // initialize pointers to the beginning of m and the dipole grid
     double* m_points_ptr = &(m_points(0, 0));
     double* m_ptr = &(m(0, 0));
     double fak = 1e-7;  // mu0 divided by 4 * pi factor
 
+    ScopedGILRelease gil;
     // Loop through the evaluation points by chunks of simd_size
     #pragma omp parallel for schedule(static)
     for(int i = 0; i < num_points; i += simd_size) {
@@ -119,7 +128,6 @@ Array dipole_field_A(Array& points, Array& m_points, Array& m) {
             A(i + k, 2) = fak * A_i.z[k];
         }
     }
-    return A;
 }
 
 // For each dipole i:
@@ -130,7 +138,7 @@ Array dipole_field_A(Array& points, Array& m_points, Array& m) {
 //    - 15 (m_l * r_l) * (r_j * r_k) / |r|^7
 // ]
 // where here the indices on m, r, and B denote the spatial components.
-Array dipole_field_dB(Array& points, Array& m_points, Array& m) {
+void dipole_field_dB_out(Array& points, Array& m_points, Array& m, Array& dB) {
     // warning: row_major checks below do NOT throw an error correctly on a compute node on Cori
     if(points.layout() != xt::layout_type::row_major)
           throw std::runtime_error("points needs to be in row-major storage order");
@@ -142,11 +150,12 @@ Array dipole_field_dB(Array& points, Array& m_points, Array& m) {
     int num_points = points.shape(0);
     int num_dipoles = m_points.shape(0);
     constexpr int simd_size = xsimd::simd_type<double>::size;
-    Array dB = xt::zeros<double>({points.shape(0), points.shape(1), points.shape(1)});
+    check_output_shape(dB, {points.shape(0), 3, 3}, "dB");
     double* m_points_ptr = &(m_points(0, 0));
     double* m_ptr = &(m(0, 0));
     double fak = 1e-7;
     
+    ScopedGILRelease gil;
     #pragma omp parallel for schedule(static)
     for(int i = 0; i < num_points; i += simd_size) {
         auto point_i = Vec3dSimd();
@@ -187,7 +196,6 @@ Array dipole_field_dB(Array& points, Array& m_points, Array& m) {
             dB(i + k, 2, 1) = dB(i + k, 1, 2);
         }
     }
-    return dB;
 }
 
 // For each dipole i:
@@ -198,7 +206,7 @@ Array dipole_field_dB(Array& points, Array& m_points, Array& m) {
 // ]
 // where here the indices on m, r, and A denote the spatial components,
 // eps_jlk is the Levi-Civita symbol, and the cross product is taken in 3D.
-Array dipole_field_dA(Array& points, Array& m_points, Array& m) {
+void dipole_field_dA_out(Array& points, Array& m_points, Array& m, Array& dA) {
     // warning: row_major checks below do NOT throw an error correctly on a compute node on Cori
     if(points.layout() != xt::layout_type::row_major)
           throw std::runtime_error("points needs to be in row-major storage order");
@@ -210,11 +218,12 @@ Array dipole_field_dA(Array& points, Array& m_points, Array& m) {
     int num_points = points.shape(0);
     int num_dipoles = m_points.shape(0);
     constexpr int simd_size = xsimd::simd_type<double>::size;
-    Array dA = xt::zeros<double>({points.shape(0), points.shape(1), points.shape(1)});
+    check_output_shape(dA, {points.shape(0), 3, 3}, "dA");
     double* m_points_ptr = &(m_points(0, 0));
     double* m_ptr = &(m(0, 0));
     double fak = 1e-7;
     
+    ScopedGILRelease gil;
     #pragma omp parallel for schedule(static)
     for(int i = 0; i < num_points; i += simd_size) {
         auto point_i = Vec3dSimd();
@@ -258,7 +267,6 @@ Array dipole_field_dA(Array& points, Array& m_points, Array& m) {
             dA(i + k, 2, 2) = fak * dA_i3.z[k];
 	}
     }
-    return dA;
 }
 
 // Calculate the geometric factor A needed for the permanent magnet optimization
@@ -289,7 +297,9 @@ Array dipole_field_Bn(Array& points, Array& m_points, Array& unitnormal, int nfp
     int num_points = points.shape(0);
     int num_dipoles = m_points.shape(0);
     constexpr int simd_size = xsimd::simd_type<double>::size;
-    Array A = xt::zeros<double>({num_points, num_dipoles, 3});
+    Array A = Array::from_shape({std::size_t(num_points), std::size_t(num_dipoles), 3});
+    // first touch with the schedule of the loop below, see threads.h
+    threads::parallel_zero(A.data(), num_points, 3*num_dipoles, simd_size);
 
     std::string cylindrical_str = "cylindrical";
     std::string toroidal_str = "toroidal";
@@ -298,6 +308,7 @@ Array dipole_field_Bn(Array& points, Array& m_points, Array& unitnormal, int nfp
     double* m_points_ptr = &(m_points(0, 0));
     double fak = 1e-7;  // mu0 divided by 4 * pi factor
 
+    ScopedGILRelease gil;
     // Loop through the evaluation points by chunks of simd_size
     #pragma omp parallel for schedule(static)
     for(int i = 0; i < num_points; i += simd_size) {
@@ -378,6 +389,7 @@ Array dipole_field_Bn(Array& points, Array& m_points, Array& unitnormal, int nfp
             }
         }
     }
+    gil.reacquire();
     return A;
 }
 
@@ -390,7 +402,7 @@ Array dipole_field_Bn(Array& points, Array& m_points, Array& unitnormal, int nfp
 // everything in xyz coordinates
 // r_i = points - m_points
 // m_i = m
-Array dipole_field_B(Array& points, Array& m_points, Array& m) {
+void dipole_field_B_out(Array& points, Array& m_points, Array& m, Array& B) {
     // warning: row_major checks below do NOT throw an error correctly on a compute node on Cori
     if(points.layout() != xt::layout_type::row_major)
           throw std::runtime_error("points needs to be in row-major storage order");
@@ -401,13 +413,14 @@ Array dipole_field_B(Array& points, Array& m_points, Array& m) {
 
     int num_points = points.shape(0);
     int num_dipoles = m_points.shape(0);
-    Array B = xt::zeros<double>({points.shape(0), points.shape(1)});
+    check_output_shape(B, {points.shape(0), 3}, "B");
 
     // initialize pointers to the beginning of m and the dipole grid
     double* m_points_ptr = &(m_points(0, 0));
     double* m_ptr = &(m(0, 0));
     double fak = 1e-7;  // mu0 divided by 4 * pi factor
 
+    ScopedGILRelease gil;
     // Loop through the evaluation points by chunks of simd_size
     #pragma omp parallel for schedule(static)
     for(int i = 0; i < num_points; i++) {
@@ -435,11 +448,10 @@ Array dipole_field_B(Array& points, Array& m_points, Array& m) {
             B(i, 1) = fak * B_i.y;
             B(i, 2) = fak * B_i.z;
     }
-    return B;
 }
 
 // A = mu0 / (4 * pi) sum_{i=1}^N m_i x r_i / |r_i|^3
-Array dipole_field_A(Array& points, Array& m_points, Array& m) {
+void dipole_field_A_out(Array& points, Array& m_points, Array& m, Array& A) {
     // warning: row_major checks below do NOT throw an error correctly on a compute node on Cori
     if(points.layout() != xt::layout_type::row_major)
           throw std::runtime_error("points needs to be in row-major storage order");
@@ -450,13 +462,14 @@ Array dipole_field_A(Array& points, Array& m_points, Array& m) {
 
     int num_points = points.shape(0);
     int num_dipoles = m_points.shape(0);
-    Array A = xt::zeros<double>({points.shape(0), points.shape(1)});
+    check_output_shape(A, {points.shape(0), 3}, "A");
 
     // initialize pointers to the beginning of m and the dipole grid
     double* m_points_ptr = &(m_points(0, 0));
     double* m_ptr = &(m(0, 0));
     double fak = 1e-7;  // mu0 divided by 4 * pi factor
 
+    ScopedGILRelease gil;
     // Loop through the evaluation points by chunks of simd_size
     #pragma omp parallel for schedule(static)
     for(int i = 0; i < num_points; i++) {
@@ -482,7 +495,6 @@ Array dipole_field_A(Array& points, Array& m_points, Array& m) {
         A(i, 1) = fak * A_i.y;
         A(i, 2) = fak * A_i.z;
     }
-    return A;
 }
 
 // For each dipole i:
@@ -493,7 +505,7 @@ Array dipole_field_A(Array& points, Array& m_points, Array& m) {
 //    - 15 (m_l * r_l) * (r_j * r_k) / |r|^7
 // ]
 // where here the indices on m, r, and B denote the spatial components.
-Array dipole_field_dB(Array& points, Array& m_points, Array& m) {
+void dipole_field_dB_out(Array& points, Array& m_points, Array& m, Array& dB) {
     // warning: row_major checks below do NOT throw an error correctly on a compute node on Cori
     if(points.layout() != xt::layout_type::row_major)
           throw std::runtime_error("points needs to be in row-major storage order");
@@ -504,11 +516,12 @@ Array dipole_field_dB(Array& points, Array& m_points, Array& m) {
 
     int num_points = points.shape(0);
     int num_dipoles = m_points.shape(0);
-    Array dB = xt::zeros<double>({points.shape(0), points.shape(1), points.shape(1)});
+    check_output_shape(dB, {points.shape(0), 3, 3}, "dB");
     double* m_points_ptr = &(m_points(0, 0));
     double* m_ptr = &(m(0, 0));
     double fak = 1e-7;
 
+    ScopedGILRelease gil;
     #pragma omp parallel for schedule(static)
     for(int i = 0; i < num_points; i++) {
         auto point_i = Vec3dStd();
@@ -544,7 +557,6 @@ Array dipole_field_dB(Array& points, Array& m_points, Array& m) {
         dB(i, 2, 0) = dB(i, 0, 2);
         dB(i, 2, 1) = dB(i, 1, 2);
     }
-    return dB;
 }
 
 // For each dipole i:
@@ -555,7 +567,7 @@ Array dipole_field_dB(Array& points, Array& m_points, Array& m) {
 // ]
 // where here the indices on m, r, and A denote the spatial components,
 // eps_jlk is the Levi-Civita symbol, and the cross product is taken in 3D.
-Array dipole_field_dA(Array& points, Array& m_points, Array& m) {
+void dipole_field_dA_out(Array& points, Array& m_points, Array& m, Array& dA) {
     // warning: row_major checks below do NOT throw an error correctly on a compute node on Cori
     if(points.layout() != xt::layout_type::row_major)
           throw std::runtime_error("points needs to be in row-major storage order");
@@ -566,11 +578,12 @@ Array dipole_field_dA(Array& points, Array& m_points, Array& m) {
 
     int num_points = points.shape(0);
     int num_dipoles = m_points.shape(0);
-    Array dA = xt::zeros<double>({points.shape(0), points.shape(1), points.shape(1)});
+    check_output_shape(dA, {points.shape(0), 3, 3}, "dA");
     double* m_points_ptr = &(m_points(0, 0));
     double* m_ptr = &(m(0, 0));
     double fak = 1e-7;
 
+    ScopedGILRelease gil;
     #pragma omp parallel for schedule(static)
     for(int i = 0; i < num_points; i++) {
         auto point_i = Vec3dStd();
@@ -609,7 +622,6 @@ Array dipole_field_dA(Array& points, Array& m_points, Array& m) {
         dA(i, 2, 1) = fak * dA_i3.y;
         dA(i, 2, 2) = fak * dA_i3.z;
     }
-    return dA;
 }
 
 
@@ -640,7 +652,9 @@ Array dipole_field_Bn(Array& points, Array& m_points, Array& unitnormal, int nfp
     
     int num_points = points.shape(0);
     int num_dipoles = m_points.shape(0);
-    Array A = xt::zeros<double>({num_points, num_dipoles, 3});
+    Array A = Array::from_shape({std::size_t(num_points), std::size_t(num_dipoles), 3});
+    // first touch with the schedule of the loop below, see threads.h
+    threads::parallel_zero(A.data(), num_points, 3*num_dipoles);
   
     std::string cylindrical_str = "cylindrical"; 
     std::string toroidal_str = "toroidal"; 
@@ -649,6 +663,7 @@ Array dipole_field_Bn(Array& points, Array& m_points, Array& unitnormal, int nfp
     double* m_points_ptr = &(m_points(0, 0));
     double fak = 1e-7;  // mu0 divided by 4 * pi factor
 
+    ScopedGILRelease gil;
     // Loop through the evaluation points by chunks of simd_size
     #pragma omp parallel for schedule(static)
     for(int i = 0; i < num_points; i++) {
@@ -724,11 +739,42 @@ Array dipole_field_Bn(Array& points, Array& m_points, Array& unitnormal, int nfp
             }
         }
     }
+    gil.reacquire();
     return A;
 }
 
 #endif
 
+// The dipole fields above write into a preallocated output, which can be
+// reused between calls. These versions allocate the output.
+Array dipole_field_B(Array& points, Array& m_points, Array& m) {
+    int num_points = points.shape(0);
+    Array B = xt::zeros<double>({num_points, 3});
+    dipole_field_B_out(points, m_points, m, B);
+    return B;
+}
+
+Array dipole_field_A(Array& points, Array& m_points, Array& m) {
+    int num_points = points.shape(0);
+    Array A = xt::zeros<double>({num_points, 3});
+    dipole_field_A_out(points, m_points, m, A);
+    return A;
+}
+
+Array dipole_field_dB(Array& points, Array& m_points, Array& m) {
+    int num_points = points.shape(0);
+    Array dB = xt::zeros<double>({num_points, 3, 3});
+    dipole_field_dB_out(points, m_points, m, dB);
+    return dB;
+}
+
+Array dipole_field_dA(Array& points, Array& m_points, Array& m) {
+    int num_points = points.shape(0);
+    Array dA = xt::zeros<double>({num_points, 3, 3});
+    dipole_field_dA_out(points, m_points, m, dA);
+    return dA;
+}
+
 // Takes a uniform CARTESIAN grid of dipoles, and loops through
 // and creates a final set of points which lie between the
 // inner and outer toroidal surfaces defined by extending the plasma
@@ -15,6 +15,16 @@ Array dipole_field_dB(Array& points, Array& m_points, Array& m);
 
 Array dipole_field_dA(Array& points, Array& m_points, Array& m);
 
+// Variants that write the field into the preallocated output B, A, dB or dA
+// of shape (npoints, 3) or (npoints, 3, 3), so that no memory is allocated.
+void dipole_field_B_out(Array& points, Array& m_points, Array& m, Array& B);
+
+void dipole_field_A_out(Array& points, Array& m_points, Array& m, Array& A);
+
+void dipole_field_dB_out(Array& points, Array& m_points, Array& m, Array& dB);
+
+void dipole_field_dA_out(Array& points, Array& m_points, Array& m, Array& dA);
+
 Array dipole_field_Bn(Array& points, Array& m_points, Array& unitnormal, int nfp, int stellsym, Array& b, std::string coordinate_flag="cartesian", double R0=0.0);
 
 std::tuple<Array, Array> define_a_uniform_cylindrical_grid_between_two_toroidal_surfaces(Array& phi, Array& normal_inner, Array& normal_outer, Array& dipole_grid_rz, Array& r_inner, Array& r_outer, Array& z_inner, Array& z_outer);
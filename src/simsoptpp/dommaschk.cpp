@@ -471,22 +471,20 @@ Array DommaschkB(Array& mArray, Array& nArray, Array& coeffs, Array& points){
     int num_points = points.shape(0);
     int num_coeffs = coeffs.shape(0);
     Array B        = xt::zeros<double>({coeffs.shape(0), points.shape(0), points.shape(1)});
-    double x,y,z,R,phi,cosphi,sinphi,coeff1,coeff2;
-    int m,n;
     for (int j=0; j < num_coeffs; ++j) {
-        m      = mArray(j);
-        n      = nArray(j);
-        coeff1 = coeffs(j,0);
-        coeff2 = coeffs(j,1);
+        int m         = mArray(j);
+        int n         = nArray(j);
+        double coeff1 = coeffs(j,0);
+        double coeff2 = coeffs(j,1);
         #pragma omp parallel for
         for (int i = 0; i < num_points; ++i) {
-            x    = points(i, 0);
-            y    = points(i, 1);
-            z    = points(i, 2);
-            R    = sqrt(x*x+y*y);
-            phi  = atan2(y,x);
-            cosphi = x/R;
-            sinphi = y/R;
+            double x      = points(i, 0);
+            double y      = points(i, 1);
+            double z      = points(i, 2);
+            double R      = sqrt(x*x+y*y);
+            double phi    = atan2(y,x);
+            double cosphi = x/R;
+            double sinphi = y/R;
             B(j,i,0) = BR(m,n,R,z,phi,coeff1,coeff2)*cosphi-Bphi(m,n,R,z,phi,coeff1,coeff2)*sinphi;
             B(j,i,1) = BR(m,n,R,z,phi,coeff1,coeff2)*sinphi+Bphi(m,n,R,z,phi,coeff1,coeff2)*cosphi;
             B(j,i,2) = BZ(m,n,R,z,phi,coeff1,coeff2);
@@ -499,22 +497,20 @@ Array DommaschkdB(Array& mArray, Array& nArray, Array& coeffs, Array& points){
     int num_points = points.shape(0);
     int num_coeffs = coeffs.shape(0);
     Array dB       = xt::zeros<double>({coeffs.shape(0), points.shape(0), points.shape(1), points.shape(1)});
-    double x,y,z,R,phi,cosphi,sinphi,coeff1,coeff2;
-    int m,n;
     for (int j=0; j < num_coeffs; ++j) {
-        m      = mArray(j);
-        n      = nArray(j);
-        coeff1 = coeffs(j,0);
-        coeff2 = coeffs(j,1);
+        int m         = mArray(j);
+        int n         = nArray(j);
+        double coeff1 = coeffs(j,0);
+        double coeff2 = coeffs(j,1);
         #pragma omp parallel for
         for (int i = 0; i < num_points; ++i) {
-            x    = points(i, 0);
-            y    = points(i, 1);
-            z    = points(i, 2);
-            R    = sqrt(x*x+y*y);
-            phi  = atan2(y,x);
-            cosphi = x/R;
-            sinphi = y/R;
+            double x      = points(i, 0);
+            double y      = points(i, 1);
+            double z      = points(i, 2);
+            double R      = sqrt(x*x+y*y);
+            double phi    = atan2(y,x);
+            double cosphi = x/R;
+            double sinphi = y/R;
             dB(j,i,0,0) = dRBR(m,n,R,z,phi,coeff1,coeff2)*cosphi*cosphi-(dphiBR(m,n,R,z,phi,coeff1,coeff2)-Bphi(m,n,R,z,phi,coeff1,coeff2)+dRBphi(m,n,R,z,phi,coeff1,coeff2)*R)*cosphi*sinphi/R+sinphi*sinphi*(dphiBphi(m,n,R,z,phi,coeff1,coeff2)+BR(m,n,R,z,phi,coeff1,coeff2))/R;
             dB(j,i,0,1) = sinphi*cosphi*(dRBR(m,n,R,z,phi,coeff1,coeff2)*R-dphiBphi(m,n,R,z,phi,coeff1,coeff2)-BR(m,n,R,z,phi,coeff1,coeff2))/R+sinphi*sinphi*(Bphi(m,n,R,z,phi,coeff1,coeff2)-dphiBR(m,n,R,z,phi,coeff1,coeff2))/R+cosphi*cosphi*dRBphi(m,n,R,z,phi,coeff1,coeff2);
             dB(j,i,0,2) = dRBZ(m,n,R,z,phi,coeff1,coeff2)*cosphi-dphiBZ(m,n,R,z,phi,coeff1,coeff2)*sinphi/R;
@@ -528,3 +524,211 @@ Array DommaschkdB(Array& mArray, Array& nArray, Array& coeffs, Array& points){
     }
     return dB;
 }
+
+#include "simdhelpers.h"
+#include <algorithm>
+
+// Expands sum_k Z^(n-2k)/(n-2k)! sum_j [...] of D_mn (if N == false) or N_mn
+// (if N == true) into its terms (a + b*log(R)) * R^rexp * Z^zexp. This mirrors
+// the sums in Dmn and Nmn above.
+static vector<DommaschkTerm> dommaschk_terms(int m, int n, bool N) {
+    vector<DommaschkTerm> terms;
+    if(n < 0)
+        return terms;
+    for (int k = 0; k <= n/2; ++k) {
+        double zfac = 1./tgamma(n-2*k+1);
+        for (int j = 0; j < k+1; ++j) {
+            double a, b, c;
+            if(!N) {
+                a = -(alpha(m,j)*(gammas(m,k-m-j)-alpha(m,k-m-j))-gamma1(m,j)*alphas(m,k-m-j)+alpha(m,j)*betas(m,k-j));
+                b = -alpha(m,j)*alphas(m,k-m-j);
+                c = alphas(m,k-j)*beta(m,j);
+            } else {
+                a = alpha(m,j)*gamma1(m,k-m-j)-gamma1(m,j)*alpha(m,k-m-j)+alpha(m,j)*beta(m,k-j);
+                b = alpha(m,j)*alpha(m,k-m-j);
+                c = -alpha(m,k-j)*beta(m,j);
+            }
+            if(a != 0 || b != 0)
+                terms.push_back({2*j+m, n-2*k, zfac*a, zfac*b});
+            if(c != 0)
+                terms.push_back({2*j-m, n-2*k, zfac*c, 0.});
+        }
+    }
+    return terms;
+}
+
+// Evaluates a polynomial given by `terms` and its derivatives
+//   P = [P, P_R, P_Z, P_RR, P_RZ, P_ZZ].
+// The powers of R are stored with an offset, i.e. R^p = rpow[p].
+template<class S>
+static inline void dommaschk_polynomial(const vector<DommaschkTerm>& terms, const S* rpow, const S* zpow, const S& logR, S (&P)[6]) {
+    for (int l = 0; l < 6; ++l)
+        P[l] = S(0.);
+    for (const auto& t : terms) {
+        const int p = t.rexp;
+        const int e = t.zexp;
+        S v = t.b == 0 ? S(t.a) : S(t.a) + t.b * logR;
+        S vR = double(p) * v + t.b;
+        S ze = zpow[e];
+        S ze1 = e > 0 ? zpow[e-1] : S(0.);
+        S ze2 = e > 1 ? zpow[e-2] : S(0.);
+        P[0] += v * rpow[p] * ze;
+        P[1] += vR * rpow[p-1] * ze;
+        P[2] += double(e) * v * rpow[p] * ze1;
+        P[3] += (double(p*(p-1)) * v + double(2*p-1) * t.b) * rpow[p-2] * ze;
+        P[4] += double(e) * vR * rpow[p-1] * ze1;
+        P[5] += double(e*(e-1)) * v * rpow[p] * ze2;
+    }
+}
+
+// Computes B and grad B at a point (or a simd block of points) from the sum of
+// the derivatives of the potential over all modes. `work` needs to hold
+// nmax + 2*mmax + 3 + nmax + 1 + 2*(mmax + 1) entries.
+template<class S>
+static inline void dommaschk_kernel(const vector<DommaschkMode>& modes, int mmax, int nmax, const S& x, const S& y, const S& z, S* work, S (&B)[3], S (&dB)[3][3]) {
+    using std::sqrt;
+    using std::log;
+    S R = sqrt(x*x + y*y);
+    S rinv = S(1.)/R;
+    S logR = log(R);
+    S c1 = x*rinv;
+    S s1 = y*rinv;
+
+    // R^p for p = -mmax-2, ..., nmax+mmax
+    S* rpow = work + mmax + 2;
+    rpow[0] = S(1.);
+    for (int p = 1; p <= nmax + mmax; ++p)
+        rpow[p] = rpow[p-1] * R;
+    for (int p = -1; p >= -mmax-2; --p)
+        rpow[p] = rpow[p+1] * rinv;
+    S* zpow = work + nmax + 2*mmax + 3;
+    zpow[0] = S(1.);
+    for (int e = 1; e <= nmax; ++e)
+        zpow[e] = zpow[e-1] * z;
+    // cos(m*phi) and sin(m*phi) by repeated rotation
+    S* cosm = zpow + nmax + 1;
+    S* sinm = cosm + mmax + 1;
+    cosm[0] = S(1.);
+    sinm[0] = S(0.);
+    for (int m = 1; m <= mmax; ++m) {
+        cosm[m] = cosm[m-1] * c1 - sinm[m-1] * s1;
+        sinm[m] = sinm[m-1] * c1 + cosm[m-1] * s1;
+    }
+
+    // derivatives of the potential, the toroidal field corresponds to Phi = phi
+    S Phi_R(0.), Phi_phi(1.), Phi_Z(0.), Phi_RR(0.), Phi_Rphi(0.), Phi_RZ(0.), Phi_phiphi(0.), Phi_phiZ(0.), Phi_ZZ(0.);
+    S D[6], N[6];
+    for (const auto& mode : modes) {
+        const int m = mode.m;
+        dommaschk_polynomial(mode.D, rpow, zpow, logR, D);
+        dommaschk_polynomial(mode.N, rpow, zpow, logR, N);
+        S f = mode.cD * cosm[m] + mode.sD * sinm[m];
+        S g = mode.cN * cosm[m] + mode.sN * sinm[m];
+        S fp = double(m) * (mode.sD * cosm[m] - mode.cD * sinm[m]);
+        S gp = double(m) * (mode.sN * cosm[m] - mode.cN * sinm[m]);
+        Phi_R      += f * D[1] + g * N[1];
+        Phi_phi    += fp * D[0] + gp * N[0];
+        Phi_Z      += f * D[2] + g * N[2];
+        Phi_RR     += f * D[3] + g * N[3];
+        Phi_Rphi   += fp * D[1] + gp * N[1];
+        Phi_RZ     += f * D[4] + g * N[4];
+        Phi_phiphi -= double(m*m) * (f * D[0] + g * N[0]);
+        Phi_phiZ   += fp * D[2] + gp * N[2];
+        Phi_ZZ     += f * D[5] + g * N[5];
+    }
+
+    // B = grad(Phi) in cylindrical coordinates and its derivatives
+    S BR = Phi_R;
+    S Bphi = Phi_phi * rinv;
+    S BZ = Phi_Z;
+    S dR_BR = Phi_RR, dphi_BR = Phi_Rphi, dZ_BR = Phi_RZ;
+    S dR_Bphi = (Phi_Rphi - Bphi) * rinv, dphi_Bphi = Phi_phiphi * rinv, dZ_Bphi = Phi_phiZ * rinv;
+    S dR_BZ = Phi_RZ, dphi_BZ = Phi_phiZ, dZ_BZ = Phi_ZZ;
+
+    B[0] = BR * c1 - Bphi * s1;
+    B[1] = BR * s1 + Bphi * c1;
+    B[2] = BZ;
+
+    // derivatives of the cartesian components along R, phi and Z
+    S dR[3]   = {dR_BR * c1 - dR_Bphi * s1, dR_BR * s1 + dR_Bphi * c1, dR_BZ};
+    S dphi[3] = {(dphi_BR - Bphi) * c1 - (BR + dphi_Bphi) * s1, (dphi_BR - Bphi) * s1 + (BR + dphi_Bphi) * c1, dphi_BZ};
+    S dZ[3]   = {dZ_BR * c1 - dZ_Bphi * s1, dZ_BR * s1 + dZ_Bphi * c1, dZ_BZ};
+    for (int l = 0; l < 3; ++l) {
+        dB[0][l] = c1 * dR[l] - s1 * rinv * dphi[l];
+        dB[1][l] = s1 * dR[l] + c1 * rinv * dphi[l];
+        dB[2][l] = dZ[l];
+    }
+}
+
+template<template<class, std::size_t, xt::layout_type> class T>
+DommaschkField<T>::DommaschkField(vector<int> m, vector<int> n, vector<vector<double>> coeffs) :
+    MagneticField<T>(), m(m), n(n), coeffs(coeffs) {
+    if(m.size() != n.size() || coeffs.size() != m.size())
+        throw std::runtime_error("m, n and coeffs need to have the same length.");
+    for (int j = 0; j < m.size(); ++j) {
+        if(coeffs[j].size() != 2)
+            throw std::runtime_error("coeffs needs to have two entries per mode.");
+        if(m[j] < 0 || n[j] < 0)
+            throw std::runtime_error("m and n need to be nonnegative.");
+        DommaschkMode mode;
+        mode.m = m[j];
+        if(n[j] % 2 == 0) {
+            mode.cD = 0.;
+            mode.sD = coeffs[j][0];
+            mode.cN = coeffs[j][1];
+            mode.sN = 0.;
+        } else {
+            mode.cD = coeffs[j][0];
+            mode.sD = 0.;
+            mode.cN = 0.;
+            mode.sN = coeffs[j][1];
+        }
+        mode.D = dommaschk_terms(m[j], n[j], false);
+        mode.N = dommaschk_terms(m[j], n[j]-1, true);
+        modes.push_back(mode);
+        mmax = std::max(mmax, m[j]);
+        nmax = std::max(nmax, n[j]);
+    }
+}
+
+template<template<class, std::size_t, xt::layout_type> class T>
+void DommaschkField<T>::compute(Tensor2* B, Tensor3* dB) {
+    Tensor2& points = this->get_points_cart_ref();
+#if defined(USE_XSIMD)
+    using S = simd_t;
+    constexpr int simd_size = xsimd::simd_type<double>::size;
+#else
+    using S = double;
+    constexpr int simd_size = 1;
+#endif
+    int worksize = 2*nmax + 4*mmax + 6;
+    double* points_ptr = &(points(0, 0));
+    double* B_ptr = B ? &((*B)(0, 0)) : nullptr;
+    double* dB_ptr = dB ? &((*dB)(0, 0, 0)) : nullptr;
+    int num_points = npoints;
+#pragma omp parallel
+    {
+        vector<S> work(worksize);
+        double xbuf[simd_size], ybuf[simd_size], zbuf[simd_size];
+#pragma omp for
+        for (int i = 0; i < num_points; i += simd_size) {
+            S x, y, z;
+            int klimit = load_points_padded<simd_size>(points_ptr, num_points, i, xbuf, ybuf, zbuf, x, y, z);
+            S B_i[3], dB_i[3][3];
+            dommaschk_kernel(modes, mmax, nmax, x, y, z, work.data(), B_i, dB_i);
+            if(B_ptr) {
+                for (int l = 0; l < 3; ++l)
+                    store_lanes_strided<simd_size>(B_ptr + 3*i + l, 3, klimit, B_i[l]);
+            }
+            if(dB_ptr) {
+                for (int j = 0; j < 3; ++j) {
+                    for (int l = 0; l < 3; ++l)
+                        store_lanes_strided<simd_size>(dB_ptr + 9*i + 3*j + l, 9, klimit, dB_i[j][l]);
+                }
+            }
+        }
+    }
+}
+
+#include "xtensor-python/pytensor.hpp"     // Numpy bindings
+template class DommaschkField<xt::pytensor>;
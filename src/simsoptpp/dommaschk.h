@@ -1,5 +1,83 @@
+#pragma once
+
+#include <vector>
 #include "xtensor-python/pyarray.hpp"
+#include "magneticfield.h"
 typedef xt::pyarray<double> Array;
+using std::vector;
 
 Array DommaschkB(Array& mArray, Array& nArray, Array& coeffs, Array& points);
 Array DommaschkdB(Array& mArray, Array& nArray, Array& coeffs, Array& points);
+
+// A single term (a + b*log(R)) * R^rexp * Z^zexp of the polynomials D_mn and
+// N_mn. The factor 1/zexp! is included in a and b.
+struct DommaschkTerm {
+    int rexp, zexp;
+    double a, b;
+};
+
+// One harmonic of the Dommaschk potential
+//
+//   (cD*cos(m*phi) + sD*sin(m*phi)) * D_mn(R, Z) + (cN*cos(m*phi) + sN*sin(m*phi)) * N_m(n-1)(R, Z).
+struct DommaschkMode {
+    int m;
+    double cD, sD, cN, sN;
+    vector<DommaschkTerm> D, N;
+};
+
+template<template<class, std::size_t, xt::layout_type> class T>
+class DommaschkField : public MagneticField<T> {
+    /*
+     * Vacuum field given by the scalar potential of W. Dommaschk (1986),
+     * Computer Physics Communications 40, 203-218, plus the toroidal field
+     * 1/R e_phi, i.e. B = grad(phi + sum_modes Phi_mn).
+     *
+     * This is the same field as the one given by `DommaschkB` and
+     * `DommaschkdB`, but
+     *  - the polynomials D_mn and N_mn are expanded into their terms once in
+     *    the constructor,
+     *  - all terms and their derivatives are evaluated once per point and
+     *    shared between all components of B and grad B,
+     *  - the sum over the coefficients is accumulated directly,
+     *  - cos(m*phi) and sin(m*phi) are obtained by recurrence from x/R and
+     *    y/R, so no trigonometric functions are evaluated,
+     *  - points are processed in blocks of the simd width.
+     */
+    public:
+        using typename MagneticField<T>::Tensor2;
+        using typename MagneticField<T>::Tensor3;
+        using MagneticField<T>::npoints;
+
+    private:
+        vector<DommaschkMode> modes;
+        int mmax = 0;
+        int nmax = 0;
+
+        // Evaluates the potential derivatives at the points and writes B
+        // and, if derivs > 0, grad B.
+        void compute(Tensor2* B, Tensor3* dB);
+
+    protected:
+        // The kernel computes B and grad B together, so both are stored in
+        // one pass, unless the other one is in the cache already.
+        void _B_impl(Tensor2& B) override {
+            if(this->data_dB.get_status())
+                compute(&B, nullptr);
+            else
+                compute(&B, &this->data_dB.get_or_create({npoints, 3, 3}));
+        }
+
+        void _dB_by_dX_impl(Tensor3& dB_by_dX) override {
+            if(this->data_B.get_status())
+                compute(nullptr, &dB_by_dX);
+            else
+                compute(&this->data_B.get_or_create({npoints, 3}), &dB_by_dX);
+        }
+
+    public:
+        const vector<int> m;
+        const vector<int> n;
+        const vector<vector<double>> coeffs;
+
+        DommaschkField(vector<int> m, vector<int> n, vector<vector<double>> coeffs);
+};
@@ -0,0 +1,145 @@
+#include "fluxobjective.h"
+#include "threads.h"
+#include <cmath>
+#include <stdexcept>
+
+template<template<class, std::size_t, xt::layout_type> class T, class Array>
+SquaredFlux<T, Array>::SquaredFlux(shared_ptr<Surface<Array>> surface, shared_ptr<MagneticField<T>> field, vector<double> Btarget, bool local) :
+    surface(surface), field(field), local(local), Btarget(Btarget) {
+    if(!surface || !field)
+        throw std::runtime_error("SquaredFlux needs a surface and a field.");
+    npoints = surface->numquadpoints_phi * surface->numquadpoints_theta;
+    if(Btarget.size() != 0 && (int)Btarget.size() != npoints)
+        throw std::runtime_error("Btarget needs to have one value per quadrature point of the surface.");
+    points = xt::zeros<double>({npoints, 3});
+    dJ_by_dB_buffer = xt::zeros<double>({npoints, 3});
+    int nphi = surface->numquadpoints_phi;
+    int ntheta = surface->numquadpoints_theta;
+    BdotN_buffer = xt::zeros<double>({nphi, ntheta});
+    dJ_by_dN = xt::zeros<double>({nphi, ntheta, 3});
+    dJ_by_dX = xt::zeros<double>({nphi, ntheta, 3});
+    update_points();
+}
+
+template<template<class, std::size_t, xt::layout_type> class T, class Array>
+void SquaredFlux<T, Array>::update_points() {
+    Array& gamma = surface->gamma();
+    const double* gamma_ptr = gamma.data();
+    double* points_ptr = points.data();
+    bool changed = false;
+    for (int i = 0; i < 3*npoints; ++i) {
+        if(points_ptr[i] != gamma_ptr[i]) {
+            points_ptr[i] = gamma_ptr[i];
+            changed = true;
+        }
+    }
+    // the points of the field may also have been changed elsewhere
+    Tensor2& field_points = field->get_points_cart_ref();
+    if(!changed && (int)field_points.shape(0) == npoints) {
+        const double* field_points_ptr = field_points.data();
+        for (int i = 0; i < 3*npoints; ++i) {
+            if(field_points_ptr[i] != points_ptr[i]) {
+                changed = true;
+                break;
+            }
+        }
+    } else {
+        changed = true;
+    }
+    if(changed)
+        field->set_points_cart(points);
+}
+
+template<template<class, std::size_t, xt::layout_type> class T, class Array>
+double SquaredFlux<T, Array>::evaluate(int derivatives) {
+    update_points();
+    const double* n_ptr = surface->normal().data();
+    // request grad B first, since fields like BiotSavart compute B along with it
+    const double* dB_ptr = derivatives > 1 ? field->dB_by_dX_ref().data() : nullptr;
+    const double* B_ptr = field->B_ref().data();
+    const double* Btarget_ptr = Btarget.size() > 0 ? Btarget.data() : nullptr;
+    double* BdotN_ptr = BdotN_buffer.data();
+
+    auto totals = threads::parallel_sum<2>(npoints, [&](int i, double* sums) {
+        const double* n = n_ptr + 3*i;
+        const double* B = B_ptr + 3*i;
+        double normN = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        double BdotN = (B[0]*n[0] + B[1]*n[1] + B[2]*n[2])/normN;
+        BdotN_ptr[i] = BdotN;
+        double Bn = Btarget_ptr ? BdotN - Btarget_ptr[i] : BdotN;
+        double modB2 = B[0]*B[0] + B[1]*B[1] + B[2]*B[2];
+        if(local) {
+            sums[0] += Bn*Bn/modB2*normN;
+        } else {
+            sums[0] += Bn*Bn*normN;
+            sums[1] += modB2*normN;
+        }
+    });
+    double numerator_sum = totals[0];
+    double denominator_sum = totals[1];
+    double J = local ? 0.5*numerator_sum/npoints : numerator_sum/denominator_sum;
+    if(derivatives == 0)
+        return J;
+
+    double* dJ_by_dB_ptr = dJ_by_dB_buffer.data();
+    double* dJ_by_dN_ptr = dJ_by_dN.data();
+    double* dJ_by_dX_ptr = dJ_by_dX.data();
+#pragma omp parallel for
+    for (int i = 0; i < npoints; ++i) {
+        const double* n = n_ptr + 3*i;
+        const double* B = B_ptr + 3*i;
+        double normN = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        double unitn[3] = {n[0]/normN, n[1]/normN, n[2]/normN};
+        double BdotN = BdotN_ptr[i];
+        double Bn = Btarget_ptr ? BdotN - Btarget_ptr[i] : BdotN;
+        double modB2 = B[0]*B[0] + B[1]*B[1] + B[2]*B[2];
+        // J = sum_i f_i(B_i, n_i) with
+        //   local:     f = Bn^2 |n|/|B|^2 / (2M)
+        //   otherwise: f = (Bn^2 |n| - J |B|^2 |n|) / sum |B|^2 |n| (at fixed J)
+        // and dBn/dB = n/|n|, dBn/dn = (B - (B.n/|n|) n/|n|)/|n|.
+        double cn, cB, cnN, cBN;
+        if(local) {
+            double w = 1./(npoints*modB2);
+            cn = w*Bn*normN;
+            cB = -w*Bn*Bn*normN/modB2;
+            cBN = w*Bn;
+            cnN = w*(0.5*Bn*Bn - Bn*BdotN);
+        } else {
+            double w = 1./denominator_sum;
+            cn = 2*w*Bn*normN;
+            cB = -2*w*J*normN;
+            cBN = 2*w*Bn;
+            cnN = w*(Bn*Bn - 2*Bn*BdotN - J*modB2);
+        }
+        double* dJdB = dJ_by_dB_ptr + 3*i;
+        for (int l = 0; l < 3; ++l)
+            dJdB[l] = cn*unitn[l] + cB*B[l];
+        if(derivatives < 2)
+            continue;
+        double* dJdN = dJ_by_dN_ptr + 3*i;
+        double* dJdX = dJ_by_dX_ptr + 3*i;
+        const double* dB = dB_ptr + 9*i;
+        for (int l = 0; l < 3; ++l) {
+            dJdN[l] = cBN*B[l] + cnN*unitn[l];
+            // dB[j, l] = dB_l/dx_j
+            dJdX[l] = dB[3*l + 0]*dJdB[0] + dB[3*l + 1]*dJdB[1] + dB[3*l + 2]*dJdB[2];
+        }
+    }
+    return J;
+}
+
+template<template<class, std::size_t, xt::layout_type> class T, class Array>
+Array& SquaredFlux<T, Array>::BdotN() {
+    evaluate(0);
+    return BdotN_buffer;
+}
+
+template<template<class, std::size_t, xt::layout_type> class T, class Array>
+Array SquaredFlux<T, Array>::dJ_by_dsurfacecoefficients() {
+    evaluate(2);
+    return surface->dnormal_by_dcoeff_vjp(dJ_by_dN) + surface->dgamma_by_dcoeff_vjp(dJ_by_dX);
+}
+
+#include "xtensor-python/pyarray.hpp"     // Numpy bindings
+#include "xtensor-python/pytensor.hpp"     // Numpy bindings
+template class SquaredFlux<xt::pytensor, xt::pyarray<double>>;
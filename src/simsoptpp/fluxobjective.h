@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include "magneticfield.h"
+#include "surface.h"
+
+using std::vector;
+using std::shared_ptr;
+
+template<template<class, std::size_t, xt::layout_type> class T, class Array>
+class SquaredFlux {
+    /*
+     * The squared flux of a magnetic field through a surface. With n the
+     * (non unit) normal of the surface at the quadrature points, Bn = B.n/|n|
+     * - Btarget and M the number of quadrature points, this is either
+     *
+     *   J = 1/(2M) sum Bn^2 |n| / |B|^2                  (local = true), or
+     *   J = (sum Bn^2 |n|) / (sum |B|^2 |n|)             (local = false).
+     *
+     * The field is evaluated at the quadrature points of the surface; the
+     * points are updated whenever the surface has moved. J, the derivative
+     * of J wrt the field at the quadrature points, and the derivative of J
+     * wrt the surface dofs are computed in a single pass over the points,
+     * directly from the caches of the surface and the field. The derivative
+     * wrt B is kept in a buffer owned by this object, which is reused across
+     * calls and can be passed to `B_vjp` of the field to obtain the
+     * derivative wrt the coil dofs.
+     */
+    public:
+        using Tensor2 = typename MagneticField<T>::Tensor2;
+        const shared_ptr<Surface<Array>> surface;
+        const shared_ptr<MagneticField<T>> field;
+        const bool local;
+
+    private:
+        vector<double> Btarget;
+        int npoints;
+        Tensor2 points;
+        Tensor2 dJ_by_dB_buffer;
+        Array BdotN_buffer;
+        Array dJ_by_dN, dJ_by_dX;
+
+        // Sets the points of the field to the quadrature points of the
+        // surface, if they are not already.
+        void update_points();
+
+        // Computes J and, if derivatives > 0, the derivative wrt B, and if
+        // derivatives > 1, the derivatives wrt the normal and the position of
+        // the quadrature points.
+        double evaluate(int derivatives);
+
+    public:
+        SquaredFlux(shared_ptr<Surface<Array>> surface, shared_ptr<MagneticField<T>> field, vector<double> Btarget, bool local);
+
+        double J() { return evaluate(0); }
+
+        // Returns B.n/|n| at the quadrature points as a (nphi, ntheta) array.
+        Array& BdotN();
+
+        // Returns the `(npoints, 3)` derivative of J wrt B at the quadrature
+        // points. The array is overwritten by the next call.
+        Tensor2& dJ_by_dB() {
+            evaluate(1);
+            return dJ_by_dB_buffer;
+        }
+
+        // Returns the derivative of J wrt the dofs of the surface, for fixed
+        // coils.
+        Array dJ_by_dsurfacecoefficients();
+};
@@ -0,0 +1,207 @@
+#include "gauss_integrals.h"
+#include "simdhelpers.h"
+#include "vec3dsimd.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <tuple>
+
+// Structure-of-arrays copy of a curve. The vectors are padded with zeros to a
+// full multiple of the simd width, so that the kernels below can always load
+// full simd vectors. Since dgamma_by_dphi is zero on the padded entries, these
+// do not contribute to any of the integrals.
+struct GaussCurve {
+    int num_quad_points;
+    int num_padded_points;
+    AlignedPaddedVec x, y, z, dx, dy, dz;
+    double lower[3];
+    double upper[3];
+};
+
+static GaussCurve gauss_curve(Array& gamma, Array& gammadash){
+    if(gamma.layout() != xt::layout_type::row_major)
+          throw std::runtime_error("gamma needs to be in row-major storage order");
+    if(gammadash.layout() != xt::layout_type::row_major)
+          throw std::runtime_error("gammadash needs to be in row-major storage order");
+    if(gamma.dimension() != 2 || gamma.shape(1) != 3)
+        throw std::runtime_error("gamma has wrong shape.");
+    if(gammadash.shape(0) != gamma.shape(0) || gammadash.shape(1) != 3)
+        throw std::runtime_error("gammadash has wrong shape.");
+#if defined(USE_XSIMD)
+    constexpr int simd_size = xsimd::simd_type<double>::size;
+#else
+    constexpr int simd_size = 1;
+#endif
+    GaussCurve c;
+    c.num_quad_points = gamma.shape(0);
+    c.num_padded_points = ((c.num_quad_points + simd_size - 1)/simd_size)*simd_size;
+    c.x  = AlignedPaddedVec(c.num_padded_points, 0.);
+    c.y  = AlignedPaddedVec(c.num_padded_points, 0.);
+    c.z  = AlignedPaddedVec(c.num_padded_points, 0.);
+    c.dx = AlignedPaddedVec(c.num_padded_points, 0.);
+    c.dy = AlignedPaddedVec(c.num_padded_points, 0.);
+    c.dz = AlignedPaddedVec(c.num_padded_points, 0.);
+    double* gamma_ptr = &(gamma(0, 0));
+    double* gammadash_ptr = &(gammadash(0, 0));
+    for (int d = 0; d < 3; ++d) {
+        c.lower[d] = gamma_ptr[d];
+        c.upper[d] = gamma_ptr[d];
+    }
+    for (int i = 0; i < c.num_quad_points; ++i) {
+        c.x[i]  = gamma_ptr[3*i+0];
+        c.y[i]  = gamma_ptr[3*i+1];
+        c.z[i]  = gamma_ptr[3*i+2];
+        c.dx[i] = gammadash_ptr[3*i+0];
+        c.dy[i] = gammadash_ptr[3*i+1];
+        c.dz[i] = gammadash_ptr[3*i+2];
+        for (int d = 0; d < 3; ++d) {
+            c.lower[d] = std::min(c.lower[d], gamma_ptr[3*i+d]);
+            c.upper[d] = std::max(c.upper[d], gamma_ptr[3*i+d]);
+        }
+    }
+    return c;
+}
+
+// Two closed curves whose axis aligned bounding boxes do not overlap are
+// separated by a plane and hence cannot be linked.
+static bool bounding_boxes_disjoint(const GaussCurve& c1, const GaussCurve& c2){
+    for (int d = 0; d < 3; ++d) {
+        if(c1.upper[d] < c2.lower[d] || c2.upper[d] < c1.lower[d])
+            return true;
+    }
+    return false;
+}
+
+// Computes the unweighted double sums
+//
+//   link    = \sum_i \sum_j (r1_i - r2_j) . (r1'_i x r2'_j) / |r1_i - r2_j|^3
+//   neumann = \sum_i \sum_j r1'_i . r2'_j / |r1_i - r2_j|
+//
+// for the pair (c1, c2). Terms with r1_i = r2_j are skipped; for the writhe
+// (c1 == c2) this corresponds to the diagonal i = j, on which the integrand of
+// the linking integral has the limit zero.
+template<bool link, bool neumann>
+void gauss_pair_kernel(GaussCurve& c1, GaussCurve& c2, double& link_sum, double& neumann_sum){
+    link_sum = 0.;
+    neumann_sum = 0.;
+#if defined(USE_XSIMD)
+    constexpr int simd_size = xsimd::simd_type<double>::size;
+    simd_t link_acc(0.);
+    simd_t neumann_acc(0.);
+    for (int i = 0; i < c1.num_quad_points; ++i) {
+        auto r1 = Vec3dSimd(c1.x[i], c1.y[i], c1.z[i]);
+        auto dr1 = Vec3dSimd(c1.dx[i], c1.dy[i], c1.dz[i]);
+        for (int j = 0; j < c2.num_padded_points; j += simd_size) {
+            auto r2 = Vec3dSimd(&(c2.x[j]), &(c2.y[j]), &(c2.z[j]));
+            auto dr2 = Vec3dSimd(&(c2.dx[j]), &(c2.dy[j]), &(c2.dz[j]));
+            auto diff = r1 - r2;
+            simd_t norm_diff_2 = normsq(diff);
+            simd_t norm_diff_inv = xsimd::select(norm_diff_2 > simd_t(0.), rsqrt(norm_diff_2), simd_t(0.));
+            if constexpr(link) {
+                auto dr1_cross_dr2 = cross(dr1, dr2);
+                simd_t norm_diff_3_inv = norm_diff_inv*norm_diff_inv*norm_diff_inv;
+                link_acc = xsimd::fma(inner(diff, dr1_cross_dr2), norm_diff_3_inv, link_acc);
+            }
+            if constexpr(neumann) {
+                neumann_acc = xsimd::fma(inner(dr1, dr2), norm_diff_inv, neumann_acc);
+            }
+        }
+    }
+    for (int k = 0; k < simd_size; ++k) {
+        link_sum += link_acc[k];
+        neumann_sum += neumann_acc[k];
+    }
+#else
+    for (int i = 0; i < c1.num_quad_points; ++i) {
+        auto r1 = Vec3dStd(c1.x[i], c1.y[i], c1.z[i]);
+        auto dr1 = Vec3dStd(c1.dx[i], c1.dy[i], c1.dz[i]);
+        for (int j = 0; j < c2.num_quad_points; ++j) {
+            auto r2 = Vec3dStd(c2.x[j], c2.y[j], c2.z[j]);
+            auto dr2 = Vec3dStd(c2.dx[j], c2.dy[j], c2.dz[j]);
+            auto diff = r1 - r2;
+            double norm_diff_2 = normsq(diff);
+            if(norm_diff_2 == 0.)
+                continue;
+            double norm_diff_inv = rsqrt(norm_diff_2);
+            if constexpr(link) {
+                auto dr1_cross_dr2 = cross(dr1, dr2);
+                link_sum += inner(diff, dr1_cross_dr2) * norm_diff_inv*norm_diff_inv*norm_diff_inv;
+            }
+            if constexpr(neumann) {
+                neumann_sum += inner(dr1, dr2) * norm_diff_inv;
+            }
+        }
+    }
+#endif
+}
+
+double gauss_linking_number(Array& gamma1, Array& gammadash1, Array& gamma2, Array& gammadash2) {
+    auto c1 = gauss_curve(gamma1, gammadash1);
+    auto c2 = gauss_curve(gamma2, gammadash2);
+    double link_sum, neumann_sum;
+    gauss_pair_kernel<true, false>(c1, c2, link_sum, neumann_sum);
+    return link_sum/(4*M_PI*c1.num_quad_points*c2.num_quad_points);
+}
+
+double gauss_writhe(Array& gamma, Array& gammadash) {
+    auto c = gauss_curve(gamma, gammadash);
+    double link_sum, neumann_sum;
+    gauss_pair_kernel<true, false>(c, c, link_sum, neumann_sum);
+    return link_sum/(4*M_PI*c.num_quad_points*c.num_quad_points);
+}
+
+// Evaluates the integral selected by `link`/`neumann` for all pairs i < j of
+// curves. The pairs are distributed over threads dynamically, since the cost
+// per pair varies with the number of quadrature points and the bounding box
+// test.
+template<bool link, bool neumann>
+Array gauss_pair_matrix(vector<Array>& gammas, vector<Array>& gammadashs, bool bounding_box_check) {
+    int num_curves = gammas.size();
+    if(gammadashs.size() != num_curves)
+        throw std::runtime_error("gammas and gammadashs need to have the same length.");
+    // Creating new xtensor arrays from an openmp thread doesn't appear
+    // to be safe. so we do that here in serial.
+    Array res = xt::zeros<double>({num_curves, num_curves});
+    if(num_curves == 0)
+        return res;
+    vector<GaussCurve> curves;
+    curves.reserve(num_curves);
+    for (int i = 0; i < num_curves; ++i)
+        curves.push_back(gauss_curve(gammas[i], gammadashs[i]));
+
+    vector<std::tuple<int, int>> pairs;
+    for (int i = 0; i < num_curves; ++i) {
+        for (int j = i+1; j < num_curves; ++j) {
+            if(bounding_box_check && bounding_boxes_disjoint(curves[i], curves[j]))
+                continue;
+            pairs.push_back({i, j});
+        }
+    }
+
+    double* res_ptr = &(res(0, 0));
+    int num_pairs = pairs.size();
+#pragma omp parallel for schedule(dynamic)
+    for (int k = 0; k < num_pairs; ++k) {
+        int i = std::get<0>(pairs[k]);
+        int j = std::get<1>(pairs[k]);
+        double link_sum, neumann_sum;
+        gauss_pair_kernel<link, neumann>(curves[i], curves[j], link_sum, neumann_sum);
+        double weight = 1./(double(curves[i].num_quad_points) * curves[j].num_quad_points);
+        double val = 0.;
+        if constexpr(link)
+            val = link_sum * weight/(4*M_PI);
+        if constexpr(neumann)
+            val = neumann_sum * weight * 1e-7;
+        res_ptr[i*num_curves + j] = val;
+        res_ptr[j*num_curves + i] = val;
+    }
+    return res;
+}
+
+Array gauss_linking_number_matrix(vector<Array>& gammas, vector<Array>& gammadashs, bool bounding_box_check) {
+    return gauss_pair_matrix<true, false>(gammas, gammadashs, bounding_box_check);
+}
+
+Array gauss_mutual_inductance_matrix(vector<Array>& gammas, vector<Array>& gammadashs) {
+    return gauss_pair_matrix<false, true>(gammas, gammadashs, false);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+#include "xtensor-python/pyarray.hpp"     // Numpy bindings
+typedef xt::pyarray<double> Array;
+using std::vector;
+
+// Double line integrals over pairs of closed curves that share the kernel
+// (r1 - r2)/|r1 - r2|^3 resp. 1/|r1 - r2|, i.e. the Gauss linking integral
+//
+//   Lk(c1, c2) = 1/(4 pi) \oint_{c1} \oint_{c2} (r1 - r2) . (dr1 x dr2) / |r1 - r2|^3,
+//
+// its self-term, the writhe Wr(c) = Lk(c, c), and the Neumann formula for the
+// mutual inductance
+//
+//   M(c1, c2) = mu0/(4 pi) \oint_{c1} \oint_{c2} dr1 . dr2 / |r1 - r2|.
+//
+// All functions take `gamma` and `gammadash` of shape (nquadpoints, 3) as
+// returned by `Curve.gamma()` and `Curve.gammadash()`, and assume that the
+// quadrature points are uniformly spaced on [0, 1), i.e. every quadrature
+// point carries the weight 1/nquadpoints.
+
+double gauss_linking_number(Array& gamma1, Array& gammadash1, Array& gamma2, Array& gammadash2);
+
+double gauss_writhe(Array& gamma, Array& gammadash);
+
+Array gauss_linking_number_matrix(vector<Array>& gammas, vector<Array>& gammadashs, bool bounding_box_check=true);
+
+Array gauss_mutual_inductance_matrix(vector<Array>& gammas, vector<Array>& gammadashs);
@@ -2,22 +2,25 @@
 #include <xtensor/xarray.hpp>
 #include <xtensor/xnoalias.hpp>
 #include <stdexcept>
+#include <algorithm>
 
 
 #include "cachedarray.h"
 #include "cache.h"
 #include "cachedtensor.h"
+#include "pointset.h"
 
 using std::logic_error;
 using std::vector;
 using std::shared_ptr;
+using std::weak_ptr;
 using std::make_shared;
 
 
 
 
 template<template<class, std::size_t, xt::layout_type> class T>
-class MagneticField {
+class MagneticField : public std::enable_shared_from_this<MagneticField<T>> {
     /*
      * This is the abstract base class for a magnetic field B and it's potential A.
      * The usage is as follows:
@@ -33,6 +36,8 @@ class MagneticField {
      *    returns a reference to the array in the cache. this should be used when
      *    performance is key and when the user guarantees that the array is only
      *    read and not modified.
+     *  - the points can also be set as a `PointSet`, which can be shared by
+     *    several fields that are evaluated on the same points, see pointset.h.
      */
     public:
         using Tensor1 = T<double, 1, xt::layout_type::row_major>;
@@ -42,6 +47,10 @@ class MagneticField {
 
     protected:
         void get_points_cyl_impl(Tensor2& points_cyl) {
+            if(pointset_status) {
+                pointset->get_cyl(points_cyl.data());
+                return;
+            }
             if(!points_cart.get_status())
                 throw logic_error("To compute points_cyl, points_cart needs to exist in the cache.");
             Tensor2& points_cart = get_points_cart_ref();
@@ -59,6 +68,10 @@ class MagneticField {
         }
 
         void get_points_cart_impl(Tensor2& points_cart) {
+            if(pointset_status) {
+                pointset->get_cart(points_cart.data());
+                return;
+            }
             if(!points_cyl.get_status())
                 throw logic_error("To compute points_cart, points_cyl needs to exist in the cache.");
             Tensor2& points_cyl = get_points_cyl_ref();
@@ -127,11 +140,22 @@ class MagneticField {
 
         CachedTensor<T, 2> points_cart;
         CachedTensor<T, 2> points_cyl;
+        // the points in structure of arrays layout, created when needed
+        shared_ptr<PointSet> pointset;
+        // whether pointset holds the current points
+        bool pointset_status = false;
         CachedTensor<T, 2> data_B, data_A, data_GradAbsB, data_AbsB, data_Bcyl, data_GradAbsBcyl;
         CachedTensor<T, 3> data_dB, data_dA;
         CachedTensor<T, 4> data_ddB, data_ddA;
         int npoints;
 
+    private:
+        // fields whose values are computed from the values of this field,
+        // e.g. a MagneticFieldSum that this field is part of. Their caches
+        // are cleared together with the cache of this field. Dependents that
+        // have been destroyed in the meantime are dropped.
+        vector<weak_ptr<MagneticField<T>>> dependents;
+
     public:
         MagneticField() {
             Tensor2 vals({{0., 0., 0.}});
@@ -149,12 +173,23 @@ class MagneticField {
             data_GradAbsB.invalidate_cache();
             data_Bcyl.invalidate_cache();
             data_GradAbsBcyl.invalidate_cache();
+            dependents.erase(std::remove_if(dependents.begin(), dependents.end(),
+                        [](const weak_ptr<MagneticField<T>>& d) { return d.expired(); }), dependents.end());
+            for (auto& dependent : dependents) {
+                if(auto d = dependent.lock())
+                    d->invalidate_cache();
+            }
+        }
+
+        void add_dependent(weak_ptr<MagneticField<T>> dependent) {
+            dependents.push_back(dependent);
         }
 
         MagneticField& set_points_cyl(Tensor2& p) {
             this->invalidate_cache();
             this->points_cart.invalidate_cache();
             this->points_cyl.invalidate_cache();
+            this->pointset_status = false;
             npoints = p.shape(0);
             Tensor2& points = points_cyl.get_or_create({npoints, 3});
             memcpy(points.data(), p.data(), 3*npoints*sizeof(double));
@@ -169,6 +204,7 @@ class MagneticField {
             this->invalidate_cache();
             this->points_cart.invalidate_cache();
             this->points_cyl.invalidate_cache();
+            this->pointset_status = false;
             npoints = p.shape(0);
             Tensor2& points = points_cart.get_or_create({npoints, 3});
             memcpy(points.data(), p.data(), 3*npoints*sizeof(double));
@@ -176,6 +212,54 @@ class MagneticField {
             return *this;
         }
 
+        // Sets the points to those of `p`, without copying them. The same
+        // PointSet can be passed to several fields.
+        MagneticField& set_pointset(shared_ptr<PointSet> p) {
+            if(!p)
+                throw std::runtime_error("The PointSet must not be None.");
+            this->invalidate_cache();
+            this->points_cart.invalidate_cache();
+            this->points_cyl.invalidate_cache();
+            npoints = p->size();
+            pointset = p;
+            pointset_status = true;
+            this->_set_points_cb();
+            return *this;
+        }
+
+        // Returns the points as a PointSet, which is created from the points
+        // given to set_points_cart or set_points_cyl on the first call.
+        shared_ptr<PointSet> get_pointset() {
+            if(pointset_status)
+                return pointset;
+            bool cart = points_cart.get_status();
+            if(!cart && !points_cyl.get_status())
+                throw logic_error("To compute pointset, points_cart or points_cyl needs to exist in the cache.");
+            Tensor2& points = cart ? points_cart.get_or_create({npoints, 3}) : points_cyl.get_or_create({npoints, 3});
+            auto coords = cart ? PointSet::cartesian : PointSet::cylindrical;
+            // a PointSet that this field created and that wasn't handed out
+            // since is refilled, so that fields that are evaluated on a single
+            // point at a time (e.g. in field line tracing) don't allocate new
+            // vectors for every point
+            if(pointset && pointset->owner == this) {
+                pointset->assign(points, coords);
+            } else {
+                pointset = std::make_shared<PointSet>(points, coords);
+                pointset->owner = this;
+            }
+            pointset_status = true;
+            return pointset;
+        }
+
+        // Returns the points as a PointSet that the caller may keep, e.g. in
+        // python. It is no longer refilled when the points of this field
+        // change.
+        shared_ptr<PointSet> share_pointset() {
+            auto p = get_pointset();
+            p->owner = nullptr;
+            return p;
+        }
+
         MagneticField& set_points(Tensor2& p) {
             return set_points_cart(p);
         }
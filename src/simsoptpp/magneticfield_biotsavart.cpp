@@ -1,5 +1,9 @@
 #include "magneticfield_biotsavart.h"
 #include "biot_savart_impl.h"
+#include "perf.h"
+#include "pygil.h"
+#include <array>
+#include "xtensor/xadapt.hpp"
 #include <fmt/core.h>
 #include <fmt/format.h>
 
@@ -8,82 +12,105 @@ void set_array_to_zero(Array& data){
     std::fill(data.begin(), data.end(), 0.);
 }
 
+#ifdef SIMSOPT_PERF
+// Rough operation counts per pair of target and quadrature point of the
+// kernels for 0, 1 and 2 derivatives, used for the instrumentation.
+static const uint64_t biot_savart_flops_per_pair[3] = {30, 90, 300};
+static const char* biot_savart_kernel_names[3] = {"BiotSavart::compute_B", "BiotSavart::compute_dB", "BiotSavart::compute_ddB"};
+static const char* biot_savart_kernel_names_A[3] = {"BiotSavart::compute_A", "BiotSavart::compute_dA", "BiotSavart::compute_ddA"};
+#endif
+
 
 template<template<class, std::size_t, xt::layout_type> class T, class Array>
 void BiotSavart<T, Array>::compute(int derivatives) {
     //fmt::print("Calling compute({})\n", derivatives);
-    auto points = this->get_points_cart_ref();
-    this->fill_points(points);
-    Array dummyjac = xt::zeros<double>({1, 1, 1});
-    Array dummyhess = xt::zeros<double>({1, 1, 1, 1});
-    Tensor3 _dummyjac = xt::zeros<double>({1, 1, 1});
-    Tensor4 _dummyhess = xt::zeros<double>({1, 1, 1, 1});
+    if(derivatives > 2)
+        throw logic_error("Only two derivatives of Biot Savart implemented");
+    SIMSOPT_PERF_SCOPE(timer, biot_savart_kernel_names[derivatives]);
+    // the points in structure of arrays layout, shared with the other fields
+    // that are evaluated on the same PointSet
+    auto points = this->get_pointset();
+    AlignedPaddedVec& pointsx = points->x();
+    AlignedPaddedVec& pointsy = points->y();
+    AlignedPaddedVec& pointsz = points->z();
     int ncoils = this->coils.size();
     Tensor2& B = data_B.get_or_create({npoints, 3});
-    Tensor3& dB = derivatives >= 1 ? data_dB.get_or_create({npoints, 3, 3}) : _dummyjac;
-    Tensor4& ddB = derivatives >= 2 ? data_ddB.get_or_create({npoints, 3, 3, 3}) : _dummyhess;
-
     set_array_to_zero(B);
-    set_array_to_zero(dB);
-    set_array_to_zero(ddB);
 
-    std::vector<double> currents(ncoils, 0.);
+    // With a collection, gamma and gammadash of all coils are computed by one
+    // product, otherwise each curve fills its own cache.
+    Array* gammas = collection ? &collection->gamma() : nullptr;
+    Array* gammadashs = collection ? &collection->gammadash() : nullptr;
     // Creating new xtensor arrays from an openmp thread doesn't appear
-    // to be safe. so we do that here in serial.
+    // to be safe. so we do that here in serial. The arrays are only zeroed in
+    // the parallel loop below, so that their memory is first touched by the
+    // thread that computes them.
+    // We also acquire all currents here, since the `get_value` function of a
+    // current may be implemented in python.
+    update_shapes();
     for (int i = 0; i < ncoils; ++i) {
-        this->coils[i]->curve->gamma();
-        this->coils[i]->curve->gammadash();
-        field_cache.get_or_create(fmt::format("B_{}", i), {npoints, 3});
-        if(derivatives > 0)
-            field_cache.get_or_create(fmt::format("dB_{}", i), {npoints, 3, 3});
-        if(derivatives > 1)
-            field_cache.get_or_create(fmt::format("ddB_{}", i), {npoints, 3, 3, 3});
+        if(!collection) {
+            this->coils[i]->curve->gamma();
+            this->coils[i]->curve->gammadash();
+        }
+        for (int d = 0; d <= derivatives; ++d)
+            coil_fields[d][i] = &field_cache.get_or_allocate(keys_B[d][i], shapes[d]);
         currents[i] = this->coils[i]->current->get_value();
+        SIMSOPT_PERF_ADD(timer, pairs, uint64_t(npoints)*this->coils[i]->curve->numquadpoints);
     }
+    SIMSOPT_PERF_ADD(timer, points, npoints);
+    SIMSOPT_PERF_ADD(timer, flops, timer.pairs*biot_savart_flops_per_pair[derivatives]);
 
-#pragma omp parallel for
-    for (int i = 0; i < ncoils; ++i) {
-        Array& Bi = field_cache.get_or_create(fmt::format("B_{}", i), {npoints, 3});
+    ScopedGILRelease gil;
+    // Evaluates the field of coil i for a curve that is either an Array or a
+    // view into the blocks of the collection.
+    auto compute_coil = [&](int i, auto& gamma, auto& gammadash) {
+        Array& Bi = *coil_fields[0][i];
         set_array_to_zero(Bi);
-        Array& gamma = this->coils[i]->curve->gamma();
-        Array& gammadash = this->coils[i]->curve->gammadash();
-        double current = currents[i];
+        const double* quadweights = this->coils[i]->curve->quadweights_ptr();
         if(derivatives == 0){
-            biot_savart_kernel<Array, 0>(pointsx, pointsy, pointsz, gamma, gammadash, Bi, dummyjac, dummyhess);
+            biot_savart_kernel<Array, 0>(pointsx, pointsy, pointsz, gamma, gammadash, Bi, dummyjac, dummyhess, quadweights);
         } else {
-            Array& dBi = field_cache.get_or_create(fmt::format("dB_{}", i), {npoints, 3, 3});
+            Array& dBi = *coil_fields[1][i];
             set_array_to_zero(dBi);
             if(derivatives == 1) {
-                biot_savart_kernel<Array, 1>(pointsx, pointsy, pointsz, gamma, gammadash, Bi, dBi, dummyhess);
+                biot_savart_kernel<Array, 1>(pointsx, pointsy, pointsz, gamma, gammadash, Bi, dBi, dummyhess, quadweights);
             } else {
-                Array& ddBi = field_cache.get_or_create(fmt::format("ddB_{}", i), {npoints, 3, 3, 3});
+                Array& ddBi = *coil_fields[2][i];
                 set_array_to_zero(ddBi);
-                if (derivatives == 2) {
-                    biot_savart_kernel<Array, 2>(pointsx, pointsy, pointsz, gamma, gammadash, Bi, dBi, ddBi);
-                } else {
-                    throw logic_error("Only two derivatives of Biot Savart implemented");
-                }
+                biot_savart_kernel<Array, 2>(pointsx, pointsy, pointsz, gamma, gammadash, Bi, dBi, ddBi, quadweights);
             }
         }
-    }
+    };
+#pragma omp parallel for
     for (int i = 0; i < ncoils; ++i) {
-        Array& Bi = field_cache.get_or_create(fmt::format("B_{}", i), {npoints, 3});
-        double current = this->coils[i]->current->get_value();
-        xt::noalias(B) = B + current * Bi;
+        if(collection) {
+            std::size_t nq = collection->numquadpoints;
+            std::array<std::size_t, 2> shape = {nq, 3};
+            auto gamma = xt::adapt(gammas->data() + 3*nq*i, 3*nq, xt::no_ownership(), shape);
+            auto gammadash = xt::adapt(gammadashs->data() + 3*nq*i, 3*nq, xt::no_ownership(), shape);
+            compute_coil(i, gamma, gammadash);
+        } else {
+            compute_coil(i, this->coils[i]->curve->gamma(), this->coils[i]->curve->gammadash());
+        }
     }
+    // the outputs may have to be allocated below
+    gil.reacquire();
+    // the fields of the coils are added up serially and in a fixed order, so
+    // that the result doesn't depend on the number of threads
+    for (int i = 0; i < ncoils; ++i)
+        xt::noalias(B) = B + currents[i] * (*coil_fields[0][i]);
     if(derivatives>=1) {
-        for (int i = 0; i < ncoils; ++i) {
-            Array& dBi = field_cache.get_or_create(fmt::format("dB_{}", i), {npoints, 3, 3});
-            double current = this->coils[i]->current->get_value();
-            xt::noalias(dB) = dB + current * dBi;
-        }
+        Tensor3& dB = data_dB.get_or_create({npoints, 3, 3});
+        set_array_to_zero(dB);
+        for (int i = 0; i < ncoils; ++i)
+            xt::noalias(dB) = dB + currents[i] * (*coil_fields[1][i]);
     }
     if(derivatives>=2) {
-        for (int i = 0; i < ncoils; ++i) {
-            Array& ddBi = field_cache.get_or_create(fmt::format("ddB_{}", i), {npoints, 3, 3, 3});
-            double current = this->coils[i]->current->get_value();
-            xt::noalias(ddB) = ddB + current * ddBi;
-        }
+        Tensor4& ddB = data_ddB.get_or_create({npoints, 3, 3, 3});
+        set_array_to_zero(ddB);
+        for (int i = 0; i < ncoils; ++i)
+            xt::noalias(ddB) = ddB + currents[i] * (*coil_fields[2][i]);
     }
 }
 
@@ -91,87 +118,101 @@ void BiotSavart<T, Array>::compute(int derivatives) {
 template<template<class, std::size_t, xt::layout_type> class T, class Array>
 void BiotSavart<T, Array>::compute_A(int derivatives) {
     //fmt::print("Calling compute({})\n", derivatives);
-    auto points = this->get_points_cart_ref();
-    this->fill_points(points);
-    Array dummyjac = xt::zeros<double>({1, 1, 1});
-    Array dummyhess = xt::zeros<double>({1, 1, 1, 1});
-    Tensor3 _dummyjac = xt::zeros<double>({1, 1, 1});
-    Tensor4 _dummyhess = xt::zeros<double>({1, 1, 1, 1});
+    if(derivatives > 2)
+        throw logic_error("Only two derivatives of Biot Savart vector potential implemented");
+    SIMSOPT_PERF_SCOPE(timer, biot_savart_kernel_names_A[derivatives]);
+    // the points in structure of arrays layout, shared with the other fields
+    // that are evaluated on the same PointSet
+    auto points = this->get_pointset();
+    AlignedPaddedVec& pointsx = points->x();
+    AlignedPaddedVec& pointsy = points->y();
+    AlignedPaddedVec& pointsz = points->z();
     int ncoils = this->coils.size();
     Tensor2& A = data_A.get_or_create({npoints, 3});
-    Tensor3& dA = derivatives >= 1 ? data_dA.get_or_create({npoints, 3, 3}) : _dummyjac;
-    Tensor4& ddA = derivatives >= 2 ? data_ddA.get_or_create({npoints, 3, 3, 3}) : _dummyhess;
-
     set_array_to_zero(A);
-    set_array_to_zero(dA);
-    set_array_to_zero(ddA);
 
     // Creating new xtensor arrays from an openmp thread doesn't appear
-    // to be safe. so we do that here in serial.
+    // to be safe. so we do that here in serial. The arrays are only zeroed in
+    // the parallel loop below.
     // We also acquire all currents here. The reason for that is that some
     // coils point at the same current in the background, and if the
     // `get_value` function for that is implemented in python, then this will
     // freeze in parallel.
-    std::vector<double> currents(ncoils, 0.);
+    Array* gammas = collection ? &collection->gamma() : nullptr;
+    Array* gammadashs = collection ? &collection->gammadash() : nullptr;
+    update_shapes();
     for (int i = 0; i < ncoils; ++i) {
-        this->coils[i]->curve->gamma();
-        this->coils[i]->curve->gammadash();
-        field_cache.get_or_create(fmt::format("A_{}", i), {npoints, 3});
-        if(derivatives > 0)
-            field_cache.get_or_create(fmt::format("dA_{}", i), {npoints, 3, 3});
-        if(derivatives > 1)
-            field_cache.get_or_create(fmt::format("ddA_{}", i), {npoints, 3, 3, 3});
+        if(!collection) {
+            this->coils[i]->curve->gamma();
+            this->coils[i]->curve->gammadash();
+        }
+        for (int d = 0; d <= derivatives; ++d)
+            coil_fields[d][i] = &field_cache.get_or_allocate(keys_A[d][i], shapes[d]);
         currents[i] = this->coils[i]->current->get_value();
+        SIMSOPT_PERF_ADD(timer, pairs, uint64_t(npoints)*this->coils[i]->curve->numquadpoints);
     }
+    SIMSOPT_PERF_ADD(timer, points, npoints);
+    SIMSOPT_PERF_ADD(timer, flops, timer.pairs*biot_savart_flops_per_pair[derivatives]);
 
-#pragma omp parallel for
-    for (int i = 0; i < ncoils; ++i) {
-        Array& Ai = field_cache.get_or_create(fmt::format("A_{}", i), {npoints, 3});
+    ScopedGILRelease gil;
+    auto compute_coil = [&](int i, auto& gamma, auto& gammadash) {
+        Array& Ai = *coil_fields[0][i];
         set_array_to_zero(Ai);
-        Array& gamma = this->coils[i]->curve->gamma();
-        Array& gammadash = this->coils[i]->curve->gammadash();
-        double current = currents[i];
+        const double* quadweights = this->coils[i]->curve->quadweights_ptr();
         if(derivatives == 0){
-            biot_savart_kernel_A<Array, 0>(pointsx, pointsy, pointsz, gamma, gammadash, Ai, dummyjac, dummyhess);
+            biot_savart_kernel_A<Array, 0>(pointsx, pointsy, pointsz, gamma, gammadash, Ai, dummyjac, dummyhess, quadweights);
         } else {
-            Array& dAi = field_cache.get_or_create(fmt::format("dA_{}", i), {npoints, 3, 3});
+            Array& dAi = *coil_fields[1][i];
             set_array_to_zero(dAi);
             if(derivatives == 1) {
-                biot_savart_kernel_A<Array, 1>(pointsx, pointsy, pointsz, gamma, gammadash, Ai, dAi, dummyhess);
+                biot_savart_kernel_A<Array, 1>(pointsx, pointsy, pointsz, gamma, gammadash, Ai, dAi, dummyhess, quadweights);
             } else {
-                Array& ddAi = field_cache.get_or_create(fmt::format("ddA_{}", i), {npoints, 3, 3, 3});
+                Array& ddAi = *coil_fields[2][i];
                 set_array_to_zero(ddAi);
-                if (derivatives == 2) {
-                    biot_savart_kernel_A<Array, 2>(pointsx, pointsy, pointsz, gamma, gammadash, Ai, dAi, ddAi);
-                } else {
-                    throw logic_error("Only two derivatives of Biot Savart vector potential implemented");
-                }
+                biot_savart_kernel_A<Array, 2>(pointsx, pointsy, pointsz, gamma, gammadash, Ai, dAi, ddAi, quadweights);
             }
         }
-    }
+    };
+#pragma omp parallel for
     for (int i = 0; i < ncoils; ++i) {
-        Array& Ai = field_cache.get_or_create(fmt::format("A_{}", i), {npoints, 3});
-        double current = this->coils[i]->current->get_value();
-        xt::noalias(A) = A + current * Ai;
+        if(collection) {
+            std::size_t nq = collection->numquadpoints;
+            std::array<std::size_t, 2> shape = {nq, 3};
+            auto gamma = xt::adapt(gammas->data() + 3*nq*i, 3*nq, xt::no_ownership(), shape);
+            auto gammadash = xt::adapt(gammadashs->data() + 3*nq*i, 3*nq, xt::no_ownership(), shape);
+            compute_coil(i, gamma, gammadash);
+        } else {
+            compute_coil(i, this->coils[i]->curve->gamma(), this->coils[i]->curve->gammadash());
+        }
     }
+    // the outputs may have to be allocated below
+    gil.reacquire();
+    for (int i = 0; i < ncoils; ++i)
+        xt::noalias(A) = A + currents[i] * (*coil_fields[0][i]);
     if(derivatives>=1) {
-        for (int i = 0; i < ncoils; ++i) {
-            Array& dAi = field_cache.get_or_create(fmt::format("dA_{}", i), {npoints, 3, 3});
-            double current = this->coils[i]->current->get_value();
-            xt::noalias(dA) = dA + current * dAi;
-        }
+        Tensor3& dA = data_dA.get_or_create({npoints, 3, 3});
+        set_array_to_zero(dA);
+        for (int i = 0; i < ncoils; ++i)
+            xt::noalias(dA) = dA + currents[i] * (*coil_fields[1][i]);
     }
     if(derivatives>=2) {
-        for (int i = 0; i < ncoils; ++i) {
-            Array& ddAi = field_cache.get_or_create(fmt::format("ddA_{}", i), {npoints, 3, 3, 3});
-            double current = this->coils[i]->current->get_value();
-            xt::noalias(ddA) = ddA + current * ddAi;
-        }
+        Tensor4& ddA = data_ddA.get_or_create({npoints, 3, 3, 3});
+        set_array_to_zero(ddA);
+        for (int i = 0; i < ncoils; ++i)
+            xt::noalias(ddA) = ddA + currents[i] * (*coil_fields[2][i]);
     }
 }
 
 
+#ifdef SIMSOPT_WITHOUT_PYTHON
+// for the C++ benchmarks, which don't link against python
+#include "xtensor/xtensor.hpp"
+template<class Type, std::size_t rank, xt::layout_type layout>
+using DefaultTensor = xt::xtensor<Type, rank, layout, XTENSOR_DEFAULT_ALLOCATOR(double)>;
+template class BiotSavart<DefaultTensor, xt::xarray<double>>;
+#else
 #include "xtensor-python/pyarray.hpp"     // Numpy bindings
 #include "xtensor-python/pytensor.hpp"     // Numpy bindings
 typedef xt::pyarray<double> PyArray;
 template class BiotSavart<xt::pytensor, PyArray>;
+#endif
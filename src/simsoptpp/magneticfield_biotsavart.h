@@ -1,11 +1,14 @@
 #pragma once 
 
+#include <array>
+#include <string>
 #include <vector>
 #include "xtensor/xarray.hpp"
 #include "xtensor/xlayout.hpp"
 #include "simdhelpers.h"
 #include "magneticfield.h"
 #include "coil.h"
+#include "curvecollection.h"
 
 template<template<class, std::size_t, xt::layout_type> class T, class Array>
 class BiotSavart : public MagneticField<T> {
@@ -16,58 +19,49 @@ class BiotSavart : public MagneticField<T> {
         using typename MagneticField<T>::Tensor3;
         using typename MagneticField<T>::Tensor4;
         const vector<shared_ptr<Coil<Array>>> coils;
+        // If set, the curves of the coils are evaluated as one block by the
+        // collection, and the kernels read gamma and gammadash from its
+        // contiguous buffers.
+        const shared_ptr<CurveXYZFourierCollection<Array>> collection;
 
     private:
         Cache<Array> field_cache;
-
-        #if defined(USE_XSIMD)
-        // this vectors are aligned in memory for fast simd usage.
-        AlignedPaddedVec pointsx = AlignedPaddedVec(xsimd::simd_type<double>::size, 0.);
-        AlignedPaddedVec pointsy = AlignedPaddedVec(xsimd::simd_type<double>::size, 0.);
-        AlignedPaddedVec pointsz = AlignedPaddedVec(xsimd::simd_type<double>::size, 0.);
-
-        inline void fill_points(const Tensor2& points) {
-            // allocating these aligned vectors is not super cheap, so reuse
-            // whenever possible.
-            if(pointsx.size() != npoints)
-                pointsx = AlignedPaddedVec(npoints, 0.);
-            if(pointsy.size() != npoints)
-                pointsy = AlignedPaddedVec(npoints, 0.);
-            if(pointsz.size() != npoints)
-                pointsz = AlignedPaddedVec(npoints, 0.);
-            for (int i = 0; i < npoints; ++i) {
-                pointsx[i] = points(i, 0);
-                pointsy[i] = points(i, 1);
-                pointsz[i] = points(i, 2);
+        // Passed to the kernels for the derivatives that are not computed,
+        // the kernels don't access them. They are kept, so that no arrays
+        // have to be created for every evaluation.
+        Array dummyjac = xt::zeros<double>({1, 1, 1});
+        Array dummyhess = xt::zeros<double>({1, 1, 1, 1});
+
+        // The keys of the fields of the single coils in field_cache, indexed
+        // by the number of derivatives, and their shapes for the current
+        // number of points. They are created once, so that an evaluation
+        // doesn't format strings or allocate vectors.
+        std::array<vector<string>, 3> keys_B, keys_A;
+        std::array<vector<int>, 3> shapes;
+        // The fields of the single coils and the currents of the evaluation
+        // that is in progress.
+        std::array<vector<Array*>, 3> coil_fields;
+        vector<double> currents;
+
+        void init_keys() {
+            const char* prefixes[3] = {"", "d", "dd"};
+            for (int d = 0; d < 3; ++d) {
+                for (size_t i = 0; i < coils.size(); ++i) {
+                    keys_B[d].push_back(string(prefixes[d]) + "B_" + std::to_string(i));
+                    keys_A[d].push_back(string(prefixes[d]) + "A_" + std::to_string(i));
+                }
+                coil_fields[d].resize(coils.size(), nullptr);
             }
+            currents.resize(coils.size(), 0.);
         }
-        #else
-        AlignedPaddedVec pointsx;
-        AlignedPaddedVec pointsy;
-        AlignedPaddedVec pointsz;
-
-        inline void fill_points(const Tensor2& points) {
-            // allocating these aligned vectors is not super cheap, so reuse
-            // whenever possible.
-            if(pointsx.size() != npoints){
-                pointsx.clear();
-                pointsx.resize(npoints, 0.0);
-            }
-            if(pointsy.size() != npoints){
-                pointsy.clear();
-                pointsy.resize(npoints, 0.0);
-            }
-            if(pointsz.size() != npoints){
-                pointsz.clear();
-                pointsz.resize(npoints, 0.0);
-            }
-            for (int i = 0; i < npoints; ++i) {
-                pointsx[i] = points(i, 0);
-                pointsy[i] = points(i, 1);
-                pointsz[i] = points(i, 2);
-            }
+
+        void update_shapes() {
+            if(!shapes[0].empty() && shapes[0][0] == this->npoints)
+                return;
+            shapes[0] = {this->npoints, 3};
+            shapes[1] = {this->npoints, 3, 3};
+            shapes[2] = {this->npoints, 3, 3, 3};
         }
-        #endif
 
     protected:
 
@@ -108,7 +102,17 @@ class BiotSavart : public MagneticField<T> {
 
 
         BiotSavart(vector<shared_ptr<Coil<Array>>> coils) : MagneticField<T>(), coils(coils) {
+            init_keys();
+        }
 
+        BiotSavart(vector<shared_ptr<Coil<Array>>> coils, shared_ptr<CurveXYZFourierCollection<Array>> collection) :
+            MagneticField<T>(), coils(coils), collection(collection) {
+            bool same_curves = collection->ncurves == int(coils.size());
+            for (int i = 0; same_curves && i < collection->ncurves; ++i)
+                same_curves = static_cast<Curve<Array>*>(collection->curves[i].get()) == coils[i]->curve.get();
+            if(!same_curves)
+                throw std::runtime_error("The curves of the collection need to be the curves of the coils, in the same order.");
+            init_keys();
         }
 
         void compute(int derivatives);
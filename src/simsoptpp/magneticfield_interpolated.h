@@ -22,16 +22,67 @@ class InterpolatedField : public MagneticField<T> {
         const int nfp = 1;
         vector<bool> symmetries = vector<bool>(1, false);
 
+        shared_ptr<RegularGridInterpolant3D<Tensor2>>& get_interpolant(shared_ptr<RegularGridInterpolant3D<Tensor2>>& interp) {
+            if(!interp)
+                interp = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, r_range, phi_range, z_range, 3, extrapolate, skip);
+            return interp;
+        }
+
+        void build_interpolant(shared_ptr<RegularGridInterpolant3D<Tensor2>>& interp, bool& status, std::function<Vec(Vec, Vec, Vec)>& fbatch) {
+            get_interpolant(interp);
+            if(!status) {
+                auto old_points = this->field->get_pointset();
+                interp->interpolate_batch(fbatch);
+                this->field->set_pointset(old_points);
+                status = true;
+            }
+        }
+
+        void evaluate_dofs(shared_ptr<RegularGridInterpolant3D<Tensor2>>& interp, std::function<Vec(Vec, Vec, Vec)>& fbatch, uint32_t first, uint32_t last, Tensor2& out) {
+            if(out.dimension() != 2 || out.shape(0) != last-first || out.shape(1) != 3)
+                throw std::runtime_error("out has wrong shape.");
+            if(out.layout() != xt::layout_type::row_major)
+                throw std::runtime_error("out needs to be in row-major storage order");
+            auto old_points = this->field->get_pointset();
+            get_interpolant(interp)->evaluate_dofs(fbatch, first, last, out.data());
+            this->field->set_pointset(old_points);
+        }
+
+        void set_values(shared_ptr<RegularGridInterpolant3D<Tensor2>>& interp, bool& status, Tensor2& values) {
+            check_values(interp, values);
+            interp->set_values(values.data());
+            status = true;
+        }
+
+        void check_values(shared_ptr<RegularGridInterpolant3D<Tensor2>>& interp, Tensor2& values) {
+            if(values.dimension() != 2 || values.shape(0) != get_interpolant(interp)->num_dofs() || values.shape(1) != 3)
+                throw std::runtime_error("values has wrong shape.");
+            if(values.layout() != xt::layout_type::row_major)
+                throw std::runtime_error("values needs to be in row-major storage order");
+        }
+
+        void check_table(shared_ptr<RegularGridInterpolant3D<Tensor2>>& interp, Tensor2& table, uint32_t ncells) {
+            if(table.dimension() != 2 || table.shape(0) != ncells || table.shape(1) != get_interpolant(interp)->cell_table_size())
+                throw std::runtime_error("table has wrong shape.");
+            if(table.layout() != xt::layout_type::row_major)
+                throw std::runtime_error("table needs to be in row-major storage order");
+        }
+
+        void fill_table(shared_ptr<RegularGridInterpolant3D<Tensor2>>& interp, Tensor2& values, uint32_t first, uint32_t last, Tensor2& out) {
+            check_values(interp, values);
+            check_table(interp, out, last-first);
+            interp->fill_table(values.data(), first, last, out.data());
+        }
+
+        void set_table(shared_ptr<RegularGridInterpolant3D<Tensor2>>& interp, bool& status, Tensor2& table) {
+            check_table(interp, table, get_interpolant(interp)->num_cells());
+            interp->set_table(table.data());
+            status = true;
+        }
+
     protected:
         void _B_cyl_impl(Tensor2& B_cyl) override {
-            if(!interp_B)
-                interp_B = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, r_range, phi_range, z_range, 3, extrapolate, skip);
-            if(!status_B) {
-                Tensor2 old_points = this->field->get_points_cart();
-                interp_B->interpolate_batch(fbatch_B);
-                this->field->set_points_cart(old_points);
-                status_B = true;
-            }
+            build_interpolant(interp_B, status_B, fbatch_B);
             if(nfp > 1 || stellsym){
                 Tensor2& rphiz = this->get_points_cyl_ref();
                 Tensor2& rphiz_sym = points_cyl_sym.get_or_create({npoints, 3});
@@ -44,14 +95,7 @@ class InterpolatedField : public MagneticField<T> {
         }
 
         void _GradAbsB_cyl_impl(Tensor2& GradAbsB_cyl) override {
-            if(!interp_GradAbsB)
-                interp_GradAbsB = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, r_range, phi_range, z_range, 3, extrapolate, skip);
-            if(!status_GradAbsB) {
-                Tensor2 old_points = this->field->get_points_cart();
-                interp_GradAbsB->interpolate_batch(fbatch_GradAbsB);
-                this->field->set_points_cart(old_points);
-                status_GradAbsB = true;
-            }
+            build_interpolant(interp_GradAbsB, status_GradAbsB, fbatch_GradAbsB);
             if(nfp > 1 || stellsym){
                 Tensor2& rphiz = this->get_points_cyl_ref();
                 Tensor2& rphiz_sym = points_cyl_sym.get_or_create({npoints, 3});
@@ -152,13 +196,7 @@ class InterpolatedField : public MagneticField<T> {
         {
             fbatch_B = [this](Vec r, Vec phi, Vec z) {
                 int npoints = r.size();
-                Tensor2 points = xt::zeros<double>({npoints, 3});
-                for(int i=0; i<npoints; i++) {
-                    points(i, 0) = r[i];
-                    points(i, 1) = phi[i];
-                    points(i, 2) = z[i];
-                }
-                this->field->set_points_cyl(points);
+                this->field->set_pointset(std::make_shared<PointSet>(r.data(), phi.data(), z.data(), npoints, PointSet::cylindrical));
                 auto B_cyl = this->field->B_cyl();
                 //fmt::print("B: Actual size: ({}, {}), 3*npoints={}\n", B.shape(0), B.shape(1), 3*npoints);
                 auto res = Vec(B_cyl.data(), B_cyl.data()+3*npoints);
@@ -167,13 +205,7 @@ class InterpolatedField : public MagneticField<T> {
 
             fbatch_GradAbsB = [this](Vec r, Vec phi, Vec z) {
                 int npoints = r.size();
-                Tensor2 points = xt::zeros<double>({npoints, 3});
-                for(int i=0; i<npoints; i++) {
-                    points(i, 0) = r[i];
-                    points(i, 1) = phi[i];
-                    points(i, 2) = z[i];
-                }
-                this->field->set_points_cyl(points);
+                this->field->set_pointset(std::make_shared<PointSet>(r.data(), phi.data(), z.data(), npoints, PointSet::cylindrical));
                 auto GradAbsB_cyl = this->field->GradAbsB_cyl();
                 //fmt::print("GradAbsB: Actual size: ({}, {}), 3*npoints={}\n", GradAbsB.shape(0), GradAbsB.shape(1), 3*npoints);
                 auto res = Vec(GradAbsB_cyl.data(), GradAbsB_cyl.data() + 3*npoints);
@@ -186,26 +218,36 @@ class InterpolatedField : public MagneticField<T> {
                 RangeTriplet r_range, RangeTriplet phi_range, RangeTriplet z_range,
                 bool extrapolate, int nfp, bool stellsym, std::function<std::vector<bool>(Vec, Vec, Vec)> skip) : InterpolatedField(field, UniformInterpolationRule(degree), r_range, phi_range, z_range, extrapolate, nfp, stellsym, skip) {}
 
+        // The interpolants can also be built in two steps: the field is
+        // evaluated at the interpolation nodes first, ..., last-1 with
+        // `evaluate_dofs_*`, and the interpolant is then built from the values
+        // at all `num_dofs()` nodes with `set_values_*`. This allows to split
+        // up the evaluation of an expensive field, e.g. across MPI ranks.
+        uint32_t num_dofs() { return get_interpolant(interp_B)->num_dofs(); }
+        void evaluate_dofs_B(uint32_t first, uint32_t last, Tensor2& out) { evaluate_dofs(interp_B, fbatch_B, first, last, out); }
+        void evaluate_dofs_GradAbsB(uint32_t first, uint32_t last, Tensor2& out) { evaluate_dofs(interp_GradAbsB, fbatch_GradAbsB, first, last, out); }
+        void set_values_B(Tensor2& values) { set_values(interp_B, status_B, values); }
+        void set_values_GradAbsB(Tensor2& values) { set_values(interp_GradAbsB, status_GradAbsB, values); }
+
+        // `set_values_*` can be split up further: `fill_table_*` writes the
+        // tables of the cells first, ..., last-1 into `out`, of shape
+        // (last-first, cell_table_size()), and `set_table_*` makes the
+        // interpolant use `table`, of shape (num_cells(), cell_table_size()),
+        // without copying it. The table has to be kept alive by the caller,
+        // e.g. in a shared memory window that holds it once per node.
+        uint32_t num_cells() { return get_interpolant(interp_B)->num_cells(); }
+        int cell_table_size() { return get_interpolant(interp_B)->cell_table_size(); }
+        void fill_table_B(Tensor2& values, uint32_t first, uint32_t last, Tensor2& out) { fill_table(interp_B, values, first, last, out); }
+        void fill_table_GradAbsB(Tensor2& values, uint32_t first, uint32_t last, Tensor2& out) { fill_table(interp_GradAbsB, values, first, last, out); }
+        void set_table_B(Tensor2& table) { set_table(interp_B, status_B, table); }
+        void set_table_GradAbsB(Tensor2& table) { set_table(interp_GradAbsB, status_GradAbsB, table); }
+
         std::pair<double, double> estimate_error_B(int samples) {
-            if(!interp_B)
-                interp_B = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, r_range, phi_range, z_range, 3, extrapolate, skip);
-            if(!status_B) {
-                Tensor2 old_points = this->field->get_points_cart();
-                interp_B->interpolate_batch(fbatch_B);
-                this->field->set_points_cart(old_points);
-                status_B = true;
-            }
+            build_interpolant(interp_B, status_B, fbatch_B);
             return interp_B->estimate_error(this->fbatch_B, samples);
         }
         std::pair<double, double> estimate_error_GradAbsB(int samples) {
-            if(!interp_GradAbsB)
-                interp_GradAbsB = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, r_range, phi_range, z_range, 3, extrapolate, skip);
-            if(!status_GradAbsB) {
-                Tensor2 old_points = this->field->get_points_cart();
-                interp_GradAbsB->interpolate_batch(fbatch_GradAbsB);
-                this->field->set_points_cart(old_points);
-                status_GradAbsB = true;
-            }
+            build_interpolant(interp_GradAbsB, status_GradAbsB, fbatch_GradAbsB);
             return interp_GradAbsB->estimate_error(this->fbatch_GradAbsB, samples);
         }
 };
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "magneticfield.h"
+
+// Below this many entries the sum is memory bound and cheaper than starting
+// the threads, e.g. for the single points evaluated during tracing.
+constexpr int accumulate_fields_parallel_threshold = 1 << 15;
+
+// Writes out[i] = scale * sum_j in[j][i] for i = 0, ..., n-1 in a single pass
+// over the output.
+inline void accumulate_fields(double* out, const vector<const double*>& in, double scale, int n) {
+    int nin = in.size();
+#pragma omp parallel for if(n >= accumulate_fields_parallel_threshold)
+    for (int i = 0; i < n; ++i) {
+        double res = 0.;
+        for (int j = 0; j < nin; ++j)
+            res += in[j][i];
+        out[i] = scale * res;
+    }
+}
+
+template<template<class, std::size_t, xt::layout_type> class T>
+class MagneticFieldSum : public MagneticField<T> {
+    /*
+     * The sum of several magnetic fields, e.g. the field of the coils plus
+     * the field of some magnets. The points are forwarded to all children as
+     * one PointSet and B, A and their derivatives are summed directly into the
+     * caches of this field.
+     * Since everything happens in C++, a sum of native fields can be traced
+     * and interpolated without calling back into Python.
+     */
+    public:
+        using typename MagneticField<T>::Tensor2;
+        using typename MagneticField<T>::Tensor3;
+        using typename MagneticField<T>::Tensor4;
+        const vector<shared_ptr<MagneticField<T>>> fields;
+
+    private:
+        bool linked = false;
+
+        // Registers this field as a dependent of its children, so that their
+        // changes clear the cache of this field. This needs the shared_ptr
+        // that owns this field, so it is done on the first evaluation rather
+        // than in the constructor. Until then, there is nothing to clear.
+        void link_children() {
+            if(linked)
+                return;
+            auto self = this->weak_from_this();
+            if(self.expired())
+                throw std::runtime_error("A MagneticFieldSum needs to be owned by a shared_ptr.");
+            for (auto& field : fields)
+                field->add_dependent(self);
+            linked = true;
+        }
+
+        template<class Tensor, class F>
+        void sum_children(Tensor& out, F get) {
+            link_children();
+            vector<const double*> in(fields.size());
+            // evaluate the children first, as they may call back into Python
+            for (int j = 0; j < (int)fields.size(); ++j) {
+                Tensor& child = get(*fields[j]);
+                if(child.size() != out.size())
+                    throw std::runtime_error("The fields in a MagneticFieldSum are evaluated at different points, call set_points on the sum.");
+                in[j] = child.data();
+            }
+            accumulate_fields(out.data(), in, 1., out.size());
+        }
+
+    protected:
+        void _set_points_cb() override {
+            // the children share the points, so they are only transposed and
+            // converted to cylindrical coordinates once
+            auto points = this->get_pointset();
+            for (auto& field : fields)
+                field->set_pointset(points);
+        }
+
+        void _B_impl(Tensor2& B) override {
+            sum_children(B, [](MagneticField<T>& f) -> Tensor2& { return f.B_ref(); });
+        }
+        void _dB_by_dX_impl(Tensor3& dB_by_dX) override {
+            sum_children(dB_by_dX, [](MagneticField<T>& f) -> Tensor3& { return f.dB_by_dX_ref(); });
+        }
+        void _d2B_by_dXdX_impl(Tensor4& d2B_by_dXdX) override {
+            sum_children(d2B_by_dXdX, [](MagneticField<T>& f) -> Tensor4& { return f.d2B_by_dXdX_ref(); });
+        }
+        void _A_impl(Tensor2& A) override {
+            sum_children(A, [](MagneticField<T>& f) -> Tensor2& { return f.A_ref(); });
+        }
+        void _dA_by_dX_impl(Tensor3& dA_by_dX) override {
+            sum_children(dA_by_dX, [](MagneticField<T>& f) -> Tensor3& { return f.dA_by_dX_ref(); });
+        }
+        void _d2A_by_dXdX_impl(Tensor4& d2A_by_dXdX) override {
+            sum_children(d2A_by_dXdX, [](MagneticField<T>& f) -> Tensor4& { return f.d2A_by_dXdX_ref(); });
+        }
+
+    public:
+        MagneticFieldSum(vector<shared_ptr<MagneticField<T>>> fields) : MagneticField<T>(), fields(fields) {
+            if(fields.size() == 0)
+                throw std::runtime_error("MagneticFieldSum needs at least one field.");
+            for (auto& field : fields) {
+                if(!field)
+                    throw std::runtime_error("The fields of a MagneticFieldSum must not be None.");
+            }
+        }
+};
+
+template<template<class, std::size_t, xt::layout_type> class T>
+class MagneticFieldScaled : public MagneticField<T> {
+    /*
+     * A magnetic field multiplied by a constant. Changing the scalar clears
+     * the cache of this field and of the sums it is part of, but not the one
+     * of the underlying field.
+     */
+    public:
+        using typename MagneticField<T>::Tensor2;
+        using typename MagneticField<T>::Tensor3;
+        using typename MagneticField<T>::Tensor4;
+        const shared_ptr<MagneticField<T>> field;
+
+    private:
+        double scalar;
+        bool linked = false;
+
+        // see MagneticFieldSum::link_children
+        void link_field() {
+            if(linked)
+                return;
+            auto self = this->weak_from_this();
+            if(self.expired())
+                throw std::runtime_error("A MagneticFieldScaled needs to be owned by a shared_ptr.");
+            field->add_dependent(self);
+            linked = true;
+        }
+
+        template<class Tensor>
+        void scale(Tensor& out, Tensor& in) {
+            link_field();
+            if(in.size() != out.size())
+                throw std::runtime_error("The field in a MagneticFieldScaled is evaluated at different points, call set_points on the scaled field.");
+            accumulate_fields(out.data(), {in.data()}, scalar, out.size());
+        }
+
+    protected:
+        void _set_points_cb() override {
+            field->set_pointset(this->get_pointset());
+        }
+
+        void _B_impl(Tensor2& B) override { scale(B, field->B_ref()); }
+        void _dB_by_dX_impl(Tensor3& dB_by_dX) override { scale(dB_by_dX, field->dB_by_dX_ref()); }
+        void _d2B_by_dXdX_impl(Tensor4& d2B_by_dXdX) override { scale(d2B_by_dXdX, field->d2B_by_dXdX_ref()); }
+        void _A_impl(Tensor2& A) override { scale(A, field->A_ref()); }
+        void _dA_by_dX_impl(Tensor3& dA_by_dX) override { scale(dA_by_dX, field->dA_by_dX_ref()); }
+        void _d2A_by_dXdX_impl(Tensor4& d2A_by_dXdX) override { scale(d2A_by_dXdX, field->d2A_by_dXdX_ref()); }
+
+    public:
+        MagneticFieldScaled(shared_ptr<MagneticField<T>> field, double scalar) : MagneticField<T>(), field(field), scalar(scalar) {
+            if(!field)
+                throw std::runtime_error("The field of a MagneticFieldScaled must not be None.");
+        }
+
+        double get_scalar() { return scalar; }
+
+        void set_scalar(double val) {
+            scalar = val;
+            this->invalidate_cache();
+        }
+};
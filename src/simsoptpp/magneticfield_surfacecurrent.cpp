@@ -0,0 +1,255 @@
+#include "magneticfield_surfacecurrent.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#if defined(USE_XSIMD)
+static inline simd_t drop_coincident(const simd_t& r2, double tol2, const simd_t& val) {
+    return xsimd::select(r2 > simd_t(tol2), val, simd_t(0.));
+}
+#endif
+static inline double drop_coincident(double r2, double tol2, double val) {
+    return r2 > tol2 ? val : 0.;
+}
+
+// Adds the field of the current element K dA at (sx, sy, sz), and its
+// derivatives if dB is not null, unless the target coincides with it.
+template<class S>
+static inline void direct_kernel(const S& x, const S& y, const S& z, double sx, double sy, double sz,
+        double Kx, double Ky, double Kz, double tol2, S (&B)[3], S (*dB)[3]) {
+    using std::sqrt;
+    S dx = x - sx;
+    S dy = y - sy;
+    S dz = z - sz;
+    S r2 = dx*dx + dy*dy + dz*dz;
+    S rinv = drop_coincident(r2, tol2, S(1.)/sqrt(r2));
+    S rinv3 = rinv*rinv*rinv;
+    S c[3] = {Ky*dz - Kz*dy, Kz*dx - Kx*dz, Kx*dy - Ky*dx};
+    for (int l = 0; l < 3; ++l)
+        B[l] += c[l]*rinv3;
+    if(!dB)
+        return;
+    // dB_l/dx_k = (K x e_k)_l / r^3 - 3 (K x d)_l d_k / r^5
+    S rinv5_3 = 3.*rinv3*rinv*rinv;
+    S d[3] = {dx, dy, dz};
+    S Kxe[3][3] = {{S(0.), S(Kz), S(-Ky)}, {S(-Kz), S(0.), S(Kx)}, {S(Ky), S(-Kx), S(0.)}};
+    for (int k = 0; k < 3; ++k) {
+        for (int l = 0; l < 3; ++l)
+            dB[k][l] += Kxe[k][l]*rinv3 - c[l]*d[k]*rinv5_3;
+    }
+}
+
+// Adds the first two terms of the multipole expansion of the field of a patch,
+//   sum K x (d - s)/|d - s|^3 ~ M0 x d/|d|^3 - sum_j M1[:, j] x d/dd_j (d/|d|^3),
+// with d = x - center and s = y - center, and its derivatives if dB is not null.
+template<class S>
+static inline void far_kernel(const S& x, const S& y, const S& z, const SurfaceCurrentPatch& p, S (&B)[3], S (*dB)[3]) {
+    using std::sqrt;
+    S d[3] = {x - p.center[0], y - p.center[1], z - p.center[2]};
+    S r2 = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+    S rinv = S(1.)/sqrt(r2);
+    S rinv2 = rinv*rinv;
+    S rinv3 = rinv*rinv2;
+    S rinv5 = rinv3*rinv2;
+    S Md[3], u[3];
+    for (int a = 0; a < 3; ++a) {
+        Md[a] = p.M1[a][0]*d[0] + p.M1[a][1]*d[1] + p.M1[a][2]*d[2];
+        u[a] = p.M0[a]*rinv3 + 3.*Md[a]*rinv5;
+    }
+    // B = u x d - w/|d|^3
+    B[0] += u[1]*d[2] - u[2]*d[1] - p.w[0]*rinv3;
+    B[1] += u[2]*d[0] - u[0]*d[2] - p.w[1]*rinv3;
+    B[2] += u[0]*d[1] - u[1]*d[0] - p.w[2]*rinv3;
+    if(!dB)
+        return;
+    S rinv7 = rinv5*rinv2;
+    for (int k = 0; k < 3; ++k) {
+        S du[3];
+        for (int a = 0; a < 3; ++a)
+            du[a] = 3.*p.M1[a][k]*rinv5 - 3.*p.M0[a]*d[k]*rinv5 - 15.*Md[a]*d[k]*rinv7;
+        // (u x e_k)_l
+        S uxe[3] = {S(0.), S(0.), S(0.)};
+        uxe[(k+1)%3] = u[(k+2)%3];
+        uxe[(k+2)%3] = S(-1.)*u[(k+1)%3];
+        dB[k][0] += du[1]*d[2] - du[2]*d[1] + uxe[0] + 3.*p.w[0]*d[k]*rinv5;
+        dB[k][1] += du[2]*d[0] - du[0]*d[2] + uxe[1] + 3.*p.w[1]*d[k]*rinv5;
+        dB[k][2] += du[0]*d[1] - du[1]*d[0] + uxe[2] + 3.*p.w[2]*d[k]*rinv5;
+    }
+}
+
+template<template<class, std::size_t, xt::layout_type> class T, class Array>
+SurfaceCurrentField<T, Array>::SurfaceCurrentField(shared_ptr<Surface<Array>> surface, Array& K, double theta) :
+    MagneticField<T>(), surface(surface), theta(theta) {
+    if(!surface)
+        throw std::runtime_error("The surface of a SurfaceCurrentField must not be None.");
+    if(theta < 0)
+        throw std::runtime_error("theta needs to be nonnegative.");
+    set_K(K);
+}
+
+template<template<class, std::size_t, xt::layout_type> class T, class Array>
+void SurfaceCurrentField<T, Array>::set_K(Array& K_) {
+    int nphi = surface->numquadpoints_phi;
+    int ntheta = surface->numquadpoints_theta;
+    if(K_.dimension() != 3 || (int)K_.shape(0) != nphi || (int)K_.shape(1) != ntheta || K_.shape(2) != 3)
+        throw std::runtime_error("K needs to have shape (nphi, ntheta, 3), matching the quadrature points of the surface.");
+    K = vector<double>(3*nphi*ntheta);
+    for (int i = 0; i < nphi; ++i) {
+        for (int j = 0; j < ntheta; ++j) {
+            for (int l = 0; l < 3; ++l)
+                K[3*(i*ntheta + j) + l] = K_(i, j, l);
+        }
+    }
+    invalidate_sources();
+}
+
+template<template<class, std::size_t, xt::layout_type> class T, class Array>
+Array SurfaceCurrentField<T, Array>::get_K() {
+    int nphi = surface->numquadpoints_phi;
+    int ntheta = surface->numquadpoints_theta;
+    Array res = xt::zeros<double>({nphi, ntheta, 3});
+    for (int i = 0; i < nphi; ++i) {
+        for (int j = 0; j < ntheta; ++j) {
+            for (int l = 0; l < 3; ++l)
+                res(i, j, l) = K[3*(i*ntheta + j) + l];
+        }
+    }
+    return res;
+}
+
+template<template<class, std::size_t, xt::layout_type> class T, class Array>
+void SurfaceCurrentField<T, Array>::update_sources() {
+    int nphi = surface->numquadpoints_phi;
+    int ntheta = surface->numquadpoints_theta;
+    Array& gamma = surface->gamma();
+    Array& normal = surface->normal();
+    int nsrc = nphi*ntheta;
+    for (auto* v : {&xs, &ys, &zs, &Kxs, &Kys, &Kzs}) {
+        if((int)v->size() != nsrc) {
+            v->clear();
+            v->resize(nsrc, 0.);
+        }
+    }
+    patches.clear();
+    double scale2 = 0.;
+    int idx = 0;
+    for (int i0 = 0; i0 < nphi; i0 += patch_size) {
+        for (int j0 = 0; j0 < ntheta; j0 += patch_size) {
+            SurfaceCurrentPatch p;
+            p.begin = idx;
+            for (int i = i0; i < std::min(i0 + patch_size, nphi); ++i) {
+                for (int j = j0; j < std::min(j0 + patch_size, ntheta); ++j) {
+                    double nx = normal(i, j, 0), ny = normal(i, j, 1), nz = normal(i, j, 2);
+                    double dA = std::sqrt(nx*nx + ny*ny + nz*nz)/nsrc;
+                    const double* Kij = &K[3*(i*ntheta + j)];
+                    xs[idx] = gamma(i, j, 0);
+                    ys[idx] = gamma(i, j, 1);
+                    zs[idx] = gamma(i, j, 2);
+                    Kxs[idx] = Kij[0]*dA;
+                    Kys[idx] = Kij[1]*dA;
+                    Kzs[idx] = Kij[2]*dA;
+                    scale2 = std::max(scale2, xs[idx]*xs[idx] + ys[idx]*ys[idx] + zs[idx]*zs[idx]);
+                    ++idx;
+                }
+            }
+            p.end = idx;
+            int count = p.end - p.begin;
+            for (int l = 0; l < 3; ++l)
+                p.center[l] = 0.;
+            for (int s = p.begin; s < p.end; ++s) {
+                p.center[0] += xs[s]/count;
+                p.center[1] += ys[s]/count;
+                p.center[2] += zs[s]/count;
+            }
+            double rho2 = 0.;
+            for (int a = 0; a < 3; ++a) {
+                p.M0[a] = 0.;
+                for (int j = 0; j < 3; ++j)
+                    p.M1[a][j] = 0.;
+            }
+            for (int s = p.begin; s < p.end; ++s) {
+                double y[3] = {xs[s] - p.center[0], ys[s] - p.center[1], zs[s] - p.center[2]};
+                double Ks[3] = {Kxs[s], Kys[s], Kzs[s]};
+                rho2 = std::max(rho2, y[0]*y[0] + y[1]*y[1] + y[2]*y[2]);
+                for (int a = 0; a < 3; ++a) {
+                    p.M0[a] += Ks[a];
+                    for (int j = 0; j < 3; ++j)
+                        p.M1[a][j] += Ks[a]*y[j];
+                }
+            }
+            p.w[0] = p.M1[1][2] - p.M1[2][1];
+            p.w[1] = p.M1[2][0] - p.M1[0][2];
+            p.w[2] = p.M1[0][1] - p.M1[1][0];
+            p.far2 = theta > 0 ? rho2/(theta*theta) : std::numeric_limits<double>::infinity();
+            patches.push_back(p);
+        }
+    }
+    // targets closer than this to a quadrature point are considered to lie on it
+    coincident_tol2 = 1e-24*scale2;
+    sources_status = true;
+}
+
+template<template<class, std::size_t, xt::layout_type> class T, class Array>
+void SurfaceCurrentField<T, Array>::compute(Tensor2* B, Tensor3* dB) {
+    if(!sources_status)
+        update_sources();
+    Tensor2& points = this->get_points_cart_ref();
+#if defined(USE_XSIMD)
+    using S = simd_t;
+    constexpr int simd_size = xsimd::simd_type<double>::size;
+#else
+    using S = double;
+    constexpr int simd_size = 1;
+#endif
+    const double mu0_over_4pi = 1e-7;
+    double* points_ptr = &(points(0, 0));
+    double* B_ptr = B ? &((*B)(0, 0)) : nullptr;
+    double* dB_ptr = dB ? &((*dB)(0, 0, 0)) : nullptr;
+    int num_points = npoints;
+    double tol2 = coincident_tol2;
+#pragma omp parallel
+    {
+        double xbuf[simd_size], ybuf[simd_size], zbuf[simd_size];
+#pragma omp for schedule(dynamic, 4)
+        for (int i = 0; i < num_points; i += simd_size) {
+            S x, y, z;
+            int klimit = load_points_padded<simd_size>(points_ptr, num_points, i, xbuf, ybuf, zbuf, x, y, z);
+            S B_i[3] = {S(0.), S(0.), S(0.)};
+            S dB_i[3][3];
+            for (int k = 0; k < 3; ++k) {
+                for (int l = 0; l < 3; ++l)
+                    dB_i[k][l] = S(0.);
+            }
+            S (*dB_i_ptr)[3] = dB_ptr ? dB_i : nullptr;
+            for (const SurfaceCurrentPatch& p : patches) {
+                bool far = theta > 0;
+                for (int l = 0; far && l < simd_size; ++l) {
+                    double dx = xbuf[l] - p.center[0];
+                    double dy = ybuf[l] - p.center[1];
+                    double dz = zbuf[l] - p.center[2];
+                    far = dx*dx + dy*dy + dz*dz > p.far2;
+                }
+                if(far) {
+                    far_kernel(x, y, z, p, B_i, dB_i_ptr);
+                } else {
+                    for (int s = p.begin; s < p.end; ++s)
+                        direct_kernel(x, y, z, xs[s], ys[s], zs[s], Kxs[s], Kys[s], Kzs[s], tol2, B_i, dB_i_ptr);
+                }
+            }
+            if(B_ptr) {
+                for (int l = 0; l < 3; ++l)
+                    store_lanes_strided<simd_size>(B_ptr + 3*i + l, 3, klimit, B_i[l], mu0_over_4pi);
+            }
+            if(dB_ptr) {
+                for (int k = 0; k < 3; ++k) {
+                    for (int l = 0; l < 3; ++l)
+                        store_lanes_strided<simd_size>(dB_ptr + 9*i + 3*k + l, 9, klimit, dB_i[k][l], mu0_over_4pi);
+                }
+            }
+        }
+    }
+}
+
+#include "xtensor-python/pyarray.hpp"     // Numpy bindings
+#include "xtensor-python/pytensor.hpp"     // Numpy bindings
+template class SurfaceCurrentField<xt::pytensor, xt::pyarray<double>>;
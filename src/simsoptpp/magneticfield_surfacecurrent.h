@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vector>
+#include "magneticfield.h"
+#include "surface.h"
+#include "simdhelpers.h"
+
+using std::vector;
+using std::shared_ptr;
+
+// A block of neighbouring quadrature points of the surface together with the
+// moments of its current about its centre, used for the far field.
+struct SurfaceCurrentPatch {
+    int begin, end;
+    double center[3];
+    // a target is far from the patch if its squared distance to the centre
+    // exceeds this value
+    double far2;
+    // M0 = sum K dA, M1[a][j] = sum K_a (x - center)_j dA, and the
+    // antisymmetric part of M1 as a vector
+    double M0[3], M1[3][3], w[3];
+};
+
+template<template<class, std::size_t, xt::layout_type> class T, class Array>
+class SurfaceCurrentField : public MagneticField<T> {
+    /*
+     * The magnetic field of a current sheet with surface current density K on
+     * a surface,
+     *
+     *   B(x) = mu0/(4 pi) int K(y) x (x - y)/|x - y|^3 dA(y),
+     *
+     * discretized with the trapezoidal rule on the quadrature points of the
+     * surface, which therefore need to cover the full torus. Examples are the
+     * current on a winding surface, or the current K = n x B/mu0 on a flux
+     * surface, whose field outside the surface is the one of the plasma
+     * currents by the virtual casing principle.
+     *
+     * Targets that coincide with a quadrature point skip that point, so that
+     * on the surface the average of the fields on both sides is obtained to
+     * the order of the quadrature spacing.
+     *
+     * Targets are processed in parallel and in blocks of the simd width. If
+     * theta > 0, the quadrature points are grouped into patches and the
+     * contribution of patches whose distance from all targets in a block is
+     * larger than their radius divided by theta is approximated by the first
+     * two terms of the multipole expansion, i.e. with a relative error of
+     * order theta^2. For theta = 0 the sum is evaluated directly.
+     *
+     * The positions and K dA of the quadrature points and the patches are
+     * computed from the surface on first use and kept until K is set again or
+     * `invalidate_sources()` is called, which is needed whenever the surface
+     * changes. B and its derivative are computed in one pass.
+     */
+    public:
+        using typename MagneticField<T>::Tensor2;
+        using typename MagneticField<T>::Tensor3;
+        using MagneticField<T>::npoints;
+        const shared_ptr<Surface<Array>> surface;
+        const double theta;
+
+    private:
+        // K on the quadrature points, stored as (nphi, ntheta, 3)
+        vector<double> K;
+        // positions and K dA of the quadrature points, ordered by patches
+        AlignedPaddedVec xs, ys, zs, Kxs, Kys, Kzs;
+        vector<SurfaceCurrentPatch> patches;
+        double coincident_tol2;
+        // whether the sources above are up to date with the surface and K
+        bool sources_status = false;
+
+        void update_sources();
+        void compute(Tensor2* B, Tensor3* dB);
+
+    protected:
+        void _B_impl(Tensor2& B) override {
+            compute(&B, nullptr);
+        }
+
+        void _dB_by_dX_impl(Tensor3& dB_by_dX) override {
+            // B is filled in the same pass, unless it is in the cache already
+            if(this->data_B.get_status())
+                compute(nullptr, &dB_by_dX);
+            else
+                compute(&this->data_B.get_or_create({npoints, 3}), &dB_by_dX);
+        }
+
+    public:
+        // Number of quadrature points per patch in each direction.
+        static constexpr int patch_size = 8;
+
+        SurfaceCurrentField(shared_ptr<Surface<Array>> surface, Array& K, double theta);
+
+        // Sets the surface current density, a `(nphi, ntheta, 3)` array.
+        void set_K(Array& K);
+
+        // Recomputes the sources from the surface on the next evaluation and
+        // clears the cache, needs to be called when the surface changes.
+        void invalidate_sources() {
+            sources_status = false;
+            this->invalidate_cache();
+        }
+
+        Array get_K();
+};
@@ -0,0 +1,236 @@
+#include "multifilament.h"
+#include <Eigen/Core>
+#include <Eigen/Dense>
+#include <cmath>
+#include <stdexcept>
+
+typedef Eigen::Vector3d Vec3d;
+
+static inline Vec3d row(Array& data, int i) {
+    return Vec3d(data(i, 0), data(i, 1), data(i, 2));
+}
+
+// The rotated centroid frame at a single quadrature point, together with its
+// derivative along the curve and all intermediate quantities that are needed
+// to compute the vector-Jacobian product.
+struct CentroidFrame {
+    double l, s, p, tgdd, sd, nmd, ca, sa, ad;
+    Vec3d t, delta, n, b, nn, bb, td, deltad, md, nd, bd, nnd, bbd;
+
+    CentroidFrame(const Vec3d& g, const Vec3d& gd, const Vec3d& gdd, const Vec3d& R, const Vec3d& Rd, double alpha, double alphadash) {
+        l = gd.norm();
+        t = gd/l;
+        delta = g - R;
+        s = delta.dot(t);
+        Vec3d m = delta - s * t;
+        p = m.norm();
+        n = m/p;
+        b = t.cross(n);
+        ca = std::cos(alpha);
+        sa = std::sin(alpha);
+        ad = alphadash;
+        nn = ca * n - sa * b;
+        bb = sa * n + ca * b;
+
+        tgdd = t.dot(gdd);
+        td = (gdd - tgdd * t)/l;
+        deltad = gd - Rd;
+        sd = deltad.dot(t) + delta.dot(td);
+        md = deltad - sd * t - s * td;
+        nmd = n.dot(md);
+        nd = (md - nmd * n)/p;
+        bd = td.cross(n) + t.cross(nd);
+        nnd = ca * nd - sa * bd - ad * bb;
+        bbd = sa * nd + ca * bd + ad * nn;
+    }
+};
+
+static void check_inputs(Array& gamma, Array& gammadash, Array& gammadashdash, Array& alpha, Array& alphadash,
+        vector<double>& dn, vector<double>& db) {
+    int nq = gamma.shape(0);
+    if(gamma.dimension() != 2 || gamma.shape(1) != 3)
+        throw std::runtime_error("gamma has wrong shape.");
+    if(gammadash.shape(0) != nq || gammadashdash.shape(0) != nq)
+        throw std::runtime_error("gamma, gammadash and gammadashdash need to have the same shape.");
+    if(alpha.size() != nq || alphadash.size() != nq)
+        throw std::runtime_error("alpha and alphadash need to have one entry per quadrature point.");
+    if(db.size() != dn.size())
+        throw std::runtime_error("dn and db need to have the same length.");
+}
+
+static void centre_of_mass(Array& gamma, Array& gammadash, Vec3d& R, Vec3d& Rd) {
+    int nq = gamma.shape(0);
+    R = Vec3d::Zero();
+    Rd = Vec3d::Zero();
+    for (int i = 0; i < nq; ++i) {
+        R += row(gamma, i);
+        Rd += row(gammadash, i);
+    }
+    R /= nq;
+    Rd /= nq;
+}
+
+void multifilament_gamma(Array& gamma, Array& gammadash, Array& gammadashdash, Array& alpha, Array& alphadash,
+        vector<double>& dn, vector<double>& db, Array& filaments_gamma, Array& filaments_gammadash) {
+    check_inputs(gamma, gammadash, gammadashdash, alpha, alphadash, dn, db);
+    int nq = gamma.shape(0);
+    int nfil = dn.size();
+    if(filaments_gamma.shape(0) != nfil*nq || filaments_gammadash.shape(0) != nfil*nq)
+        throw std::runtime_error("filaments_gamma and filaments_gammadash need to have shape (nfilaments*nquadpoints, 3).");
+    Vec3d R, Rd;
+    centre_of_mass(gamma, gammadash, R, Rd);
+
+    double* fg = &(filaments_gamma(0, 0));
+    double* fgd = &(filaments_gammadash(0, 0));
+#pragma omp parallel for
+    for (int i = 0; i < nq; ++i) {
+        Vec3d g = row(gamma, i);
+        Vec3d gd = row(gammadash, i);
+        auto frame = CentroidFrame(g, gd, row(gammadashdash, i), R, Rd, alpha[i], alphadash[i]);
+        for (int k = 0; k < nfil; ++k) {
+            Vec3d fil = g + dn[k] * frame.nn + db[k] * frame.bb;
+            Vec3d fild = gd + dn[k] * frame.nnd + db[k] * frame.bbd;
+            for (int j = 0; j < 3; ++j) {
+                fg[3*(k*nq + i) + j] = fil[j];
+                fgd[3*(k*nq + i) + j] = fild[j];
+            }
+        }
+    }
+}
+
+std::tuple<Array, Array, Array, Array, Array> multifilament_vjp(Array& gamma, Array& gammadash, Array& gammadashdash, Array& alpha, Array& alphadash,
+        vector<double>& dn, vector<double>& db, Array& v_gamma, Array& v_gammadash) {
+    check_inputs(gamma, gammadash, gammadashdash, alpha, alphadash, dn, db);
+    int nq = gamma.shape(0);
+    int nfil = dn.size();
+    if(v_gamma.shape(0) != nfil*nq || v_gammadash.shape(0) != nfil*nq)
+        throw std::runtime_error("v_gamma and v_gammadash need to have shape (nfilaments*nquadpoints, 3).");
+    Vec3d R, Rd;
+    centre_of_mass(gamma, gammadash, R, Rd);
+
+    // Creating new xtensor arrays from an openmp thread doesn't appear
+    // to be safe. so we do that here in serial.
+    Array res_gamma = xt::zeros<double>({nq, 3});
+    Array res_gammadash = xt::zeros<double>({nq, 3});
+    Array res_gammadashdash = xt::zeros<double>({nq, 3});
+    Array res_alpha = xt::zeros<double>({nq});
+    Array res_alphadash = xt::zeros<double>({nq});
+    // gradients with respect to the centre of mass R and its derivative Rd
+    // are accumulated per point and distributed back onto all points at the end
+    vector<Vec3d> res_R(nq), res_Rd(nq);
+
+    double* vg_ptr = &(v_gamma(0, 0));
+    double* vgd_ptr = &(v_gammadash(0, 0));
+#pragma omp parallel for
+    for (int i = 0; i < nq; ++i) {
+        Vec3d g = row(gamma, i);
+        Vec3d gd = row(gammadash, i);
+        Vec3d gdd = row(gammadashdash, i);
+        auto f = CentroidFrame(g, gd, gdd, R, Rd, alpha[i], alphadash[i]);
+
+        // sum over the filaments, this is the only part that scales with the
+        // number of filaments.
+        Vec3d v_g = Vec3d::Zero(), v_gd = Vec3d::Zero();
+        Vec3d v_nn = Vec3d::Zero(), v_bb = Vec3d::Zero(), v_nnd = Vec3d::Zero(), v_bbd = Vec3d::Zero();
+        for (int k = 0; k < nfil; ++k) {
+            Vec3d vg = Eigen::Map<const Vec3d>(vg_ptr + 3*(k*nq + i));
+            Vec3d vgd = Eigen::Map<const Vec3d>(vgd_ptr + 3*(k*nq + i));
+            v_g += vg;
+            v_nn += dn[k] * vg;
+            v_bb += db[k] * vg;
+            v_gd += vgd;
+            v_nnd += dn[k] * vgd;
+            v_bbd += db[k] * vgd;
+        }
+
+        // reverse pass through CentroidFrame
+        Vec3d v_nd = f.ca * v_nnd + f.sa * v_bbd;
+        Vec3d v_bd = -f.sa * v_nnd + f.ca * v_bbd;
+        v_bb -= f.ad * v_nnd;
+        v_nn += f.ad * v_bbd;
+        double v_ad = -f.bb.dot(v_nnd) + f.nn.dot(v_bbd);
+        double v_a = (-f.sa * f.nd - f.ca * f.bd).dot(v_nnd) + (f.ca * f.nd - f.sa * f.bd).dot(v_bbd);
+
+        // bd = td x n + t x nd
+        Vec3d v_td = f.n.cross(v_bd);
+        Vec3d v_n = v_bd.cross(f.td);
+        Vec3d v_t = f.nd.cross(v_bd);
+        v_nd += v_bd.cross(f.t);
+        // nd = (md - nmd n)/p
+        Vec3d v_md = v_nd/f.p;
+        double v_nmd = -f.n.dot(v_nd)/f.p;
+        v_n -= f.nmd * v_nd/f.p;
+        double v_p = -f.nd.dot(v_nd)/f.p;
+        // nmd = n . md
+        v_n += v_nmd * f.md;
+        v_md += v_nmd * f.n;
+        // md = deltad - sd t - s td
+        Vec3d v_deltad = v_md;
+        double v_sd = -f.t.dot(v_md);
+        v_t -= f.sd * v_md;
+        double v_s = -f.td.dot(v_md);
+        v_td -= f.s * v_md;
+        // sd = deltad . t + delta . td
+        v_deltad += v_sd * f.t;
+        v_t += v_sd * f.deltad;
+        Vec3d v_delta = v_sd * f.td;
+        v_td += v_sd * f.delta;
+        // deltad = gd - Rd
+        v_gd += v_deltad;
+        res_Rd[i] = -v_deltad;
+        // td = (gdd - tgdd t)/l
+        Vec3d v_gdd = v_td/f.l;
+        double v_tgdd = -f.t.dot(v_td)/f.l;
+        v_t -= f.tgdd * v_td/f.l;
+        double v_l = -f.td.dot(v_td)/f.l;
+        // tgdd = t . gdd
+        v_t += v_tgdd * gdd;
+        v_gdd += v_tgdd * f.t;
+        // nn = ca n - sa b, bb = sa n + ca b
+        v_n += f.ca * v_nn + f.sa * v_bb;
+        Vec3d v_b = -f.sa * v_nn + f.ca * v_bb;
+        v_a += -f.bb.dot(v_nn) + f.nn.dot(v_bb);
+        // b = t x n
+        v_t += f.n.cross(v_b);
+        v_n += v_b.cross(f.t);
+        // n = m/p, p = |m|
+        Vec3d v_m = v_n/f.p;
+        v_p -= f.n.dot(v_n)/f.p;
+        v_m += v_p * f.n;
+        // m = delta - s t, s = delta . t
+        v_delta += v_m;
+        v_s -= f.t.dot(v_m);
+        v_t -= f.s * v_m;
+        v_delta += v_s * f.t;
+        v_t += v_s * f.delta;
+        // delta = g - R
+        v_g += v_delta;
+        res_R[i] = -v_delta;
+        // t = gd/l, l = |gd|
+        v_gd += v_t/f.l;
+        v_l -= f.t.dot(v_t)/f.l;
+        v_gd += v_l * f.t;
+
+        for (int j = 0; j < 3; ++j) {
+            res_gamma(i, j) = v_g[j];
+            res_gammadash(i, j) = v_gd[j];
+            res_gammadashdash(i, j) = v_gdd[j];
+        }
+        res_alpha(i) = v_a;
+        res_alphadash(i) = v_ad;
+    }
+
+    // R and Rd are the means of gamma and gammadash
+    Vec3d v_R = Vec3d::Zero(), v_Rd = Vec3d::Zero();
+    for (int i = 0; i < nq; ++i) {
+        v_R += res_R[i];
+        v_Rd += res_Rd[i];
+    }
+    for (int i = 0; i < nq; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            res_gamma(i, j) += v_R[j]/nq;
+            res_gammadash(i, j) += v_Rd[j]/nq;
+        }
+    }
+    return std::make_tuple(res_gamma, res_gammadash, res_gammadashdash, res_alpha, res_alphadash);
+}
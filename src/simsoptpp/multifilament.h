@@ -0,0 +1,33 @@
+#pragma once
+
+#include <tuple>
+#include <vector>
+#include "xtensor-python/pyarray.hpp"     // Numpy bindings
+typedef xt::pyarray<double> Array;
+using std::vector;
+
+// Multifilament approximation of a finite build coil, see
+// Singh et al, "Optimization of finite-build stellarator coils",
+// Journal of Plasma Physics 86 (2020), doi:10.1017/S0022377820000756.
+//
+// Given the centre line `gamma` (and its first two derivatives) and the
+// rotation angle `alpha` (and its derivative) of the winding pack, the
+// rotated centroid frame (t, n, b) is computed once per quadrature point and
+// all filaments
+//
+//   gamma_k = gamma + dn[k] * n + db[k] * b,
+//
+// are written into a single block of shape (nfilaments * nquadpoints, 3), with
+// filament k occupying rows k*nquadpoints, ..., (k+1)*nquadpoints - 1.
+
+void multifilament_gamma(Array& gamma, Array& gammadash, Array& gammadashdash, Array& alpha, Array& alphadash,
+        vector<double>& dn, vector<double>& db, Array& filaments_gamma, Array& filaments_gammadash);
+
+// Vector-Jacobian product of `multifilament_gamma`. Given v_gamma and
+// v_gammadash of shape (nfilaments * nquadpoints, 3), returns the products
+// with respect to gamma, gammadash, gammadashdash, alpha and alphadash of the
+// centre line. The sum over the filaments is done before the frame is
+// differentiated, so the cost is independent of the number of filaments up to
+// one pass over the block.
+std::tuple<Array, Array, Array, Array, Array> multifilament_vjp(Array& gamma, Array& gammadash, Array& gammadashdash, Array& alpha, Array& alphadash,
+        vector<double>& dn, vector<double>& db, Array& v_gamma, Array& v_gammadash);
@@ -0,0 +1,229 @@
+#include "perf.h"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace perf {
+
+#ifdef SIMSOPT_PERF
+
+struct TraceEvent {
+    std::string name;
+    double start;
+    double duration;
+};
+
+// The statistics of one kernel in one thread. Only the owning thread writes
+// to them, so they are atomic only to be read by `report` at any time.
+struct KernelSlot {
+    KernelSlot(const std::string& name) : name(name) {}
+    const std::string name;
+    std::atomic<uint64_t> calls{0};
+    std::atomic<double> time{0.}; // seconds
+    std::atomic<uint64_t> points{0};
+    std::atomic<uint64_t> pairs{0};
+    std::atomic<uint64_t> flops{0};
+};
+
+struct CounterSlot {
+    CounterSlot(const std::string& name) : name(name) {}
+    const std::string name;
+    std::atomic<uint64_t> value{0};
+};
+
+template<class A>
+static inline void add_relaxed(A& a, decltype(a.load()) n) {
+    a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// The statistics of one thread. The maps from the names to the slots are
+// only used by the owning thread. The mutex is taken when a slot or trace
+// event is added and while a report is created.
+struct ThreadBuffer {
+    std::mutex mutex;
+    int tid;
+    // deques, so that adding slots doesn't move the existing ones
+    std::deque<KernelSlot> kernels;
+    std::deque<CounterSlot> counters;
+    std::unordered_map<const char*, KernelSlot*> kernels_by_address;
+    std::unordered_map<std::string, KernelSlot*> kernels_by_name;
+    std::unordered_map<const char*, CounterSlot*> counters_by_address;
+    std::vector<TraceEvent> events;
+
+    template<class Key, class Slot>
+    Slot* slot(std::unordered_map<Key, Slot*>& index, std::deque<Slot>& slots, const Key& key) {
+        auto it = index.find(key);
+        if(it != index.end())
+            return it->second;
+        std::lock_guard<std::mutex> lock(mutex);
+        slots.emplace_back(key);
+        return index[key] = &slots.back();
+    }
+};
+
+static std::mutex buffers_mutex;
+static std::atomic<bool> tracing(false);
+
+// The buffers are kept alive after their thread exits, so that no statistics
+// are lost.
+static std::vector<std::shared_ptr<ThreadBuffer>>& buffers() {
+    static std::vector<std::shared_ptr<ThreadBuffer>> all;
+    return all;
+}
+
+static ThreadBuffer& local_buffer() {
+    thread_local std::shared_ptr<ThreadBuffer> buffer = [](){
+        auto b = std::make_shared<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        b->tid = buffers().size();
+        buffers().push_back(b);
+        return b;
+    }();
+    return *buffer;
+}
+
+static double now() {
+    static const auto origin = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - origin).count();
+}
+
+void count(const char* name, uint64_t n) {
+    ThreadBuffer& buffer = local_buffer();
+    add_relaxed(buffer.slot(buffer.counters_by_address, buffer.counters, name)->value, n);
+}
+
+ScopedTimer::ScopedTimer(const char* name) : start(now()) {
+    ThreadBuffer& buffer = local_buffer();
+    slot = buffer.slot(buffer.kernels_by_address, buffer.kernels, name);
+}
+
+ScopedTimer::ScopedTimer(const std::string& name) : start(now()) {
+    ThreadBuffer& buffer = local_buffer();
+    slot = buffer.slot(buffer.kernels_by_name, buffer.kernels, name);
+}
+
+ScopedTimer::~ScopedTimer() {
+    double duration = now() - start;
+    add_relaxed(slot->calls, 1);
+    add_relaxed(slot->time, duration);
+    add_relaxed(slot->points, points);
+    add_relaxed(slot->pairs, pairs);
+    add_relaxed(slot->flops, flops);
+    if(tracing) {
+        ThreadBuffer& buffer = local_buffer();
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        buffer.events.push_back({slot->name, start, duration});
+    }
+}
+
+bool enabled() {
+    return true;
+}
+
+Report report() {
+    Report res;
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    for (auto& buffer : buffers()) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        // the same name may have several slots, e.g. for equal string
+        // literals at different addresses
+        for (auto& slot : buffer->kernels) {
+            if(slot.calls == 0)
+                continue;
+            KernelStats& stats = res.kernels[slot.name];
+            stats.calls += slot.calls;
+            stats.time += slot.time;
+            stats.points += slot.points;
+            stats.pairs += slot.pairs;
+            stats.flops += slot.flops;
+        }
+        for (auto& slot : buffer->counters) {
+            if(slot.value > 0)
+                res.counters[slot.name] += slot.value;
+        }
+    }
+    return res;
+}
+
+void reset() {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    for (auto& buffer : buffers()) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        // the slots stay, as their threads may be using them right now
+        for (auto& slot : buffer->kernels) {
+            slot.calls = 0;
+            slot.time = 0.;
+            slot.points = 0;
+            slot.pairs = 0;
+            slot.flops = 0;
+        }
+        for (auto& slot : buffer->counters)
+            slot.value = 0;
+        buffer->events.clear();
+    }
+}
+
+void set_tracing(bool on) {
+    tracing = on;
+}
+
+static std::string escape(const std::string& s) {
+    std::string res;
+    for (char c : s) {
+        if(c == '"' || c == '\\')
+            res += '\\';
+        res += c;
+    }
+    return res;
+}
+
+void write_chrome_trace(const std::string& filename) {
+    std::ofstream out(filename);
+    if(!out)
+        throw std::runtime_error("Could not open " + filename + " for writing.");
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    out.precision(15);
+    bool first = true;
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    for (auto& buffer : buffers()) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        for (auto& event : buffer->events) {
+            out << (first ? "\n" : ",\n");
+            out << "{\"name\": \"" << escape(event.name) << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << buffer->tid
+                << ", \"ts\": " << 1e6*event.start << ", \"dur\": " << 1e6*event.duration << "}";
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+}
+
+#else
+
+bool enabled() {
+    return false;
+}
+
+Report report() {
+    return Report();
+}
+
+void reset() {}
+
+void set_tracing(bool on) {
+    if(on)
+        throw std::runtime_error("simsoptpp was compiled without SIMSOPT_PERF, so no trace can be recorded.");
+}
+
+void write_chrome_trace(const std::string& /* filename */) {
+    throw std::runtime_error("simsoptpp was compiled without SIMSOPT_PERF, so no trace can be recorded.");
+}
+
+#endif
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "config.h"
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Instrumentation of the hot paths of simsoptpp. When compiled with
+// SIMSOPT_PERF (set the environment variable SIMSOPT_PERF=1 or pass
+// -DSIMSOPT_PERF=ON to cmake), kernels record their wall time, the number of
+// calls, and the number of points, pairs and floating point operations that
+// they process; the caches record their hits and misses. Without SIMSOPT_PERF
+// the macros below expand to nothing, so there is no overhead.
+//
+// Each thread records into its own buffer, the buffers are only combined in
+// `perf::report`, so kernels running in OpenMP threads can be instrumented.
+// Within a buffer, every counter and kernel has a slot that is looked up by
+// the address of its name, so names given as string literals cost neither a
+// std::string nor a lock per call.
+//
+// Usage:
+//
+//     void kernel(...) {
+//         SIMSOPT_PERF_SCOPE(timer, "kernel");
+//         ...
+//         SIMSOPT_PERF_ADD(timer, pairs, npoints*nsources);
+//     }
+//     SIMSOPT_PERF_COUNT("cache_hits", 1);
+
+namespace perf {
+
+struct KernelStats {
+    uint64_t calls = 0;
+    double time = 0.; // seconds
+    uint64_t points = 0;
+    uint64_t pairs = 0;
+    uint64_t flops = 0;
+};
+
+struct Report {
+    std::map<std::string, KernelStats> kernels;
+    std::map<std::string, uint64_t> counters;
+};
+
+// Returns true if simsoptpp was compiled with SIMSOPT_PERF.
+bool enabled();
+
+// Combines the statistics of all threads.
+Report report();
+
+// Clears all statistics and trace events.
+void reset();
+
+// Turns the recording of trace events on or off. When on, every timed scope
+// is recorded as an event that can be written with `write_chrome_trace`.
+void set_tracing(bool on);
+
+// Writes the recorded trace events in the Chrome trace event format, which
+// can be viewed in chrome://tracing or https://ui.perfetto.dev.
+void write_chrome_trace(const std::string& filename);
+
+#ifdef SIMSOPT_PERF
+
+struct KernelSlot;
+
+// `name` needs to outlive the program, e.g. be a string literal.
+void count(const char* name, uint64_t n);
+
+class ScopedTimer {
+    public:
+        // `name` needs to outlive the program, e.g. be a string literal.
+        ScopedTimer(const char* name);
+        // For names that are built at runtime, these are looked up by value.
+        ScopedTimer(const std::string& name);
+        ~ScopedTimer();
+        uint64_t points = 0;
+        uint64_t pairs = 0;
+        uint64_t flops = 0;
+    private:
+        KernelSlot* slot;
+        double start;
+};
+
+#endif
+
+}
+
+#ifdef SIMSOPT_PERF
+#define SIMSOPT_PERF_SCOPE(timer, name) perf::ScopedTimer timer(name)
+#define SIMSOPT_PERF_ADD(timer, field, n) timer.field += (n)
+#define SIMSOPT_PERF_COUNT(name, n) perf::count(name, n)
+#else
+#define SIMSOPT_PERF_SCOPE(timer, name)
+#define SIMSOPT_PERF_ADD(timer, field, n)
+#define SIMSOPT_PERF_COUNT(name, n)
+#endif
@@ -2,6 +2,8 @@
 #include <Eigen/Dense>
 #include "simdhelpers.h"
 #include "vec3dsimd.h"
+#include "pygil.h"
+#include "threads.h"
 #include "xtensor/xsort.hpp"
 #include "xtensor/xview.hpp"
 #include <functional>
@@ -98,24 +100,22 @@ void print_MwPGP(Array& A_obj, Array& b_obj, Array& x_k1, Array& m_proxy, Array&
 {
     int ngrid = A_obj.shape(0);
     int N = m_maxima.shape(0);
-    double R2 = 0.0;
-    double N2 = 0.0;
-    double L2 = 0.0;
-    double L1 = 0.0;
-    double L0 = 0.0;
     double cost = 0.0;
     double l0_tol = 1e-20;
-    Array R2_temp = xt::zeros<double>({ngrid});
-#pragma omp parallel for reduction(+: N2, L2, L1, L0)
-    for(int i = 0; i < N; ++i) {
+    vector<double> R2_temp(ngrid, 0.);
+    auto norms = threads::parallel_sum<4>(N, [&](int i, double* sums) {
 	for(int ii = 0; ii < 3; ++ii) {
 	    m_history(i, ii, print_iter) = x_k1(i, ii);
-	    N2 += (x_k1(i, ii) - m_proxy(i, ii)) * (x_k1(i, ii) - m_proxy(i, ii));
-	    L2 += x_k1(i, ii) * x_k1(i, ii);
-	    L1 += abs(x_k1(i, ii));
-	    L0 += ((abs(m_proxy(i, ii)) < l0_tol) ? 1.0 : 0.0);
+	    sums[0] += (x_k1(i, ii) - m_proxy(i, ii)) * (x_k1(i, ii) - m_proxy(i, ii));
+	    sums[1] += x_k1(i, ii) * x_k1(i, ii);
+	    sums[2] += abs(x_k1(i, ii));
+	    sums[3] += ((abs(m_proxy(i, ii)) < l0_tol) ? 1.0 : 0.0);
 	}
-    }
+    });
+    double N2 = norms[0];
+    double L2 = norms[1];
+    double L1 = norms[2];
+    double L0 = norms[3];
 
     // Computation of R2 takes more work than the other loss terms... need to compute
     // the linear least-squares term.
@@ -123,10 +123,9 @@ void print_MwPGP(Array& A_obj, Array& b_obj, Array& x_k1, Array& m_proxy, Array&
     Eigen::Map<Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor>> eigen_v(const_cast<double*>(x_k1.data()), 3*N, 1);
     Eigen::Map<Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor>> eigen_res(const_cast<double*>(R2_temp.data()), ngrid, 1);
     eigen_res = eigen_mat*eigen_v;
-#pragma omp parallel for reduction(+: R2)
-    for(int i = 0; i < ngrid; ++i) {
-	R2 += (R2_temp(i) - b_obj(i)) * (R2_temp(i) - b_obj(i));
-    }
+    double R2 = threads::parallel_sum<1>(ngrid, [&](int i, double* sums) {
+	sums[0] += (R2_temp[i] - b_obj(i)) * (R2_temp[i] - b_obj(i));
+    })[0];
 
     // rescale loss terms by the hyperparameters
     R2 = 0.5 * R2;
@@ -162,12 +161,11 @@ std::tuple<Array, Array, Array, Array> MwPGP_algorithm(Array& A_obj, Array& b_ob
 
     // define bunch of doubles, mostly for setting the std::tuples correctly
     double norm_g_alpha_p, norm_phi_temp, gamma, gp, pATAp;
-    double g_alpha_p1, g_alpha_p2, g_alpha_p3, phi_temp1, phi_temp2, phi_temp3;
-    double phig1, phig2, phig3, p_temp1, p_temp2, p_temp3;
+    double p_temp1, p_temp2, p_temp3;
     double alpha_cg, alpha_f;
     vector<double> alpha_fs(N);
     Array x_k1 = m0;
-    Array x_k_prev;
+    Array x_k_prev = m0;
 
     // record the history of the algorithm iterations
     Array m_history = xt::zeros<double>({N, 3, 21});
@@ -199,31 +197,32 @@ std::tuple<Array, Array, Array, Array> MwPGP_algorithm(Array& A_obj, Array& b_ob
     if (verbose)
         printf("Iteration ... |Am - b|^2 ... |m-w|^2/v ...   a|m|^2 ...  b|m-1|^2 ...   c|m|_1 ...   d|m|_0 ... Total Error:\n");
 
+    ScopedGILRelease gil;
     // Main loop over the optimization iterations
     for (int k = 0; k < max_iter; ++k) {
 
-	      x_k_prev = x_k1;
+	      std::copy(x_k1.begin(), x_k1.end(), x_k_prev.begin());
 
         // compute L2 norm of reduced g and L2 norm of phi(x, g)
         // as well as some dot products needed for the algorithm
-        norm_g_alpha_p = 0.0;
-        norm_phi_temp = 0.0;
-        gp = 0.0;
-        pATAp = 0.0;
-        ATAp = xt::zeros<double>({N, 3});
+        std::fill(ATAp.begin(), ATAp.end(), 0.);
         Eigen::Map<Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor>> eigen_v(const_cast<double*>(p.data()), 1, 3*N);
         Eigen::Map<Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor>> eigen_res(const_cast<double*>(ATAp.data()), 1, 3*N);
         eigen_res = eigen_v*eigen_mat.transpose()*eigen_mat + 2 * eigen_v * (reg_l2 + 1.0 / (2.0 * nu));
-#pragma omp parallel for reduction(+: norm_g_alpha_p, norm_phi_temp, gp, pATAp) private(phi_temp1, phi_temp2, phi_temp3, g_alpha_p1, g_alpha_p2, g_alpha_p3)
-        for(int i = 0; i < N; ++i) {
+        auto norms = threads::parallel_sum<4>(N, [&](int i, double* sums) {
+            double g_alpha_p1, g_alpha_p2, g_alpha_p3, phi_temp1, phi_temp2, phi_temp3;
             std::tie(g_alpha_p1, g_alpha_p2, g_alpha_p3) = g_reduced_projected_gradient(x_k1(i, 0), x_k1(i, 1), x_k1(i, 2), g(i, 0), g(i, 1), g(i, 2), alpha, m_maxima(i));
             std::tie(phi_temp1, phi_temp2, phi_temp3) = phi_MwPGP(x_k1(i, 0), x_k1(i, 1), x_k1(i, 2), g(i, 0), g(i, 1), g(i, 2), m_maxima(i));
-	    norm_g_alpha_p += g_alpha_p1 * g_alpha_p1 + g_alpha_p2 * g_alpha_p2 + g_alpha_p3 * g_alpha_p3;
-            norm_phi_temp += phi_temp1 * phi_temp1 + phi_temp2 * phi_temp2 + phi_temp3 * phi_temp3;
-	    gp += g(i, 0) * p(i, 0) + g(i, 1) * p(i, 1) + g(i, 2) * p(i, 2);
+	    sums[0] += g_alpha_p1 * g_alpha_p1 + g_alpha_p2 * g_alpha_p2 + g_alpha_p3 * g_alpha_p3;
+            sums[1] += phi_temp1 * phi_temp1 + phi_temp2 * phi_temp2 + phi_temp3 * phi_temp3;
+	    sums[2] += g(i, 0) * p(i, 0) + g(i, 1) * p(i, 1) + g(i, 2) * p(i, 2);
             alpha_fs[i] = find_max_alphaf(x_k1(i, 0), x_k1(i, 1), x_k1(i, 2), p(i, 0), p(i, 1), p(i, 2), m_maxima(i));
-            pATAp += p(i, 0) * ATAp(i, 0) + p(i, 1) * ATAp(i, 1) + p(i, 2) * ATAp(i, 2);
-        }
+            sums[3] += p(i, 0) * ATAp(i, 0) + p(i, 1) * ATAp(i, 1) + p(i, 2) * ATAp(i, 2);
+        });
+        norm_g_alpha_p = norms[0];
+        norm_phi_temp = norms[1];
+        gp = norms[2];
+        pATAp = norms[3];
 
         // compute step sizes for different descent step types
 	auto max_i = std::min_element(alpha_fs.begin(), alpha_fs.end());
@@ -243,12 +242,11 @@ std::tuple<Array, Array, Array, Array> MwPGP_algorithm(Array& A_obj, Array& b_ob
                 }
 
                 // compute gamma step size
-                gamma = 0.0;
-#pragma omp parallel for reduction(+: gamma) private(phig1, phig2, phig3)
-                for (int i = 0; i < N; ++i) {
+                gamma = threads::parallel_sum<1>(N, [&](int i, double* sums) {
+                    double phig1, phig2, phig3;
                     std::tie(phig1, phig2, phig3) = phi_MwPGP(x_k1(i, 0), x_k1(i, 1), x_k1(i, 2), g(i, 0), g(i, 1), g(i, 2), m_maxima(i));
-                    gamma += (phig1 * ATAp(i, 0) + phig2 * ATAp(i, 1) + phig3 * ATAp(i, 2));
-                }
+                    sums[0] += (phig1 * ATAp(i, 0) + phig2 * ATAp(i, 1) + phig3 * ATAp(i, 2));
+                })[0];
                 gamma = gamma / pATAp;
 
                 // update p
@@ -308,18 +306,17 @@ std::tuple<Array, Array, Array, Array> MwPGP_algorithm(Array& A_obj, Array& b_ob
 	}
 
 	// check if converged
-	x_sum = 0;
-#pragma omp parallel for
-        for (int i = 0; i < N; ++i) {
+	x_sum = threads::parallel_sum<1>(N, [&](int i, double* sums) {
             for (int ii = 0; ii < 3; ++ii) {
-                x_sum += abs(x_k1(i, ii) - x_k_prev(i, ii));
+                sums[0] += abs(x_k1(i, ii) - x_k_prev(i, ii));
 	    }
-	}
+	})[0];
 	if (x_sum < epsilon) {
             printf("MwPGP algorithm ended early, at iteration %d\n", k);
 	    break;
 	}
     }
+    gil.reacquire();
     return std::make_tuple(objective_history, R2_history, m_history, x_k1);
 }
 
@@ -328,14 +325,13 @@ std::tuple<Array, Array, Array, Array> MwPGP_algorithm(Array& A_obj, Array& b_ob
 void print_GPMO(int k, int ngrid, int& print_iter, Array& x, double* Aij_mj_ptr, Array& objective_history, Array& Bn_history, Array& m_history, double mmax_sum, double* normal_norms_ptr) 
 {	
     int N = x.shape(0);
-    double sqrtR2 = 0.0;
-    double R2 = 0.0;
     double L2 = mmax_sum;
-#pragma omp parallel for schedule(static) reduction(+: R2, sqrtR2)
-    for(int i = 0; i < ngrid; ++i) {
-	R2 += Aij_mj_ptr[i] * Aij_mj_ptr[i];
-	sqrtR2 += abs(Aij_mj_ptr[i]) * sqrt(normal_norms_ptr[i]);
-    }
+    auto norms = threads::parallel_sum<2>(ngrid, [&](int i, double* sums) {
+	sums[0] += Aij_mj_ptr[i] * Aij_mj_ptr[i];
+	sums[1] += abs(Aij_mj_ptr[i]) * sqrt(normal_norms_ptr[i]);
+    });
+    double R2 = norms[0];
+    double sqrtR2 = norms[1];
     R2 = 0.5 * R2;
     objective_history(print_iter) = R2;
     Bn_history(print_iter) = sqrtR2 / sqrt(ngrid);
@@ -429,6 +425,7 @@ std::tuple<Array, Array, Array, Array, Array> GPMO_backtracking(Array& A_obj, Ar
     int num_nonzero = 0;
     int k = 0;
 
+    ScopedGILRelease gil;
     // Main loop over the optimization iterations
     for (int k = 0; k < K; ++k) {
 #pragma omp parallel for schedule(static)
@@ -564,6 +561,7 @@ std::tuple<Array, Array, Array, Array, Array> GPMO_backtracking(Array& A_obj, Ar
 	    }            
 	}
     }
+    gil.reacquire();
     return std::make_tuple(objective_history, Bn_history, m_history, num_nonzeros, x);
 }
 
@@ -614,6 +612,7 @@ std::tuple<Array, Array, Array, Array> GPMO_multi(Array& A_obj, Array& b_obj, Ar
     int j_update = 1;
     if (single_direction >= 0) j_update = 3;
     
+    ScopedGILRelease gil;
     // Main loop over the optimization iterations
     for (int k = 0; k < K; ++k) {
 #pragma omp parallel for schedule(static)
@@ -697,6 +696,7 @@ std::tuple<Array, Array, Array, Array> GPMO_multi(Array& A_obj, Array& b_obj, Ar
             print_GPMO(k, ngrid, print_iter, x, Aij_mj_ptr, objective_history, Bn_history, m_history, mmax_sum, normal_norms_ptr);
 	}
     }
+    gil.reacquire();
     return std::make_tuple(objective_history, Bn_history, m_history, x);
 }
 
@@ -770,6 +770,7 @@ std::tuple<Array, Array, Array, Array, Array> GPMO_ArbVec_backtracking(
     int num_nonzero = 0;
     Array num_nonzeros = xt::zeros<int>({nhistory + 1});
 
+    ScopedGILRelease gil;
     // Main loop over the optimization iterations
     for (int k = 0; k < K; ++k) {
         double cos_thresh_angle = cos(thresh_angle);
@@ -944,6 +945,7 @@ std::tuple<Array, Array, Array, Array, Array> GPMO_ArbVec_backtracking(
 	}
     }
 
+    gil.reacquire();
     return std::make_tuple(objective_history, Bn_history, m_history, 
                            num_nonzeros, x);
 }
@@ -995,6 +997,7 @@ std::tuple<Array, Array, Array, Array> GPMO_ArbVec(Array& A_obj, Array& b_obj, A
     double* normal_norms_ptr = &(normal_norms(0));
     double* mmax_ptr = &(mmax(0));
 
+    ScopedGILRelease gil;
     // Main loop over the optimization iterations
     for (int k = 0; k < K; ++k) {
 #pragma omp parallel for schedule(static)
@@ -1060,6 +1063,7 @@ std::tuple<Array, Array, Array, Array> GPMO_ArbVec(Array& A_obj, Array& b_obj, A
             print_GPMO(k, ngrid, print_iter, x, Aij_mj_ptr, objective_history, Bn_history, m_history, mmax_sum, normal_norms_ptr);
 	}
     }
+    gil.reacquire();
     return std::make_tuple(objective_history, Bn_history, m_history, x);
 }
 
@@ -1108,6 +1112,7 @@ std::tuple<Array, Array, Array, Array> GPMO_baseline(Array& A_obj, Array& b_obj,
     int j_update = 1;
     if (single_direction >= 0) j_update = 3;
     
+    ScopedGILRelease gil;
     // Main loop over the optimization iterations
     for (int k = 0; k < K; ++k) {
 #pragma omp parallel for schedule(static)
@@ -1159,5 +1164,6 @@ std::tuple<Array, Array, Array, Array> GPMO_baseline(Array& A_obj, Array& b_obj,
             print_GPMO(k, ngrid, print_iter, x, Aij_mj_ptr, objective_history, Bn_history, m_history, mmax_sum, normal_norms_ptr);
 	}
     }
+    gil.reacquire();
     return std::make_tuple(objective_history, Bn_history, m_history, x);
 }
@@ -0,0 +1,108 @@
+#include "pointset.h"
+#include "perf.h"
+#include <cmath>
+
+// allocating these aligned vectors is not super cheap, so reuse whenever
+// possible. they are not initialized here, so that they are first touched by
+// the threads that fill them.
+static void resize_uninitialized(AlignedPaddedVec& v, int n) {
+    if(v.size() != n)
+        v = AlignedPaddedVec(n);
+}
+
+PointSet::PointSet(const double* a, const double* b, const double* c, int n, Coordinates coords) {
+    AlignedPaddedVec& first = resize(n, coords);
+    AlignedPaddedVec& second = coords == cartesian ? ys : phis;
+#pragma omp parallel for schedule(static) if(n >= threads::parallel_init_min_size)
+    for (int i = 0; i < n; ++i) {
+        first[i] = a[i];
+        second[i] = b[i];
+        zs[i] = c[i];
+    }
+    if(coords == cylindrical)
+        wrap_phi();
+}
+
+AlignedPaddedVec& PointSet::resize(int n, Coordinates coords) {
+    npoints = n;
+    resize_uninitialized(zs, n);
+    if(coords == cartesian) {
+        resize_uninitialized(xs, n);
+        resize_uninitialized(ys, n);
+        has_cart = true;
+        has_cyl = false;
+        return xs;
+    } else {
+        resize_uninitialized(rs, n);
+        resize_uninitialized(phis, n);
+        has_cyl = true;
+        has_cart = false;
+        return rs;
+    }
+}
+
+void PointSet::wrap_phi() {
+    // the same convention as MagneticField::set_points_cyl
+#pragma omp parallel for schedule(static) if(npoints >= threads::parallel_init_min_size)
+    for (int i = 0; i < npoints; ++i)
+        phis[i] = std::fmod(phis[i], 2*M_PI);
+}
+
+void PointSet::compute_cart() {
+    if(has_cart)
+        return;
+    std::lock_guard<std::mutex> lock(mutex);
+    if(has_cart)
+        return;
+    SIMSOPT_PERF_SCOPE(timer, "PointSet::compute_cart");
+    SIMSOPT_PERF_ADD(timer, points, npoints);
+    resize_uninitialized(xs, npoints);
+    resize_uninitialized(ys, npoints);
+#pragma omp parallel for schedule(static) if(npoints >= threads::parallel_init_min_size)
+    for (int i = 0; i < npoints; ++i) {
+        xs[i] = rs[i] * std::cos(phis[i]);
+        ys[i] = rs[i] * std::sin(phis[i]);
+    }
+    has_cart = true;
+}
+
+void PointSet::compute_cyl() {
+    if(has_cyl)
+        return;
+    std::lock_guard<std::mutex> lock(mutex);
+    if(has_cyl)
+        return;
+    SIMSOPT_PERF_SCOPE(timer, "PointSet::compute_cyl");
+    SIMSOPT_PERF_ADD(timer, points, npoints);
+    resize_uninitialized(rs, npoints);
+    resize_uninitialized(phis, npoints);
+#pragma omp parallel for schedule(static) if(npoints >= threads::parallel_init_min_size)
+    for (int i = 0; i < npoints; ++i) {
+        double x = xs[i];
+        double y = ys[i];
+        rs[i] = std::sqrt(x*x + y*y);
+        double phi = std::atan2(y, x);
+        if(phi < 0)
+            phi += 2*M_PI;
+        phis[i] = phi;
+    }
+    has_cyl = true;
+}
+
+void PointSet::get_cart(double* out) {
+    compute_cart();
+    for (int i = 0; i < npoints; ++i) {
+        out[3*i + 0] = xs[i];
+        out[3*i + 1] = ys[i];
+        out[3*i + 2] = zs[i];
+    }
+}
+
+void PointSet::get_cyl(double* out) {
+    compute_cyl();
+    for (int i = 0; i < npoints; ++i) {
+        out[3*i + 0] = rs[i];
+        out[3*i + 1] = phis[i];
+        out[3*i + 2] = zs[i];
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include "simdhelpers.h"
+#include "threads.h"
+
+// A set of points in structure of arrays layout, i.e. the coordinates are
+// stored in separate aligned and padded vectors as required by the simd
+// kernels. The points are given either in cartesian or in cylindrical
+// coordinates (r, phi, z), and the other representation is computed on first
+// use, once.
+//
+// A field that is evaluated on points given as a (n, 3) array creates a
+// PointSet when one of its kernels needs it (see
+// `MagneticField::get_pointset`). Passing the same PointSet to several fields
+// (`MagneticField::set_pointset`), as e.g. `MagneticFieldSum` does for its
+// children, avoids transposing the points and converting them to cylindrical
+// coordinates once per field.
+//
+// The views are computed under a lock, so a PointSet can be shared between
+// fields that are evaluated concurrently (e.g. in a `TaskGraph`). The vectors
+// that are returned must not be modified.
+class PointSet {
+    public:
+        enum Coordinates { cartesian, cylindrical };
+
+        // `points` is a (n, 3) array, in the given coordinates.
+        template<class Tensor>
+        PointSet(const Tensor& points, Coordinates coords) {
+            assign(points, coords);
+        }
+
+        // The three coordinates of the n points are given separately.
+        PointSet(const double* a, const double* b, const double* c, int n, Coordinates coords);
+
+        PointSet(const PointSet&) = delete;
+        PointSet& operator=(const PointSet&) = delete;
+
+        // Replaces the points, reusing the memory of the vectors if the
+        // number of points doesn't change. Must not be called while the
+        // PointSet is used elsewhere.
+        template<class Tensor>
+        void assign(const Tensor& points, Coordinates coords) {
+            if(points.dimension() != 2 || points.shape(1) != 3)
+                throw std::runtime_error("The points need to be an array of shape (n, 3).");
+            int n = points.shape(0);
+            AlignedPaddedVec& a = resize(n, coords);
+            AlignedPaddedVec& b = coords == cartesian ? ys : phis;
+#pragma omp parallel for schedule(static) if(n >= threads::parallel_init_min_size)
+            for (int i = 0; i < n; ++i) {
+                a[i] = points(i, 0);
+                b[i] = points(i, 1);
+                zs[i] = points(i, 2);
+            }
+            if(coords == cylindrical)
+                wrap_phi();
+        }
+
+        int size() const { return npoints; }
+
+        // The field that created this PointSet from its points and refills it
+        // with `assign` when they change. Set to nullptr once the PointSet is
+        // handed out to someone who may keep it, e.g. to python.
+        const void* owner = nullptr;
+
+        // The cartesian coordinates.
+        AlignedPaddedVec& x() { compute_cart(); return xs; }
+        AlignedPaddedVec& y() { compute_cart(); return ys; }
+        AlignedPaddedVec& z() { return zs; }
+
+        // The cylindrical coordinates, phi is in [0, 2pi) for points given in
+        // cartesian coordinates, and (-2pi, 2pi) for points given in
+        // cylindrical coordinates.
+        AlignedPaddedVec& r() { compute_cyl(); return rs; }
+        AlignedPaddedVec& phi() { compute_cyl(); return phis; }
+
+        // Writes the points into the row major (n, 3) array `out`.
+        void get_cart(double* out);
+        void get_cyl(double* out);
+
+    private:
+        int npoints = 0;
+        AlignedPaddedVec xs, ys, zs, rs, phis;
+        std::atomic<bool> has_cart{false}, has_cyl{false};
+        std::mutex mutex;
+
+        // Resizes the vectors of the given coordinates (and z) to n entries,
+        // marks the other coordinates as missing and returns the vector of
+        // the first coordinate.
+        AlignedPaddedVec& resize(int n, Coordinates coords);
+        void wrap_phi();
+        void compute_cart();
+        void compute_cyl();
+};
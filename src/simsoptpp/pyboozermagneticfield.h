@@ -15,6 +15,10 @@ template <class BoozerMagneticFieldBase = PyBoozerMagneticField> class PyBoozerM
             PYBIND11_OVERLOAD(void, BoozerMagneticFieldBase, _set_points);
         }
 
+        virtual void _compute_impl(long mask) override {
+            PYBIND11_OVERLOAD(void, BoozerMagneticFieldBase, _compute_impl, mask);
+        }
+
         virtual void _K_impl(typename BoozerMagneticFieldBase::Tensor2& data) override {
             PYBIND11_OVERLOAD(void, BoozerMagneticFieldBase, _K_impl, data);
         }
@@ -74,6 +74,22 @@ template <class CurveBase = PyCurve> class PyCurveTrampoline : public CurveBase
             PYBIND11_OVERLOAD(PyArray, CurveBase, dgammadashdashdash_by_dcoeff_vjp_impl, v);
         }
 
+        virtual PyArray dgamma_by_dcoeff_jvp_impl(PyArray& w) override {
+            PYBIND11_OVERLOAD(PyArray, CurveBase, dgamma_by_dcoeff_jvp_impl, w);
+        }
+
+        virtual PyArray dgammadash_by_dcoeff_jvp_impl(PyArray& w) override {
+            PYBIND11_OVERLOAD(PyArray, CurveBase, dgammadash_by_dcoeff_jvp_impl, w);
+        }
+
+        virtual PyArray dgammadashdash_by_dcoeff_jvp_impl(PyArray& w) override {
+            PYBIND11_OVERLOAD(PyArray, CurveBase, dgammadashdash_by_dcoeff_jvp_impl, w);
+        }
+
+        virtual PyArray dgammadashdashdash_by_dcoeff_jvp_impl(PyArray& w) override {
+            PYBIND11_OVERLOAD(PyArray, CurveBase, dgammadashdashdash_by_dcoeff_jvp_impl, w);
+        }
+
         virtual void kappa_impl(PyArray& data) override {
             PYBIND11_OVERLOAD(void, CurveBase, kappa_impl, data);
         }
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+
+#ifdef SIMSOPT_WITHOUT_PYTHON
+
+// Builds without python, e.g. the C++ benchmarks, have no GIL.
+class ScopedGILRelease {
+    public:
+        void reacquire() {}
+};
+
+class ScopedGILAcquire {};
+
+#else
+
+#include "pybind11/pybind11.h"
+
+// Releases the GIL while it is in scope, so that other python threads can run
+// while a long computation is done in C++. Nothing is done if the calling
+// thread does not hold the GIL, e.g. when called from an OpenMP thread.
+//
+// While the GIL is released, no python objects may be created, copied or
+// destroyed. In particular no pyarray/pytensor may be allocated (xt::zeros,
+// copy assignment, temporaries of xtensor expressions), so all outputs have to
+// be allocated before the GIL is released. Writing to the elements of
+// existing arrays is fine.
+class ScopedGILRelease {
+    public:
+        ScopedGILRelease() {
+            if(Py_IsInitialized() && PyGILState_Check())
+                release = std::make_unique<pybind11::gil_scoped_release>();
+        }
+
+        // Acquire the GIL again before the end of the scope, e.g. before
+        // returning python objects.
+        void reacquire() {
+            release.reset();
+        }
+
+    private:
+        std::unique_ptr<pybind11::gil_scoped_release> release;
+};
+
+// Acquires the GIL while it is in scope, if the calling thread released it
+// with a ScopedGILRelease, e.g. to evaluate a magnetic field that may be
+// implemented in python or allocate pytensors in its cache. Nothing is done if
+// the thread holds the GIL already or if python is not running.
+class ScopedGILAcquire {
+    public:
+        ScopedGILAcquire() {
+            if(Py_IsInitialized() && !PyGILState_Check())
+                acquire.emplace();
+        }
+
+    private:
+        std::optional<pybind11::gil_scoped_acquire> acquire;
+};
+
+#endif
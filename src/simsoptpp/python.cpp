@@ -16,6 +16,13 @@ typedef xt::pytensor<double, 2, xt::layout_type::row_major> PyTensor;
 #include "biot_savart_vjp_py.h"
 #include "dommaschk.h"
 #include "dipole_field.h"
+#include "multifilament.h"
+#include "coil_forces.h"
+#include "perf.h"
+#include "threads.h"
+#include "taskgraph.h"
+#include "arena.h"
+#include "pygil.h"
 #include "permanent_magnet_optimization.h"
 #include "reiman.h"
 #include "boozerradialinterpolant.h"
@@ -51,17 +58,82 @@ PYBIND11_MODULE(simsoptpp, m) {
     m.attr("using_xsimd") = false;
 #endif
 
-    m.def("biot_savart", &biot_savart);
-    m.def("biot_savart_B", &biot_savart_B);
-    m.def("biot_savart_vjp", &biot_savart_vjp);
-    m.def("biot_savart_vjp_graph", &biot_savart_vjp_graph);
-    m.def("biot_savart_vector_potential_vjp_graph", &biot_savart_vector_potential_vjp_graph);
+    // The output buffers are not converted, otherwise results would be written
+    // to a temporary copy. Neither are the input arrays, so that passing e.g.
+    // float32 arrays raises a TypeError instead of silently copying them.
+    m.def("biot_savart", &biot_savart, py::arg("points"), py::arg("gammas").noconvert(), py::arg("dgamma_by_dphis").noconvert(), py::arg("B").noconvert(), py::arg("dB_by_dX").noconvert(), py::arg("d2B_by_dXdX").noconvert(), py::arg("quadweights") = vector<vector<double>>());
+    // out and quadweights are keyword only, so that the two overloads can't be
+    // confused by the position of an argument
+    m.def("biot_savart_B", &biot_savart_B, py::arg("points").noconvert(), py::arg("gammas").noconvert(), py::arg("dgamma_by_dphis").noconvert(), py::arg("currents"), py::kw_only(), py::arg("quadweights") = vector<vector<double>>());
+    m.def("biot_savart_B", &biot_savart_B_out, py::arg("points").noconvert(), py::arg("gammas").noconvert(), py::arg("dgamma_by_dphis").noconvert(), py::arg("currents"), py::kw_only(), py::arg("out").noconvert(), py::arg("quadweights") = vector<vector<double>>());
+    m.def("biot_savart_vjp", &biot_savart_vjp, py::arg("points"), py::arg("gammas").noconvert(), py::arg("dgamma_by_dphis").noconvert(), py::arg("currents"), py::arg("v").noconvert(), py::arg("vgrad").noconvert(), py::arg("dgamma_by_dcoeffs").noconvert(), py::arg("d2gamma_by_dphidcoeffs").noconvert(), py::arg("res_B").noconvert(), py::arg("res_dB").noconvert(), py::arg("quadweights") = vector<vector<double>>());
+    m.def("biot_savart_vjp_graph", &biot_savart_vjp_graph, py::arg("points"), py::arg("gammas").noconvert(), py::arg("dgamma_by_dphis").noconvert(), py::arg("currents"), py::arg("v").noconvert(), py::arg("res_gamma").noconvert(), py::arg("res_dgamma_by_dphi").noconvert(), py::arg("vgrad").noconvert(), py::arg("res_grad_gamma").noconvert(), py::arg("res_grad_dgamma_by_dphi").noconvert(), py::arg("quadweights") = vector<vector<double>>());
+    m.def("biot_savart_vector_potential_vjp_graph", &biot_savart_vector_potential_vjp_graph, py::arg("points"), py::arg("gammas").noconvert(), py::arg("dgamma_by_dphis").noconvert(), py::arg("currents"), py::arg("v").noconvert(), py::arg("res_gamma").noconvert(), py::arg("res_dgamma_by_dphi").noconvert(), py::arg("vgrad").noconvert(), py::arg("res_grad_gamma").noconvert(), py::arg("res_grad_dgamma_by_dphi").noconvert(), py::arg("quadweights") = vector<vector<double>>());
+
+    // Multifilament approximation of finite build coils
+    m.def("multifilament_gamma", &multifilament_gamma);
+    m.def("multifilament_vjp", &multifilament_vjp);
+
+    // Lorentz forces on coils including the regularized self field
+    m.def("coil_forces", &coil_forces, py::arg("gammas"), py::arg("gammadashs"), py::arg("gammadashdashs"), py::arg("currents"), py::arg("regularizations"));
+    m.def("coil_forces_vjp", &coil_forces_vjp, py::arg("gammas"), py::arg("gammadashs"), py::arg("gammadashdashs"), py::arg("currents"), py::arg("regularizations"), py::arg("v"));
+
+    // Instrumentation of the kernels, only records data when compiled with SIMSOPT_PERF
+    m.def("perf_enabled", &perf::enabled);
+    m.def("perf_report", []() {
+        auto report = perf::report();
+        py::dict kernels, counters;
+        for (auto& kv : report.kernels) {
+            py::dict stats;
+            stats["calls"] = kv.second.calls;
+            stats["time"] = kv.second.time;
+            stats["points"] = kv.second.points;
+            stats["pairs"] = kv.second.pairs;
+            stats["flops"] = kv.second.flops;
+            kernels[py::str(kv.first)] = stats;
+        }
+        for (auto& kv : report.counters)
+            counters[py::str(kv.first)] = kv.second;
+        py::dict res;
+        res["kernels"] = kernels;
+        res["counters"] = counters;
+        return res;
+    });
+    m.def("perf_reset", &perf::reset);
+    m.def("perf_set_tracing", &perf::set_tracing, py::arg("on"));
+    m.def("perf_write_chrome_trace", &perf::write_chrome_trace, py::arg("filename"));
+
+    // Number of threads and their placement on the cpus
+    m.def("get_num_threads", &threads::get_num_threads);
+    m.def("set_num_threads", &threads::set_num_threads, py::arg("num_threads"));
+    m.def("get_thread_affinity", &threads::get_thread_affinity);
+    m.def("set_thread_affinity", &threads::set_thread_affinity, py::arg("cpus"));
+    m.def("get_deterministic", &threads::get_deterministic);
+    m.def("set_deterministic", &threads::set_deterministic, py::arg("deterministic"));
+    m.def("arena_heap_allocations", &arena::heap_allocations);
+
+    // Concurrent evaluation of tasks with dependencies. Python callables
+    // acquire the GIL when they are called, so only their calls into kernels
+    // that release the GIL overlap.
+    py::class_<TaskGraph>(m, "TaskGraph")
+        .def(py::init<>())
+        .def("add_task", &TaskGraph::add_task, py::arg("fn"), py::arg("deps") = vector<int>(), py::arg("name") = "", py::arg("parallel") = false)
+        .def("run", [](TaskGraph& graph) {
+                ScopedGILRelease gil;
+                graph.run();
+            })
+        .def("__len__", &TaskGraph::size);
 
     // Functions below are implemented for permanent magnet optimization
-    m.def("dipole_field_B" , &dipole_field_B);
-    m.def("dipole_field_A" , &dipole_field_A);
-    m.def("dipole_field_dB", &dipole_field_dB);
-    m.def("dipole_field_dA" , &dipole_field_dA);
+    m.def("dipole_field_B", &dipole_field_B, py::arg("points").noconvert(), py::arg("m_points").noconvert(), py::arg("m").noconvert());
+    m.def("dipole_field_A", &dipole_field_A, py::arg("points").noconvert(), py::arg("m_points").noconvert(), py::arg("m").noconvert());
+    m.def("dipole_field_dB", &dipole_field_dB, py::arg("points").noconvert(), py::arg("m_points").noconvert(), py::arg("m").noconvert());
+    m.def("dipole_field_dA", &dipole_field_dA, py::arg("points").noconvert(), py::arg("m_points").noconvert(), py::arg("m").noconvert());
+    // out= variants that write into a preallocated array, out is keyword only
+    m.def("dipole_field_B" , &dipole_field_B_out, py::arg("points").noconvert(), py::arg("m_points").noconvert(), py::arg("m").noconvert(), py::kw_only(), py::arg("out").noconvert());
+    m.def("dipole_field_A" , &dipole_field_A_out, py::arg("points").noconvert(), py::arg("m_points").noconvert(), py::arg("m").noconvert(), py::kw_only(), py::arg("out").noconvert());
+    m.def("dipole_field_dB", &dipole_field_dB_out, py::arg("points").noconvert(), py::arg("m_points").noconvert(), py::arg("m").noconvert(), py::kw_only(), py::arg("out").noconvert());
+    m.def("dipole_field_dA" , &dipole_field_dA_out, py::arg("points").noconvert(), py::arg("m_points").noconvert(), py::arg("m").noconvert(), py::kw_only(), py::arg("out").noconvert());
     m.def("dipole_field_Bn" , &dipole_field_Bn, py::arg("points"), py::arg("m_points"), py::arg("unitnormal"), py::arg("nfp"), py::arg("stellsym"), py::arg("b"), py::arg("coordinate_flag") = "cartesian", py::arg("R0") = 0.0);
     m.def("define_a_uniform_cylindrical_grid_between_two_toroidal_surfaces" , &define_a_uniform_cylindrical_grid_between_two_toroidal_surfaces);
     m.def("define_a_uniform_cartesian_grid_between_two_toroidal_surfaces" , &define_a_uniform_cartesian_grid_between_two_toroidal_surfaces);
@@ -85,6 +157,7 @@ PYBIND11_MODULE(simsoptpp, m) {
     m.def("fourier_transform_odd", &fourier_transform_odd);
     m.def("inverse_fourier_transform_even", &inverse_fourier_transform_even);
     m.def("inverse_fourier_transform_odd", &inverse_fourier_transform_odd);
+    m.def("inverse_fourier_transform_many", &inverse_fourier_transform_many);
     m.def("compute_kmns",&compute_kmns);
     m.def("compute_kmnc_kmns",&compute_kmnc_kmns);
 
@@ -182,11 +255,7 @@ PYBIND11_MODULE(simsoptpp, m) {
 
             Btarget_ptr = Btarget.data();
         }
-        double numerator_sum = 0.0;
-        double denominator_sum = 0.0;
-
-        #pragma omp parallel for reduction(+:numerator_sum, denominator_sum)
-        for(int i=0; i<nphi*ntheta; i++){
+        auto totals = threads::parallel_sum<2>(nphi*ntheta, [&](int i, double* sums) {
             double normN = std::sqrt(n_ptr[3*i+0]*n_ptr[3*i+0] + n_ptr[3*i+1]*n_ptr[3*i+1] + n_ptr[3*i+2]*n_ptr[3*i+2]);
             double Nx = n_ptr[3*i+0]/normN;
             double Ny = n_ptr[3*i+1]/normN;
@@ -197,12 +266,14 @@ PYBIND11_MODULE(simsoptpp, m) {
 
             double mod_Bcoil = std::sqrt(Bcoil_ptr[3*i+0]*Bcoil_ptr[3*i+0] + Bcoil_ptr[3*i+1]*Bcoil_ptr[3*i+1] + Bcoil_ptr[3*i+2]*Bcoil_ptr[3*i+2]);
             if (local) {
-                numerator_sum += (BcoildotN * BcoildotN) / (mod_Bcoil * mod_Bcoil) * normN;
+                sums[0] += (BcoildotN * BcoildotN) / (mod_Bcoil * mod_Bcoil) * normN;
             } else {
-                numerator_sum += (BcoildotN * BcoildotN) * normN;
-                denominator_sum += mod_Bcoil * mod_Bcoil * normN;
+                sums[0] += (BcoildotN * BcoildotN) * normN;
+                sums[1] += mod_Bcoil * mod_Bcoil * normN;
             }
-        }
+        });
+        double numerator_sum = totals[0];
+        double denominator_sum = totals[1];
 
         double result = 0.0;
         if (local) {
@@ -11,10 +11,12 @@ using std::vector;
 namespace py = pybind11;
 #include "boozermagneticfield.h"
 #include "boozermagneticfield_interpolated.h"
+#include "boozermagneticfield_spline.h"
 #include "pyboozermagneticfield.h"
 #include "regular_grid_interpolant_3d.h"
 typedef InterpolatedBoozerField<xt::pytensor> PyInterpolatedBoozerField;
 typedef BoozerMagneticField<xt::pytensor> PyBoozerMagneticField;
+typedef BoozerRadialSplineField<xt::pytensor> PyBoozerRadialSplineField;
 
 template <typename T, typename S> void register_common_field_methods(S &c) {
     c
@@ -88,6 +90,11 @@ template <typename T, typename S> void register_common_field_methods(S &c) {
      .def("dIds_ref", py::overload_cast<>(&T::dIds_ref), "Same as `dIds`, but returns a reference to the array (this array should be read only).")
      .def("diotads_ref", py::overload_cast<>(&T::diotads_ref), "Same as `diotads`, but returns a reference to the array (this array should be read only).")
 
+     .def("compute", &T::compute, "Computes all quantities whose bit is set in `mask` (see `quantity_mask`) that are not cached yet, in a single pass over the points if the field supports it.")
+     .def_static("quantity_mask", &T::quantity_mask, "Returns the mask for a list of quantity names, e.g. `[\"modB\", \"modB_derivs\"]`, to be passed to `compute`.")
+     .def_static("quantity_names", &T::quantity_names, "Returns the names of the quantities in the order of their bits in a mask.")
+     .def("quantity_buffer", &T::quantity_buffer, "Returns the `(npoints, 1)` cache of quantity `q` and marks it as valid. Only meant to be written to by implementations of `_compute_impl`.")
+     .def("quantity_ref", &T::quantity_ref, "Returns a reference to quantity `q`, computing it if necessary (this array should be read only).")
      .def("invalidate_cache", &T::invalidate_cache, "Clear the cache. Called automatically after each call to `set_points[...]`.")
      .def("get_points", &T::get_points, "Get the point where the field should be evaluated in Boozer coordinates.")
      .def("get_points_ref", &T::get_points_ref, "As `get_points`, but returns a reference to the array (this array should be read only).")
@@ -115,4 +122,24 @@ void init_boozermagneticfields(py::module_ &m){
       .def_readonly("zeta_range", &PyInterpolatedBoozerField::zeta_range)
       .def_readonly("rule", &PyInterpolatedBoozerField::rule);
 
+  py::class_<RadialSplines, shared_ptr<RadialSplines>>(m, "RadialSplines", "B-splines in s with shared knots, given in the (t, c, k) format of scipy.")
+      .def(py::init<vector<double>, int, vector<vector<double>>>(), py::arg("knots"), py::arg("degree"), py::arg("coeffs"))
+      .def_readonly("knots", &RadialSplines::knots)
+      .def_readonly("degree", &RadialSplines::degree)
+      .def_readonly("num_functions", &RadialSplines::num_functions);
+
+  py::class_<PyBoozerRadialSplineField, shared_ptr<PyBoozerRadialSplineField>, PyBoozerMagneticField>(m, "BoozerRadialSplineField")
+      .def(py::init<double, vector<double>, vector<double>, vector<double>,
+              shared_ptr<RadialSplines>, shared_ptr<RadialSplines>, shared_ptr<RadialSplines>, shared_ptr<RadialSplines>,
+              shared_ptr<RadialSplines>, shared_ptr<RadialSplines>, shared_ptr<RadialSplines>, shared_ptr<RadialSplines>,
+              shared_ptr<RadialSplines>, shared_ptr<RadialSplines>, shared_ptr<RadialSplines>, shared_ptr<RadialSplines>,
+              shared_ptr<RadialSplines>, shared_ptr<RadialSplines>>(),
+              py::arg("psi0"), py::arg("xm"), py::arg("xn"), py::arg("radial_power"),
+              py::arg("modB_cos"), py::arg("modB_sin"), py::arg("R_cos"), py::arg("R_sin"),
+              py::arg("Z_cos"), py::arg("Z_sin"), py::arg("nu_cos"), py::arg("nu_sin"),
+              py::arg("K_cos"), py::arg("K_sin"), py::arg("psip"), py::arg("G"), py::arg("I"), py::arg("iota"))
+      .def_readonly("xm", &PyBoozerRadialSplineField::xm)
+      .def_readonly("xn", &PyBoozerRadialSplineField::xn)
+      .def_readonly("radial_power", &PyBoozerRadialSplineField::radial_power);
+
 }
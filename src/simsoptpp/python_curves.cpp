@@ -15,6 +15,8 @@ typedef CurveXYZFourier<PyArray> PyCurveXYZFourier;
 typedef CurveRZFourier<PyArray> PyCurveRZFourier; 
 #include "curvecwsfourier.h"
 typedef CurveCWSFourier<PyArray> PyCurveCWSFourier;
+#include "curvecollection.h"
+typedef CurveXYZFourierCollection<PyArray> PyCurveXYZFourierCollection;
 
 template <class PyCurveCWSFourierBase = PyCurveCWSFourier> class PyCurveCWSFourierTrampoline : public PyCurveTrampoline<PyCurveCWSFourierBase> {
     public:
@@ -104,6 +106,11 @@ template <typename T, typename S> void register_common_curve_methods(S &c) {
      .def("dgammadashdash_by_dcoeff_vjp_impl", &T::dgammadashdash_by_dcoeff_vjp_impl)
      .def("dgammadashdashdash_by_dcoeff_vjp_impl", &T::dgammadashdashdash_by_dcoeff_vjp_impl)
 
+     .def("dgamma_by_dcoeff_jvp_impl", &T::dgamma_by_dcoeff_jvp_impl)
+     .def("dgammadash_by_dcoeff_jvp_impl", &T::dgammadash_by_dcoeff_jvp_impl)
+     .def("dgammadashdash_by_dcoeff_jvp_impl", &T::dgammadashdash_by_dcoeff_jvp_impl)
+     .def("dgammadashdashdash_by_dcoeff_jvp_impl", &T::dgammadashdashdash_by_dcoeff_jvp_impl)
+
      .def("incremental_arclength", &T::incremental_arclength)
      .def("dincremental_arclength_by_dcoeff", &T::dincremental_arclength_by_dcoeff)
      .def("kappa", &T::kappa)
@@ -117,7 +124,9 @@ template <typename T, typename S> void register_common_curve_methods(S &c) {
      .def("set_dofs_impl", &T::set_dofs_impl)
      .def("get_dofs", &T::get_dofs)
      .def("num_dofs", &T::num_dofs)
-     .def_readonly("quadpoints", &T::quadpoints);
+     .def("set_quadweights", &T::set_quadweights)
+     .def_readonly("quadpoints", &T::quadpoints)
+     .def_readonly("quadweights", &T::quadweights);
 }
 
 void init_curves(py::module_ &m) {
@@ -164,4 +173,20 @@ void init_curves(py::module_ &m) {
         .def_readwrite("zc", &PyCurveCWSFourier::zc)
         .def_readwrite("zs", &PyCurveCWSFourier::zs);
     register_common_curve_methods<PyCurveCWSFourier>(pycurvecwsfourier);
+
+    py::class_<PyCurveXYZFourierCollection, shared_ptr<PyCurveXYZFourierCollection>>(m, "CurveXYZFourierCollection")
+        .def(py::init<vector<shared_ptr<PyCurveXYZFourier>>>())
+        .def("gamma", &PyCurveXYZFourierCollection::gamma)
+        .def("gammadash", &PyCurveXYZFourierCollection::gammadash)
+        .def("gammadashdash", &PyCurveXYZFourierCollection::gammadashdash)
+        .def("gammadashdashdash", &PyCurveXYZFourierCollection::gammadashdashdash)
+        .def("dgamma_by_dcoeff_vjp", &PyCurveXYZFourierCollection::dgamma_by_dcoeff_vjp)
+        .def("dgammadash_by_dcoeff_vjp", &PyCurveXYZFourierCollection::dgammadash_by_dcoeff_vjp)
+        .def("dgammadashdash_by_dcoeff_vjp", &PyCurveXYZFourierCollection::dgammadashdash_by_dcoeff_vjp)
+        .def("dgammadashdashdash_by_dcoeff_vjp", &PyCurveXYZFourierCollection::dgammadashdashdash_by_dcoeff_vjp)
+        .def("invalidate_cache", &PyCurveXYZFourierCollection::invalidate_cache)
+        .def("num_dofs", &PyCurveXYZFourierCollection::num_dofs)
+        .def_readonly("ncurves", &PyCurveXYZFourierCollection::ncurves)
+        .def_readonly("order", &PyCurveXYZFourierCollection::order)
+        .def_readonly("numquadpoints", &PyCurveXYZFourierCollection::numquadpoints);
 }
@@ -3,6 +3,7 @@
 namespace py = pybind11;
 #include "xtensor-python/pyarray.hpp"     // Numpy bindings
 typedef xt::pyarray<double> PyArray;
+#include "gauss_integrals.h"
 using std::vector;
 using std::tuple;
 using std::set;
@@ -173,6 +174,10 @@ void init_distance(py::module_ &m){
 
     m.def("get_pointclouds_closer_than_threshold_within_collection", &get_close_candidates_pdist, "In a list of point clouds, get all pairings that are closer than threshold to each other.", py::arg("pointClouds"), py::arg("threshold"), py::arg("num_base_curves"));
     m.def("get_pointclouds_closer_than_threshold_between_two_collections", &get_close_candidates_cdist, "Between two lists of pointclouds, get all pairings that are closer than threshold to each other.", py::arg("pointCloudsA"), py::arg("pointCloudsB"), py::arg("threshold"));
+    m.def("gauss_linking_number", &gauss_linking_number, "Compute the linking number of two closed curves given their `gamma` and `gammadash`.", py::arg("gamma1"), py::arg("gammadash1"), py::arg("gamma2"), py::arg("gammadash2"));
+    m.def("gauss_linking_number_matrix", &gauss_linking_number_matrix, "Compute the matrix of pairwise linking numbers of a list of closed curves. Pairs with disjoint bounding boxes are skipped if `bounding_box_check` is true.", py::arg("gammas"), py::arg("gammadashs"), py::arg("bounding_box_check") = true);
+    m.def("gauss_writhe", &gauss_writhe, "Compute the writhe of a closed curve given its `gamma` and `gammadash`.", py::arg("gamma"), py::arg("gammadash"));
+    m.def("gauss_mutual_inductance_matrix", &gauss_mutual_inductance_matrix, "Compute the matrix of mutual inductances (Neumann formula) of a list of closed curves. The diagonal is set to zero.", py::arg("gammas"), py::arg("gammadashs"));
     m.def("linkNumber", [](const PyArray& curve1, const PyArray& curve2, const PyArray& curve1dash, const PyArray& curve2dash) {
         int linknphi1 = curve1.shape(0);
         int linknphi2 = curve2.shape(0);
@@ -12,12 +12,23 @@ namespace py = pybind11;
 #include "magneticfield.h"
 #include "magneticfield_biotsavart.h"
 #include "magneticfield_interpolated.h"
+#include "magneticfield_sum.h"
+#include "magneticfield_surfacecurrent.h"
+#include "dommaschk.h"
+#include "reiman.h"
 #include "pymagneticfield.h"
 #include "regular_grid_interpolant_3d.h"
 #include "pycurrent.h"
+#include "fluxobjective.h"
 typedef MagneticField<xt::pytensor> PyMagneticField;
 typedef BiotSavart<xt::pytensor, PyArray> PyBiotSavart;
 typedef InterpolatedField<xt::pytensor> PyInterpolatedField;
+typedef DommaschkField<xt::pytensor> PyDommaschkField;
+typedef ReimanField<xt::pytensor> PyReimanField;
+typedef MagneticFieldSum<xt::pytensor> PyMagneticFieldSum;
+typedef MagneticFieldScaled<xt::pytensor> PyMagneticFieldScaled;
+typedef SurfaceCurrentField<xt::pytensor, PyArray> PySurfaceCurrentField;
+typedef SquaredFlux<xt::pytensor, PyArray> PySquaredFlux;
 
 
 
@@ -49,11 +60,41 @@ template <typename T, typename S> void register_common_field_methods(S &c) {
      .def("get_points_cyl_ref", &T::get_points_cyl_ref, "As `get_points_cyl`, but returns a reference to the array (this array should be read only).")
      .def("set_points_cart", &T::set_points_cart, "Set the points where to evaluate the magnetic fields, in cartesian coordinates.")
      .def("set_points_cyl", &T::set_points_cyl, "Set the points where to evaluate the magnetic fields, in cylindrical coordinates (the order is :math:`(r, \\phi, z)`).")
-     .def("set_points", &T::set_points, "Shorthand for `set_points_cart`.");
+     .def("set_points", &T::set_points, "Shorthand for `set_points_cart`.")
+     .def("set_pointset", &T::set_pointset, py::arg("points"), "Set the points where to evaluate the magnetic field to those of a `PointSet`, which can be shared with other fields.")
+     .def("get_pointset", &T::share_pointset, "Get the points where the field is evaluated as a `PointSet`.");
 }
 
 void init_magneticfields(py::module_ &m){
 
+    py::class_<PointSet, shared_ptr<PointSet>>(m, "PointSet",
+            R"pbdoc(
+            A set of points that is stored in the layout used by the kernels,
+            together with its representation in cylindrical coordinates, which
+            is computed once when it is first needed. Passing the same
+            `PointSet` to several fields (or to the Biot-Savart kernels) avoids
+            converting the points once per field. Numpy arrays and nested lists
+            of shape `(n, 3)` are converted automatically, as cartesian
+            coordinates.
+            )pbdoc")
+        .def(py::init([](PyArray& points) { return std::make_shared<PointSet>(points, PointSet::cartesian); }), py::arg("points"),
+                "Creates the point set from a `(n, 3)` array of cartesian coordinates.")
+        .def_static("from_cyl", [](PyArray& rphiz) { return std::make_shared<PointSet>(rphiz, PointSet::cylindrical); }, py::arg("rphiz"),
+                "Creates the point set from a `(n, 3)` array of cylindrical coordinates (the order is :math:`(r, \\phi, z)`).")
+        .def("__len__", &PointSet::size)
+        .def("get_points_cart", [](PointSet& p) {
+                PyArray res = xt::zeros<double>({p.size(), 3});
+                p.get_cart(res.data());
+                return res;
+            }, "Returns the points in cartesian coordinates as a `(n, 3)` array.")
+        .def("get_points_cyl", [](PointSet& p) {
+                PyArray res = xt::zeros<double>({p.size(), 3});
+                p.get_cyl(res.data());
+                return res;
+            }, "Returns the points in cylindrical coordinates as a `(n, 3)` array.");
+    py::implicitly_convertible<py::array, PointSet>();
+    py::implicitly_convertible<py::sequence, PointSet>();
+
     py::class_<InterpolationRule, shared_ptr<InterpolationRule>>(m, "InterpolationRule", "Abstract class for interpolation rules on an interval.")
         .def_readonly("degree", &InterpolationRule::degree, "The degree of the polynomial. The number of interpolation points in `degree+1`.");
 
@@ -98,21 +139,69 @@ void init_magneticfields(py::module_ &m){
 
     auto bs = py::class_<PyBiotSavart, PyMagneticFieldTrampoline<PyBiotSavart>, shared_ptr<PyBiotSavart>, PyMagneticField>(m, "BiotSavart")
         .def(py::init<vector<shared_ptr<Coil<PyArray>>>>())
+        .def(py::init<vector<shared_ptr<Coil<PyArray>>>, shared_ptr<CurveXYZFourierCollection<PyArray>>>())
         .def("compute", &PyBiotSavart::compute)
         .def("fieldcache_get_or_create", &PyBiotSavart::fieldcache_get_or_create)
         .def("fieldcache_get_status", &PyBiotSavart::fieldcache_get_status)
-        .def_readonly("coils", &PyBiotSavart::coils);
+        .def_readonly("coils", &PyBiotSavart::coils)
+        .def_readonly("collection", &PyBiotSavart::collection);
     register_common_field_methods<PyBiotSavart>(bs);
 
+    auto dommaschk = py::class_<PyDommaschkField, PyMagneticFieldTrampoline<PyDommaschkField>, shared_ptr<PyDommaschkField>, PyMagneticField>(m, "DommaschkField")
+        .def(py::init<vector<int>, vector<int>, vector<vector<double>>>());
+    register_common_field_methods<PyDommaschkField>(dommaschk);
+
+    auto reiman = py::class_<PyReimanField, PyMagneticFieldTrampoline<PyReimanField>, shared_ptr<PyReimanField>, PyMagneticField>(m, "ReimanField")
+        .def(py::init<double, double, vector<int>, vector<double>, int>());
+    register_common_field_methods<PyReimanField>(reiman);
+
+    auto fieldsum = py::class_<PyMagneticFieldSum, PyMagneticFieldTrampoline<PyMagneticFieldSum>, shared_ptr<PyMagneticFieldSum>, PyMagneticField>(m, "MagneticFieldSum")
+        .def(py::init<vector<shared_ptr<PyMagneticField>>>())
+        .def_readonly("fields", &PyMagneticFieldSum::fields);
+    register_common_field_methods<PyMagneticFieldSum>(fieldsum);
+
+    auto fieldscaled = py::class_<PyMagneticFieldScaled, PyMagneticFieldTrampoline<PyMagneticFieldScaled>, shared_ptr<PyMagneticFieldScaled>, PyMagneticField>(m, "MagneticFieldScaled")
+        .def(py::init<shared_ptr<PyMagneticField>, double>())
+        .def_readonly("field", &PyMagneticFieldScaled::field)
+        .def("get_scalar", &PyMagneticFieldScaled::get_scalar)
+        .def("set_scalar", &PyMagneticFieldScaled::set_scalar, "Set the scalar and clear the cache.");
+    register_common_field_methods<PyMagneticFieldScaled>(fieldscaled);
+
+    auto surfacecurrent = py::class_<PySurfaceCurrentField, PyMagneticFieldTrampoline<PySurfaceCurrentField>, shared_ptr<PySurfaceCurrentField>, PyMagneticField>(m, "SurfaceCurrentField")
+        .def(py::init<shared_ptr<Surface<PyArray>>, PyArray&, double>())
+        .def("set_K", &PySurfaceCurrentField::set_K, "Set the surface current density and clear the cache.")
+        .def("get_K", &PySurfaceCurrentField::get_K)
+        .def("invalidate_sources", &PySurfaceCurrentField::invalidate_sources, "Recompute the quadrature points and current elements from the surface on the next evaluation and clear the cache. Needs to be called when the surface changes.")
+        .def_readonly("theta", &PySurfaceCurrentField::theta);
+    register_common_field_methods<PySurfaceCurrentField>(surfacecurrent);
+
     auto ifield = py::class_<PyInterpolatedField, shared_ptr<PyInterpolatedField>, PyMagneticField>(m, "InterpolatedField")
         .def(py::init<shared_ptr<PyMagneticField>, InterpolationRule, RangeTriplet, RangeTriplet, RangeTriplet, bool, int, bool, std::function<std::vector<bool>(Vec, Vec, Vec)>>())
         .def(py::init<shared_ptr<PyMagneticField>, int, RangeTriplet, RangeTriplet, RangeTriplet, bool, int, bool, std::function<std::vector<bool>(Vec, Vec, Vec)>>())
         .def("estimate_error_B", &PyInterpolatedField::estimate_error_B)
         .def("estimate_error_GradAbsB", &PyInterpolatedField::estimate_error_GradAbsB)
+        .def("num_dofs", &PyInterpolatedField::num_dofs, "Number of interpolation nodes at which the field is evaluated.")
+        .def("evaluate_dofs_B", &PyInterpolatedField::evaluate_dofs_B, "Evaluate B (in cylindrical coordinates) at the interpolation nodes first, ..., last-1.", py::arg("first"), py::arg("last"), py::arg("out").noconvert())
+        .def("evaluate_dofs_GradAbsB", &PyInterpolatedField::evaluate_dofs_GradAbsB, "Evaluate GradAbsB (in cylindrical coordinates) at the interpolation nodes first, ..., last-1.", py::arg("first"), py::arg("last"), py::arg("out").noconvert())
+        .def("set_values_B", &PyInterpolatedField::set_values_B, "Build the interpolant of B from its values at all interpolation nodes.")
+        .def("set_values_GradAbsB", &PyInterpolatedField::set_values_GradAbsB, "Build the interpolant of GradAbsB from its values at all interpolation nodes.")
+        .def("num_cells", &PyInterpolatedField::num_cells, "Number of cells of the interpolant that are not skipped.")
+        .def("cell_table_size", &PyInterpolatedField::cell_table_size, "Number of entries of the table of one cell.")
+        .def("fill_table_B", &PyInterpolatedField::fill_table_B, "Write the tables of the cells first, ..., last-1 of the interpolant of B, given its values at all interpolation nodes, into out.", py::arg("values").noconvert(), py::arg("first"), py::arg("last"), py::arg("out").noconvert())
+        .def("fill_table_GradAbsB", &PyInterpolatedField::fill_table_GradAbsB, "Write the tables of the cells first, ..., last-1 of the interpolant of GradAbsB, given its values at all interpolation nodes, into out.", py::arg("values").noconvert(), py::arg("first"), py::arg("last"), py::arg("out").noconvert())
+        .def("set_table_B", &PyInterpolatedField::set_table_B, "Use the tables of all cells in table for the interpolant of B, without copying them. table has to be kept alive.", py::arg("table").noconvert())
+        .def("set_table_GradAbsB", &PyInterpolatedField::set_table_GradAbsB, "Use the tables of all cells in table for the interpolant of GradAbsB, without copying them. table has to be kept alive.", py::arg("table").noconvert())
         .def_readonly("r_range", &PyInterpolatedField::r_range)
         .def_readonly("phi_range", &PyInterpolatedField::phi_range)
         .def_readonly("z_range", &PyInterpolatedField::z_range)
         .def_readonly("rule", &PyInterpolatedField::rule);
     //register_common_field_methods<PyInterpolatedField>(ifield);
+
+    py::class_<PySquaredFlux, shared_ptr<PySquaredFlux>>(m, "SquaredFlux", "Squared flux of a magnetic field through a surface.")
+        .def(py::init<shared_ptr<Surface<PyArray>>, shared_ptr<PyMagneticField>, vector<double>, bool>())
+        .def("J", &PySquaredFlux::J)
+        .def("BdotN", &PySquaredFlux::BdotN, "Returns a `(nphi, ntheta)` array containing the normal component of the field on the surface.")
+        .def("dJ_by_dB", &PySquaredFlux::dJ_by_dB, "Returns a `(npoints, 3)` array containing the derivative of `J` wrt the field at the quadrature points (this array is overwritten by the next call).")
+        .def("dJ_by_dsurfacecoefficients", &PySquaredFlux::dJ_by_dsurfacecoefficients, "Returns the derivative of `J` wrt the dofs of the surface for fixed field sources.");
  
 }
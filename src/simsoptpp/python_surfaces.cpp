@@ -15,6 +15,8 @@ typedef SurfaceRZFourier<PyArray> PySurfaceRZFourier;
 typedef SurfaceXYZFourier<PyArray> PySurfaceXYZFourier;
 #include "surfacexyztensorfourier.h"
 typedef SurfaceXYZTensorFourier<PyArray> PySurfaceXYZTensorFourier;
+#include "currentpotential.h"
+typedef CurrentPotentialSolver<PyArray> PyCurrentPotentialSolver;
 
 template <class PySurfaceRZFourierBase = PySurfaceRZFourier> class PySurfaceRZFourierTrampoline : public PySurfaceTrampoline<PySurfaceRZFourierBase> {
     public:
@@ -200,4 +202,20 @@ void init_surfaces(py::module_ &m){
         .def_readwrite("nfp", &PySurfaceXYZTensorFourier::nfp)
         .def_readwrite("stellsym", &PySurfaceXYZTensorFourier::stellsym)
         .def_readwrite("clamped_dims", &PySurfaceXYZTensorFourier::clamped_dims);
+
+    py::class_<PyCurrentPotentialSolver, shared_ptr<PyCurrentPotentialSolver>>(m, "CurrentPotentialSolver", "Regularized least squares solver for the current potential on a winding surface.")
+        .def(py::init<shared_ptr<PySurface>, shared_ptr<PySurface>, int, int, int, bool, double, double, PyArray&>())
+        .def("num_dofs", &PyCurrentPotentialSolver::num_dofs)
+        .def("solve", &PyCurrentPotentialSolver::solve, "Returns the coefficients of the current potential that minimize `chi2_B + lambda chi2_K`.")
+        .def("chi2", &PyCurrentPotentialSolver::chi2, "Returns `(chi2_B, chi2_K)` for the given coefficients.")
+        .def("current_potential", &PyCurrentPotentialSolver::current_potential, "Returns a `(nphi, ntheta)` array containing the single valued part of the current potential on the winding surface.")
+        .def("K", &PyCurrentPotentialSolver::K, "Returns a `(nphi, ntheta, 3)` array containing the surface current density on the winding surface.")
+        .def("Bnormal", &PyCurrentPotentialSolver::Bnormal, "Returns a `(nphi, ntheta)` array containing the normal field of the winding surface currents on the plasma surface.")
+        .def("cut_coils", &PyCurrentPotentialSolver::cut_coils, "Returns the dofs of `CurveCWSFourier` curves following contours of the current potential.")
+        .def_readonly("xm", &PyCurrentPotentialSolver::xm)
+        .def_readonly("xn", &PyCurrentPotentialSolver::xn)
+        .def_readonly("nfp", &PyCurrentPotentialSolver::nfp)
+        .def_readonly("stellsym", &PyCurrentPotentialSolver::stellsym)
+        .def_readonly("net_poloidal_current", &PyCurrentPotentialSolver::net_poloidal_current)
+        .def_readonly("net_toroidal_current", &PyCurrentPotentialSolver::net_toroidal_current);
 }
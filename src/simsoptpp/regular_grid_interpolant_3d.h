@@ -1,6 +1,5 @@
 #pragma once
 #include "simdhelpers.h"
-#include <unordered_map>
 #include <algorithm>
 #include <fmt/core.h>
 #include <fmt/ranges.h>
@@ -103,7 +102,14 @@ class RegularGridInterpolant3D {
         Vec xdoftensor_reduced, ydoftensor_reduced, zdoftensor_reduced;
 
         Vec vals; // contains the values of the function to be interpolated at the dofs, of size dofs_to_keep * value_size
-        std::unordered_map<int, AlignedPaddedVec> all_local_vals_map; // maps each cell to an array of size (degree+1)**3 * padded_value_size
+        // The tables of the cells that are kept, one after another, each of
+        // size local_vals_size = (degree+1)**3 * padded_value_size. They are
+        // either stored in `table_storage`, or, after `set_table`, in memory
+        // that is owned by someone else, e.g. shared by the MPI ranks on a node.
+        AlignedPaddedVec table_storage;
+        const double* external_table = nullptr;
+        std::vector<int32_t> cell_to_table; // position of each cell in the table, -1 for skipped cells
+        std::vector<uint32_t> table_to_cell; // the cell of each position in the table
         std::vector<bool> skip_cell; // whether to skip each cell or not
         // since we are skipping some dofs, we need mappings into the list of
         // reduced dofs, e.g. if we skip dofs 3, then reduced to full would
@@ -139,6 +145,10 @@ class RegularGridInterpolant3D {
             return i*(degree+1)*(degree+1) + j*(degree+1) + k;
         }
 
+        const double* table() const {
+            return external_table ? external_table : (table_storage.empty() ? nullptr : table_storage.data());
+        }
+
         int locate_unsafe(double x, double y, double z);
         void evaluate_inplace(double x, double y, double z, double* res);
         void evaluate_local(double x, double y, double z, int cell_idx, double* res);
@@ -204,6 +214,14 @@ class RegularGridInterpolant3D {
                 }
             }
             cells_to_keep = nx*ny*nz - cells_to_skip;
+            cell_to_table = std::vector<int32_t>(nx*ny*nz, -1);
+            table_to_cell.reserve(cells_to_keep);
+            for (int c = 0; c < nx*ny*nz; ++c) {
+                if(!skip_cell[c]) {
+                    cell_to_table[c] = table_to_cell.size();
+                    table_to_cell.push_back(c);
+                }
+            }
 
             // now build the interpolation points in 1d.
             xdof = Vec(nx*degree+1, 0.);
@@ -302,6 +320,27 @@ class RegularGridInterpolant3D {
 
         void interpolate_batch(std::function<Vec(Vec, Vec, Vec)> &f); // build the interpolant
 
+        // `interpolate_batch` in two steps, so that the evaluation of f can be
+        // split up, e.g. across MPI ranks: `evaluate_dofs` evaluates f at the
+        // interpolation nodes first, ..., last-1 and writes the
+        // (last-first)*value_size values to `out`, and `set_values` builds the
+        // interpolant from the values at all `num_dofs()` nodes.
+        uint32_t num_dofs() { return dofs_to_keep; }
+        void evaluate_dofs(std::function<Vec(Vec, Vec, Vec)> &f, uint32_t first, uint32_t last, double* out);
+        void set_values(const double* values);
+
+        // `set_values` in turn consists of `fill_table`, which writes the
+        // tables of the cells first, ..., last-1 (out of `num_cells()`, each
+        // of size `cell_table_size()`) to `out`, and `set_table`, which makes
+        // the interpolant use the tables of all cells in `table` without
+        // copying them. This allows to store the tables once per node in
+        // memory that is shared by the MPI ranks. `table` has to outlive the
+        // interpolant, or the next call to `set_values` or `set_table`.
+        uint32_t num_cells() { return cells_to_keep; }
+        int cell_table_size() { return local_vals_size; }
+        void fill_table(const double* values, uint32_t first, uint32_t last, double* out);
+        void set_table(const double* table);
+
         Vec evaluate(double x, double y, double z); // evaluate the interpolant at one location
         void evaluate_batch(Array& xyz, Array& fxyz); // evluate the interpolant at multiple locations
 
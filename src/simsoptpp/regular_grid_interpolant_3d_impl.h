@@ -1,4 +1,6 @@
 #include "regular_grid_interpolant_3d.h"
+#include "perf.h"
+#include <array>
 #include <xtensor/xarray.hpp>
 #include "xtensor/xlayout.hpp"
 #define _USE_MATH_DEFINES
@@ -12,54 +14,82 @@ const int RegularGridInterpolant3D<Array>::simdcount;
 
 template<class Array>
 void RegularGridInterpolant3D<Array>::interpolate_batch(std::function<Vec(Vec, Vec, Vec)> &f) {
-    int BATCH_SIZE = 16384;
-    int NUM_BATCHES = dofs_to_keep/BATCH_SIZE + (dofs_to_keep % BATCH_SIZE != 0);
-    for (int i = 0; i < NUM_BATCHES; ++i) {
-        uint32_t first = i * BATCH_SIZE;
-        uint32_t last = std::min((uint32_t)((i+1) * BATCH_SIZE), dofs_to_keep);
-        Vec xsub(xdoftensor_reduced.begin() + first, xdoftensor_reduced.begin() + last);
-        Vec ysub(ydoftensor_reduced.begin() + first, ydoftensor_reduced.begin() + last);
-        Vec zsub(zdoftensor_reduced.begin() + first, zdoftensor_reduced.begin() + last);
-        Vec fxyzsub  = f(xsub, ysub, zsub);
-        for (int j = 0; j < last-first; ++j) {
-            for (int l = 0; l < value_size; ++l) {
-                vals[first * value_size + j * value_size + l] = fxyzsub[j * value_size + l];
-            }
-        }
+    SIMSOPT_PERF_SCOPE(timer, "RegularGridInterpolant3D::interpolate_batch");
+    SIMSOPT_PERF_ADD(timer, points, dofs_to_keep);
+    evaluate_dofs(f, 0, dofs_to_keep, vals.data());
+    set_values(vals.data());
+}
+
+template<class Array>
+void RegularGridInterpolant3D<Array>::evaluate_dofs(std::function<Vec(Vec, Vec, Vec)> &f, uint32_t first, uint32_t last, double* out) {
+    if(first > last || last > dofs_to_keep)
+        throw std::runtime_error(fmt::format("Invalid range of interpolation nodes [{}, {}), the interpolant has {} nodes.", first, last, dofs_to_keep));
+    uint32_t BATCH_SIZE = 16384;
+    for (uint32_t batch_first = first; batch_first < last; batch_first += BATCH_SIZE) {
+        uint32_t batch_last = std::min(batch_first + BATCH_SIZE, last);
+        Vec xsub(xdoftensor_reduced.begin() + batch_first, xdoftensor_reduced.begin() + batch_last);
+        Vec ysub(ydoftensor_reduced.begin() + batch_first, ydoftensor_reduced.begin() + batch_last);
+        Vec zsub(zdoftensor_reduced.begin() + batch_first, zdoftensor_reduced.begin() + batch_last);
+        // f takes its arguments by value, moving them avoids a copy per batch
+        Vec fxyzsub  = f(std::move(xsub), std::move(ysub), std::move(zsub));
+        if(fxyzsub.size() != (batch_last-batch_first) * value_size)
+            throw std::runtime_error("The function to be interpolated returned an array of the wrong size.");
+        std::copy(fxyzsub.begin(), fxyzsub.end(), out + (batch_first-first) * value_size);
     }
+}
+
+template<class Array>
+void RegularGridInterpolant3D<Array>::set_values(const double* values) {
+    // the table is filled in parallel, so that its memory is spread over the
+    // NUMA nodes (see threads.h)
+    if(table_storage.size() != uint64_t(cells_to_keep)*local_vals_size)
+        table_storage = AlignedPaddedVec(uint64_t(cells_to_keep)*local_vals_size);
+    fill_table(values, 0, cells_to_keep, table_storage.data());
+    external_table = nullptr;
+}
+
+template<class Array>
+void RegularGridInterpolant3D<Array>::fill_table(const double* values, uint32_t first, uint32_t last, double* out) {
+    if(first > last || last > cells_to_keep)
+        throw std::runtime_error(fmt::format("Invalid range of cells [{}, {}), the interpolant has {} cells.", first, last, cells_to_keep));
     int degree = rule.degree;
-    all_local_vals_map = std::unordered_map<int, AlignedPaddedVec>();
-    all_local_vals_map.reserve(cells_to_keep);
-
-    for (int xidx = 0; xidx < nx; ++xidx) {
-        for (int yidx = 0; yidx < ny; ++yidx) {
-            for (int zidx = 0; zidx < nz; ++zidx) {
-                int meshidx = idx_cell(xidx, yidx, zidx);
-                if(skip_cell[meshidx])
-                    continue;
-                AlignedPaddedVec local_vals(local_vals_size, 0.);
-                for (int i = 0; i < degree+1; ++i) {
-                    for (int j = 0; j < degree+1; ++j) {
-                        for (int k = 0; k < degree+1; ++k) {
-                            int offset = value_size*full_to_reduced_map[idx_dof(xidx*degree+i, yidx*degree+j, zidx*degree+k)];
-                            int offset_local = padded_value_size * idx_dof_local(i, j, k);
-                            for (int l = 0; l < value_size; ++l) {
-                                local_vals[offset_local + l] = vals[offset + l];
-                            }
-                        }
+#pragma omp parallel for schedule(static)
+    for (int64_t c = first; c < last; ++c) {
+        int cell = table_to_cell[c];
+        int xidx = cell/(ny*nz), yidx = (cell/nz) % ny, zidx = cell % nz;
+        double* local_vals = out + (c-first)*local_vals_size;
+        std::fill(local_vals, local_vals + local_vals_size, 0.);
+        for (int i = 0; i < degree+1; ++i) {
+            for (int j = 0; j < degree+1; ++j) {
+                for (int k = 0; k < degree+1; ++k) {
+                    int offset = value_size*full_to_reduced_map[idx_dof(xidx*degree+i, yidx*degree+j, zidx*degree+k)];
+                    int offset_local = padded_value_size * idx_dof_local(i, j, k);
+                    for (int l = 0; l < value_size; ++l) {
+                        local_vals[offset_local + l] = values[offset + l];
                     }
                 }
-                all_local_vals_map.insert({meshidx, local_vals});
             }
         }
     }
 }
 
+template<class Array>
+void RegularGridInterpolant3D<Array>::set_table(const double* table) {
+    // the simd kernels load the values of a cell with aligned loads
+    if(reinterpret_cast<uintptr_t>(table) % (simdcount*sizeof(double)) != 0)
+        throw std::runtime_error(fmt::format("The table needs to be aligned to {} bytes.", simdcount*sizeof(double)));
+    external_table = table;
+    table_storage = AlignedPaddedVec();
+}
+
 template<class Array>
 void RegularGridInterpolant3D<Array>::evaluate_batch(Array& xyz, Array& fxyz){
     if(fxyz.layout() != xt::layout_type::row_major)
           throw std::runtime_error("fxyz needs to be in row-major storage order");
     int npoints = xyz.shape(0);
+    SIMSOPT_PERF_SCOPE(timer, "RegularGridInterpolant3D::evaluate_batch");
+    SIMSOPT_PERF_ADD(timer, points, npoints);
+    SIMSOPT_PERF_COUNT("interpolant_lookups", npoints);
     for (int i = 0; i < npoints; ++i) {
         evaluate_inplace(xyz(i, 0), xyz(i, 1), xyz(i, 2), fxyz.data() + value_size*i);
     }
@@ -67,6 +97,7 @@ void RegularGridInterpolant3D<Array>::evaluate_batch(Array& xyz, Array& fxyz){
 
 template<class Array>
 Vec RegularGridInterpolant3D<Array>::evaluate(double x, double y, double z){
+    SIMSOPT_PERF_COUNT("interpolant_lookups", 1);
     Vec fxyz(value_size, 0.);
     evaluate_inplace(x, y, z, fxyz.data());
     return fxyz;
@@ -114,15 +145,15 @@ template<class Array>
 void RegularGridInterpolant3D<Array>::evaluate_local(double x, double y, double z, int cell_idx, double* res)
 {
     int degree = rule.degree;
-    auto got = all_local_vals_map.find(cell_idx);
-    if (got == all_local_vals_map.end()) {
+    const double* vals_table = table();
+    if (cell_idx < 0 || cell_idx >= (int)cell_to_table.size() || cell_to_table[cell_idx] < 0 || !vals_table) {
         if(out_of_bounds_ok)
             return;
         else
-            throw std::runtime_error(fmt::format("cell_idx={} not in all_local_vals_map", cell_idx));
+            throw std::runtime_error(fmt::format("cell_idx={} not in the table of the interpolant", cell_idx));
     }
 
-    double* vals_local = got->second.data();
+    const double* vals_local = vals_table + uint64_t(cell_to_table[cell_idx])*local_vals_size;
     #if defined(USE_XSIMD)
     if(xsimd::simd_type<double>::size >= 3){
         simd_t xyz;
@@ -150,7 +181,7 @@ void RegularGridInterpolant3D<Array>::evaluate_local(double x, double y, double
     for(int l=0; l<padded_value_size; l += simdcount) {
         simd_t sumi(0.);
         int offset_local = l;
-        double* val_ptr = &(vals_local[offset_local]);
+        const double* val_ptr = &(vals_local[offset_local]);
         for (int i = 0; i < degree+1; ++i) {
             simd_t sumj(0.); 
             for (int j = 0; j < degree+1; ++j) {
@@ -179,7 +210,7 @@ void RegularGridInterpolant3D<Array>::evaluate_local(double x, double y, double
     for(int l=0; l<padded_value_size; l += simdcount) {
         double sumi(0.);
         int offset_local = l;
-        double* val_ptr = &(vals_local[offset_local]);
+        const double* val_ptr = &(vals_local[offset_local]);
         for (int i = 0; i < degree+1; ++i) {
             double sumj(0.);
             for (int j = 0; j < degree+1; ++j) {
@@ -104,4 +104,142 @@ Array ReimandB(double& iota0, double& iota1, Array& k_theta, Array& epsilon, int
         dB(i,2,2) = dZBZ;
     }
     return dB;
-}
\ No newline at end of file
+}
+#include "reiman.h"
+#include "simdhelpers.h"
+#include <algorithm>
+#include <stdexcept>
+
+// Computes B and grad B at a point (or a simd block of points). `work` needs
+// to hold 2*(kmax+1) entries.
+template<class S>
+static inline void reiman_kernel(double iota0, double iota1, const vector<int>& ks, const vector<double>& epsilonk, int m0, int kmax,
+        const S& x, const S& y, const S& Z, S* work, S (&B)[3], S (&dB)[3][3]) {
+    using std::sqrt;
+    const double R_axis = 1.0;
+    S R = sqrt(x*x + y*y);
+    S rinv = S(1.)/R;
+    S c1 = x*rinv;
+    S s1 = y*rinv;
+    S dR = R - R_axis;
+    S rmin2 = dR*dR + Z*Z;
+    S rmin2inv = S(1.)/rmin2;
+    S rmin4inv = rmin2inv*rmin2inv;
+
+    // (cos(phi) - i sin(phi))^m0
+    S ure(1.), uim(0.);
+    S sgn_s1 = m0 >= 0 ? S(-1.)*s1 : s1;
+    for (int j = 0; j < std::abs(m0); ++j) {
+        S tmp = ure*c1 - uim*sgn_s1;
+        uim = ure*sgn_s1 + uim*c1;
+        ure = tmp;
+    }
+    // ((R-1) + iZ)^k for k = 0, ..., kmax
+    S* wre = work;
+    S* wim = work + kmax + 1;
+    wre[0] = S(1.);
+    wim[0] = S(0.);
+    for (int kk = 1; kk <= kmax; ++kk) {
+        wre[kk] = wre[kk-1]*dR - wim[kk-1]*Z;
+        wim[kk] = wre[kk-1]*Z + wim[kk-1]*dR;
+    }
+
+    S combo = iota0 + iota1*rmin2;
+    S combo1(0.);
+    S dcombodR = 2.0*iota1*dR;
+    S dcombodZ = 2.0*iota1*Z;
+    S dcombodphi(0.), dcombo1dR(0.), dcombo1dZ(0.), dcombo1dphi(0.);
+    for (int ind = 0; ind < (int)ks.size(); ++ind) {
+        const int kk = ks[ind];
+        const double ke = kk*epsilonk[ind];
+        // C = rmin^k cos(k*theta - m0*phi), Sn = rmin^k sin(k*theta - m0*phi)
+        S C = wre[kk]*ure - wim[kk]*uim;
+        S Sn = wre[kk]*uim + wim[kk]*ure;
+        combo       -= ke*C*rmin2inv;
+        combo1      += ke*Sn*rmin2inv;
+        dcombodR    -= ke*(double(kk)*Z*Sn + double(kk-2)*dR*C)*rmin4inv;
+        dcombodZ    += ke*(double(kk)*dR*Sn - double(kk-2)*Z*C)*rmin4inv;
+        dcombodphi  -= (ke*m0)*Sn*rmin2inv;
+        dcombo1dR   += ke*(double(kk-2)*dR*Sn - double(kk)*Z*C)*rmin4inv;
+        dcombo1dZ   += ke*(double(kk)*dR*C + double(kk-2)*Z*Sn)*rmin4inv;
+        dcombo1dphi -= (ke*m0)*C*rmin2inv;
+    }
+
+    S BR   =  (dR*rinv)*combo1 + (Z*rinv)*combo;
+    S BZ   = -(dR*rinv)*combo  + (Z*rinv)*combo1;
+    S Bphi(-1.);
+
+    S dR_BR   = -(Z*rinv*rinv)*combo + (Z*rinv)*dcombodR + combo1*R_axis*rinv*rinv + dcombo1dR*dR*rinv;
+    S dZ_BR   = rinv*combo + (Z*rinv)*dcombodZ + dcombo1dZ*dR*rinv;
+    S dphi_BR = (dR*rinv)*dcombo1dphi + (Z*rinv)*dcombodphi;
+    S dR_BZ   = -(R_axis*rinv*rinv)*combo - (dR*rinv)*dcombodR - combo1*Z*rinv*rinv + dcombo1dR*Z*rinv;
+    S dZ_BZ   = -(dR*rinv)*dcombodZ + combo1*rinv + dcombo1dZ*Z*rinv;
+    S dphi_BZ = -(dR*rinv)*dcombodphi + (Z*rinv)*dcombo1dphi;
+
+    B[0] = BR*c1 - Bphi*s1;
+    B[1] = BR*s1 + Bphi*c1;
+    B[2] = BZ;
+
+    // derivatives of the cartesian components along R, phi and Z, B_phi is constant
+    S dRB[3]   = {dR_BR*c1, dR_BR*s1, dR_BZ};
+    S dphiB[3] = {(dphi_BR - Bphi)*c1 - BR*s1, (dphi_BR - Bphi)*s1 + BR*c1, dphi_BZ};
+    S dZB[3]   = {dZ_BR*c1, dZ_BR*s1, dZ_BZ};
+    for (int l = 0; l < 3; ++l) {
+        dB[0][l] = c1*dRB[l] - s1*rinv*dphiB[l];
+        dB[1][l] = s1*dRB[l] + c1*rinv*dphiB[l];
+        dB[2][l] = dZB[l];
+    }
+}
+
+template<template<class, std::size_t, xt::layout_type> class T>
+ReimanField<T>::ReimanField(double iota0, double iota1, vector<int> k, vector<double> epsilonk, int m0) :
+    MagneticField<T>(), iota0(iota0), iota1(iota1), k(k), epsilonk(epsilonk), m0(m0) {
+    if(k.size() != epsilonk.size())
+        throw std::runtime_error("k and epsilonk need to have the same length.");
+    for (int kk : k) {
+        if(kk < 0)
+            throw std::runtime_error("k needs to be nonnegative.");
+        kmax = std::max(kmax, kk);
+    }
+}
+
+template<template<class, std::size_t, xt::layout_type> class T>
+void ReimanField<T>::compute(Tensor2* B, Tensor3* dB) {
+    Tensor2& points = this->get_points_cart_ref();
+#if defined(USE_XSIMD)
+    using S = simd_t;
+    constexpr int simd_size = xsimd::simd_type<double>::size;
+#else
+    using S = double;
+    constexpr int simd_size = 1;
+#endif
+    double* points_ptr = &(points(0, 0));
+    double* B_ptr = B ? &((*B)(0, 0)) : nullptr;
+    double* dB_ptr = dB ? &((*dB)(0, 0, 0)) : nullptr;
+    int num_points = npoints;
+#pragma omp parallel
+    {
+        vector<S> work(2*(kmax+1));
+        double xbuf[simd_size], ybuf[simd_size], zbuf[simd_size];
+#pragma omp for
+        for (int i = 0; i < num_points; i += simd_size) {
+            S x, y, z;
+            int klimit = load_points_padded<simd_size>(points_ptr, num_points, i, xbuf, ybuf, zbuf, x, y, z);
+            S B_i[3], dB_i[3][3];
+            reiman_kernel(iota0, iota1, k, epsilonk, m0, kmax, x, y, z, work.data(), B_i, dB_i);
+            if(B_ptr) {
+                for (int l = 0; l < 3; ++l)
+                    store_lanes_strided<simd_size>(B_ptr + 3*i + l, 3, klimit, B_i[l]);
+            }
+            if(dB_ptr) {
+                for (int j = 0; j < 3; ++j) {
+                    for (int l = 0; l < 3; ++l)
+                        store_lanes_strided<simd_size>(dB_ptr + 9*i + 3*j + l, 9, klimit, dB_i[j][l]);
+                }
+            }
+        }
+    }
+}
+
+#include "xtensor-python/pytensor.hpp"     // Numpy bindings
+template class ReimanField<xt::pytensor>;
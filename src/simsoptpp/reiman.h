@@ -1,4 +1,63 @@
+#pragma once
+
+#include <vector>
 #include "xtensor-python/pyarray.hpp"
+#include "magneticfield.h"
 typedef xt::pyarray<double> Array;
+using std::vector;
+
 Array ReimanB(double& iota0, double& iota1, Array& k_theta, Array& epsilon, int& m0_symmetry, Array& points);
 Array ReimandB(double& iota0, double& iota1, Array& k_theta, Array& epsilon, int& m0_symmetry, Array& points);
+
+template<template<class, std::size_t, xt::layout_type> class T>
+class ReimanField : public MagneticField<T> {
+    /*
+     * Magnetic field model in section 5 of Reiman and Greenside, Computer
+     * Physics Communications 43 (1986) 157-167, the same field as the one
+     * given by `ReimanB` and `ReimandB`.
+     *
+     * With rmin and theta the polar coordinates around the axis R = 1, Z = 0,
+     * every mode depends on
+     *
+     *   rmin^k * exp(i*(k*theta - m0*phi)) = ((R-1) + i*Z)^k * (cos(phi) - i*sin(phi))^m0,
+     *
+     * which is computed by complex multiplication for all k at once. Hence
+     * neither pow nor any trigonometric function is evaluated per point.
+     * Points are processed in parallel and in blocks of the simd width.
+     */
+    public:
+        using typename MagneticField<T>::Tensor2;
+        using typename MagneticField<T>::Tensor3;
+        using MagneticField<T>::npoints;
+
+    private:
+        int kmax = 0;
+
+        void compute(Tensor2* B, Tensor3* dB);
+
+    protected:
+        // The kernel computes B and grad B together, so both are stored in
+        // one pass, unless the other one is in the cache already.
+        void _B_impl(Tensor2& B) override {
+            if(this->data_dB.get_status())
+                compute(&B, nullptr);
+            else
+                compute(&B, &this->data_dB.get_or_create({npoints, 3, 3}));
+        }
+
+        void _dB_by_dX_impl(Tensor3& dB_by_dX) override {
+            if(this->data_B.get_status())
+                compute(nullptr, &dB_by_dX);
+            else
+                compute(&this->data_B.get_or_create({npoints, 3}), &dB_by_dX);
+        }
+
+    public:
+        const double iota0;
+        const double iota1;
+        const vector<int> k;
+        const vector<double> epsilonk;
+        const int m0;
+
+        ReimanField(double iota0, double iota1, vector<int> k, vector<double> epsilonk, int m0);
+};
@@ -1,8 +1,10 @@
 #pragma once
+#include <algorithm>
 #include <iostream>
 #include <limits>
 #include <cmath>
 #include <new>
+#include <utility>
 #include <vector>
 #include "config.h"
 
@@ -39,6 +41,19 @@ class aligned_padded_allocator : public xs::aligned_allocator<T, Align> {
         template <class U>
         inline aligned_padded_allocator(const aligned_padded_allocator<U, Align>&) noexcept { } 
 
+        // Elements that are not given a value, e.g. in AlignedPaddedVec(n), are
+        // left uninitialized, so that they can be first touched by the
+        // threads that use them, see threads.h.
+        template <class U>
+        void construct(U* p) noexcept {
+            ::new(static_cast<void*>(p)) U;
+        }
+
+        template <class U, class... Args>
+        void construct(U* p, Args&&... args) {
+            ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+        }
+
         T* allocate(size_t n, const void* hint = 0) {
             int simdcount = Align/sizeof(T);
             int nn = (n + simdcount) - (n % simdcount); // round to next highest multiple of simdcount
@@ -99,6 +114,19 @@ public:
     constexpr AlignedPaddedAllocator(AlignedPaddedAllocator<U, ALIGNMENT_IN_BYTES> const&) noexcept
     {}
 
+    // Elements that are not given a value, e.g. in AlignedPaddedVec(n), are
+    // left uninitialized, so that they can be first touched by the
+    // threads that use them, see threads.h.
+    template <class U>
+    void construct(U* p) noexcept {
+        ::new(static_cast<void*>(p)) U;
+    }
+
+    template <class U, class... Args>
+    void construct(U* p, Args&&... args) {
+        ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+
     [[nodiscard]] T* allocate(std::size_t n)
     {
         int simdcount = ALIGNMENT_IN_BYTES/sizeof(T);
@@ -161,3 +189,40 @@ inline simd_t rsqrt(const simd_t& r2){
 inline double rsqrt(const double& r2){
     return 1./std::sqrt(r2);
 }
+
+// Moves `size` consecutive doubles between a buffer and a simd vector, or a
+// single double when the kernels are evaluated without simd.
+inline void load_lanes(const double* buf, double& s) { s = buf[0]; }
+inline void store_lanes(double* buf, const double& s) { buf[0] = s; }
+#if defined(USE_XSIMD)
+inline void load_lanes(const double* buf, simd_t& s) { s = xsimd::load_unaligned(buf); }
+inline void store_lanes(double* buf, const simd_t& s) { xsimd::store_unaligned(buf, s); }
+#endif
+
+// Gathers the points i, ..., i+size-1 of a row major (n, 3) array into xbuf,
+// ybuf and zbuf and loads them into x, y and z. The last block is padded with
+// its last valid point, so that all lanes are evaluated at valid points.
+// Returns the number of valid points in the block.
+template<int size, class S>
+inline int load_points_padded(const double* points, int n, int i, double* xbuf, double* ybuf, double* zbuf, S& x, S& y, S& z) {
+    int klimit = std::min(size, n - i);
+    for (int k = 0; k < size; ++k) {
+        int ik = i + std::min(k, klimit-1);
+        xbuf[k] = points[3*ik+0];
+        ybuf[k] = points[3*ik+1];
+        zbuf[k] = points[3*ik+2];
+    }
+    load_lanes(xbuf, x);
+    load_lanes(ybuf, y);
+    load_lanes(zbuf, z);
+    return klimit;
+}
+
+// Writes the first klimit lanes of s, times scale, to out[0], out[stride], ...
+template<int size, class S>
+inline void store_lanes_strided(double* out, int stride, int klimit, const S& s, double scale=1.) {
+    double buf[size];
+    store_lanes(buf, s);
+    for (int k = 0; k < klimit; ++k)
+        out[stride*k] = scale*buf[k];
+}
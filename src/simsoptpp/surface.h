@@ -12,6 +12,7 @@ using std::logic_error;
 
 #include "xtensor/xarray.hpp"
 #include "cachedarray.h"
+#include "perf.h"
 #include "curve.h"
 #include <Eigen/Dense>
 
@@ -36,8 +37,12 @@ class Surface {
                 loc = cache.insert(std::make_pair(key, CachedArray<Array>(xt::zeros<double>(dims)))).first;
             }
             if(!((loc->second).status)){ // needs recomputing
+                SIMSOPT_PERF_COUNT("surface_cache_misses", 1);
+                SIMSOPT_PERF_SCOPE(timer, "Surface::" + key);
                 impl((loc->second).data);
                 (loc->second).status = true;
+            } else {
+                SIMSOPT_PERF_COUNT("surface_cache_hits", 1);
             }
             return (loc->second).data;
         }
@@ -48,8 +53,12 @@ class Surface {
                 loc = cache_persistent.insert(std::make_pair(key, CachedArray<Array>(xt::zeros<double>(dims)))).first;
             }
             if(!((loc->second).status)){ // needs recomputing
+                SIMSOPT_PERF_COUNT("surface_cache_misses", 1);
+                SIMSOPT_PERF_SCOPE(timer, "Surface::" + key);
                 impl((loc->second).data);
                 (loc->second).status = true;
+            } else {
+                SIMSOPT_PERF_COUNT("surface_cache_hits", 1);
             }
             return (loc->second).data;
         }
@@ -0,0 +1,105 @@
+#include "taskgraph.h"
+#include "perf.h"
+#include <algorithm>
+#include <stdexcept>
+
+int TaskGraph::add_task(std::function<void()> fn, const std::vector<int>& deps, const std::string& name, bool parallel) {
+    if(running)
+        throw std::runtime_error("Tasks can't be added while the graph is running.");
+    if(!fn)
+        throw std::runtime_error("The task needs to be callable.");
+    int id = tasks.size();
+    std::vector<int> unique_deps(deps);
+    std::sort(unique_deps.begin(), unique_deps.end());
+    unique_deps.erase(std::unique(unique_deps.begin(), unique_deps.end()), unique_deps.end());
+    for (int dep : unique_deps) {
+        if(dep < 0 || dep >= id)
+            throw std::runtime_error("Task " + std::to_string(id) + " can only depend on tasks that were added before it.");
+    }
+    for (int dep : unique_deps)
+        tasks[dep].successors.push_back(id);
+    tasks.push_back({std::move(fn), name, parallel, int(unique_deps.size()), {}});
+    return id;
+}
+
+void TaskGraph::execute(int i) {
+    if(failed)
+        return;
+    try {
+        SIMSOPT_PERF_SCOPE(timer, tasks[i].name.empty() ? "TaskGraph::task" : tasks[i].name);
+        tasks[i].fn();
+    } catch (...) {
+#pragma omp critical(simsopt_taskgraph)
+        {
+            if(!error)
+                error = std::current_exception();
+        }
+        failed = true;
+    }
+}
+
+void TaskGraph::release(int i, bool spawn_ready, std::vector<int>& ready) {
+    for (int s : tasks[i].successors) {
+        if(pending[s].fetch_sub(1) != 1)
+            continue;
+        if(tasks[s].parallel) {
+#pragma omp critical(simsopt_taskgraph)
+            ready_parallel.push_back(s);
+        } else if(spawn_ready) {
+            spawn(s);
+        } else {
+            ready.push_back(s);
+        }
+    }
+}
+
+void TaskGraph::spawn(int i) {
+#pragma omp task firstprivate(i)
+    {
+        execute(i);
+        std::vector<int> unused;
+        release(i, true, unused);
+    }
+}
+
+void TaskGraph::run() {
+    if(running)
+        throw std::runtime_error("A TaskGraph can't be run from one of its own tasks.");
+    int ntasks = tasks.size();
+    running = true;
+    failed = false;
+    error = nullptr;
+    pending.reset(new std::atomic<int>[ntasks]);
+    ready_parallel.clear();
+    std::vector<int> ready;
+    for (int i = 0; i < ntasks; ++i) {
+        pending[i] = tasks[i].num_deps;
+        if(tasks[i].num_deps == 0)
+            (tasks[i].parallel ? ready_parallel : ready).push_back(i);
+    }
+    while(!ready.empty() || !ready_parallel.empty()) {
+        if(!ready.empty()) {
+            // the tasks spawn their successors as soon as these are ready, the
+            // region ends once no more tasks can be run concurrently
+#pragma omp parallel
+#pragma omp single
+            for (int i : ready)
+                spawn(i);
+            ready.clear();
+        }
+        std::vector<int> batch;
+        std::swap(batch, ready_parallel);
+        std::sort(batch.begin(), batch.end());
+        for (int i : batch) {
+            execute(i);
+            release(i, false, ready);
+        }
+    }
+    running = false;
+    pending.reset();
+    if(error) {
+        std::exception_ptr e = error;
+        error = nullptr;
+        std::rethrow_exception(e);
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A small executor for graphs of tasks with dependencies, e.g. the terms of an
+// objective and the intermediates that they share (the curves, the field on a
+// surface). On every call to `run`, each task is run exactly once, after all
+// the tasks that it depends on have finished, so an intermediate that is
+// needed by several terms is only computed once.
+//
+// The tasks are run concurrently as OpenMP tasks. Parallel regions inside such
+// a task are inactive, i.e. its kernels run on the thread that runs the task.
+// This is what we want for the many kernels (e.g. Biot-Savart on a small set
+// of points) that are too small to use all threads on their own. Tasks that
+// do use all threads, e.g. the Biot-Savart field on a surface, should be added
+// with `parallel = true`: these are run one after another on the calling
+// thread, outside of the task region, with their parallel regions active.
+//
+// A task may only depend on tasks that were added before it, so the graph
+// can't contain cycles, and without OpenMP the tasks are simply run in the
+// order in which they were added.
+//
+// The tasks may read shared data, e.g. the caches of a curve that is used by
+// several fields, as long as it is computed before the graph is run or by a
+// task that the readers depend on. Nothing is locked, so no task may change
+// the degrees of freedom of an object that another task uses.
+class TaskGraph {
+    public:
+        // Adds the task `fn` that is run after the tasks `deps` and returns
+        // its index. The name is used for the instrumentation in perf.h.
+        int add_task(std::function<void()> fn, const std::vector<int>& deps, const std::string& name="", bool parallel=false);
+
+        // Runs all tasks. If a task throws, no further tasks are started and
+        // the first exception is rethrown once the running tasks are done.
+        void run();
+
+        int size() const { return tasks.size(); }
+
+    private:
+        struct Task {
+            std::function<void()> fn;
+            std::string name;
+            bool parallel;
+            int num_deps;
+            std::vector<int> successors;
+        };
+        std::vector<Task> tasks;
+
+        // The state of the current call to `run`.
+        bool running = false;
+        std::unique_ptr<std::atomic<int>[]> pending;
+        std::vector<int> ready_parallel;
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+
+        void execute(int i);
+        // Called when task i has finished; runs the tasks that have become
+        // ready, or queues them if `spawn` is false or they are parallel.
+        void release(int i, bool spawn, std::vector<int>& ready);
+        void spawn(int i);
+};
@@ -0,0 +1,116 @@
+#include "threads.h"
+#include <atomic>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+#if defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+namespace threads {
+
+static bool deterministic_from_environment() {
+    const char* value = std::getenv("SIMSOPT_DETERMINISTIC");
+    return value != nullptr && std::string(value) == "1";
+}
+
+static std::atomic<bool> deterministic{deterministic_from_environment()};
+
+bool get_deterministic() {
+    return deterministic;
+}
+
+void set_deterministic(bool value) {
+    deterministic = value;
+}
+
+int get_num_threads() {
+#if defined(_OPENMP)
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+void set_num_threads(int num_threads) {
+    if(num_threads < 1)
+        throw std::runtime_error("The number of threads has to be positive.");
+#if defined(_OPENMP)
+    omp_set_num_threads(num_threads);
+#else
+    if(num_threads != 1)
+        throw std::runtime_error("simsoptpp was compiled without OpenMP, so only one thread can be used.");
+#endif
+}
+
+#if defined(__linux__)
+
+static std::vector<int> current_affinity() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if(sched_getaffinity(0, sizeof(set), &set) != 0)
+        throw std::runtime_error("sched_getaffinity failed.");
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if(CPU_ISSET(cpu, &set))
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+std::vector<std::vector<int>> get_thread_affinity() {
+    std::vector<std::vector<int>> res(get_num_threads());
+#if defined(_OPENMP)
+#pragma omp parallel
+    res[omp_get_thread_num()] = current_affinity();
+#else
+    res[0] = current_affinity();
+#endif
+    return res;
+}
+
+void set_thread_affinity(const std::vector<int>& cpus) {
+    long num_cpus = sysconf(_SC_NPROCESSORS_CONF);
+    for (int cpu : cpus) {
+        if(cpu < 0 || cpu >= num_cpus || cpu >= CPU_SETSIZE)
+            throw std::runtime_error("Invalid cpu " + std::to_string(cpu) + ".");
+    }
+    int failures = 0;
+    auto pin = [&cpus, num_cpus](int thread) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if(cpus.size() == 0) {
+            for (int cpu = 0; cpu < num_cpus && cpu < CPU_SETSIZE; ++cpu)
+                CPU_SET(cpu, &set);
+        } else {
+            CPU_SET(cpus[thread % cpus.size()], &set);
+        }
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+    };
+#if defined(_OPENMP)
+#pragma omp parallel reduction(+: failures)
+    failures += !pin(omp_get_thread_num());
+#else
+    failures += !pin(0);
+#endif
+    if(failures > 0)
+        throw std::runtime_error("sched_setaffinity failed, the cpus may not be available to this process.");
+}
+
+#else
+
+std::vector<std::vector<int>> get_thread_affinity() {
+    throw std::runtime_error("Thread affinity is only available on Linux.");
+}
+
+void set_thread_affinity(const std::vector<int>& cpus) {
+    throw std::runtime_error("Thread affinity is only available on Linux.");
+}
+
+#endif
+
+}
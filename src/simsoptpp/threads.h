@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+// Placement of memory and threads on machines with several NUMA nodes, e.g.
+// dual socket nodes.
+//
+// Linux places a page of memory on the NUMA node of the thread that first
+// writes to it. Arrays that are initialized by a single thread (e.g. with
+// xt::zeros) therefore end up on a single node, and the threads on the other
+// sockets have to access them through the interconnect. `parallel_zero` instead
+// writes to an uninitialized array with the same static OpenMP schedule as the
+// kernel that later fills it, so that each thread touches the part of the
+// array that it works on.
+
+namespace threads {
+
+// Arrays with fewer elements are initialized serially, since starting the
+// threads would take longer than the initialization.
+constexpr std::size_t parallel_init_min_size = 1 << 15;
+
+// Zeros the array `data` of `nrows` rows of `row_size` elements each. The
+// rows are distributed over the threads in the same way as the iterations of
+//
+//     #pragma omp parallel for schedule(static)
+//     for (int i = 0; i < nrows; i += rows_per_iteration)
+//
+// so `rows_per_iteration` should be the simd size for the simd kernels that
+// process several rows per iteration.
+inline void parallel_zero(double* data, int nrows, int row_size, int rows_per_iteration=1) {
+    std::size_t n = std::size_t(nrows)*row_size;
+#pragma omp parallel for schedule(static) if(n >= parallel_init_min_size)
+    for (int i = 0; i < nrows; i += rows_per_iteration) {
+        std::size_t first = std::size_t(i)*row_size;
+        std::size_t last = std::size_t(std::min(i + rows_per_iteration, nrows))*row_size;
+        for (std::size_t j = first; j < last; ++j)
+            data[j] = 0.;
+    }
+}
+
+// Whether sums over the iterations of a parallel loop (see `parallel_sum`)
+// are computed in an order that doesn't depend on the number of threads, so
+// that the results are bitwise reproducible. Off by default, unless the
+// environment variable SIMSOPT_DETERMINISTIC is set to 1.
+bool get_deterministic();
+void set_deterministic(bool deterministic);
+
+// The number of iterations that are summed up by one thread in the
+// deterministic mode.
+constexpr int deterministic_block_size = 1024;
+
+// Returns the N sums to which `f(i, sums)` adds for i = 0, ..., n-1, with the
+// iterations distributed over the threads, i.e. the same as
+//
+//     #pragma omp parallel for reduction(+: sums[:N])
+//     for (int i = 0; i < n; ++i)
+//         f(i, sums);
+//
+// where the order in which the iterations are added up depends on the number
+// of threads. In the deterministic mode, the iterations are split into blocks
+// of `deterministic_block_size` instead, each block is summed up by one
+// thread, and the sums of the blocks are added up pairwise, so that the
+// result only depends on n.
+template<int N, class F>
+std::array<double, N> parallel_sum(int n, const F& f) {
+    std::array<double, N> res{};
+    if(!get_deterministic()) {
+        double sums[N] = {};
+#pragma omp parallel for schedule(static) reduction(+: sums[:N])
+        for (int i = 0; i < n; ++i)
+            f(i, sums);
+        std::copy(sums, sums + N, res.begin());
+        return res;
+    }
+    int nblocks = (n + deterministic_block_size - 1) / deterministic_block_size;
+    std::vector<std::array<double, N>> block_sums(nblocks);
+#pragma omp parallel for schedule(static)
+    for (int b = 0; b < nblocks; ++b) {
+        double sums[N] = {};
+        int last = std::min(n, (b + 1) * deterministic_block_size);
+        for (int i = b * deterministic_block_size; i < last; ++i)
+            f(i, sums);
+        std::copy(sums, sums + N, block_sums[b].begin());
+    }
+    for (int stride = 1; stride < nblocks; stride *= 2) {
+        for (int b = 0; b + stride < nblocks; b += 2 * stride) {
+            for (int k = 0; k < N; ++k)
+                block_sums[b][k] += block_sums[b + stride][k];
+        }
+    }
+    if(nblocks > 0)
+        res = block_sums[0];
+    return res;
+}
+
+// The number of threads used by OpenMP parallel regions, 1 without OpenMP.
+int get_num_threads();
+
+// Sets the number of threads used by OpenMP parallel regions. This overrides
+// the environment variable OMP_NUM_THREADS.
+void set_num_threads(int num_threads);
+
+// Returns the CPUs that each of the OpenMP threads may run on.
+std::vector<std::vector<int>> get_thread_affinity();
+
+// Pins OpenMP thread i to the CPU cpus[i % cpus.size()]; with an empty list
+// the threads may run on all CPUs again. Thread 0 is the calling thread, i.e.
+// usually the python interpreter. The pinning applies as long as the number
+// of threads is not changed. Only available on Linux.
+void set_thread_affinity(const std::vector<int>& cpus);
+
+}
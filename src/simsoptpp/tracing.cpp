@@ -6,6 +6,7 @@
 #include <cassert>
 #include <stdexcept>
 #include "tracing.h"
+#include "pygil.h"
 using std::shared_ptr;
 using std::vector;
 using std::tuple;
@@ -49,6 +50,7 @@ class GuidingCenterVacuumRHS {
 
         void operator()(const State &ys, array<double, 4> &dydt,
                 const double t) {
+            ScopedGILAcquire gil;
             double x = ys[0];
             double y = ys[1];
             double z = ys[2];
@@ -94,6 +96,8 @@ class GuidingCenterVacuumBoozerRHS {
         typename BoozerMagneticField<T>::Tensor2 stz = xt::zeros<double>({1, 3});
         shared_ptr<BoozerMagneticField<T>> field;
         double m, q, mu;
+        // the quantities needed per step, computed in one pass over the field
+        const long mask = BoozerMagneticField<T>::quantity_mask({"modB", "modB_derivs", "G", "iota"});
     public:
         static constexpr int Size = 4;
         using State = std::array<double, Size>;
@@ -105,6 +109,7 @@ class GuidingCenterVacuumBoozerRHS {
 
         void operator()(const State &ys, array<double, 4> &dydt,
                 const double t) {
+            ScopedGILAcquire gil;
             double v_par = ys[3];
 
             stz(0, 0) = ys[0];
@@ -112,13 +117,14 @@ class GuidingCenterVacuumBoozerRHS {
             stz(0, 2) = ys[2];
 
             field->set_points(stz);
+            field->compute(mask);
             auto psi0 = field->psi0;
             double modB = field->modB_ref()(0);
             double G = field->G_ref()(0);
             double iota = field->iota_ref()(0);
-            double dmodBds = field->modB_derivs_ref()(0);
-            double dmodBdtheta = field->modB_derivs_ref()(1);
-            double dmodBdzeta = field->modB_derivs_ref()(2);
+            double dmodBds = field->dmodBds_ref()(0);
+            double dmodBdtheta = field->dmodBdtheta_ref()(0);
+            double dmodBdzeta = field->dmodBdzeta_ref()(0);
             double v_perp2 = 2*mu*modB;
             double fak1 = m*v_par*v_par/modB + m*mu;
 
@@ -148,6 +154,8 @@ class GuidingCenterNoKBoozerRHS {
         typename BoozerMagneticField<T>::Tensor2 stz = xt::zeros<double>({1, 3});
         shared_ptr<BoozerMagneticField<T>> field;
         double m, q, mu;
+        // the quantities needed per step, computed in one pass over the field
+        const long mask = BoozerMagneticField<T>::quantity_mask({"modB", "modB_derivs", "G", "I", "dGds", "dIds", "iota"});
     public:
         static constexpr int Size = 4;
         using State = std::array<double, Size>;
@@ -159,6 +167,7 @@ class GuidingCenterNoKBoozerRHS {
 
         void operator()(const State &ys, array<double, 4> &dydt,
                 const double t) {
+            ScopedGILAcquire gil;
             double v_par = ys[3];
 
             stz(0, 0) = ys[0];
@@ -166,6 +175,7 @@ class GuidingCenterNoKBoozerRHS {
             stz(0, 2) = ys[2];
 
             field->set_points(stz);
+            field->compute(mask);
             auto psi0 = field->psi0;
             double modB = field->modB_ref()(0);
             double G = field->G_ref()(0);
@@ -173,9 +183,9 @@ class GuidingCenterNoKBoozerRHS {
             double dGdpsi = field->dGds_ref()(0)/psi0;
             double dIdpsi = field->dIds_ref()(0)/psi0;
             double iota = field->iota_ref()(0);
-            double dmodBdpsi = field->modB_derivs_ref()(0)/psi0;
-            double dmodBdtheta = field->modB_derivs_ref()(1);
-            double dmodBdzeta = field->modB_derivs_ref()(2);
+            double dmodBdpsi = field->dmodBds_ref()(0)/psi0;
+            double dmodBdtheta = field->dmodBdtheta_ref()(0);
+            double dmodBdzeta = field->dmodBdzeta_ref()(0);
             double v_perp2 = 2*mu*modB;
             double fak1 = m*v_par*v_par/modB + m*mu;
             double D = ((q + m*v_par*dIdpsi/modB)*G - (-q*iota + m*v_par*dGdpsi/modB)*I)/iota;
@@ -207,6 +217,8 @@ class GuidingCenterBoozerRHS {
         typename BoozerMagneticField<T>::Tensor2 stz = xt::zeros<double>({1, 3});
         shared_ptr<BoozerMagneticField<T>> field;
         double m, q, mu;
+        // the quantities needed per step, computed in one pass over the field
+        const long mask = BoozerMagneticField<T>::quantity_mask({"modB", "modB_derivs", "K", "K_derivs", "G", "I", "dGds", "dIds", "iota"});
     public:
         static constexpr int Size = 4;
         using State = std::array<double, Size>;
@@ -217,6 +229,7 @@ class GuidingCenterBoozerRHS {
 
         void operator()(const State &ys, array<double, 4> &dydt,
                 const double t) {
+            ScopedGILAcquire gil;
             double v_par = ys[3];
 
             stz(0, 0) = ys[0];
@@ -226,20 +239,21 @@ class GuidingCenterBoozerRHS {
             assert(ys[0]>0);
 
             field->set_points(stz);
+            field->compute(mask);
             auto psi0 = field->psi0;
             double modB = field->modB_ref()(0);
             double K = field->K_ref()(0);
-            double dKdtheta = field->K_derivs_ref()(0);
-            double dKdzeta = field->K_derivs_ref()(1);
+            double dKdtheta = field->dKdtheta_ref()(0);
+            double dKdzeta = field->dKdzeta_ref()(0);
 
             double G = field->G_ref()(0);
             double I = field->I_ref()(0);
             double dGdpsi = field->dGds_ref()(0)/psi0;
             double dIdpsi = field->dIds_ref()(0)/psi0;
             double iota = field->iota_ref()(0);
-            double dmodBdpsi = field->modB_derivs_ref()(0)/psi0;
-            double dmodBdtheta = field->modB_derivs_ref()(1);
-            double dmodBdzeta = field->modB_derivs_ref()(2);
+            double dmodBdpsi = field->dmodBds_ref()(0)/psi0;
+            double dmodBdtheta = field->dmodBdtheta_ref()(0);
+            double dmodBdzeta = field->dmodBdzeta_ref()(0);
             double v_perp2 = 2*mu*modB;
             double fak1 = m*v_par*v_par/modB + m*mu; // dHdB
             double C = -m*v_par*(dKdzeta-dGdpsi)/modB - q*iota;
@@ -275,6 +289,7 @@ class FullorbitRHS {
             }
         void operator()(const array<double, 6> &ys, array<double, 6> &dydt,
                 const double t) {
+            ScopedGILAcquire gil;
             double x = ys[0];
             double y = ys[1];
             double z = ys[2];
@@ -314,6 +329,7 @@ class FieldlineRHS {
             }
         void operator()(const array<double, 3> &ys, array<double, 3> &dydt,
                 const double t) {
+            ScopedGILAcquire gil;
             double x = ys[0];
             double y = ys[1];
             double z = ys[2];
@@ -385,9 +401,13 @@ solve(RHS rhs, typename RHS::State y, double tmax, double dt, double dtmax, doub
     boost::math::tools::eps_tolerance<double> roottol(-int(std::log2(tol)));
     uintmax_t rootmaxit = 200;
     State temp;
+    // Other python threads can run while the orbit is integrated, the rhs
+    // only holds the GIL while it evaluates the field. The rhs is passed by
+    // reference to the stepper, as copying its pytensors needs the GIL.
+    ScopedGILRelease gil;
     do {
         res.push_back(join<1, RHS::Size>({t}, y));
-        tuple<double, double> step = dense.do_step(rhs);
+        tuple<double, double> step = dense.do_step(std::ref(rhs));
         iter++;
         t = dense.current_time();
         y = dense.current_state();
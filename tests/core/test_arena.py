@@ -0,0 +1,56 @@
+import unittest
+
+import numpy as np
+
+import simsoptpp as sopp
+from simsopt.geo import CurveCWSFourier, SurfaceRZFourier
+
+
+def cws_curve():
+    s = SurfaceRZFourier(nfp=2, stellsym=True, mpol=1, ntor=0)
+    s.set_rc(0, 0, 1.0)
+    s.set_rc(1, 0, 0.3)
+    s.set_zs(1, 0, 0.3)
+    order = 4
+    curve = CurveCWSFourier(s.mpol, s.ntor, s.get_dofs(), 10 * order, order, s.nfp, s.stellsym)
+    dofs = 0.1 * np.random.default_rng(1).standard_normal(len(curve.get_dofs()))
+    dofs[0] = 1
+    curve.set_dofs(dofs)
+    return curve
+
+
+class ArenaTests(unittest.TestCase):
+
+    def evaluate(self):
+        # the derivatives are kept in a cache that invalidate_cache doesn't
+        # reset, so they are computed on a new curve every time
+        res = []
+        for quantity in ['dgamma_by_dcoeff', 'dgammadash_by_dcoeff', 'dgammadashdash_by_dcoeff']:
+            res.append(getattr(cws_curve(), quantity)().copy())
+        return res
+
+    def test_no_allocations_when_repeated(self):
+        # once the arenas have grown to the size needed by the derivatives,
+        # evaluating them again doesn't allocate any scratch memory
+        first = self.evaluate()
+        allocations = sopp.arena_heap_allocations()
+        for _ in range(3):
+            for a, b in zip(first, self.evaluate()):
+                assert np.array_equal(a, b)
+        assert sopp.arena_heap_allocations() == allocations
+
+    def test_result_independent_of_threads(self):
+        n = sopp.get_num_threads()
+        try:
+            sopp.set_num_threads(max(n, 2))
+        except RuntimeError:
+            self.skipTest("simsoptpp was compiled without OpenMP")
+        try:
+            sopp.set_num_threads(1)
+            serial = self.evaluate()
+            sopp.set_num_threads(max(n, 2))
+            parallel = self.evaluate()
+        finally:
+            sopp.set_num_threads(n)
+        for a, b in zip(serial, parallel):
+            assert np.array_equal(a, b)
@@ -0,0 +1,56 @@
+import unittest
+
+import numpy as np
+try:
+    from mpi4py import MPI
+    with_mpi = True
+except ImportError:
+    with_mpi = False
+
+from simsopt._core.util import parallel_fill
+
+
+class MPIParallelFillTests(unittest.TestCase):
+
+    def check_parallel_fill(self, comm, n):
+        calls = []
+
+        def fill(first, last, out):
+            calls.append((first, last))
+            assert out.shape == (last-first, 2)
+            out[:, 0] = np.arange(first, last)
+            out[:, 1] = 10*np.arange(first, last)
+
+        with parallel_fill(comm, n, (2, ), fill) as values:
+            assert values.shape == (n, 2)
+            assert np.all(values[:, 0] == np.arange(n))
+            assert np.all(values[:, 1] == 10*np.arange(n))
+
+        # every rank is called exactly once, and the ranges of all ranks
+        # partition the rows
+        assert len(calls) == 1
+        first, last = calls[0]
+        assert 0 <= first <= last <= n
+        if comm is None:
+            assert (first, last) == (0, n)
+            return
+        ranges = sorted(comm.allgather(calls[0]))
+        assert ranges[0][0] == 0
+        assert ranges[-1][1] == n
+        for i in range(len(ranges)-1):
+            assert ranges[i][1] == ranges[i+1][0]
+
+    def test_mpi_parallel_fill_serial(self):
+        for n in [1, 2, 7]:
+            self.check_parallel_fill(None, n)
+
+    @unittest.skipIf(not with_mpi, "mpi not found")
+    def test_mpi_parallel_fill(self):
+        comm = MPI.COMM_WORLD
+        # fewer rows than ranks, so that some ranks don't fill any rows
+        for n in [1, max(comm.size-1, 1), comm.size, comm.size+1, 7, 100]:
+            self.check_parallel_fill(comm, n)
+
+
+if __name__ == "__main__":
+    unittest.main()
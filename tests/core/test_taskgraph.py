@@ -0,0 +1,107 @@
+import unittest
+
+import numpy as np
+
+import simsoptpp as sopp
+
+
+class TaskGraphTests(unittest.TestCase):
+
+    def test_order(self):
+        # a diamond with a parallel task in the middle, and a task that
+        # only depends on the first one
+        order = []
+        graph = sopp.TaskGraph()
+
+        def task(i):
+            return lambda: order.append(i)
+        a = graph.add_task(task(0))
+        b = graph.add_task(task(1), [a])
+        c = graph.add_task(task(2), [a], parallel=True)
+        d = graph.add_task(task(3), [b, c, b])
+        graph.add_task(task(4), [a], name="independent")
+        assert len(graph) == 5
+        for run in range(2):
+            order.clear()
+            graph.run()
+            assert sorted(order) == list(range(5))
+            pos = {i: order.index(i) for i in order}
+            assert pos[a] < pos[b] < pos[d]
+            assert pos[a] < pos[c] < pos[d]
+            assert pos[a] < pos[4]
+
+    def test_invalid_dependencies(self):
+        graph = sopp.TaskGraph()
+        a = graph.add_task(lambda: None)
+        with self.assertRaises(RuntimeError):
+            graph.add_task(lambda: None, [a + 1])
+        with self.assertRaises(RuntimeError):
+            graph.add_task(lambda: None, [-1])
+        assert len(graph) == 1
+
+    def test_exception(self):
+        ran = []
+        graph = sopp.TaskGraph()
+
+        def fail():
+            raise ValueError("fail")
+        a = graph.add_task(fail)
+        graph.add_task(lambda: ran.append(1), [a])
+        with self.assertRaises(ValueError):
+            graph.run()
+        assert ran == []
+
+        graph = sopp.TaskGraph()
+        graph.add_task(lambda: graph.run())
+        with self.assertRaises(RuntimeError):
+            graph.run()
+
+    def test_kernels(self):
+        # tasks that call kernels which release the GIL
+        rng = np.random.default_rng(1)
+        gammas = [rng.standard_normal((50, 3)) for _ in range(4)]
+        dgammas = [rng.standard_normal((50, 3)) for _ in range(4)]
+        points = [rng.standard_normal((200, 3)) + 5 for _ in range(8)]
+        res = [np.zeros((200, 3)) for _ in range(8)]
+        graph = sopp.TaskGraph()
+
+        def task(i):
+            return lambda: sopp.biot_savart_B(points[i], gammas, dgammas, np.ones(4), out=res[i])
+        for i in range(8):
+            graph.add_task(task(i))
+        graph.run()
+        for i in range(8):
+            assert np.allclose(res[i], sopp.biot_savart_B(points[i], gammas, dgammas, np.ones(4)), rtol=1e-14, atol=0)
+
+    def test_shared_optimizables(self):
+        # fields on different points that share their coils: the tasks fill
+        # and read the caches of the same curves, while the dofs are only
+        # changed between the runs
+        from simsopt.geo.curve import create_equally_spaced_curves
+        from simsopt.field.coil import Current, coils_via_symmetries
+        from simsopt.field.biotsavart import BiotSavart
+        curves = create_equally_spaced_curves(3, 2, stellsym=True, R0=1.0, R1=0.5, order=4)
+        currents = [Current(1e5) for _ in range(3)]
+        coils = coils_via_symmetries(curves, currents, 2, True)
+        rng = np.random.default_rng(2)
+        points = [np.ascontiguousarray(rng.uniform(-1.5, 1.5, size=(100, 3))) for _ in range(8)]
+        fields = [BiotSavart(coils) for _ in range(8)]
+        for bs, p in zip(fields, points):
+            bs.set_points(p)
+        res = [None] * 8
+        graph = sopp.TaskGraph()
+
+        def task(i):
+            def f():
+                res[i] = fields[i].dB_by_dX().copy()
+            return f
+        for i in range(8):
+            graph.add_task(task(i))
+        for run in range(3):
+            curves[0].x = curves[0].x + 0.01 * rng.standard_normal(curves[0].x.shape)
+            currents[1].x = currents[1].x * 1.1
+            graph.run()
+            for i in range(8):
+                bs = BiotSavart(coils)
+                bs.set_points(points[i])
+                assert np.allclose(res[i], bs.dB_by_dX(), rtol=1e-13, atol=0)
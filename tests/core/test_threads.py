@@ -0,0 +1,87 @@
+import os
+import sys
+import unittest
+
+import numpy as np
+
+import simsoptpp as sopp
+from simsopt.field import BiotSavart, Current, coils_via_symmetries
+from simsopt.geo import create_equally_spaced_curves
+
+
+class ThreadsTests(unittest.TestCase):
+
+    def test_num_threads(self):
+        n = sopp.get_num_threads()
+        assert n >= 1
+        try:
+            sopp.set_num_threads(1)
+            assert sopp.get_num_threads() == 1
+            with self.assertRaises(RuntimeError):
+                sopp.set_num_threads(0)
+        finally:
+            sopp.set_num_threads(n)
+
+    @unittest.skipIf(not sys.platform.startswith('linux'), "thread affinity is only available on Linux")
+    def test_thread_affinity(self):
+        cpus = sorted(os.sched_getaffinity(0))
+        before = sopp.get_thread_affinity()
+        assert len(before) == sopp.get_num_threads()
+        try:
+            sopp.set_thread_affinity(cpus[:1])
+            assert all(affinity == cpus[:1] for affinity in sopp.get_thread_affinity())
+            with self.assertRaises(RuntimeError):
+                sopp.set_thread_affinity([-1])
+        finally:
+            sopp.set_thread_affinity([])
+            os.sched_setaffinity(0, cpus)
+        assert sopp.get_thread_affinity()[0] == cpus
+
+    def test_result_independent_of_threads(self):
+        # the arrays that are first touched by several threads have to give the
+        # same result as with a single thread
+        base_curves = create_equally_spaced_curves(2, 2, stellsym=True, R0=1.0, R1=0.5, order=3)
+        coils = coils_via_symmetries(base_curves, [Current(1e5), Current(1e5)], 2, True)
+        points = np.random.default_rng(1).standard_normal((40000, 3))
+        n = sopp.get_num_threads()
+        try:
+            sopp.set_num_threads(max(n, 2))
+        except RuntimeError:
+            self.skipTest("simsoptpp was compiled without OpenMP")
+        try:
+            sopp.set_num_threads(1)
+            B1 = BiotSavart(coils).set_points(points).B().copy()
+            sopp.set_num_threads(max(n, 2))
+            B2 = BiotSavart(coils).set_points(points).B().copy()
+        finally:
+            sopp.set_num_threads(n)
+        assert np.array_equal(B1, B2)
+
+    def test_deterministic_sums(self):
+        # in the deterministic mode, sums over many points don't depend on the
+        # number of threads
+        rng = np.random.default_rng(2)
+        nphi, ntheta = 200, 300
+        Bcoil = rng.standard_normal((nphi, ntheta, 3))
+        normal = rng.standard_normal((nphi, ntheta, 3))
+        Btarget = rng.standard_normal((nphi, ntheta))
+        n = sopp.get_num_threads()
+        deterministic = sopp.get_deterministic()
+        try:
+            sopp.set_num_threads(max(n, 2))
+        except RuntimeError:
+            self.skipTest("simsoptpp was compiled without OpenMP")
+        try:
+            sopp.set_deterministic(True)
+            assert sopp.get_deterministic()
+            results = []
+            for num_threads in [1, 2, 3]:
+                sopp.set_num_threads(num_threads)
+                results.append([sopp.integral_BdotN(Bcoil, Btarget, normal, local) for local in [True, False]])
+            sopp.set_deterministic(False)
+            default = [sopp.integral_BdotN(Bcoil, Btarget, normal, local) for local in [True, False]]
+        finally:
+            sopp.set_num_threads(n)
+            sopp.set_deterministic(deterministic)
+        assert results[0] == results[1] == results[2]
+        assert np.allclose(results[0], default, rtol=1e-12)
@@ -439,5 +439,161 @@ class Testing(unittest.TestCase):
         assert np.linalg.norm(dH[0]-dH_approx) < 1e-15
 
 
+    def test_biotsavart_adaptive_quadrature(self):
+        from simsopt.geo.curve import adaptive_quadrature
+
+        def curve_with_quadpoints(quadpoints):
+            curve = CurveXYZFourier(quadpoints, 4)
+            curve.set('xc(1)', 1.)
+            curve.set('ys(1)', 1.)
+            curve.set('xc(2)', 0.3)
+            curve.set('zs(2)', 0.2)
+            curve.set('yc(3)', 0.1)
+            return curve
+
+        # target points clustered close to one section of the coil
+        curve = curve_with_quadpoints(400)
+        gamma = curve.gamma()[:20]
+        normal = np.cross(curve.gammadash()[:20], [0, 0, 1])
+        normal /= np.linalg.norm(normal, axis=1)[:, None]
+        points = gamma + 0.05 * normal
+
+        btrue = BiotSavart([Coil(curve_with_quadpoints(4000), Current(1e4))]).set_points(points).B()
+        buniform = BiotSavart([Coil(curve_with_quadpoints(100), Current(1e4))]).set_points(points).B()
+
+        quadpoints, quadweights = adaptive_quadrature(curve, 100, target_points=points)
+        assert np.all(np.diff(quadpoints) > 0)
+        assert abs(np.sum(quadweights) - 1) < 1e-2
+        adapted = curve_with_quadpoints(quadpoints)
+        adapted.set_quadweights(quadweights)
+        bs = BiotSavart([Coil(adapted, Current(1e4))]).set_points(points)
+        badapted = bs.B()
+        err_uniform = np.linalg.norm(buniform-btrue)/np.linalg.norm(btrue)
+        err_adapted = np.linalg.norm(badapted-btrue)/np.linalg.norm(btrue)
+        assert err_adapted < 0.1 * err_uniform
+
+        # explicitly uniform weights are the same as no weights
+        uniform = curve_with_quadpoints(100)
+        uniform.set_quadweights(np.full(100, 1./100))
+        bweighted = BiotSavart([Coil(uniform, Current(1e4))]).set_points(points).B()
+        assert np.allclose(bweighted, buniform, rtol=1e-13, atol=0)
+
+        # the low level functions take the weights as an argument
+        from simsoptpp import biot_savart, biot_savart_B, biot_savart_vjp
+        args = (points, [adapted.gamma()], [adapted.gammadash()])
+        assert np.allclose(biot_savart_B(*args, [1e4], quadweights=[quadweights]), badapted, rtol=1e-13, atol=0)
+        B = [np.zeros_like(points)]
+        biot_savart(*args, B, [], [], quadweights=[quadweights])
+        assert np.allclose(1e4*B[0], badapted, rtol=1e-13, atol=0)
+        res_B = [np.zeros((len(adapted.x), ))]
+        biot_savart_vjp(*args, [1e4], badapted, np.zeros((0, 3, 3)), [adapted.dgamma_by_dcoeff()],
+                        [adapted.dgammadash_by_dcoeff()], res_B, [], quadweights=[quadweights])
+        assert np.allclose(res_B[0], bs.B_vjp(badapted)(adapted), rtol=1e-12, atol=0)
+        with self.assertRaises(RuntimeError):
+            biot_savart_B(*args, [1e4], quadweights=[quadweights[:-1]])
+
+        # the vjp uses the same weights as the field
+        np.random.seed(1)
+        J0 = np.sum(badapted**2)
+        dofs = adapted.x
+        dJ = bs.B_vjp(badapted)(adapted)
+        h = 1e-2 * np.random.rand(len(dofs))
+        dJ_dh = 2*np.sum(dJ * h)
+        err = 1e6
+        for i in range(5, 10):
+            eps = 0.5**i
+            adapted.x = dofs + eps * h
+            deriv_est = (np.sum(bs.B()**2)-J0)/eps
+            err_new = np.linalg.norm(deriv_est-dJ_dh)
+            assert err_new < 0.55 * err
+            err = err_new
+        adapted.x = dofs
+
+
+    def test_biotsavart_B_out(self):
+        from simsoptpp import biot_savart, biot_savart_B
+        curves = [get_curve(perturb=True) for _ in range(3)]
+        gammas = [c.gamma() for c in curves]
+        gammadashs = [c.gammadash() for c in curves]
+        currents = [1e4, -2e4, 3e4]
+        points = np.random.default_rng(1).standard_normal((21, 3))
+        Bs = [np.zeros((21, 3)) for _ in curves]
+        biot_savart(points, gammas, gammadashs, Bs, [], [])
+        expected = sum(current * B for current, B in zip(currents, Bs))
+        out = np.ones((21, 3))
+        biot_savart_B(points, gammas, gammadashs, currents, out=out)
+        assert np.allclose(out, expected, rtol=1e-13, atol=0)
+        assert np.allclose(biot_savart_B(points, gammas, gammadashs, currents), expected, rtol=1e-13, atol=0)
+        with self.assertRaises(RuntimeError):
+            biot_savart_B(points, gammas, gammadashs, currents, out=np.zeros((20, 3)))
+        # out can only be passed by keyword, not in the place of quadweights
+        with self.assertRaises(TypeError):
+            biot_savart_B(points, gammas, gammadashs, currents, out)
+
+    def test_biotsavart_curve_collection(self):
+        # the field of coils whose curves are evaluated as one block by a
+        # collection is the same as the one of the individual curves
+        from simsopt.geo.curvecollection import CurveCollection
+        from simsopt._core.json import GSONDecoder, GSONEncoder, SIMSON
+        import json
+        np.random.seed(1)
+        curves = [get_curve(perturb=True) for _ in range(3)]
+        coils = [Coil(curve, Current(current)) for curve, current in zip(curves, [1e4, -2e4, 3e4])]
+        points = np.random.default_rng(1).standard_normal((21, 3))
+        bs = BiotSavart(coils).set_points(points)
+        bs_collection = BiotSavart(coils, CurveCollection(curves)).set_points(points)
+        assert np.allclose(bs_collection.B(), bs.B(), rtol=1e-13, atol=0)
+        assert np.allclose(bs_collection.dB_by_dX(), bs.dB_by_dX(), rtol=1e-13, atol=0)
+        assert np.allclose(bs_collection.A(), bs.A(), rtol=1e-13, atol=0)
+        v = np.random.standard_normal(size=(21, 3))
+        vgrad = np.random.standard_normal(size=(21, 3, 3))
+        for J1, J2 in zip(bs_collection.B_and_dB_vjp(v, vgrad), bs.B_and_dB_vjp(v, vgrad)):
+            for coil in coils:
+                assert np.allclose(J1(coil), J2(coil), rtol=1e-12, atol=0)
+
+        # the blocks follow changes of the dofs
+        curves[1].x = curves[1].x + 0.01
+        assert np.allclose(bs_collection.B(), bs.B(), rtol=1e-13, atol=0)
+
+        bs_regen = json.loads(json.dumps(SIMSON(bs_collection), cls=GSONEncoder), cls=GSONDecoder)
+        assert bs_regen._collection is not None
+        assert np.allclose(bs_regen.B(), bs.B(), rtol=1e-13, atol=0)
+
+        with self.assertRaises(RuntimeError):
+            BiotSavart(coils, CurveCollection(curves[::-1]))
+
+    def test_biotsavart_from_threads(self):
+        # the kernels release the GIL, evaluating from several python threads
+        # has to give the same result as evaluating serially
+        from concurrent.futures import ThreadPoolExecutor
+        from simsoptpp import biot_savart_B
+        curves = [get_curve(perturb=True) for _ in range(4)]
+        gammas = [c.gamma() for c in curves]
+        gammadashs = [c.gammadash() for c in curves]
+        currents = [1e4, 2e4, -1e4, 3e4]
+        rng = np.random.default_rng(1)
+        points = [rng.standard_normal((100, 3)) for _ in range(8)]
+        expected = [biot_savart_B(p, gammas, gammadashs, currents) for p in points]
+        with ThreadPoolExecutor(max_workers=4) as executor:
+            results = list(executor.map(lambda p: biot_savart_B(p, gammas, gammadashs, currents), points))
+        for B1, B2 in zip(expected, results):
+            assert np.allclose(B1, B2, rtol=1e-15, atol=0)
+
+    def test_biotsavart_rejects_converted_output(self):
+        # an output buffer of the wrong dtype would silently be copied, so it
+        # is rejected instead of losing the result
+        from simsoptpp import biot_savart
+        curve = get_curve()
+        points = np.zeros((5, 3))
+        with self.assertRaises(TypeError):
+            biot_savart(points, [curve.gamma()], [curve.gammadash()], [np.zeros((5, 3), dtype=np.float32)], [], [])
+        B = [np.zeros((5, 3))]
+        biot_savart(points, [curve.gamma()], [curve.gammadash()], B, [], [])
+        assert np.linalg.norm(B[0]) > 0
+        # neither are inputs of the wrong dtype copied
+        with self.assertRaises(TypeError):
+            biot_savart(points, [curve.gamma().astype(np.float32)], [curve.gammadash()], B, [], [])
+
+
 if __name__ == "__main__":
     unittest.main()
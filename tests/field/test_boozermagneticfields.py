@@ -1,6 +1,9 @@
-from simsopt.field.boozermagneticfield import BoozerRadialInterpolant, InterpolatedBoozerField, BoozerAnalytic
+from simsopt.field.boozermagneticfield import BoozerRadialInterpolant, InterpolatedBoozerField, BoozerAnalytic, \
+    BoozerRadialSplineField
+from scipy.interpolate import InterpolatedUnivariateSpline
 import numpy as np
 import unittest
+import simsoptpp as sopp
 from pathlib import Path
 TEST_DIR = (Path(__file__).parent / ".." / "test_files").resolve()
 filename = str((TEST_DIR / 'wout_LandremanPaul2021_QA_lowres.nc').resolve())
@@ -116,6 +119,146 @@ class TestingAnalytic(unittest.TestCase):
         assert (ba.K1 == 3.7)
 
 
+class TestingFourierTransforms(unittest.TestCase):
+    def test_fourier_transforms(self):
+        # modes and grid as in BoozerRadialInterpolant.compute_K
+        np.random.seed(0)
+        mboz, nboz, nfp = 4, 3, 2
+        xm = np.array([m for m in range(mboz+1) for n in range(-nboz, nboz+1) if m > 0 or n >= 0], dtype=float)
+        xn = nfp*np.array([n for m in range(mboz+1) for n in range(-nboz, nboz+1) if m > 0 or n >= 0], dtype=float)
+        num_modes = len(xm)
+        thetas = np.linspace(0, 2*np.pi, 2*(2*mboz+1), endpoint=False)
+        zetas = np.linspace(0, 2*np.pi/nfp, 2*(2*nboz+1), endpoint=False)
+        thetas, zetas = np.meshgrid(thetas, zetas)
+        thetas = thetas.flatten()
+        zetas = zetas.flatten()
+        angles = xm[None, :]*thetas[:, None] - xn[None, :]*zetas[:, None]
+
+        # the transforms agree with the direct sums
+        kmn = np.random.uniform(-1, 1, size=num_modes)
+        K = np.zeros(len(thetas))
+        sopp.inverse_fourier_transform_odd(K, kmn, xm, xn, thetas, zetas)
+        assert np.allclose(K, np.sin(angles[:, 1:]) @ kmn[1:])
+        K = np.zeros(len(thetas))
+        sopp.inverse_fourier_transform_even(K, kmn, xm, xn, thetas, zetas)
+        assert np.allclose(K, np.cos(angles) @ kmn)
+        assert np.allclose(sopp.fourier_transform_even(K, xm, xn, thetas, zetas), kmn)
+
+        # the tensor grid path agrees with the pointwise path on shuffled points
+        num_surf = 3
+        coeffs = [1e-2*np.random.uniform(-1, 1, size=(num_modes, num_surf)) for i in range(14)]
+        coeffs[0][0, :] += 1.  # rmnc
+        coeffs[6][0, :] += 1.  # bmnc
+        iota = np.array([0.4, 0.42, 0.45])
+        G = np.array([1.2, 1.2, 1.2])
+        I = np.array([0., 0.01, 0.02])
+        perm = np.random.permutation(len(thetas))
+        for n in [7, 14]:
+            args = coeffs[:n] + [iota, G, I, xm, xn]
+            f = sopp.compute_kmns if n == 7 else sopp.compute_kmnc_kmns
+            k_grid = f(*args, thetas, zetas)
+            k_points = f(*args, thetas[perm], zetas[perm])
+            assert np.allclose(k_grid, k_points, rtol=1e-12, atol=1e-14)
+
+
+class TestingRadialSplineField(unittest.TestCase):
+    def test_radialsplinefield(self):
+        """
+        Compares BoozerRadialSplineField with a direct evaluation of the
+        splines and the Fourier series, and the s derivatives with finite
+        differences.
+        """
+        np.random.seed(0)
+        nfp = 3
+        xm = np.array([m for m in range(4) for n in range(-2, 3) if m > 0 or n >= 0], dtype=float)
+        xn = nfp*np.array([n for m in range(4) for n in range(-2, 3) if m > 0 or n >= 0], dtype=float)
+        num_modes = len(xm)
+        radial_power = np.random.choice([0., 0.5, 1., 1.5], size=num_modes)
+        s_grid = np.linspace(0.05, 0.95, 12)
+
+        def splines():
+            return [InterpolatedUnivariateSpline(s_grid, np.random.uniform(-1, 1, len(s_grid)), k=3) for i in range(num_modes)]
+
+        series = {name: (splines(), splines()) for name in ['modB', 'R', 'Z', 'nu', 'K']}
+        profiles = {name: InterpolatedUnivariateSpline(s_grid, np.random.uniform(-1, 1, len(s_grid)), k=3)
+                    for name in ['psip', 'G', 'I', 'iota']}
+        field = BoozerRadialSplineField(1.5, xm, xn, radial_power, **series, **profiles)
+
+        npoints = 20
+        points = np.zeros((npoints, 3))
+        points[:, 0] = np.random.uniform(0.05, 1., npoints)
+        points[:, 1] = np.random.uniform(0, 2*np.pi, npoints)
+        points[:, 2] = np.random.uniform(0, 2*np.pi, npoints)
+        field.set_points(points)
+        s = points[:, 0]
+        angles = xm[:, None]*points[None, :, 1] - xn[:, None]*points[None, :, 2]
+
+        for name, (cos_splines, sin_splines) in series.items():
+            a = np.array([spl(s) for spl in cos_splines])*s[None, :]**radial_power[:, None]
+            b = np.array([spl(s) for spl in sin_splines])*s[None, :]**radial_power[:, None]
+            f = np.sum(a*np.cos(angles) + b*np.sin(angles), axis=0)
+            dfdtheta = np.sum(xm[:, None]*(-a*np.sin(angles) + b*np.cos(angles)), axis=0)
+            dfdzeta = np.sum(xn[:, None]*(a*np.sin(angles) - b*np.cos(angles)), axis=0)
+            assert np.allclose(getattr(field, name)()[:, 0], f, rtol=1e-12, atol=1e-12)
+            assert np.allclose(getattr(field, 'd'+name+'dtheta')()[:, 0], dfdtheta, rtol=1e-12, atol=1e-12)
+            assert np.allclose(getattr(field, 'd'+name+'dzeta')()[:, 0], dfdzeta, rtol=1e-12, atol=1e-12)
+        modB = np.sum(xm[:, None]**2*np.array([spl(s) for spl in series['modB'][0]])*s[None, :]**radial_power[:, None]*np.cos(angles)
+                      + xm[:, None]**2*np.array([spl(s) for spl in series['modB'][1]])*s[None, :]**radial_power[:, None]*np.sin(angles), axis=0)
+        assert np.allclose(field.d2modBdtheta2()[:, 0], -modB, rtol=1e-12, atol=1e-12)
+        for name, spline in profiles.items():
+            assert np.allclose(getattr(field, name)()[:, 0], spline(s), rtol=1e-12, atol=1e-12)
+        assert np.allclose(field.diotads()[:, 0], profiles['iota'].derivative()(s), rtol=1e-12, atol=1e-12)
+
+        # s derivatives
+        derivs = [field.dmodBds().copy(), field.dRds().copy(), field.dZds().copy(), field.dnuds().copy(), field.dGds().copy(), field.dIds().copy()]
+        eps = 1e-5
+        points_eps = points.copy()
+        points_eps[:, 0] += eps
+        field.set_points(points_eps)
+        values_plus = [field.modB().copy(), field.R().copy(), field.Z().copy(), field.nu().copy(), field.G().copy(), field.I().copy()]
+        points_eps[:, 0] -= 2*eps
+        field.set_points(points_eps)
+        values_minus = [field.modB(), field.R(), field.Z(), field.nu(), field.G(), field.I()]
+        for val_plus, val_minus, deriv in zip(values_plus, values_minus, derivs):
+            assert np.allclose((val_plus - val_minus)/(2*eps), deriv, rtol=1e-6, atol=1e-6)
+
+        # the derivative groups agree with the single quantities
+        field.set_points(points)
+        assert np.allclose(field.modB_derivs(), np.concatenate([field.dmodBds(), field.dmodBdtheta(), field.dmodBdzeta()], axis=1))
+        assert np.allclose(field.K_derivs(), np.concatenate([field.dKdtheta(), field.dKdzeta()], axis=1))
+        assert np.allclose(field.R_derivs(), np.concatenate([field.dRds(), field.dRdtheta(), field.dRdzeta()], axis=1))
+
+        # all quantities computed at once agree with the single ones
+        single = [field.quantity_ref(q).copy() for q in range(len(field.quantity_names()))]
+        field.set_points(points)
+        mask = field.quantity_mask(field.quantity_names())
+        assert mask == 2**len(field.quantity_names()) - 1
+        field.compute(mask)
+        for q in range(len(field.quantity_names())):
+            assert np.allclose(field.quantity_ref(q), single[q], rtol=1e-14, atol=1e-14)
+        assert field.quantity_mask(["modB_derivs"]) == field.quantity_mask(["dmodBds", "dmodBdtheta", "dmodBdzeta"])
+        assert field.quantity_mask(["nu_derivs"]) == field.quantity_mask(["dnuds", "dnudtheta", "dnudzeta"])
+        with self.assertRaises(RuntimeError):
+            field.quantity_mask(["B"])
+
+        # missing parts of a series vanish
+        field = BoozerRadialSplineField(1.5, xm, xn, radial_power, series['modB'], series['R'], series['Z'],
+                                        (None, series['nu'][1]), None, **profiles)
+        field.set_points(points)
+        assert np.allclose(field.K(), 0)
+        nu = np.sum(np.array([spl(s) for spl in series['nu'][1]])*s[None, :]**radial_power[:, None]*np.sin(angles), axis=0)
+        assert np.allclose(field.nu()[:, 0], nu, rtol=1e-12, atol=1e-12)
+
+        # s^p with p < 1 is not differentiable on the axis, the s derivatives
+        # stay finite there
+        field = BoozerRadialSplineField(1.5, xm, xn, np.full(num_modes, 0.5), **series, **profiles)
+        points[:, 0] = 0.
+        field.set_points(points)
+        for name in ['modB', 'R', 'Z', 'nu']:
+            assert np.all(np.isfinite(getattr(field, 'd'+name+'ds')()))
+            assert np.all(np.isfinite(getattr(field, name)()))
+
+
 @unittest.skipIf(vmec is None, "vmec python package is not found")
 class TestingVmec(unittest.TestCase):
     def test_boozerradialinterpolant_finite_beta(self):
@@ -459,6 +602,64 @@ class TestingVmec(unittest.TestCase):
                 assert np.allclose(bri.modB_derivs()[:, 1], bri.dmodBdtheta()[:, 0])
                 assert np.allclose(bri.modB_derivs()[:, 2], bri.dmodBdzeta()[:, 0])
 
+    def test_radialsplinefield_from_interpolant(self):
+        """
+        BoozerRadialSplineField agrees with the BoozerRadialInterpolant it is
+        created from.
+        """
+        vmec = Vmec(filename_mhd_lowres)
+        bri = BoozerRadialInterpolant(vmec, 3, mpol=5, ntor=5, rescale=False)
+        field = BoozerRadialSplineField.from_radial_interpolant(bri)
+        np.random.seed(1)
+        npoints = 20
+        points = np.zeros((npoints, 3))
+        points[:, 0] = np.random.uniform(0.1, 0.9, npoints)
+        points[:, 1] = np.random.uniform(0, 2*np.pi, npoints)
+        points[:, 2] = np.random.uniform(0, 2*np.pi, npoints)
+        bri.set_points(points)
+        field.set_points(points)
+        for name in ['modB', 'dmodBdtheta', 'dmodBdzeta', 'R', 'dRdtheta', 'Z', 'dZdzeta', 'nu', 'dnudtheta',
+                     'K', 'dKdtheta', 'dKdzeta', 'psip', 'G', 'I', 'iota']:
+            assert np.allclose(getattr(field, name)(), getattr(bri, name)(), rtol=1e-10, atol=1e-12)
+
+    def test_compute_fused(self):
+        """
+        Quantities requested together with ``compute`` agree with the ones
+        computed one by one, for BoozerRadialInterpolant and
+        InterpolatedBoozerField.
+        """
+        names = ['modB', 'dmodBds', 'dmodBdtheta', 'dmodBdzeta', 'R', 'dRds', 'dRdtheta', 'dRdzeta',
+                 'Z', 'dZds', 'dZdtheta', 'dZdzeta', 'nu', 'dnuds', 'dnudtheta', 'dnudzeta',
+                 'K', 'dKdtheta', 'dKdzeta', 'psip', 'G', 'dGds', 'I', 'dIds', 'iota', 'diotads']
+        np.random.seed(2)
+        npoints = 30
+        points = np.zeros((npoints, 3))
+        points[:, 0] = np.random.uniform(0.1, 0.9, npoints)
+        points[:, 1] = np.random.uniform(0, 2*np.pi, npoints)
+        points[:, 2] = np.random.uniform(0, 2*np.pi, npoints)
+        for filename_vmec in [filename_mhd_lowres, filename_mhd_lasym]:
+            vmec = Vmec(filename_vmec)
+            bri = BoozerRadialInterpolant(vmec, 3, mpol=5, ntor=5, rescale=True)
+            nfp = vmec.wout.nfp
+            stellsym = bri.stellsym
+            fields = [bri]
+            for i in range(2):
+                fields.append(InterpolatedBoozerField(
+                    bri, 3, [0.05, 0.95, 6], [0, np.pi if stellsym else 2*np.pi, 6], [0, 2*np.pi/nfp, 6],
+                    True, nfp=nfp, stellsym=stellsym))
+            bri.set_points(points)
+            single = {name: getattr(bri, name)().copy() for name in names}
+            fields[1].set_points(points)
+            single_interp = {name: getattr(fields[1], name)().copy() for name in names}
+
+            bri.set_points(points)
+            bri.compute(bri.quantity_mask(names))
+            fields[2].set_points(points)
+            fields[2].compute(fields[2].quantity_mask(names))
+            for name in names:
+                assert np.allclose(getattr(bri, name)(), single[name], rtol=1e-12, atol=1e-12)
+                assert np.allclose(getattr(fields[2], name)(), single_interp[name], rtol=1e-12, atol=1e-12)
+
     def test_interpolatedboozerfield_sym(self):
         """
         Here we perform 3D interpolation on a random set of points. Compare
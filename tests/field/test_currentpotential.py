@@ -0,0 +1,97 @@
+import unittest
+
+import numpy as np
+
+from simsopt.field import CurrentPotentialSolver, SurfaceCurrentField, coils_via_symmetries
+from simsopt.geo import SurfaceRZFourier
+
+
+def get_surfaces(nfp=2, stellsym=True):
+    plasma = SurfaceRZFourier(nfp=nfp, mpol=1, ntor=1, quadpoints_phi=np.linspace(0, 1/(2*nfp), 16, endpoint=False),
+                              quadpoints_theta=np.linspace(0, 1, 16, endpoint=False))
+    plasma.set_rc(0, 0, 1.0)
+    plasma.set_rc(1, 0, 0.2)
+    plasma.set_zs(1, 0, 0.25)
+    plasma.set_rc(1, 1, 0.05)
+    plasma.set_zs(1, 1, 0.05)
+    winding = SurfaceRZFourier(nfp=nfp, stellsym=stellsym, mpol=1, ntor=0, quadpoints_phi=np.linspace(0, 1, 64, endpoint=False),
+                               quadpoints_theta=np.linspace(0, 1, 64, endpoint=False))
+    winding.set_rc(0, 0, 1.0)
+    winding.set_rc(1, 0, 0.5)
+    winding.set_zs(1, 0, 0.5)
+    return plasma, winding
+
+
+class CurrentPotentialSolverTests(unittest.TestCase):
+
+    def test_normal_field(self):
+        """
+        The normal field computed from the inductance has to agree with the
+        Biot-Savart law applied to the surface current.
+        """
+        for stellsym in [True, False]:
+            plasma, winding = get_surfaces(stellsym=stellsym)
+            solver = CurrentPotentialSolver(plasma, winding, 3, 3, 1e6)
+            np.random.seed(1)
+            phi = 1e4 * np.random.standard_normal(solver.num_dofs())
+            field = SurfaceCurrentField(winding, solver.K(phi))
+            field.set_points(plasma.gamma().reshape((-1, 3)))
+            unitnormal = plasma.unitnormal()
+            Bn = np.sum(field.B().reshape(unitnormal.shape) * unitnormal, axis=2)
+            assert np.max(np.abs(solver.Bnormal(phi) - Bn)) < 1e-2 * np.max(np.abs(Bn))
+
+    def test_regularization_scan(self):
+        plasma, winding = get_surfaces()
+        target = 1e-2 * np.sin(2*np.pi*plasma.quadpoints_theta)[None, :] * np.ones((len(plasma.quadpoints_phi), 1))
+        solver = CurrentPotentialSolver(plasma, winding, 3, 3, 1e6, Bnormal_target=target)
+        lams = 10.0**np.arange(-18, -9)
+        phis, chi2_B, chi2_K = solver.scan(lams)
+        assert np.all(np.diff(chi2_B) >= -1e-8 * np.max(chi2_B))
+        assert np.all(np.diff(chi2_K) <= 1e-8 * np.max(chi2_K))
+        # the solution is the minimizer of the regularized objective
+        phi = phis[5]
+        lam = lams[5]
+        obj = np.dot(solver.chi2(phi), [1, lam])
+        np.random.seed(1)
+        for _ in range(5):
+            dphi = 1e-2 * np.random.standard_normal(phi.shape) * np.max(np.abs(phi))
+            assert np.dot(solver.chi2(phi + dphi), [1, lam]) > obj
+
+    def test_unregularized(self):
+        """
+        With more basis functions than points on the plasma surface, some
+        combinations of them have no normal field there. Without
+        regularization, these are left out instead of dividing by zero.
+        """
+        plasma, winding = get_surfaces()
+        solver = CurrentPotentialSolver(plasma, winding, 12, 12, 1e6)
+        assert solver.num_dofs() > len(plasma.gamma().reshape((-1, 3)))
+        phi = solver.solve(0.)
+        assert np.all(np.isfinite(phi))
+        assert solver.chi2(phi)[0] < solver.chi2(np.zeros_like(phi))[0]
+
+    def test_cut_coils(self):
+        plasma, winding = get_surfaces()
+        G = 1e6
+        solver = CurrentPotentialSolver(plasma, winding, 3, 3, G)
+        phi = solver.solve(1e-15)
+        ncoils = 3
+        curves, currents = solver.coils(phi, ncoils, 10, 64)
+        assert len(curves) == ncoils
+        assert np.isclose(sum(c.get_value() for c in currents) * 2 * winding.nfp, G)
+        # the curves follow the contours of the current potential
+        for k, curve in enumerate(curves):
+            dofs = curve.get_dofs()
+            order = 10
+            t = 2*np.pi*curve.quadpoints
+            phi_c = dofs[2*order+3:3*order+4]
+            phi_s = dofs[3*order+4:]
+            angle = dofs[2*order+2]*t + sum(phi_c[m]*np.cos(m*t) for m in range(order+1)) \
+                + sum(phi_s[m-1]*np.sin(m*t) for m in range(1, order+1))
+            p, th = angle/(2*np.pi), t/(2*np.pi)
+            Phi = G*p + sum(phi[j]*np.sin(2*np.pi*(solver.xm[j]*th - winding.nfp*solver.xn[j]*p)) for j in range(len(phi)))
+            assert np.allclose(Phi, G*(k + 0.5)/(2*winding.nfp*ncoils), atol=1e-5*G)
+        coils = coils_via_symmetries(curves, currents, winding.nfp, True)
+        assert len(coils) == 2*winding.nfp*ncoils
+        with self.assertRaises(RuntimeError):
+            CurrentPotentialSolver(plasma, winding, 3, 3, G, net_toroidal_current=1e5).cut_coils(phi, ncoils, 10, 64)
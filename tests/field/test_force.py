@@ -0,0 +1,78 @@
+import unittest
+
+import numpy as np
+
+from simsopt.field import (BiotSavart, Coil, Current, coils_via_symmetries, coil_force_per_unit_length,
+                           coil_net_forces, coil_net_torques, LpCurveForce, regularization_circ,
+                           regularization_rect)
+from simsopt.geo import CurveXYZFourier, create_equally_spaced_curves
+
+
+def get_coils(ncoils=3, nfp=2):
+    base_curves = create_equally_spaced_curves(ncoils, nfp, stellsym=True, R0=1.0, R1=0.5, order=3, numquadpoints=60)
+    np.random.seed(1)
+    for c in base_curves:
+        c.x = c.x + 0.01 * np.random.standard_normal(c.x.shape)
+    base_currents = [Current(1e5 * (1 + 0.1 * i)) for i in range(ncoils)]
+    return coils_via_symmetries(base_curves, base_currents, nfp, True)
+
+
+class CoilForceTests(unittest.TestCase):
+
+    def test_hoop_force(self):
+        """
+        The self force of a circular coil is the hoop force
+        mu0 I^2/(4 pi R) (log(8 R/a) - 3/4) per unit length.
+        """
+        R, a, I = 1.7, 0.03, 1e6
+        curve = CurveXYZFourier(64, 1)
+        curve.set("xc(1)", R)
+        curve.set("ys(1)", R)
+        coil = Coil(curve, Current(I))
+        f = coil_force_per_unit_length([coil], regularization_circ(a))[0]
+        radial = curve.gamma() / R
+        exact = 1e-7 * I**2 / R * (np.log(8 * R / a) - 0.75)
+        assert np.allclose(f, exact * radial, rtol=1e-10, atol=1e-10 * exact)
+        assert np.allclose(coil_net_forces([coil], regularization_circ(a)), 0, atol=1e-10 * exact)
+        # a square cross section has nearly the same regularization as a
+        # circular one of equal area
+        assert abs(regularization_rect(a, a) / regularization_circ(a / np.sqrt(np.pi)) - 1) < 0.05
+
+    def test_mutual_force(self):
+        """
+        The difference to the self force is the force from the Biot-Savart
+        field of the other coils.
+        """
+        coils = get_coils()
+        reg = regularization_circ(0.05)
+        forces = coil_force_per_unit_length(coils, reg)
+        for i in [0, 3]:
+            others = [c for j, c in enumerate(coils) if j != i]
+            bs = BiotSavart(others)
+            bs.set_points(coils[i].curve.gamma())
+            tangent = coils[i].curve.gammadash() / np.linalg.norm(coils[i].curve.gammadash(), axis=1)[:, None]
+            mutual = coils[i].current.get_value() * np.cross(tangent, bs.B())
+            self_force = coil_force_per_unit_length([coils[i]], reg)[0]
+            assert np.allclose(forces[i], self_force + mutual, rtol=1e-10, atol=1e-10 * np.max(np.abs(mutual)))
+        assert coil_net_forces(coils, reg).shape == (len(coils), 3)
+        assert coil_net_torques(coils, reg).shape == (len(coils), 3)
+
+    def test_lp_force_taylor(self):
+        coils = get_coils()
+        for threshold in [0., 1e4]:
+            J = LpCurveForce(coils, regularization_circ(0.05), p=2.5, threshold=threshold)
+            x0 = J.x
+            np.random.seed(2)
+            h = np.random.standard_normal(x0.shape) * np.maximum(np.abs(x0), 1e-2)
+            dJh = J.dJ() @ h
+            err_old = 1e10
+            for i in range(5, 10):
+                eps = 0.5**i
+                J.x = x0 + eps * h
+                Jp = J.J()
+                J.x = x0 - eps * h
+                Jm = J.J()
+                err = abs((Jp - Jm) / (2 * eps) - dJh)
+                assert err < 0.3 * err_old
+                err_old = err
+            J.x = x0
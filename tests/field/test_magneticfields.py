@@ -18,13 +18,15 @@ from simsopt.configs import get_ncsx_data
 from simsopt.field import (BiotSavart, CircularCoil, Coil, Current,
                            DipoleField, Dommaschk, InterpolatedField,
                            MagneticFieldSum, PoloidalField, Reiman,
-                           ScalarPotentialRZMagneticField, ToroidalField,
+                           ScalarPotentialRZMagneticField, SurfaceCurrentField,
+                           ToroidalField,
                            coils_via_symmetries)
 from simsopt.objectives import SquaredFlux
 from simsopt.geo import (CurveHelical, CurveRZFourier, CurveXYZFourier,
                          PermanentMagnetGrid, SurfaceRZFourier,
                          create_equally_spaced_curves)
 from simsopt.solve import relax_and_split
+import simsoptpp as sopp
 from simsoptpp import dipole_field_Bn
 
 TEST_DIR = (Path(__file__).parent / ".." / "test_files").resolve()
@@ -475,6 +477,45 @@ class Testing(unittest.TestCase):
         Bfield_regen = json.loads(field_json_str, cls=GSONDecoder)
         self.assertTrue(np.allclose(B, Bfield_regen.B()))
 
+    def test_Dommaschk_native(self):
+        # the native field agrees with the sum over the per mode arrays
+        np.random.seed(0)
+        mn = [[10, 2], [15, 3], [5, 4]]
+        coeffs = [[-2.18, -2.18], [25.8, -25.8], [0.3, 1.2]]
+        Bfield = Dommaschk(mn=mn, coeffs=coeffs)
+        points = np.asarray(17 * [[0.9231, 0.8423, -0.1123]])
+        points += 0.05 * (np.random.rand(*points.shape)-0.5)
+        Bfield.set_points(points)
+        m = np.array(mn)[:, 0]
+        n = np.array(mn)[:, 1]
+        Btor = ToroidalField(1, 1)
+        Btor.set_points(points)
+        B = np.add.reduce(sopp.DommaschkB(m, n, coeffs, points)) + Btor.B()
+        dB = np.add.reduce(sopp.DommaschkdB(m, n, coeffs, points)) + Btor.dB_by_dX()
+        assert np.allclose(Bfield.B(), B, rtol=1e-12, atol=1e-12)
+        assert np.allclose(Bfield.dB_by_dX(), dB, rtol=1e-12, atol=1e-10)
+        # B and grad B are stored together, in either order
+        Bfield.set_points(points)
+        assert np.allclose(Bfield.dB_by_dX(), dB, rtol=1e-12, atol=1e-10)
+        assert np.allclose(Bfield.B(), B, rtol=1e-12, atol=1e-12)
+
+        # modes with logarithmic terms: grad B is symmetric, traceless and
+        # consistent with B
+        Bfield = Dommaschk(mn=[[1, 2], [2, 4], [0, 3]], coeffs=[[0.3, 0.2], [0.5, -1.], [0.1, 0.4]])
+        Bfield.set_points(points)
+        dB = Bfield.dB_by_dX()
+        assert np.allclose(dB, dB.transpose((0, 2, 1)))
+        assert np.allclose(np.trace(dB, axis1=1, axis2=2), 0)
+        h = 1e-6
+        for j in range(3):
+            e = np.zeros((1, 3))
+            e[0, j] = h
+            Bfield.set_points(points + e)
+            Bp = Bfield.B()
+            Bfield.set_points(points - e)
+            Bm = Bfield.B()
+            assert np.allclose((Bp-Bm)/(2*h), dB[:, j, :], atol=1e-7)
+
     def test_DipoleField_single_dipole(self):
         m = np.array([0.5, 0.5, 0.5])
         m_loc = np.array([0.1, -0.1, 1]).reshape(1, 3)
@@ -617,6 +658,22 @@ class Testing(unittest.TestCase):
         assert np.allclose(gradB, transpGradB)
         assert np.allclose(gradB, gradB_simsopt, atol=1e-4) 
 
+    def test_dipole_field_out(self):
+        rng = np.random.default_rng(1)
+        points = rng.standard_normal((13, 3))
+        m_loc = rng.standard_normal((7, 3)) + 3.
+        m = rng.standard_normal((7, 3))
+        for quantity, shape in [('B', (13, 3)), ('A', (13, 3)), ('dB', (13, 3, 3)), ('dA', (13, 3, 3))]:
+            kernel = getattr(sopp, f"dipole_field_{quantity}")
+            expected = kernel(points, m_loc, m)
+            # the output is overwritten, not accumulated, when the buffer is reused
+            out = np.ones(shape)
+            kernel(points, m_loc, m, out=out)
+            kernel(points, m_loc, m, out=out)
+            assert np.array_equal(out, expected)
+            with self.assertRaises(RuntimeError):
+                kernel(points, m_loc, m, out=np.zeros((12, ) + shape[1:]))
+
     def test_pmopt_dipoles(self):
         """
             Test that A * m in the permanent magnet optimizer class
@@ -735,6 +792,123 @@ class Testing(unittest.TestCase):
         Bfield_regen = json.loads(field_json_str, cls=GSONDecoder)
         self.assertTrue(np.allclose(Bfield2.B(), Bfield_regen.B()))
 
+    def test_sum_and_multiply_native(self):
+        # sums and products are evaluated in C++ and mix native and python fields
+        np.random.seed(0)
+        points = np.asarray(17 * [[0.9231, 0.8423, -0.1123]])
+        points += 0.05 * (np.random.rand(*points.shape)-0.5)
+        Bdom = Dommaschk(mn=[[10, 2], [15, 3]], coeffs=[[-2.18, -2.18], [25.8, -25.8]])
+        Brei = Reiman(k=[6, 3], epsilonk=[0.01, 0.02], m0=2)
+        Btor = ToroidalField(1.2, 0.1)
+        Btotal = Bdom + 0.5*Brei + Btor
+        assert isinstance(Btotal, sopp.MagneticFieldSum)
+        Btotal.set_points(points)
+        B = Btotal.B()
+        dB = Btotal.dB_by_dX()
+        for f in [Bdom, Brei, Btor]:
+            f.set_points(points)
+        assert np.allclose(B, Bdom.B() + 0.5*Brei.B() + Btor.B(), rtol=1e-14, atol=1e-14)
+        assert np.allclose(dB, Bdom.dB_by_dX() + 0.5*Brei.dB_by_dX() + Btor.dB_by_dX(), rtol=1e-14, atol=1e-14)
+
+        # changing the scalar clears the cache of the scaled field and of the
+        # sums it is part of
+        assert np.allclose(Btotal.B(), B, rtol=1e-14, atol=1e-14)
+        Bscaled = Btotal.Bfields[0].Bfields[1]
+        Bscaled.scalar = 2.
+        assert Bscaled.scalar == 2.
+        assert np.allclose(Btotal.B(), Bdom.B() + 2*Brei.B() + Btor.B(), rtol=1e-14, atol=1e-14)
+
+        # sums that have been deleted are dropped from the dependents of
+        # their fields
+        Btmp = Brei + Btor
+        Btmp.set_points(points)
+        Btmp.B()
+        del Btmp
+        Brei.set_points(points)
+        Bscaled.scalar = 0.5
+        assert np.allclose(Btotal.B(), B, rtol=1e-14, atol=1e-14)
+
+        # sums of native fields can be interpolated
+        rrange = (1.1, 1.4, 10)
+        phirange = (0, 2*np.pi, 32)
+        zrange = (-0.15, 0.15, 10)
+        Bh = InterpolatedField(Brei + 2*Btor, 4, rrange, phirange, zrange, True)
+        Bh.set_points(points)
+        Brei.set_points(points)
+        Btor.set_points(points)
+        assert np.allclose(Bh.B(), Brei.B() + 2*Btor.B(), atol=1e-3)
+
+    def test_pointset(self):
+        # fields evaluated on a shared PointSet agree with fields that are
+        # given the points as an array
+        np.random.seed(0)
+        points = np.asarray(17 * [[0.9231, 0.8423, -0.1123]])
+        points += 0.05 * (np.random.rand(*points.shape)-0.5)
+        pointset = sopp.PointSet(points)
+        assert len(pointset) == len(points)
+        assert np.array_equal(pointset.get_points_cart(), points)
+        rphiz = pointset.get_points_cyl()
+        assert np.allclose(sopp.PointSet.from_cyl(rphiz).get_points_cart(), points, rtol=0, atol=1e-14)
+        with self.assertRaises(RuntimeError):
+            sopp.PointSet(np.zeros((3, 2)))
+
+        base_curves = create_equally_spaced_curves(2, 2, stellsym=True, R0=1.0, R1=0.5, order=3)
+        coils = coils_via_symmetries(base_curves, [Current(1e5), Current(1e5)], 2, True)
+        bs = BiotSavart(coils)
+        Btor = ToroidalField(1.2, 0.1)
+        bs.set_points(points)
+        Btor.set_points(points)
+        B, dB, A = bs.B(), bs.dB_by_dX(), bs.A()
+        assert np.allclose(bs.get_points_cyl(), rphiz, rtol=1e-15, atol=0)
+        Bsum = B + Btor.B()
+        v = np.random.rand(*points.shape)
+        vjp = bs.B_vjp(v)
+
+        bs.set_points(pointset)
+        assert bs.get_pointset() is pointset
+        assert np.array_equal(bs.get_points_cart(), points)
+        assert np.array_equal(bs.B(), B)
+        assert np.array_equal(bs.dB_by_dX(), dB)
+        assert np.array_equal(bs.A(), A)
+        assert all(np.array_equal(a, b) for a, b in zip(bs.B_vjp(v)(bs), vjp(bs)))
+
+        # the children of a sum share the points of the sum
+        Btotal = bs + Btor
+        Btotal.set_points(points)
+        assert bs.get_pointset() is Btor.get_pointset()
+        assert np.allclose(Btotal.B(), Bsum, rtol=1e-15, atol=0)
+        Btotal.set_points_cyl(rphiz)
+        assert np.allclose(Btotal.B(), Bsum, rtol=1e-13, atol=0)
+
+        # the PointSet that a sum created is refilled when the points change,
+        # but not once it was handed out, also through one of the children
+        old_pointset = Btotal.get_pointset()
+        Btotal.set_points(points[:5])
+        assert np.allclose(old_pointset.get_points_cart(), points, rtol=0, atol=1e-14)
+        assert np.allclose(Btotal.B(), Bsum[:5], rtol=1e-13, atol=0)
+        child_pointset = bs.get_pointset()
+        Btotal.set_points(points)
+        assert np.allclose(child_pointset.get_points_cart(), points[:5], rtol=0, atol=1e-14)
+        assert np.allclose(Btotal.B(), Bsum, rtol=1e-13, atol=0)
+        del old_pointset, child_pointset
+        Btotal.set_points(points)
+        assert bs.get_pointset() is Btor.get_pointset()
+        assert np.allclose(Btotal.B(), Bsum, rtol=1e-13, atol=0)
+        Btotal.set_points(points[:5])
+        assert np.allclose(Btotal.B(), Bsum[:5], rtol=1e-13, atol=0)
+        assert np.allclose(bs.B(), B[:5], rtol=1e-13, atol=0)
+
+        # the kernels accept a PointSet in place of the array of points
+        gammas = [c.curve.gamma() for c in coils]
+        gammadashs = [c.curve.gammadash() for c in coils]
+        B1 = [np.zeros((len(points), 3)) for _ in coils]
+        B2 = [np.zeros((len(points), 3)) for _ in coils]
+        sopp.biot_savart(points, gammas, gammadashs, B1, [], [])
+        sopp.biot_savart(pointset, gammas, gammadashs, B2, [], [])
+        assert all(np.array_equal(a, b) for a, b in zip(B1, B2))
+        sopp.biot_savart(points.tolist(), gammas, gammadashs, B2, [], [])
+        assert all(np.array_equal(a, b) for a, b in zip(B1, B2))
+
     def test_Reiman(self):
         iota0 = 0.15
         iota1 = 0.38
@@ -782,6 +956,28 @@ class Testing(unittest.TestCase):
                         [-2.68700789e-04, 1.70889034e-01, 6.77592533e-06]])
         assert np.allclose(dB1, dB2)
 
+    def test_Reiman_native(self):
+        # the native field agrees with the pointwise formulas for several
+        # modes and toroidal symmetries
+        np.random.seed(0)
+        iota0 = 0.15
+        iota1 = 0.38
+        k = [6, 3, 1]
+        epsilonk = [0.01, -0.02, 0.005]
+        points = np.asarray(17 * [[-1.41513202e-03, 8.99999382e-01, -3.14473221e-04]])
+        points += 0.1 * (np.random.rand(*points.shape)-0.5)
+        for m0 in [1, 2, -3]:
+            Bfield = Reiman(iota0=iota0, iota1=iota1, k=k, epsilonk=epsilonk, m0=m0)
+            Bfield.set_points(points)
+            B = sopp.ReimanB(iota0, iota1, k, epsilonk, m0, points)
+            dB = sopp.ReimandB(iota0, iota1, k, epsilonk, m0, points)
+            assert np.allclose(Bfield.B(), B, rtol=1e-12, atol=1e-12)
+            assert np.allclose(Bfield.dB_by_dX(), dB, rtol=1e-12, atol=1e-12)
+            # B and grad B are stored together, in either order
+            Bfield.set_points(points)
+            assert np.allclose(Bfield.dB_by_dX(), dB, rtol=1e-12, atol=1e-12)
+            assert np.allclose(Bfield.B(), B, rtol=1e-12, atol=1e-12)
+
     def subtest_reiman_dBdX_taylortest(self, idx):
         iota0 = 0.15
         iota1 = 0.38
@@ -810,6 +1006,78 @@ class Testing(unittest.TestCase):
             with self.subTest(idx=idx):
                 self.subtest_reiman_dBdX_taylortest(idx)
 
+    def test_surface_current_field(self):
+        s = SurfaceRZFourier(nfp=2, mpol=1, ntor=1, quadpoints_phi=np.linspace(0, 1, 40, endpoint=False),
+                             quadpoints_theta=np.linspace(0, 1, 24, endpoint=False))
+        s.set_rc(0, 0, 1.0)
+        s.set_rc(1, 0, 0.3)
+        s.set_zs(1, 0, 0.3)
+        s.set_rc(1, 1, 0.05)
+        gamma = s.gamma()
+        phi, theta = np.meshgrid(2*np.pi*s.quadpoints_phi, 2*np.pi*s.quadpoints_theta, indexing='ij')
+        K = np.stack([np.sin(theta + phi), np.cos(2*theta), 1 + 0.5*np.sin(phi - theta)], axis=2)
+
+        np.random.seed(1)
+        N = 20
+        R = np.random.uniform(1.5, 2.0, size=N)
+        phis = np.random.uniform(0, 2*np.pi, size=N)
+        points = np.stack([R*np.cos(phis), R*np.sin(phis), np.random.uniform(-0.5, 0.5, size=N)], axis=1)
+        # a target on the surface
+        points[0] = gamma[3, 5]
+
+        field = SurfaceCurrentField(s, K)
+        field.set_points(points)
+        B = field.B()
+        dB = field.dB_by_dX()
+
+        dA = np.linalg.norm(s.normal(), axis=2)/gamma[:, :, 0].size
+        y = gamma.reshape((-1, 3))
+        KdA = (K*dA[:, :, None]).reshape((-1, 3))
+        B_ref = np.zeros_like(points)
+        for i in range(N):
+            d = points[i] - y
+            r = np.linalg.norm(d, axis=1)
+            far = r > 1e-12
+            B_ref[i] = 1e-7 * np.sum(np.cross(KdA[far], d[far])/r[far, None]**3, axis=0)
+        assert np.allclose(B, B_ref, rtol=1e-13, atol=1e-13*np.max(np.abs(B_ref)))
+
+        for direction in np.eye(3):
+            err = 1e6
+            for i in range(5, 10):
+                eps = 0.5**i
+                field.set_points(points[1:] + eps * direction)
+                Bp = field.B()
+                field.set_points(points[1:] - eps * direction)
+                Bm = field.B()
+                new_err = np.linalg.norm((Bp-Bm)/(2*eps) - dB[1:].transpose((0, 2, 1)).dot(direction))
+                assert new_err < 0.3 * err
+                err = new_err
+
+        # the multipole approximation of distant patches
+        field_tree = SurfaceCurrentField(s, K, theta=0.3)
+        field_tree.set_points(points)
+        assert np.max(np.abs(field_tree.B() - B)) < 1e-2 * np.max(np.abs(B))
+        assert np.max(np.abs(field_tree.dB_by_dX() - dB)) < 1e-2 * np.max(np.abs(dB))
+
+        field_json_str = json.dumps(SIMSON(field), cls=GSONEncoder)
+        field_regen = json.loads(field_json_str, cls=GSONDecoder)
+        self.assertTrue(np.allclose(B, field_regen.B()))
+
+        # B and dB computed together agree with B computed on its own
+        field.set_points(points)
+        assert np.allclose(field.dB_by_dX(), dB, rtol=1e-13, atol=0)
+        assert np.allclose(field.B(), B, rtol=1e-13, atol=0)
+
+        # the sources are kept until the surface or K change
+        s.set_rc(0, 0, 1.1)
+        field_moved = SurfaceCurrentField(s, K)
+        field_moved.set_points(points)
+        assert np.allclose(field.B(), field_moved.B(), rtol=1e-13, atol=0)
+        assert not np.allclose(field.B(), B)
+        s.set_rc(0, 0, 1.0)
+        field.set_K(2*K)
+        assert np.allclose(field.B(), 2*B, rtol=1e-13, atol=0)
+
     def test_interpolated_field_close_with_symmetries(self):
         R0test = 1.5
         B0test = 0.8
@@ -0,0 +1,111 @@
+import unittest
+
+import numpy as np
+try:
+    from mpi4py import MPI
+    with_mpi = True
+except ImportError:
+    with_mpi = False
+
+from simsopt.field.coil import coils_via_symmetries
+from simsopt.field.biotsavart import BiotSavart
+from simsopt.field.magneticfieldclasses import InterpolatedField
+from simsopt.configs.zoo import get_ncsx_data
+
+
+class MPIMagneticFieldTests(unittest.TestCase):
+
+    @unittest.skipIf(not with_mpi, "mpi not found")
+    def test_mpi_interpolated_field_distributed(self):
+        comm = MPI.COMM_WORLD
+        curves, currents, ma = get_ncsx_data()
+        nfp = 3
+        coils = coils_via_symmetries(curves, currents, nfp, True)
+        bs = BiotSavart(coils)
+        rrange = [1.5, 1.7, 4]
+        phirange = [0, 2*np.pi/nfp, 8]
+        zrange = [0., 0.1, 2]
+        N = 100
+        # all ranks have to pass the same points
+        np.random.seed(1)
+        points = np.random.uniform(size=(N, 3))
+        points[:, 0] = points[:, 0]*(rrange[1]-rrange[0]) + rrange[0]
+        points[:, 1] = points[:, 1]*2*np.pi
+        points[:, 2] = points[:, 2]*0.2 - 0.1
+        points = comm.bcast(points, root=0)
+        bs.set_points_cyl(points)
+        B = bs.B()
+        dB = bs.dB_by_dX()
+        xyz = bs.get_points_cart()
+
+        bsh_serial = InterpolatedField(bs, 2, rrange, phirange, zrange, True, nfp=nfp, stellsym=True)
+        bsh_serial.set_points_cyl(points)
+        Bh_serial = bsh_serial.B()
+        dBh_serial = bsh_serial.GradAbsB()
+
+        for c in [comm, None]:
+            assert np.allclose(bs.evaluate_distributed(xyz, comm=c), B)
+            assert np.allclose(bs.evaluate_distributed(xyz, comm=c, quantity="dB_by_dX"), dB)
+            # the points of the field are restored
+            assert np.allclose(bs.get_points_cart(), xyz)
+
+            # the interpolant that is built on first use is the same
+            bsh = InterpolatedField(bs, 2, rrange, phirange, zrange, True, nfp=nfp, stellsym=True)
+            bsh.build_interpolants(comm=c)
+            bsh.set_points_cyl(points)
+            assert np.allclose(bsh.B(), Bh_serial, rtol=1e-13, atol=1e-13)
+            assert np.allclose(bsh.GradAbsB(), dBh_serial, rtol=1e-13, atol=1e-13)
+            # with mpi, the tables are stored in shared memory, and building
+            # the interpolants again releases them
+            if c is not None:
+                table = bsh._shared_tables["B"][0]
+                assert table.shape == (bsh.num_cells(), bsh.cell_table_size())
+                bsh.build_interpolants(comm=None)
+                assert bsh._shared_tables == {}
+                bsh.set_points_cyl(points)
+                assert np.allclose(bsh.B(), Bh_serial, rtol=1e-13, atol=1e-13)
+
+        with self.assertRaises(ValueError):
+            bsh.build_interpolants(quantities=("A", ))
+
+    def test_interpolated_field_external_table(self):
+        # the tables of the cells filled in two parts into an array that the
+        # interpolant uses without copying it
+        curves, currents, ma = get_ncsx_data()
+        coils = coils_via_symmetries(curves, currents, 3, True)
+        bs = BiotSavart(coils)
+        rrange = [1.5, 1.7, 4]
+        phirange = [0, 2*np.pi/3, 8]
+        zrange = [0., 0.1, 2]
+        np.random.seed(1)
+        points = np.random.uniform(size=(50, 3))
+        points[:, 0] = points[:, 0]*(rrange[1]-rrange[0]) + rrange[0]
+        points[:, 1] = points[:, 1]*2*np.pi
+        points[:, 2] = points[:, 2]*0.2 - 0.1
+        bsh_serial = InterpolatedField(bs, 2, rrange, phirange, zrange, True, nfp=3, stellsym=True)
+        bsh_serial.set_points_cyl(points)
+
+        bsh = InterpolatedField(bs, 2, rrange, phirange, zrange, True, nfp=3, stellsym=True)
+        values = np.zeros((bsh.num_dofs(), 3))
+        bsh.evaluate_dofs_B(0, bsh.num_dofs(), values)
+        ncells = bsh.num_cells()
+        # the simd kernels need the table to be aligned, as is the memory of
+        # an mpi window
+        size = ncells*bsh.cell_table_size()
+        buf = np.zeros(size + 8)
+        offset = (-buf.ctypes.data % 64)//8
+        table = buf[offset:offset+size].reshape((ncells, bsh.cell_table_size()))
+        bsh.fill_table_B(values, 0, ncells//2, table[:ncells//2])
+        bsh.fill_table_B(values, ncells//2, ncells, table[ncells//2:])
+        bsh.set_table_B(table)
+        bsh.set_points_cyl(points)
+        assert np.allclose(bsh.B(), bsh_serial.B(), rtol=1e-13, atol=1e-13)
+
+        with self.assertRaises(RuntimeError):
+            bsh.fill_table_B(values, 0, ncells+1, np.zeros((ncells+1, bsh.cell_table_size())))
+        with self.assertRaises(RuntimeError):
+            bsh.set_table_GradAbsB(table[1:])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,53 @@
+import json
+import os
+import tempfile
+import unittest
+
+import numpy as np
+
+import simsoptpp as sopp
+from simsopt.field import BiotSavart, Current, coils_via_symmetries
+from simsopt.geo import create_equally_spaced_curves
+
+
+class PerfTests(unittest.TestCase):
+
+    def test_report(self):
+        base_curves = create_equally_spaced_curves(2, 2, stellsym=True, R0=1.0, R1=0.5, order=3, numquadpoints=40)
+        coils = coils_via_symmetries(base_curves, [Current(1e5), Current(1e5)], 2, True)
+        bs = BiotSavart(coils)
+        points = np.random.default_rng(1).standard_normal((17, 3))
+
+        sopp.perf_reset()
+        bs.set_points(points)
+        bs.B()
+        bs.B()
+        report = sopp.perf_report()
+        assert set(report.keys()) == {'kernels', 'counters'}
+        if not sopp.perf_enabled():
+            assert report['kernels'] == {} and report['counters'] == {}
+            with self.assertRaises(RuntimeError):
+                sopp.perf_set_tracing(True)
+            return
+
+        stats = report['kernels']['BiotSavart::compute_B']
+        assert stats['calls'] == 1
+        assert stats['points'] == len(points)
+        assert stats['pairs'] == len(points) * sum(len(c.curve.quadpoints) for c in coils)
+        assert stats['time'] > 0
+        assert report['counters']['field_cache_hits'] >= 1
+        assert report['counters']['curve_cache_misses'] >= len(base_curves)
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            filename = os.path.join(tmpdir, 'trace.json')
+            sopp.perf_set_tracing(True)
+            bs.set_points(points)
+            bs.dB_by_dX()
+            sopp.perf_set_tracing(False)
+            sopp.perf_write_chrome_trace(filename)
+            with open(filename) as f:
+                events = json.load(f)['traceEvents']
+            assert any(e['name'] == 'BiotSavart::compute_dB' for e in events)
+
+        sopp.perf_reset()
+        assert sopp.perf_report()['kernels'] == {}
@@ -454,6 +454,68 @@ class Testing(unittest.TestCase):
         rc.gamma_impl(tmp, quadpoints[:10])
         assert np.allclose(cg[:10, :]@mat, tmp)
 
+    def test_fourier_curve_vjp_jvp(self):
+        # the vjps/jvps of the Fourier curves are computed from a shared basis
+        # table, compare them to contractions with the dense jacobians.
+        np.random.seed(1)
+        curves = [get_curve("CurveXYZFourier", False, x=30),
+                  get_curve("CurveRZFourier", False, x=30),
+                  CurveRZFourier(30, 3, 2, False)]
+        curves[2].x = np.random.standard_normal(size=curves[2].x.shape)
+        for curve in curves:
+            v = np.random.standard_normal(size=(curve.quadpoints.size, 3))
+            w = np.random.standard_normal(size=curve.x.shape)
+            derivs = [
+                (curve.dgamma_by_dcoeff(), curve.dgamma_by_dcoeff_vjp_impl, curve.dgamma_by_dcoeff_jvp_impl),
+                (curve.dgammadash_by_dcoeff(), curve.dgammadash_by_dcoeff_vjp_impl, curve.dgammadash_by_dcoeff_jvp_impl),
+                (curve.dgammadashdash_by_dcoeff(), curve.dgammadashdash_by_dcoeff_vjp_impl, curve.dgammadashdash_by_dcoeff_jvp_impl),
+                (curve.dgammadashdashdash_by_dcoeff(), curve.dgammadashdashdash_by_dcoeff_vjp_impl, curve.dgammadashdashdash_by_dcoeff_jvp_impl),
+            ]
+            for dense, vjp, jvp in derivs:
+                assert np.allclose(vjp(v), np.einsum('ij,ijk->k', v, dense))
+                assert np.allclose(jvp(w), dense @ w)
+                with self.assertRaises(RuntimeError):
+                    jvp(w[:-1])
+                with self.assertRaises(RuntimeError):
+                    vjp(v[:-1])
+            # gamma and its derivatives are linear in the dofs
+            for dense, g in zip([d[0] for d in derivs], [curve.gamma(), curve.gammadash(), curve.gammadashdash(), curve.gammadashdashdash()]):
+                assert np.allclose(g, dense @ curve.x)
+
+    def test_curve_collection(self):
+        from simsopt.geo.curvecollection import CurveCollection
+        from simsoptpp import biot_savart_B
+        np.random.seed(1)
+        curves = [CurveXYZFourier(40, 4) for _ in range(5)]
+        for curve in curves:
+            curve.x = np.random.standard_normal(size=curve.x.shape)
+        collection = CurveCollection(curves)
+        blocks = [collection.gamma(), collection.gammadash(), collection.gammadashdash(), collection.gammadashdashdash()]
+        for c, curve in enumerate(curves):
+            for block, g in zip(blocks, [curve.gamma(), curve.gammadash(), curve.gammadashdash(), curve.gammadashdashdash()]):
+                assert np.allclose(block[c], g)
+
+        # the blocks are recomputed when the dofs of one of the curves change
+        curves[2].x = curves[2].x + 0.1
+        assert np.allclose(collection.gamma()[2], curves[2].gamma())
+
+        # the vjp agrees with the vjps of the individual curves
+        v = np.random.standard_normal(size=(5, 40, 3))
+        vd = np.random.standard_normal(size=(5, 40, 3))
+        res = collection.dgamma_and_dgammadash_by_dcoeff_vjp(v, vd)
+        for c, curve in enumerate(curves):
+            assert np.allclose(res(curve), curve.dgamma_by_dcoeff_vjp_impl(v[c]) + curve.dgammadash_by_dcoeff_vjp_impl(vd[c]))
+
+        # the views of the blocks can be passed to Biot-Savart directly
+        points = np.random.standard_normal(size=(10, 3))
+        currents = list(np.random.standard_normal(size=(5, )))
+        B = biot_savart_B(points, collection.gammas(), collection.gammadashs(), currents)
+        Btrue = biot_savart_B(points, [c.gamma() for c in curves], [c.gammadash() for c in curves], currents)
+        assert np.allclose(B, Btrue)
+
+        with self.assertRaises(RuntimeError):
+            CurveCollection([CurveXYZFourier(40, 4), CurveXYZFourier(40, 3)])
+
     def subtest_serialization(self, curvetype, rotated):
         epss = [0.5**i for i in range(10, 15)]
         x = np.asarray([0.6] + [0.6 + eps for eps in epss])
@@ -390,6 +390,98 @@ class Testing(unittest.TestCase):
         self.assertAlmostEqual(fullArray, 0)
         self.assertAlmostEqual(fullArray2, 1)
 
+    def test_quadrature_weights(self):
+        # the objectives integrate with the quadrature weights of the curves,
+        # so a curve with adaptive quadrature points gives the same values as
+        # one with many uniformly spaced points.
+        from simsopt.geo.curve import adaptive_quadrature
+        from simsopt.field import Current, Coil, coil_force_per_unit_length, regularization_circ
+
+        def curve_with_quadpoints(quadpoints):
+            curve = CurveXYZFourier(quadpoints, 4)
+            curve.set('xc(1)', 1.)
+            curve.set('ys(1)', 1.)
+            curve.set('xc(2)', 0.3)
+            curve.set('zs(2)', 0.2)
+            curve.set('yc(3)', 0.1)
+            return curve
+
+        uniform = curve_with_quadpoints(400)
+        quadpoints, quadweights = adaptive_quadrature(uniform, 80)
+        adapted = curve_with_quadpoints(quadpoints)
+        adapted.set_quadweights(quadweights)
+        for objective in [CurveLength, lambda c: LpCurveCurvature(c, 2), lambda c: LpCurveTorsion(c, 2), MeanSquaredCurvature]:
+            assert abs(objective(adapted).J() - objective(uniform).J()) < 1e-6 * abs(objective(uniform).J())
+        # explicitly uniform weights are the same as no weights
+        weighted = curve_with_quadpoints(400)
+        weighted.set_quadweights(np.full(400, 1./400))
+        for objective in [CurveLength, ArclengthVariation, lambda c: CurveCurveDistance([c, c], 0.5)]:
+            assert abs(objective(weighted).J() - objective(uniform).J()) < 1e-12 * abs(objective(uniform).J())
+
+        # the derivatives include the weights
+        J = CurveLength(adapted)
+        x0 = adapted.x
+        h = np.random.standard_normal(size=x0.shape)
+        deriv = np.sum(J.dJ() * h)
+        eps = 1e-6
+        adapted.x = x0 + eps * h
+        Jp = J.J()
+        adapted.x = x0 - eps * h
+        Jm = J.J()
+        adapted.x = x0
+        assert abs((Jp - Jm)/(2*eps) - deriv) < 1e-6 * abs(deriv)
+
+        # a circle that links the curve once
+        circle = CurveXYZFourier(101, 1)
+        circle.set('xc(0)', 1.)
+        circle.set('xc(1)', 0.5)
+        circle.set('zs(1)', 0.5)
+        self.assertAlmostEqual(LinkingNumber([adapted, circle]).J(), 1)
+
+        # the weights are kept when saving and loading the curve
+        adapted_regen = json.loads(json.dumps(SIMSON(adapted), cls=GSONEncoder), cls=GSONDecoder)
+        assert np.allclose(adapted_regen.quadweights, quadweights)
+        assert abs(CurveLength(adapted_regen).J() - CurveLength(adapted).J()) < 1e-14
+
+        # the coil forces need uniformly spaced quadrature points
+        with self.assertRaises(ValueError):
+            coil_force_per_unit_length([Coil(adapted, Current(1e4))], regularization_circ(0.05))
+
+    def test_gauss_integrals(self):
+        curves = create_equally_spaced_curves(3, 1, stellsym=False, R0=1, R1=0.5, order=5, numquadpoints=97)
+        # a circle along the magnetic axis, which links each of the coils
+        curve = CurveXYZFourier(101, 3)
+        coeffs = curve.dofs_matrix
+        coeffs[0][2] = 1.
+        coeffs[1][1] = 1.
+        coeffs[2][1] = 0.1
+        curve.set_dofs(np.concatenate(coeffs))
+        curves.append(curve)
+        gammas = [c.gamma() for c in curves]
+        gammadashs = [c.gammadash() for c in curves]
+
+        link = sopp.gauss_linking_number_matrix(gammas, gammadashs)
+        link_nobbox = sopp.gauss_linking_number_matrix(gammas, gammadashs, bounding_box_check=False)
+        inductance = sopp.gauss_mutual_inductance_matrix(gammas, gammadashs)
+        for i in range(len(curves)):
+            for j in range(len(curves)):
+                if i == j:
+                    continue
+                n1 = gammas[i].shape[0]
+                n2 = gammas[j].shape[0]
+                link_ref = sopp.linkNumber(gammas[i], gammas[j], gammadashs[i], gammadashs[j])/(4*np.pi*n1*n2)
+                assert abs(link[i, j] - link_ref) < 1e-10
+                assert abs(link_nobbox[i, j] - link_ref) < 1e-10
+                assert abs(sopp.gauss_linking_number(gammas[i], gammadashs[i], gammas[j], gammadashs[j]) - link_ref) < 1e-10
+                diff = gammas[i][:, None, :] - gammas[j][None, :, :]
+                neumann = np.sum(np.sum(gammadashs[i][:, None, :] * gammadashs[j][None, :, :], axis=2)/np.linalg.norm(diff, axis=2))
+                assert abs(inductance[i, j] - 1e-7 * neumann/(n1*n2)) < 1e-10 * abs(inductance[i, j]) + 1e-20
+        # the coils are not linked with each other, but each is linked with the axis
+        assert np.allclose(link[:3, :3], 0, atol=1e-6)
+        assert np.allclose(np.abs(link[3, :3]), 1, atol=1e-6)
+        # a planar curve has no writhe
+        assert abs(sopp.gauss_writhe(gammas[0], gammadashs[0])) < 1e-12
+
 
 if __name__ == "__main__":
     unittest.main()
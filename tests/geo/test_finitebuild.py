@@ -1,10 +1,10 @@
 import unittest
 from .surface_test_helpers import get_surface, get_exact_surface
 from simsopt.field.biotsavart import BiotSavart
-from simsopt.field.coil import Coil, apply_symmetries_to_curves, apply_symmetries_to_currents
+from simsopt.field.coil import Coil, MultifilamentCoil, Current, apply_symmetries_to_curves, apply_symmetries_to_currents
 from simsopt.geo.curveobjectives import CurveLength, CurveCurveDistance
 from simsopt.geo.finitebuild import CurveFilament, FilamentRotation, \
-    create_multifilament_grid, ZeroRotation
+    create_multifilament_grid, create_multifilament_curve, ZeroRotation
 from simsopt.geo.qfmsurface import QfmSurface
 from simsopt.objectives.fluxobjective import SquaredFlux
 from simsopt.objectives.utilities import QuadraticPenalty
@@ -144,6 +144,76 @@ class MultifilamentTesting(unittest.TestCase):
         fils[0].rotation.x = xr + 1e-2*np.random.standard_normal(size=xr.shape)
         check(fils, c, numfilaments_n, numfilaments_b)
 
+    def test_multifilament_curve(self):
+        """
+        Check that the filaments of CurveMultifilament agree with the ones of
+        CurveFilament, that a MultifilamentCoil produces the same field as
+        the individual filaments, and that the derivatives with respect to
+        the centre line and the rotation are correct.
+        """
+        curves, currents, ma = get_ncsx_data(Nt_coils=6, ppp=20)
+        c = curves[0]
+        nn, nb = 2, 3
+        fils = create_multifilament_grid(c, nn, nb, 0.01, 0.02, rotation_order=1)
+        fils[0].rotation.x = np.array([0.1, 0.2, -0.3])
+        block = create_multifilament_curve(c, nn, nb, 0.01, 0.02, rotation_order=1)
+        block.rotation.x = fils[0].rotation.x
+        n = c.quadpoints.size
+        for k, fil in enumerate(fils):
+            assert np.allclose(block.filaments_gamma()[k], fil.gamma(), atol=1e-14)
+            assert np.allclose(block.gammadash()[k*n:(k+1)*n], fil.gammadash())
+
+        current = Current(1e5)
+        bs_fils = BiotSavart([Coil(fil, current/len(fils)) for fil in fils])
+        bs_block = BiotSavart([MultifilamentCoil(block, current)])
+        points = ma.gamma()
+        bs_fils.set_points(points)
+        bs_block.set_points(points)
+        assert np.allclose(bs_block.B(), bs_fils.B())
+        assert np.allclose(bs_block.dB_by_dX(), bs_fils.dB_by_dX())
+
+        np.random.seed(1)
+        v = np.random.standard_normal(size=points.shape)
+        dJ_fils = bs_fils.B_vjp(v)
+        dJ_block = bs_block.B_vjp(v)
+        for opt in [c, block.rotation, current]:
+            assert np.allclose(dJ_block(opt), dJ_fils(opt))
+
+        # filaments with different currents, the tangents stay those of the
+        # filaments and the weights are applied in Biot-Savart
+        weights = np.linspace(1., 2., len(fils))
+        weights /= np.sum(weights)
+        block_weighted = create_multifilament_curve(c, nn, nb, 0.01, 0.02, rotation_order=1, weights=weights)
+        block_weighted.rotation.x = fils[0].rotation.x
+        assert np.allclose(block_weighted.gammadash(), block.gammadash())
+        bs_fils_weighted = BiotSavart([Coil(fil, w*current) for fil, w in zip(fils, weights)])
+        bs_block_weighted = BiotSavart([MultifilamentCoil(block_weighted, current)])
+        bs_fils_weighted.set_points(points)
+        bs_block_weighted.set_points(points)
+        assert np.allclose(bs_block_weighted.B(), bs_fils_weighted.B())
+        assert np.allclose(bs_block_weighted.dB_by_dX(), bs_fils_weighted.dB_by_dX())
+        dJ_fils = bs_fils_weighted.B_vjp(v)
+        dJ_block = bs_block_weighted.B_vjp(v)
+        for opt in [c, block_weighted.rotation, current]:
+            assert np.allclose(dJ_block(opt), dJ_fils(opt))
+
+        # taylor test of the vjps through the frame
+        dofs = block.x
+        vg = np.random.standard_normal(size=block.gamma().shape)
+        vgd = np.random.standard_normal(size=block.gamma().shape)
+        h = np.random.standard_normal(size=dofs.shape)
+        df = np.sum(block.dgamma_and_dgammadash_by_dcoeff_vjp(vg, vgd)(block)*h)
+        err_old = 1e10
+        for i in range(10, 15):
+            eps = 0.5**i
+            block.x = dofs + eps*h
+            f1 = np.sum(block.gamma()*vg) + np.sum(block.gammadash()*vgd)
+            block.x = dofs - eps*h
+            f2 = np.sum(block.gamma()*vg) + np.sum(block.gammadash()*vgd)
+            err = abs((f1-f2)/(2*eps) - df)
+            assert err < 0.3 * err_old
+            err_old = err
+
     def test_biotsavart_with_symmetries(self):
         """
         More involved test that checks whether the multifilament code interacts
@@ -73,3 +73,34 @@ class FluxObjectiveTests(unittest.TestCase):
 
         JF_scaled_summed = Jf + ALPHA * sum(Jls)
         check_taylor_test(JF_scaled_summed)
+
+    def test_flux_surface_derivative(self):
+        s = SurfaceRZFourier.from_vmec_input(filename, range="half period", nphi=16, ntheta=16)
+        base_curves = create_equally_spaced_curves(3, s.nfp, stellsym=s.stellsym, R0=1.0, R1=0.5, order=4)
+        base_currents = [Current(1e5) for i in range(3)]
+        coils = coils_via_symmetries(base_curves, base_currents, s.nfp, s.stellsym)
+        bs = BiotSavart(coils)
+        target = 0.01 * np.ones(s.gamma().shape[0:2])
+
+        for local in [False, True]:
+            Jf = SquaredFlux(s, bs, target, local=local)
+            Bn = np.sum(bs.B().reshape(s.gamma().shape) * s.unitnormal(), axis=2)
+            np.testing.assert_allclose(Jf.BdotN(), Bn, rtol=1e-13, atol=1e-13)
+
+            dofs = s.get_dofs()
+            np.random.seed(1)
+            h = np.random.uniform(size=dofs.shape)
+            J0, dJ0 = Jf.J(), Jf.dJ_by_dsurfacecoefficients()
+            dJh = sum(dJ0 * h)
+            err_old = 1e10
+            for i in range(11, 17):
+                eps = 0.5 ** i
+                s.set_dofs(dofs + eps * h)
+                J1 = Jf.J()
+                s.set_dofs(dofs - eps * h)
+                J2 = Jf.J()
+                err = np.abs((J1 - J2) / (2 * eps) - dJh)
+                assert err < 0.6 ** 2 * err_old
+                err_old = err
+            s.set_dofs(dofs)
+            self.assertAlmostEqual(Jf.J(), J0)